@@ -29,6 +29,7 @@
 namespace mem
 {
 
+class Mmu;
 class Module;
 
 }
@@ -107,6 +108,11 @@ public:
 	/// getNumEntryModules() - 1.
 	virtual mem::Module *getEntryModule(int index);
 
+	/// Return the memory management unit that translates the addresses
+	/// issued by this architecture into the physical addresses seen by the
+	/// memory hierarchy, or `nullptr` if not available.
+	virtual mem::Mmu *getMmu() { return nullptr; }
+
 	/// Dump the statistics summary for the timing simulator.
 	virtual void DumpSummary(std::ostream &os) const { }
 
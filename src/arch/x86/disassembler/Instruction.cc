@@ -486,7 +486,8 @@ void Instruction::Decode(const char *buffer, unsigned eip)
 		{
 
 		case 0xf0:
-			// lock prefix is ignored
+			// lock prefix does not select the instruction
+			prefixes |= PrefixLock;
 			break;
 
 		case 0xf2:
@@ -569,7 +570,7 @@ void Instruction::Decode(const char *buffer, unsigned eip)
 				info->nomatch_result)
 			continue;
 		if ((buf32 & info->match_mask) == info->match_result
-				&& info->prefixes == prefixes)
+				&& info->prefixes == (prefixes & ~PrefixLock))
 			break;
 	}
 
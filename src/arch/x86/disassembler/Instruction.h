@@ -289,6 +289,9 @@ public:
 	/// Return segment register
 	Reg getSegment() const { return segment; }
 
+	/// Return the mask of prefixes of type Prefix
+	int getPrefixes() const { return prefixes; }
+
 	/// Return the base register for the effective address computation
 	Reg getEaBase() const { return ea_base; }
 
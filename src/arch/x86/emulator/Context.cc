@@ -17,7 +17,9 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <cstring>
+#include <mutex>
 #include <fcntl.h>
 #include <poll.h>
 #include <unistd.h>
@@ -59,10 +61,6 @@ const misc::StringMap Context::StateMap =
 };
 
 
-long Context::host_flags;
-unsigned char Context::host_fpenv[28];
-
-
 Context::Context() :
 		comm::Context(Emulator::getInstance()),
 		emulator(Emulator::getInstance())
@@ -355,10 +353,12 @@ void Context::Initialize()
 	// Create new memory image
 	assert(!memory.get());
 	memory = misc::new_shared<mem::Memory>();
+	inst_cache = misc::new_shared<InstructionCache>(memory.get());
 
 	// Creating a new independent context forces the creation of a new
 	// virtual memory space within the context's associated MMU.
 	mmu_space = mmu->newSpace();
+	mmu_space->setMemory(memory);
 
 	// Create signal handler table
 	signal_handler_table = misc::new_shared<SignalHandlerTable>();
@@ -390,11 +390,13 @@ void Context::Load(const std::vector<std::string> &args,
 	// Create new memory image
 	assert(!memory.get());
 	memory = misc::new_shared<mem::Memory>();
+	inst_cache = misc::new_shared<InstructionCache>(memory.get());
 
 	// Loading a context from an executable file creates a new virtual
 	// address space within the context's associated MMU.
 	assert(!mmu_space);
 	mmu_space = mmu->newSpace();
+	mmu_space->setMemory(memory);
 
 	// Create signal handler table
 	signal_handler_table = misc::new_shared<SignalHandlerTable>();
@@ -438,6 +440,7 @@ void Context::Clone(Context *parent)
 	// structure must be only freed by the parent when all its children have
 	// been killed. The set of signal handlers is the same, too.
 	memory = parent->memory;
+	inst_cache = parent->inst_cache;
 
 	// Cloning a context makes the new context share the same virtual memory
 	// address space as the parent in the parent's associated MMU.
@@ -471,11 +474,13 @@ void Context::Fork(Context *parent)
 	// Memory
 	memory = misc::new_shared<mem::Memory>();
 	memory->Clone(*parent->memory);
+	inst_cache = misc::new_shared<InstructionCache>(memory.get());
 	
 	// Forking a context creates a new virtual memory space in the parent
 	// context's associated MMU.
 	assert(!mmu_space);
 	mmu_space = mmu->newSpace();
+	mmu_space->setMemory(memory);
 	
 	// Create speculative memory, linked with the real memory
 	spec_mem = misc::new_unique<mem::SpecMem>(memory.get());
@@ -760,37 +765,59 @@ void Context::Execute()
 	else
 		memory->setSafeDefault();
 
-	// Read instruction from memory. Memory should be accessed here in unsafe mode
-	// (i.e., allowing segmentation faults) if executing speculatively.
-	char buffer[20];
-	unsigned char *buffer_ptr = (unsigned char *)memory->getBuffer(
-			regs.getEip(), 20, mem::Memory::AccessExec);
-	if (!buffer_ptr)
+	// Instructions executed before are taken from the instruction cache
+	ExecuteInstFn fn = nullptr;
+	const InstructionCache::Entry *entry = inst_cache->Lookup(
+			regs.getEip());
+	if (entry)
 	{
-		// Disable safe mode. If a part of the 20 read bytes does not
-		// belong to the actual instruction, and they lie on a page with
-		// no permissions, this would generate an undesired protection
-		// fault.
-		memory->setSafe(false);
-		buffer_ptr = (unsigned char *)buffer;
-		memory->Access(regs.getEip(), 20, (char *)buffer_ptr,
-				mem::Memory::AccessExec);
+		inst = entry->inst;
+		fn = entry->fn;
 	}
+	else
+	{
+		// Read instruction from memory. Memory should be accessed here
+		// in unsafe mode (i.e., allowing segmentation faults) if
+		// executing speculatively.
+		char buffer[20];
+		unsigned char *buffer_ptr = (unsigned char *)memory->getBuffer(
+				regs.getEip(), 20, mem::Memory::AccessExec);
+		if (!buffer_ptr)
+		{
+			// Disable safe mode. If a part of the 20 read bytes
+			// does not belong to the actual instruction, and they
+			// lie on a page with no permissions, this would
+			// generate an undesired protection fault.
+			memory->setSafe(false);
+			buffer_ptr = (unsigned char *)buffer;
+			memory->Access(regs.getEip(), 20, (char *)buffer_ptr,
+					mem::Memory::AccessExec);
+		}
 
-	// Return to default safe mode
-	memory->setSafeDefault();
+		// Disassemble
+		inst.Decode((char *)buffer_ptr, regs.getEip());
+		if (inst.getOpcode() == Instruction::OpcodeInvalid && !spec_mode)
+		{
+			inst.Dump(std::cout);
+			throw Error(misc::fmt("Unsupported instruction "
+					"(%02x %02x %02x %02x...)\n",
+					buffer_ptr[0], buffer_ptr[1],
+					buffer_ptr[2], buffer_ptr[3]));
+		}
 
-	// Disassemble
-	inst.Decode((char *)buffer_ptr, regs.getEip());
-	if (inst.getOpcode() == Instruction::OpcodeInvalid && !spec_mode)
-	{
-		inst.Dump(std::cout);
-		throw Error(misc::fmt("Unsupported instruction "
-				"(%02x %02x %02x %02x...)\n",
-				buffer_ptr[0], buffer_ptr[1],
-				buffer_ptr[2], buffer_ptr[3]));
+		// Cache valid instructions fetched outside of speculative
+		// mode
+		if (inst.getOpcode())
+		{
+			fn = execute_inst_fn[inst.getOpcode()];
+			if (!spec_mode)
+				inst_cache->Insert(inst, fn);
+		}
 	}
 
+	// Return to default safe mode
+	memory->setSafeDefault();
+
 	// Clear existing list of microinstructions, though the architectural
 	// simulator might have cleared it already. A new list will be generated
 	// for the next executed x86 instruction.
@@ -820,7 +847,6 @@ void Context::Execute()
 	{
 		try
 		{
-			ExecuteInstFn fn = execute_inst_fn[inst.getOpcode()];
 			(this->*fn)();
 		}
 		catch (mem::Memory::Error &e)
@@ -863,6 +889,322 @@ void Context::Execute()
 }
 
 
+// Return whether an instruction ends a basic block. These are the
+// instructions transferring control, including software interrupts used for
+// system calls, which can change the state of the context.
+static bool isBlockEnd(Instruction::Opcode opcode)
+{
+	switch (opcode)
+	{
+
+	case Instruction::Opcode_call_rel32:
+	case Instruction::Opcode_call_rm32:
+	case Instruction::Opcode_hlt:
+	case Instruction::Opcode_int_3:
+	case Instruction::Opcode_int_imm8:
+	case Instruction::Opcode_into:
+	case Instruction::Opcode_ja_rel8:
+	case Instruction::Opcode_jae_rel8:
+	case Instruction::Opcode_jb_rel8:
+	case Instruction::Opcode_jbe_rel8:
+	case Instruction::Opcode_je_rel8:
+	case Instruction::Opcode_jcxz_rel8:
+	case Instruction::Opcode_jecxz_rel8:
+	case Instruction::Opcode_jg_rel8:
+	case Instruction::Opcode_jge_rel8:
+	case Instruction::Opcode_jl_rel8:
+	case Instruction::Opcode_jle_rel8:
+	case Instruction::Opcode_jne_rel8:
+	case Instruction::Opcode_jno_rel8:
+	case Instruction::Opcode_jnp_rel8:
+	case Instruction::Opcode_jns_rel8:
+	case Instruction::Opcode_jo_rel8:
+	case Instruction::Opcode_jp_rel8:
+	case Instruction::Opcode_js_rel8:
+	case Instruction::Opcode_ja_rel32:
+	case Instruction::Opcode_jae_rel32:
+	case Instruction::Opcode_jb_rel32:
+	case Instruction::Opcode_jbe_rel32:
+	case Instruction::Opcode_je_rel32:
+	case Instruction::Opcode_jg_rel32:
+	case Instruction::Opcode_jge_rel32:
+	case Instruction::Opcode_jl_rel32:
+	case Instruction::Opcode_jle_rel32:
+	case Instruction::Opcode_jne_rel32:
+	case Instruction::Opcode_jno_rel32:
+	case Instruction::Opcode_jnp_rel32:
+	case Instruction::Opcode_jns_rel32:
+	case Instruction::Opcode_jo_rel32:
+	case Instruction::Opcode_jp_rel32:
+	case Instruction::Opcode_js_rel32:
+	case Instruction::Opcode_jmp_rel8:
+	case Instruction::Opcode_jmp_rel32:
+	case Instruction::Opcode_jmp_rm32:
+	case Instruction::Opcode_ret:
+	case Instruction::Opcode_ret_imm16:
+
+		return true;
+
+	default:
+
+		return false;
+	}
+}
+
+
+// Return whether an instruction must be emulated while no other context runs
+// on another host thread. These are software interrupts used for system
+// calls, instructions with a 'lock' prefix, and exchanges with memory, which
+// are locked implicitly.
+static bool isSerializing(const Instruction &inst)
+{
+	switch (inst.getOpcode())
+	{
+
+	case Instruction::Opcode_hlt:
+	case Instruction::Opcode_int_3:
+	case Instruction::Opcode_int_imm8:
+	case Instruction::Opcode_into:
+
+		return true;
+
+	case Instruction::Opcode_xchg_rm8_r8:
+	case Instruction::Opcode_xchg_rm16_r16:
+	case Instruction::Opcode_xchg_rm32_r32:
+
+		return inst.getModRmMod() != 3;
+
+	default:
+
+		return inst.getPrefixes() & Instruction::PrefixLock;
+	}
+}
+
+
+// Read the bytes of an instruction to decode. Bytes in pages that do not
+// exist, or that were never written, are read as zero regardless of the page
+// permissions, since the instruction can be shorter than the bytes read. The
+// memory is not modified, so other threads can access it at the same time.
+static void ReadInstructionBytes(mem::Memory *memory, unsigned address,
+		char *buffer, unsigned size)
+{
+	while (size)
+	{
+		unsigned offset = address & (mem::Memory::PageSize - 1);
+		unsigned chunk = std::min(size, mem::Memory::PageSize - offset);
+		mem::Memory::Page *page = memory->getPage(address);
+		char *data = page ? page->getData() : nullptr;
+		if (data)
+			memcpy(buffer, data + offset, chunk);
+		else
+			memset(buffer, 0, chunk);
+		address += chunk;
+		buffer += chunk;
+		size -= chunk;
+	}
+}
+
+
+InstructionCache::Block *Context::FetchBlock()
+{
+	// Decode instructions starting at the current 'eip'
+	InstructionCache::Block block;
+	block.eip = regs.getEip();
+	block.end_eip = block.eip;
+	while (block.entries.size() < InstructionCache::MaxBlockSize)
+	{
+		// Stop at pages that cannot be executed. Execute() will report
+		// the fault if the block is empty.
+		mem::Memory::Page *page = memory->getPage(block.end_eip);
+		if (!page || (memory->getSafe() &&
+				!(page->getPerm() & mem::Memory::AccessExec)))
+			break;
+
+		// Mark the page before reading the instruction, so that a write
+		// from a context running on another host thread is reported
+		// even if it happens before the block is cached.
+		page->setCode(true);
+
+		// Read and decode. Invalid instructions end the block, and are
+		// reported by Execute() if they are reached.
+		char buffer[20];
+		ReadInstructionBytes(memory.get(), block.end_eip, buffer,
+				sizeof buffer);
+		InstructionCache::Entry entry;
+		entry.inst.Decode(buffer, block.end_eip);
+		Instruction::Opcode opcode = entry.inst.getOpcode();
+		if (!opcode || !entry.inst.getSize())
+			break;
+
+		// Add instruction
+		entry.fn = execute_inst_fn[opcode];
+		entry.serializing = isSerializing(entry.inst);
+		block.entries.push_back(entry);
+		block.end_eip += entry.inst.getSize();
+		if (isBlockEnd(opcode))
+			break;
+	}
+
+	// Cache block
+	return inst_cache->InsertBlock(std::move(block));
+}
+
+
+int Context::ExecuteBlocks(int max_instructions, bool parallel)
+{
+	// Find first block. Host threads running blocks of the same
+	// instruction cache look it up holding its mutex, and never discard
+	// blocks.
+	InstructionCache::Block *block;
+	if (parallel)
+	{
+		std::lock_guard<std::mutex> lock(inst_cache->getMutex());
+		block = inst_cache->FindBlock(regs.getEip());
+		if (!block)
+			block = FetchBlock();
+	}
+	else
+	{
+		block = inst_cache->LookupBlock(regs.getEip());
+		if (!block)
+			block = FetchBlock();
+	}
+	if (!block)
+		return 0;
+
+	// Emulate blocks. Micro-instructions are not produced in functional
+	// simulation, so the list is not cleared for each instruction.
+	int num_instructions = 0;
+	try
+	{
+		while (true)
+		{
+			// Emulate instructions of the block, leaving it as soon
+			// as an instruction jumps away from it, or writes code.
+			for (const InstructionCache::Entry &entry : block->entries)
+			{
+				// Leave serializing instructions to the caller
+				if (parallel && entry.serializing)
+					return num_instructions;
+
+				// Set instruction and addresses
+				inst = entry.inst;
+				last_eip = current_eip;
+				current_eip = regs.getEip();
+				target_eip = 0;
+				last_effective_address = 0;
+
+				// Emulate
+				regs.incEip(inst.getSize());
+				(this->*entry.fn)();
+				if (!parallel)
+					emulator->incNumInstructions();
+				num_instructions++;
+
+				// Check next instruction
+				if (num_instructions == max_instructions ||
+						memory->hasInvalidatedCode() ||
+						regs.getEip() != inst.getEip() +
+						inst.getSize())
+					break;
+			}
+
+			// Stop if the context is no longer running, or if the
+			// maximum number of instructions was reached. A block that
+			// left on a code write must not be used for chaining.
+			if (num_instructions >= max_instructions ||
+					!getState(StateRunning) ||
+					memory->hasInvalidatedCode())
+				break;
+
+			// Find next block, following the links of the current
+			// block first.
+			unsigned eip = regs.getEip();
+			InstructionCache::Block *next = inst_cache->getLinkedBlock(
+					block, eip);
+			if (!next)
+			{
+				std::unique_lock<std::mutex> lock(
+						inst_cache->getMutex(),
+						std::defer_lock);
+				if (parallel)
+				{
+					lock.lock();
+					next = inst_cache->FindBlock(eip);
+				}
+				else
+				{
+					next = inst_cache->LookupBlock(eip);
+				}
+				if (!next)
+					next = FetchBlock();
+				if (!next)
+					break;
+				inst_cache->LinkBlock(block, next);
+			}
+
+			// Continue with the next block
+			block = next;
+		}
+	}
+	catch (mem::Memory::Error &e)
+	{
+		// Guest stack back trace
+		if (call_stack != nullptr)
+			call_stack->BackTrace(inst.getEip(), std::cerr);
+
+		// Propagate exception
+		e.PrependPrefix("x86");
+		throw e;
+	}
+	catch (misc::Error &e)
+	{
+		// Add context information to the error message
+		e.AppendPrefix(misc::fmt("pid %d", getId()));
+		e.AppendPrefix(misc::fmt("eip 0x%x", regs.getEip()));
+		throw e;
+	}
+
+	// Return number of emulated instructions
+	return num_instructions;
+}
+
+
+int Context::ExecuteBlock(int max_instructions)
+{
+	// Debug information and speculative execution are handled one
+	// instruction at a time.
+	if (max_instructions < 2 ||
+			emulator->isa_debug ||
+			emulator->call_debug ||
+			getState(StateSpecMode))
+	{
+		Execute();
+		return 1;
+	}
+
+	// Emulate blocks, or a single instruction if the first block could
+	// not be fetched
+	memory->setSafeDefault();
+	int num_instructions = ExecuteBlocks(max_instructions, false);
+	if (!num_instructions)
+	{
+		Execute();
+		return 1;
+	}
+	return num_instructions;
+}
+
+
+int Context::ExecuteParallel(int max_instructions)
+{
+	// Code modified by another context is discarded once all threads stop
+	if (memory->hasInvalidatedCode())
+		return 0;
+	return ExecuteBlocks(max_instructions, true);
+}
+
+
 void Context::FinishGroup(int exit_code)
 {
 	// Make call on group parent only
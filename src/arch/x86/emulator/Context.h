@@ -34,6 +34,7 @@
 #include <memory/Mmu.h>
 #include <memory/SpecMem.h>
 
+#include "InstructionCache.h"
 #include "Regs.h"
 #include "Signal.h"
 #include "Uinst.h"
@@ -49,59 +50,6 @@ class Core;
 class Thread;
 
 
-// Assembly code used before and after instruction emulation when the host flags
-// are affected by the guest code
-#define __X86_ISA_ASM_START__ asm volatile ( \
-	"pushf\n\t" \
-	"pop %0\n\t" \
-	: "=m" (Context::host_flags));
-
-#define __X86_ISA_ASM_END__ asm volatile ( \
-	"push %0\n\t" \
-	"popf\n\t" \
-	: "=m" (Context::host_flags));
-
-#define __X86_CONTEXT_SAVE_FLAGS__ asm volatile ( \
-	"pushf\n\t" \
-	"pop %0\n\t" \
-	: "=m" (Context::host_flags));
-
-#define __X86_CONTEXT_RESTORE_FLAGS__ asm volatile ( \
-	"push %0\n\t" \
-	"popf\n\t" \
-	: "=m" (Context::host_flags));
-
-
-// Assembly code used before and after emulation of floating-point operations
-#define __X86_CONTEXT_FP_BEGIN__ { \
-	unsigned short fpu_ctrl = regs.getFpuCtrl(); \
-	asm volatile ( \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		"fnstenv %1\n\t" \
-		"fnclex\n\t" \
-		"fldcw %2\n\t" \
-		: "=m" (Context::host_flags), "=m" (*Context::host_fpenv) \
-		: "m" (fpu_ctrl) \
-	); \
-}
-
-#define __X86_CONTEXT_FP_END__ { \
-	unsigned short fpu_ctrl; \
-	asm volatile ( \
-		"push %0\n\t" \
-		"popf\n\t" \
-		"fnstcw %1\n\t" \
-		"fldenv %2\n\t" \
-		: "=m" (Context::host_flags), "=m" (fpu_ctrl) \
-		: "m" (*Context::host_fpenv) \
-	); \
-	regs.setFpuCtrl(fpu_ctrl); \
-}
-
-
-
-
 /// x86 Context
 class Context : public comm::Context
 {
@@ -136,12 +84,6 @@ public:
 
 private:
 
-	// Saved host flags during instruction emulation
-	static long host_flags;
-
-	// Saved host floating-point environment during instruction emulation
-	static unsigned char host_fpenv[28];
-
 	// Emulator that it belongs to
 	Emulator *emulator;
 
@@ -154,6 +96,10 @@ private:
 	// this memory object will be the one automatically freeing it.
 	std::shared_ptr<mem::Memory> memory;
 
+	// Cache of decoded instructions of the memory, shared by all contexts
+	// sharing the memory object.
+	std::shared_ptr<InstructionCache> inst_cache;
+
 	// Memory management unit, which can be shared by multiple contexts.
 	// NOTE: For now, the MMU of each context is taken directly from the
 	// associated emulator's MMU. This will change with fused memory.
@@ -495,6 +441,20 @@ private:
 	// Table of functions
 	static ExecuteInstFn execute_inst_fn[Instruction::OpcodeCount];
 
+	// Decode and cache the basic block starting at the current 'eip'.
+	// Return `nullptr` if no instruction could be decoded, or the block
+	// could not be cached.
+	InstructionCache::Block *FetchBlock();
+
+	// Emulate basic blocks starting at the current 'eip', for at most
+	// 'max_instructions' instructions. In the parallel functional
+	// simulation ('parallel' set), the blocks are looked up holding the
+	// instruction cache mutex, instructions are not counted in the
+	// emulator, and the emulation stops before a serializing instruction.
+	// Return the number of emulated instructions, which is 0 if the first
+	// block could not be fetched.
+	int ExecuteBlocks(int max_instructions, bool parallel);
+
 	// Safe memory accesses, based on the current speculative mode
 	void MemoryRead(unsigned int address, int size, void *buffer);
 	void MemoryWrite(unsigned int address, int size, void *buffer);
@@ -587,21 +547,36 @@ private:
 	void StoreIR16(unsigned short value) { regs.Write(inst.getOpIndex() + Instruction::RegAx, value); }
 	void StoreIR32(unsigned int value) { regs.Write(inst.getOpIndex() + Instruction::RegEax, value); }
 
-	void LoadFpu(int index, unsigned char *value);
-	void StoreFpu(int index, unsigned char *value);
-	void PopFpu(unsigned char *value);
-	void PushFpu(unsigned char *value);
+	// Read, write, push, and pop entries of the FPU stack
+	long double LoadFpu(int index);
+	void StoreFpu(int index, long double value);
+	long double PopFpu();
+	void PushFpu(long double value);
 
 	float LoadFloat();
 	double LoadDouble();
-	void LoadExtended(unsigned char *value);
+	long double LoadExtended();
 	void StoreFloat(float value);
 	void StoreDouble(double value);
-	void StoreExtended(unsigned char *value);
+	void StoreExtended(long double value);
+
+	// Set up the host floating-point environment with the rounding mode
+	// of the guest FPU control word before emulating an x87 computation
+	void FpuBegin();
+
+	// Restore the host floating-point environment after emulating an x87
+	// computation. An error is thrown if the computation raised an
+	// exception that is unmasked in the guest FPU control word.
+	void FpuEnd();
+
+	// Round the result of an x87 arithmetic instruction to the precision
+	// selected in the guest FPU control word
+	long double FpuRoundPrecision(long double value);
 
-	// Store the code bits (14, 10, 9, and 8) of the FPU state word into the
-	// 'code' register
-	void StoreFpuCode(unsigned short status);
+	// Compare two floating-point values as instructions 'fcomi', 'fucomi',
+	// 'ucomiss', and 'ucomisd' do, setting flags ZF, PF, and CF, and
+	// clearing OF, SF, and AF.
+	void CompareFlags(long double value1, long double value2);
 
 	// Read the state register, by building it from the 'top' and 'code'
 	// fields
@@ -635,6 +610,12 @@ private:
 	void LoadXmmM64(XmmValue &value);
 	void LoadXmmM128(XmmValue &value);
 
+	// Convert a floating-point value into a 32-bit integer as SSE
+	// conversion instructions do. The value is truncated if 'truncate' is
+	// set, or rounded to the nearest integer otherwise. NaN and values out
+	// of range produce the integer indefinite value 0x80000000.
+	static int XmmConvertToInt32(double value, bool truncate);
+
 
 	
 	
@@ -844,6 +825,26 @@ public:
 	/// register \c eip.
 	void Execute();
 
+	/// Run instructions for the context in functional simulation, starting
+	/// at the position pointed to by register \c eip. Basic blocks of
+	/// decoded instructions are emulated back to back, following the
+	/// blocks executed after them in previous runs, until the context
+	/// stops running or \a max_instructions instructions are emulated.
+	/// The function falls back to Execute() for debugging and speculative
+	/// execution, and returns the number of emulated instructions.
+	int ExecuteBlock(int max_instructions);
+
+	/// Run instructions for the context on a host thread of the parallel
+	/// functional simulation, while other contexts run on other threads.
+	/// The emulation stops after \a max_instructions instructions, before
+	/// an instruction that must be emulated while no other context runs
+	/// (system calls, \c lock prefixes, and exchanges with memory), when
+	/// the context stops running, or when some code page of its memory
+	/// was modified. The caller must continue the emulation with
+	/// Execute() if fewer instructions were emulated, and add the
+	/// returned number of instructions to the emulator counter.
+	int ExecuteParallel(int max_instructions);
+
 	/// Return a reference of the register file
 	Regs &getRegs() { return regs; }
 
@@ -855,6 +856,11 @@ public:
 		return memory.get();
 	}
 
+	/// Return the cache of decoded instructions of the context memory
+	InstructionCache *getInstructionCache() const {
+		return inst_cache.get();
+	}
+
 	/// Force a new 'eip' value for the context. The forced value should be
 	/// the same as the current 'eip' under normal circumstances. If it is
 	/// not, speculative execution starts, which will end on the next call
@@ -946,6 +952,9 @@ public:
 			int odep2,
 			int odep3)
 	{
+		// Checked here to skip the call in functional simulation
+		if (!uinst_active)
+			return;
 		newMemoryUinst(opcode,
 				0,
 				0,
@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <cfenv>
+#include <cmath>
 #include <cstdarg>
 #include <cstring>
 
@@ -86,7 +88,8 @@ unsigned char Context::LoadRm8()
 		return regs.Read(inst.getModRmRm() + Instruction::RegAl);
 
 	MemoryRead(getEffectiveAddress(), 1, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]=0x%x", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]=0x%x", last_effective_address, value);
 	return value;
 }
 
@@ -98,7 +101,8 @@ unsigned short Context::LoadRm16()
 		return regs.Read(inst.getModRmRm() + Instruction::RegAx);
 
 	MemoryRead(getEffectiveAddress(), 2, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]=0x%x", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]=0x%x", last_effective_address, value);
 	return value;
 }
 
@@ -110,7 +114,8 @@ unsigned int Context::LoadRm32()
 		return regs.Read(inst.getModRmRm() + Instruction::RegEax);
 
 	MemoryRead(getEffectiveAddress(), 4, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]=0x%x", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]=0x%x", last_effective_address, value);
 	return value;
 }
 
@@ -122,7 +127,8 @@ unsigned short Context::LoadR32M16()
 		return regs.Read(inst.getModRmRm() + Instruction::RegEax);
 
 	MemoryRead(getEffectiveAddress(), 2, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]=0x%x", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]=0x%x", last_effective_address, value);
 	return value;
 }
 
@@ -131,7 +137,8 @@ unsigned long long Context::LoadM64()
 	unsigned long long value;
 
 	MemoryRead(getEffectiveAddress(), 8, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]=0x%llx", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]=0x%llx", last_effective_address, value);
 	return value;
 }
 
@@ -143,7 +150,8 @@ void Context::StoreRm8(unsigned char value)
 		return;
 	}
 	MemoryWrite(getEffectiveAddress(), 1, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x] <- 0x%x", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x] <- 0x%x", last_effective_address, value);
 }
 
 void Context::StoreRm16(unsigned short value)
@@ -154,7 +162,8 @@ void Context::StoreRm16(unsigned short value)
 		return;
 	}
 	MemoryWrite(getEffectiveAddress(), 2, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x] <- 0x%x", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x] <- 0x%x", last_effective_address, value);
 }
 
 void Context::StoreRm32(unsigned int value)
@@ -165,13 +174,15 @@ void Context::StoreRm32(unsigned int value)
 		return;
 	}
 	MemoryWrite(getEffectiveAddress(), 4, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x] <- 0x%x", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x] <- 0x%x", last_effective_address, value);
 }
 
 void Context::StoreM64(unsigned long long value)
 {
 	MemoryWrite(getEffectiveAddress(), 8, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x] <- 0x%llx", last_effective_address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x] <- 0x%llx", last_effective_address, value);
 }
 
 unsigned Context::getLinearAddress(unsigned offset)
@@ -242,7 +253,7 @@ unsigned Context::getMoffsAddress()
 	return address;
 }
 
-void Context::LoadFpu(int index, unsigned char *value)
+long double Context::LoadFpu(int index)
 {
 	if (!misc::inRange(index, 0, 7))
 		throw Error("Invalid value for 'index'");
@@ -251,14 +262,16 @@ void Context::LoadFpu(int index, unsigned char *value)
 	if (!regs.isFpuValid(eff_index))
 		throw Error("Invalid FPU stack entry");
 
-	memcpy(value, regs.getFpuValue(eff_index), 10);
+	long double value = Extended::ExtendedToLongDouble(
+			regs.getFpuValue(eff_index));
 	if (emulator->isa_debug)
 		emulator->isa_debug << misc::fmt("  st(%d)=%g", index,
-				Extended::ExtendedToDouble(value));
+				(double) value);
+	return value;
 }
 
 
-void Context::StoreFpu(int index, unsigned char *value)
+void Context::StoreFpu(int index, long double value)
 {
 	// Check valid index
 	if (!misc::inRange(index, 0, 7))
@@ -270,19 +283,19 @@ void Context::StoreFpu(int index, unsigned char *value)
 		throw Error("Invalid FPU stack entry");
 
 	// Store value
-	memcpy(regs.getFpuValue(index), value, 10);
+	Extended::LongDoubleToExtended(value, regs.getFpuValue(index));
 	if (emulator->isa_debug)
 		emulator->isa_debug << misc::fmt("  st(%d)<=%g", index,
-				Extended::ExtendedToDouble(value));
+				(double) value);
 }
 
 
-void Context::PushFpu(unsigned char *value)
+void Context::PushFpu(long double value)
 {
 	// Debug
 	if (emulator->isa_debug)
 		emulator->isa_debug << misc::fmt("  st(0)<=%g (pushed)",
-				Extended::ExtendedToDouble(value));
+				(double) value);
 
 	// Get stack top
 	regs.decFpuTop();
@@ -290,29 +303,30 @@ void Context::PushFpu(unsigned char *value)
 		throw misc::Panic("Unexpected valid FPU entry");
 
 	regs.setFpuValid(regs.getFpuTop());
-	memcpy(regs.getFpuValue(regs.getFpuTop()), value, 10);
+	Extended::LongDoubleToExtended(value,
+			regs.getFpuValue(regs.getFpuTop()));
 }
 
 
-void Context::PopFpu(unsigned char *value)
+long double Context::PopFpu()
 {
 	// Check valid entry
 	if (!regs.isFpuValid(regs.getFpuTop()))
 		throw misc::Panic("Unexpected invalid FPU entry");
 
-	// Copy value
-	if (value)
-		memcpy(value, regs.getFpuValue(regs.getFpuTop()), 10);
-	
+	// Read value
+	long double value = Extended::ExtendedToLongDouble(
+			regs.getFpuValue(regs.getFpuTop()));
+
 	// Debug
 	if (emulator->isa_debug)
 		emulator->isa_debug << misc::fmt("  st(0)=%g (popped)",
-				Extended::ExtendedToDouble(regs.
-				getFpuValue(regs.getFpuTop())));
+				(double) value);
 
 	// Pop
 	regs.setFpuValid(regs.getFpuTop(), false);
 	regs.incFpuTop();
+	return value;
 }
 
 
@@ -320,27 +334,33 @@ double Context::LoadDouble()
 {
 	double value;
 	MemoryRead(getEffectiveAddress(), 8, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]=%g", getEffectiveAddress(), value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]=%g", getEffectiveAddress(), value);
 	return value;
 }
 
 
-void Context::LoadExtended(unsigned char *value)
+long double Context::LoadExtended()
 {
+	unsigned char value[10];
 	MemoryRead(getEffectiveAddress(), 10, value);
+	return Extended::ExtendedToLongDouble(value);
 }
 
 
-void Context::StoreExtended(unsigned char *value)
+void Context::StoreExtended(long double value)
 {
-	MemoryWrite(getEffectiveAddress(), 10, value);
+	unsigned char e[10];
+	Extended::LongDoubleToExtended(value, e);
+	MemoryWrite(getEffectiveAddress(), 10, e);
 }
 
 
 void Context::StoreDouble(double value)
 {
 	MemoryWrite(getEffectiveAddress(), 8, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]<=%g", getEffectiveAddress(), value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]<=%g", getEffectiveAddress(), value);
 }
 
 
@@ -349,8 +369,9 @@ float Context::LoadFloat()
 	float value;
 
 	MemoryRead(getEffectiveAddress(), 4, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]=%g", getEffectiveAddress(),
-			(double) value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]=%g", getEffectiveAddress(),
+				(double) value);
 
 	return value;
 }
@@ -359,17 +380,9 @@ float Context::LoadFloat()
 void Context::StoreFloat(float value)
 {
 	MemoryWrite(getEffectiveAddress(), 4, &value);
-	emulator->isa_debug << misc::fmt("  [0x%x]<=%g", getEffectiveAddress(),
-			(double) value);
-}
-
-
-void Context::StoreFpuCode(unsigned short status)
-{
-	regs.setFpuCode(0);
-	if (misc::getBit32(status, 14))
-		regs.setFpuCode(regs.getFpuCode() | 8);
-	regs.setFpuCode(regs.getFpuCode() | ((status >> 8) & 7));
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt("  [0x%x]<=%g", getEffectiveAddress(),
+				(double) value);
 }
 
 
@@ -388,5 +401,91 @@ unsigned short Context::LoadFpuStatus()
 }
 
 
+void Context::FpuBegin()
+{
+	// Rounding control in bits 10-11 of the control word
+	static const int round_modes[4] =
+	{
+		FE_TONEAREST,
+		FE_DOWNWARD,
+		FE_UPWARD,
+		FE_TOWARDZERO
+	};
+	unsigned short fpu_ctrl = regs.getFpuCtrl();
+	if (fpu_ctrl & 0xc00)
+		fesetround(round_modes[(fpu_ctrl >> 10) & 3]);
+
+	// Exception flags are only checked if some exception is unmasked in
+	// bits 0-5 of the control word
+	if ((fpu_ctrl & 0x3f) != 0x3f)
+		feclearexcept(FE_ALL_EXCEPT);
+}
+
+
+void Context::FpuEnd()
+{
+	// Restore default rounding
+	unsigned short fpu_ctrl = regs.getFpuCtrl();
+	if (fpu_ctrl & 0xc00)
+		fesetround(FE_TONEAREST);
+	if ((fpu_ctrl & 0x3f) == 0x3f)
+		return;
+
+	// Unmasked exceptions. Denormal operands (bit 1) are not reported by
+	// the host environment.
+	int exceptions = 0;
+	if (!(fpu_ctrl & 0x01))
+		exceptions |= FE_INVALID;
+	if (!(fpu_ctrl & 0x04))
+		exceptions |= FE_DIVBYZERO;
+	if (!(fpu_ctrl & 0x08))
+		exceptions |= FE_OVERFLOW;
+	if (!(fpu_ctrl & 0x10))
+		exceptions |= FE_UNDERFLOW;
+	if (!(fpu_ctrl & 0x20))
+		exceptions |= FE_INEXACT;
+	if (fetestexcept(exceptions))
+		throw Error(misc::fmt("Unmasked x87 floating-point exception "
+				"(control word 0x%x)", fpu_ctrl));
+}
+
+
+long double Context::FpuRoundPrecision(long double value)
+{
+	// Precision control in bits 8-9 of the control word
+	switch ((regs.getFpuCtrl() >> 8) & 3)
+	{
+
+	case 0:
+
+		return (float) value;
+
+	case 2:
+
+		return (double) value;
+
+	default:
+
+		return value;
+	}
+}
+
+
+void Context::CompareFlags(long double value1, long double value2)
+{
+	// Unordered operands set all of ZF, PF, and CF
+	unsigned eflags = regs.getEflags() & ~Regs::ArithmeticFlagsMask;
+	if (std::isunordered(value1, value2))
+		eflags |= (1 << Instruction::FlagZF) |
+				(1 << Instruction::FlagPF) |
+				(1 << Instruction::FlagCF);
+	else if (value1 < value2)
+		eflags |= 1 << Instruction::FlagCF;
+	else if (value1 == value2)
+		eflags |= 1 << Instruction::FlagZF;
+	regs.setEflags(eflags);
+}
+
+
 }  // namespace x86
 
@@ -17,6 +17,11 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
 #include <lib/cpp/Misc.h>
 
 #include "Context.h"
@@ -36,28 +41,90 @@ namespace x86
 #define assert __COMPILATION_ERROR__
 
 
-void Context::ExecuteInst_f2xm1()
+// Constants pushed by instructions 'fldl2e', 'fldl2t', 'fldpi', 'fldlg2', and
+// 'fldln2'
+static const long double FpuL2e = 1.4426950408889634073599246810018921L;
+static const long double FpuL2t = 3.3219280948873623478703194294893901L;
+static const long double FpuPi = 3.1415926535897932384626433832795029L;
+static const long double FpuLg2 = 0.30102999566398119521373889472449302677L;
+static const long double FpuLn2 = 0.69314718055994530941723212145817657L;
+
+// Condition code bits, as stored in the FPU register file
+static const int FpuCodeC0 = 1 << 0;
+static const int FpuCodeC1 = 1 << 1;
+static const int FpuCodeC2 = 1 << 2;
+static const int FpuCodeC3 = 1 << 3;
+
+
+// Return the condition codes produced by comparing two values
+static int FpuCompareCode(long double value1, long double value2)
 {
-	unsigned char st0[10];
-	unsigned short status;
+	if (std::isunordered(value1, value2))
+		return FpuCodeC3 | FpuCodeC2 | FpuCodeC0;
+	if (value1 < value2)
+		return FpuCodeC0;
+	if (value1 == value2)
+		return FpuCodeC3;
+	return 0;
+}
+
 
-	LoadFpu(0, st0);
+// Return the condition codes of a complete partial remainder, given the
+// absolute value of its quotient. Bits 0, 1, and 2 of the quotient go to C1,
+// C3, and C0, respectively.
+static int FpuRemainderCode(unsigned quotient)
+{
+	int code = 0;
+	if (quotient & 1)
+		code |= FpuCodeC1;
+	if (quotient & 2)
+		code |= FpuCodeC3;
+	if (quotient & 4)
+		code |= FpuCodeC0;
+	return code;
+}
+
+
+// Compute an incomplete partial remainder in 'result' if the exponents of
+// the operands differ by 64 or more, and return whether it was computed. As
+// on Intel processors, each step reduces the exponent difference to a value
+// between 32 and 63 by subtracting a multiple of 32.
+static bool FpuPartialRemainder(long double value1, long double value2,
+		long double &result)
+{
+	if (!std::isfinite(value1) || !std::isfinite(value2) ||
+			value1 == 0 || value2 == 0)
+		return false;
+	int difference = std::ilogb(value1) - std::ilogb(value2);
+	if (difference < 64)
+		return false;
+	result = std::fmod(value1, std::scalbn(value2,
+			difference - 32 - difference % 32));
+	return true;
+}
+
+
+// Convert a value into an integer of type T, rounding it with the current
+// rounding mode. Values out of range produce the integer indefinite value.
+template<typename T> static T FpuConvertToInteger(long double value)
+{
+	long double result = std::nearbyint(value);
+	if (!(result >= std::numeric_limits<T>::min() &&
+			result <= std::numeric_limits<T>::max()))
+		return std::numeric_limits<T>::min();
+	return (T) result;
+}
 
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"f2xm1\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+
+void Context::ExecuteInst_f2xm1()
+{
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = std::expm1(st0 * FpuLn2);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpExp,
 			Uinst::DepSt0,
@@ -72,26 +139,8 @@ void Context::ExecuteInst_f2xm1()
 
 void Context::ExecuteInst_fabs()
 {
-	unsigned char st0[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fabs\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpu(0, st0);
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+	StoreFpu(0, std::fabs(st0));
 
 	newUinst(Uinst::OpcodeFpSign,
 			Uinst::DepSt0,
@@ -106,29 +155,14 @@ void Context::ExecuteInst_fabs()
 
 void Context::ExecuteInst_fadd_m32()
 {
-	unsigned char st0[10];
-	float m32;
-	unsigned short status;
-
-	m32 = LoadFloat();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"flds %3\n\t"
-		"faddp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (m32)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	float m32 = LoadFloat();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 + m32);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpAdd,
 			Uinst::DepSt0,
@@ -143,29 +177,14 @@ void Context::ExecuteInst_fadd_m32()
 
 void Context::ExecuteInst_fadd_m64()
 {
-	unsigned char st0[10];
-	double m64;
-	unsigned short status;
-
-	m64 = LoadDouble();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldl %3\n\t"
-		"faddp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (m64)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	double m64 = LoadDouble();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 + m64);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpAdd,
 			Uinst::DepSt0,
@@ -180,28 +199,14 @@ void Context::ExecuteInst_fadd_m64()
 
 void Context::ExecuteInst_fadd_st0_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"faddp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (*sti)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 + sti);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpAdd,
 			Uinst::DepSt0,
@@ -216,28 +221,14 @@ void Context::ExecuteInst_fadd_st0_sti()
 
 void Context::ExecuteInst_fadd_sti_st0()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"faddp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*sti), "=g" (status)
-		: "m" (*sti), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	sti = FpuRoundPrecision(sti + st0);
+	FpuEnd();
 
 	StoreFpu(inst.getOpIndex(), sti);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpAdd,
 			Uinst::DepSt0,
@@ -253,7 +244,7 @@ void Context::ExecuteInst_fadd_sti_st0()
 void Context::ExecuteInst_faddp_sti_st0()
 {
 	ExecuteInst_fadd_sti_st0();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -268,26 +259,8 @@ void Context::ExecuteInst_faddp_sti_st0()
 
 void Context::ExecuteInst_fchs()
 {
-	unsigned char st0[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fchs\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpu(0, st0);
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+	StoreFpu(0, -st0);
 
 	newUinst(Uinst::OpcodeFpSign,
 			Uinst::DepSt0,
@@ -302,8 +275,7 @@ void Context::ExecuteInst_fchs()
 
 void Context::ExecuteInst_fcmovb_st0_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
+	long double sti = LoadFpu(inst.getOpIndex());
 	if (regs.getFlag(Instruction::FlagCF))
 		StoreFpu(0, sti);
 
@@ -320,8 +292,7 @@ void Context::ExecuteInst_fcmovb_st0_sti()
 
 void Context::ExecuteInst_fcmove_st0_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
+	long double sti = LoadFpu(inst.getOpIndex());
 	if (regs.getFlag(Instruction::FlagZF))
 		StoreFpu(0, sti);
 
@@ -338,8 +309,7 @@ void Context::ExecuteInst_fcmove_st0_sti()
 
 void Context::ExecuteInst_fcmovbe_st0_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
+	long double sti = LoadFpu(inst.getOpIndex());
 	if (regs.getFlag(Instruction::FlagCF) || regs.getFlag(Instruction::FlagZF))
 		StoreFpu(0, sti);
 
@@ -356,8 +326,7 @@ void Context::ExecuteInst_fcmovbe_st0_sti()
 
 void Context::ExecuteInst_fcmovu_st0_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
+	long double sti = LoadFpu(inst.getOpIndex());
 	if (regs.getFlag(Instruction::FlagPF))
 		StoreFpu(0, sti);
 
@@ -374,8 +343,7 @@ void Context::ExecuteInst_fcmovu_st0_sti()
 
 void Context::ExecuteInst_fcmovnb_st0_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
+	long double sti = LoadFpu(inst.getOpIndex());
 	if (!regs.getFlag(Instruction::FlagCF))
 		StoreFpu(0, sti);
 
@@ -392,8 +360,7 @@ void Context::ExecuteInst_fcmovnb_st0_sti()
 
 void Context::ExecuteInst_fcmovne_st0_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
+	long double sti = LoadFpu(inst.getOpIndex());
 	if (!regs.getFlag(Instruction::FlagZF))
 		StoreFpu(0, sti);
 
@@ -410,8 +377,7 @@ void Context::ExecuteInst_fcmovne_st0_sti()
 
 void Context::ExecuteInst_fcmovnbe_st0_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
+	long double sti = LoadFpu(inst.getOpIndex());
 	if (!regs.getFlag(Instruction::FlagCF) && !regs.getFlag(Instruction::FlagZF))
 		StoreFpu(0, sti);
 
@@ -428,8 +394,7 @@ void Context::ExecuteInst_fcmovnbe_st0_sti()
 
 void Context::ExecuteInst_fcmovnu_st0_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
+	long double sti = LoadFpu(inst.getOpIndex());
 	if (!regs.getFlag(Instruction::FlagPF))
 		StoreFpu(0, sti);
 
@@ -446,26 +411,9 @@ void Context::ExecuteInst_fcmovnu_st0_sti()
 
 void Context::ExecuteInst_fcom_m32()
 {
-	unsigned char st0[10];
-	float m32;
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	m32 = LoadFloat();
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %1\n\t"
-		"fcomps %2\n\t"
-		"fnstsw %%ax\n\t"
-		"mov %%ax, %0\n\t"
-		: "=g" (status)
-		: "m" (*st0), "m" (m32)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+	float m32 = LoadFloat();
+	regs.setFpuCode(FpuCompareCode(st0, m32));
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -480,26 +428,9 @@ void Context::ExecuteInst_fcom_m32()
 
 void Context::ExecuteInst_fcom_m64()
 {
-	unsigned char st0[10];
-	double m64;
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	m64 = LoadDouble();
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %1\n\t"
-		"fcompl %2\n\t"
-		"fnstsw %%ax\n\t"
-		"mov %%ax, %0\n\t"
-		: "=g" (status)
-		: "m" (*st0), "m" (m64)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+	double m64 = LoadDouble();
+	regs.setFpuCode(FpuCompareCode(st0, m64));
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -514,26 +445,9 @@ void Context::ExecuteInst_fcom_m64()
 
 void Context::ExecuteInst_fcom_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %1\n\t"
-		"fcompp\n\t"
-		"fnstsw %%ax\n\t"
-		"mov %%ax, %0\n\t"
-		: "=g" (status)
-		: "m" (*st0), "m" (*sti)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+	regs.setFpuCode(FpuCompareCode(st0, sti));
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -549,7 +463,7 @@ void Context::ExecuteInst_fcom_sti()
 void Context::ExecuteInst_fcomp_m32()
 {
 	ExecuteInst_fcom_m32();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -565,7 +479,7 @@ void Context::ExecuteInst_fcomp_m32()
 void Context::ExecuteInst_fcomp_m64()
 {
 	ExecuteInst_fcom_m64();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -581,7 +495,7 @@ void Context::ExecuteInst_fcomp_m64()
 void Context::ExecuteInst_fcomp_sti()
 {
 	ExecuteInst_fcom_sti();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -596,28 +510,11 @@ void Context::ExecuteInst_fcomp_sti()
 
 void Context::ExecuteInst_fcompp()
 {
-	unsigned char st0[10], st1[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(1, st1);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %1\n\t"
-		"fcompp\n\t"
-		"fnstsw %%ax\n\t"
-		"mov %%ax, %0\n\t"
-		: "=g" (status)
-		: "m" (*st0), "m" (*st1)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpuCode(status);
-	PopFpu(nullptr);
-	PopFpu(nullptr);
+	long double st0 = LoadFpu(0);
+	long double st1 = LoadFpu(1);
+	regs.setFpuCode(FpuCompareCode(st0, st1));
+	PopFpu();
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -641,28 +538,9 @@ void Context::ExecuteInst_fcompp()
 
 void Context::ExecuteInst_fcomi_st0_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned long flags = regs.getEflags();
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"fldt %2\n\t"
-		"fldt %1\n\t"
-		"fcomip %%st(1), %%st\n\t"
-		"fstp %%st(0)\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags)
-		: "m" (*st0), "m" (*sti), "g" (flags)
-	);
-	__X86_CONTEXT_FP_END__
-
-	regs.setEflags(flags);
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+	CompareFlags(st0, sti);
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -678,7 +556,7 @@ void Context::ExecuteInst_fcomi_st0_sti()
 void Context::ExecuteInst_fcomip_st0_sti()
 {
 	ExecuteInst_fcomi_st0_sti();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -693,28 +571,9 @@ void Context::ExecuteInst_fcomip_st0_sti()
 
 void Context::ExecuteInst_fucomi_st0_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned long flags = regs.getEflags();
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"fldt %2\n\t"
-		"fldt %1\n\t"
-		"fucomip %%st(1), %%st\n\t"
-		"fstp %%st(0)\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags)
-		: "m" (*st0), "m" (*sti), "g" (flags)
-	);
-	__X86_CONTEXT_FP_END__
-
-	regs.setEflags(flags);
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+	CompareFlags(st0, sti);
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -730,7 +589,7 @@ void Context::ExecuteInst_fucomi_st0_sti()
 void Context::ExecuteInst_fucomip_st0_sti()
 {
 	ExecuteInst_fucomi_st0_sti();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -745,26 +604,13 @@ void Context::ExecuteInst_fucomip_st0_sti()
 
 void Context::ExecuteInst_fcos()
 {
-	unsigned char st0[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
+	long double st0 = LoadFpu(0);
 
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fcos\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	FpuBegin();
+	st0 = std::cos(st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpCos,
 			Uinst::DepSt0,
@@ -779,29 +625,14 @@ void Context::ExecuteInst_fcos()
 
 void Context::ExecuteInst_fdiv_m32()
 {
-	unsigned char st0[10];
-	float m32;
-	unsigned short status;
-
-	m32 = LoadFloat();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"flds %3\n\t"
-		"fdivrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (m32)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	float m32 = LoadFloat();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 / m32);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpDiv,
 			Uinst::DepSt0,
@@ -816,29 +647,14 @@ void Context::ExecuteInst_fdiv_m32()
 
 void Context::ExecuteInst_fdiv_m64()
 {
-	unsigned char st0[10];
-	double m64;
-	unsigned short status;
-
-	m64 = LoadDouble();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldl %3\n\t"
-		"fdivrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (m64)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	double m64 = LoadDouble();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 / m64);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpDiv,
 			Uinst::DepSt0,
@@ -853,28 +669,14 @@ void Context::ExecuteInst_fdiv_m64()
 
 void Context::ExecuteInst_fdiv_st0_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fdivrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (*sti)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 / sti);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpDiv,
 			Uinst::DepSt0,
@@ -889,28 +691,14 @@ void Context::ExecuteInst_fdiv_st0_sti()
 
 void Context::ExecuteInst_fdiv_sti_st0()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fdivrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*sti), "=g" (status)
-		: "m" (*sti), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	sti = FpuRoundPrecision(sti / st0);
+	FpuEnd();
 
 	StoreFpu(inst.getOpIndex(), sti);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpDiv,
 			Uinst::DepSt0,
@@ -926,7 +714,7 @@ void Context::ExecuteInst_fdiv_sti_st0()
 void Context::ExecuteInst_fdivp_sti_st0()
 {
 	ExecuteInst_fdiv_sti_st0();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -941,29 +729,14 @@ void Context::ExecuteInst_fdivp_sti_st0()
 
 void Context::ExecuteInst_fdivr_m32()
 {
-	unsigned char st0[10];
-	float m32;
-	unsigned short status;
-
-	m32 = LoadFloat();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"flds %2\n\t"
-		"fldt %3\n\t"
-		"fdivrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (m32), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	float m32 = LoadFloat();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(m32 / st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpDiv,
 			Uinst::DepSt0,
@@ -978,29 +751,14 @@ void Context::ExecuteInst_fdivr_m32()
 
 void Context::ExecuteInst_fdivr_m64()
 {
-	unsigned char st0[10];
-	double m64;
-	unsigned short status;
-
-	m64 = LoadDouble();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldl %2\n\t"
-		"fldt %3\n\t"
-		"fdivrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (m64), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	double m64 = LoadDouble();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(m64 / st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpDiv,
 			Uinst::DepSt0,
@@ -1015,28 +773,14 @@ void Context::ExecuteInst_fdivr_m64()
 
 void Context::ExecuteInst_fdivr_st0_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fdivrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*sti), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(sti / st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeDiv,
 			Uinst::DepSt0,
@@ -1051,28 +795,14 @@ void Context::ExecuteInst_fdivr_st0_sti()
 
 void Context::ExecuteInst_fdivr_sti_st0()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fdivrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*sti), "=g" (status)
-		: "m" (*st0), "m" (*sti)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	sti = FpuRoundPrecision(st0 / sti);
+	FpuEnd();
 
 	StoreFpu(inst.getOpIndex(), sti);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeDiv,
 			Uinst::DepSt0,
@@ -1088,7 +818,7 @@ void Context::ExecuteInst_fdivr_sti_st0()
 void Context::ExecuteInst_fdivrp_sti_st0()
 {
 	ExecuteInst_fdivr_sti_st0();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -1104,20 +834,8 @@ void Context::ExecuteInst_fdivrp_sti_st0()
 void Context::ExecuteInst_fild_m16()
 {
 	short m16;
-	unsigned char e[10];
-
 	MemoryRead(getEffectiveAddress(), 2, &m16);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"filds %1\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*e)
-		: "m" (m16)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(e);
+	PushFpu(m16);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1134,20 +852,8 @@ void Context::ExecuteInst_fild_m16()
 void Context::ExecuteInst_fild_m32()
 {
 	int m32;
-	unsigned char e[10];
-
 	MemoryRead(getEffectiveAddress(), 4, &m32);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fildl %1\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*e)
-		: "m" (m32)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(e);
+	PushFpu(m32);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1164,20 +870,8 @@ void Context::ExecuteInst_fild_m32()
 void Context::ExecuteInst_fild_m64()
 {
 	long long m64;
-	unsigned char e[10];
-
 	MemoryRead(getEffectiveAddress(), 8, &m64);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fildq %1\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*e)
-		: "m" (m64)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(e);
+	PushFpu(m64);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1193,19 +887,11 @@ void Context::ExecuteInst_fild_m64()
 
 void Context::ExecuteInst_fist_m16()
 {
-	short m16;
-	unsigned char e[10];
+	long double st0 = LoadFpu(0);
 
-	LoadFpu(0, e);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %1\n\t"
-		"fistps %0\n\t"
-		: "=m" (m16)
-		: "m" (*e)
-	);
-	__X86_CONTEXT_FP_END__
+	FpuBegin();
+	short m16 = FpuConvertToInteger<short>(st0);
+	FpuEnd();
 
 	MemoryWrite(getEffectiveAddress(), 2, &m16);
 
@@ -1222,19 +908,11 @@ void Context::ExecuteInst_fist_m16()
 
 void Context::ExecuteInst_fist_m32()
 {
-	int m32;
-	unsigned char e[10];
+	long double st0 = LoadFpu(0);
 
-	LoadFpu(0, e);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %1\n\t"
-		"fistpl %0\n\t"
-		: "=m" (m32)
-		: "m" (*e)
-	);
-	__X86_CONTEXT_FP_END__
+	FpuBegin();
+	int m32 = FpuConvertToInteger<int>(st0);
+	FpuEnd();
 
 	MemoryWrite(getEffectiveAddress(), 4, &m32);
 
@@ -1251,19 +929,11 @@ void Context::ExecuteInst_fist_m32()
 
 void Context::ExecuteInst_fist_m64()
 {
-	long long m64;
-	unsigned char e[10];
+	long double st0 = LoadFpu(0);
 
-	LoadFpu(0, e);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %1\n\t"
-		"fistpq %0\n\t"
-		: "=m" (m64)
-		: "m" (*e)
-	);
-	__X86_CONTEXT_FP_END__
+	FpuBegin();
+	long long m64 = FpuConvertToInteger<long long>(st0);
+	FpuEnd();
 
 	MemoryWrite(getEffectiveAddress(), 8, &m64);
 
@@ -1281,7 +951,7 @@ void Context::ExecuteInst_fist_m64()
 void Context::ExecuteInst_fistp_m16()
 {
 	ExecuteInst_fist_m16();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -1297,7 +967,7 @@ void Context::ExecuteInst_fistp_m16()
 void Context::ExecuteInst_fistp_m32()
 {
 	ExecuteInst_fist_m32();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -1313,7 +983,7 @@ void Context::ExecuteInst_fistp_m32()
 void Context::ExecuteInst_fistp_m64()
 {
 	ExecuteInst_fist_m64();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -1328,17 +998,7 @@ void Context::ExecuteInst_fistp_m64()
 
 void Context::ExecuteInst_fld1()
 {
-	unsigned char v[10];
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fld1\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*v)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(v);
+	PushFpu(1.0L);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1354,17 +1014,7 @@ void Context::ExecuteInst_fld1()
 
 void Context::ExecuteInst_fldl2e()
 {
-	unsigned char v[10];
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldl2e\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*v)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(v);
+	PushFpu(FpuL2e);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1380,17 +1030,7 @@ void Context::ExecuteInst_fldl2e()
 
 void Context::ExecuteInst_fldl2t()
 {
-	unsigned char v[10];
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldl2t\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*v)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(v);
+	PushFpu(FpuL2t);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1406,17 +1046,7 @@ void Context::ExecuteInst_fldl2t()
 
 void Context::ExecuteInst_fldpi()
 {
-	unsigned char v[10];
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldpi\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*v)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(v);
+	PushFpu(FpuPi);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1432,17 +1062,7 @@ void Context::ExecuteInst_fldpi()
 
 void Context::ExecuteInst_fldlg2()
 {
-	unsigned char v[10];
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldlg2\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*v)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(v);
+	PushFpu(FpuLg2);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1458,17 +1078,7 @@ void Context::ExecuteInst_fldlg2()
 
 void Context::ExecuteInst_fldln2()
 {
-	unsigned char v[10];
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldln2\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*v)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(v);
+	PushFpu(FpuLn2);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1484,17 +1094,7 @@ void Context::ExecuteInst_fldln2()
 
 void Context::ExecuteInst_fldz()
 {
-	unsigned char v[10];
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldz\n\t"
-		"fstpt %0\n\t"
-		: "=m" (*v)
-	);
-	__X86_CONTEXT_FP_END__
-
-	PushFpu(v);
+	PushFpu(0.0L);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1510,12 +1110,7 @@ void Context::ExecuteInst_fldz()
 
 void Context::ExecuteInst_fld_m32()
 {
-	unsigned char e[10];
-	float m32;
-
-	m32 = LoadFloat();
-	Extended::FloatToExtended(m32, e);
-	PushFpu(e);
+	PushFpu(LoadFloat());
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1531,12 +1126,7 @@ void Context::ExecuteInst_fld_m32()
 
 void Context::ExecuteInst_fld_m64()
 {
-	unsigned char e[10];
-	double m64;
-
-	m64 = LoadDouble();
-	Extended::DoubleToExtended(m64, e);
-	PushFpu(e);
+	PushFpu(LoadDouble());
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1552,10 +1142,7 @@ void Context::ExecuteInst_fld_m64()
 
 void Context::ExecuteInst_fld_m80()
 {
-	unsigned char e[10];
-
-	LoadExtended(e);
-	PushFpu(e);
+	PushFpu(LoadExtended());
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -1571,9 +1158,7 @@ void Context::ExecuteInst_fld_m80()
 
 void Context::ExecuteInst_fld_sti()
 {
-	unsigned char sti[10];
-	LoadFpu(inst.getOpIndex(), sti);
-	PushFpu(sti);
+	PushFpu(LoadFpu(inst.getOpIndex()));
 
 	newUinst(Uinst::OpcodeFpMove,
 			Uinst::DepSti,
@@ -1611,7 +1196,8 @@ void Context::ExecuteInst_fldcw_m16()
 
 	// Set value
 	regs.setFpuCtrl(value);
-	emulator->isa_debug << misc::fmt(" fpcw<=0x%x", value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt(" fpcw<=0x%x", value);
 
 	// Micro-instructions
 	newUinst(Uinst::OpcodeFpMove,
@@ -1627,29 +1213,14 @@ void Context::ExecuteInst_fldcw_m16()
 
 void Context::ExecuteInst_fmul_m32()
 {
-	unsigned char st0[10];
-	float m32;
-	unsigned short status;
-
-	m32 = LoadFloat();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"flds %3\n\t"
-		"fmulp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (m32)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	float m32 = LoadFloat();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 * m32);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpMult,
 			Uinst::DepSt0,
@@ -1664,29 +1235,14 @@ void Context::ExecuteInst_fmul_m32()
 
 void Context::ExecuteInst_fmul_m64()
 {
-	unsigned char st0[10];
-	double m64;
-	unsigned short status;
-
-	m64 = LoadDouble();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldl %3\n\t"
-		"fmulp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (m64)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	double m64 = LoadDouble();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 * m64);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpMult,
 			Uinst::DepSt0,
@@ -1701,28 +1257,14 @@ void Context::ExecuteInst_fmul_m64()
 
 void Context::ExecuteInst_fmul_st0_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fmulp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (*sti)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 * sti);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpMult,
 			Uinst::DepSt0,
@@ -1737,28 +1279,14 @@ void Context::ExecuteInst_fmul_st0_sti()
 
 void Context::ExecuteInst_fmul_sti_st0()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fmulp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*sti), "=g" (status)
-		: "m" (*sti), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	sti = FpuRoundPrecision(sti * st0);
+	FpuEnd();
 
 	StoreFpu(inst.getOpIndex(), sti);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpMult,
 			Uinst::DepSt0,
@@ -1774,7 +1302,7 @@ void Context::ExecuteInst_fmul_sti_st0()
 void Context::ExecuteInst_fmulp_sti_st0()
 {
 	ExecuteInst_fmul_sti_st0();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -1811,29 +1339,15 @@ void Context::ExecuteInst_fnstsw_ax()
 
 void Context::ExecuteInst_fpatan()
 {
-	unsigned char st0[10], st1[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(1, st1);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %3\n\t"
-		"fldt %2\n\t"
-		"fpatan\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st1), "=g" (status)
-		: "m" (*st0), "m" (*st1)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double st1 = LoadFpu(1);
+
+	FpuBegin();
+	st1 = std::atan2(st1, st0);
+	FpuEnd();
 
 	StoreFpu(1, st1);
-	PopFpu(nullptr);
-	StoreFpuCode(status);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpAtan,
 			Uinst::DepSt0,
@@ -1849,29 +1363,33 @@ void Context::ExecuteInst_fpatan()
 
 void Context::ExecuteInst_fprem()
 {
-	unsigned char st0[10], st1[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(1, st1);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %3\n\t"
-		"fldt %2\n\t"
-		"fprem\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"fstp %%st(0)\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (*st1)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpu(0, st0);
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+	long double st1 = LoadFpu(1);
+
+	// Partial remainder with the quotient truncated. The three least
+	// significant bits of the quotient are obtained from the quotient
+	// rounded to nearest.
+	long double result;
+	int code = FpuCodeC2;
+	FpuBegin();
+	if (!FpuPartialRemainder(st0, st1, result))
+	{
+		int quotient;
+		long double remainder = std::remquo(st0, st1, &quotient);
+		result = std::fmod(st0, st1);
+		quotient = std::abs(quotient);
+		if (result != remainder)
+			quotient--;
+		code = FpuRemainderCode(quotient);
+	}
+	FpuEnd();
+
+	// Invalid operations clear the condition codes
+	if (std::isnan(result))
+		code = 0;
+
+	StoreFpu(0, result);
+	regs.setFpuCode(code);
 
 	newUinst(Uinst::OpcodeFpDiv,
 			Uinst::DepSt0,
@@ -1886,29 +1404,27 @@ void Context::ExecuteInst_fprem()
 
 void Context::ExecuteInst_fprem1()
 {
-	unsigned char st0[10], st1[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(1, st1);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %3\n\t"
-		"fldt %2\n\t"
-		"fprem1\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"fstp %%st(0)\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (*st1)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double st1 = LoadFpu(1);
 
-	StoreFpu(0, st0);
-	StoreFpuCode(status);
+	// IEEE partial remainder, with the quotient rounded to nearest
+	long double result;
+	int code = FpuCodeC2;
+	FpuBegin();
+	if (!FpuPartialRemainder(st0, st1, result))
+	{
+		int quotient;
+		result = std::remquo(st0, st1, &quotient);
+		code = FpuRemainderCode(std::abs(quotient));
+	}
+	FpuEnd();
+
+	// Invalid operations clear the condition codes
+	if (std::isnan(result))
+		code = 0;
+
+	StoreFpu(0, result);
+	regs.setFpuCode(code);
 
 	newUinst(Uinst::OpcodeFpDiv,
 			Uinst::DepSt0,
@@ -1923,24 +1439,11 @@ void Context::ExecuteInst_fprem1()
 
 void Context::ExecuteInst_fptan()
 {
-	unsigned char st0[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fptan\n\t"
-		"fnstsw %%ax\n\t"
-		"fstp %%st(0)\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = std::tan(st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
 
@@ -1954,32 +1457,18 @@ void Context::ExecuteInst_fptan()
 			0);
 
 	ExecuteInst_fld1();
-	StoreFpuCode(status);
 }
 
 
 void Context::ExecuteInst_frndint()
 {
-	unsigned char st0[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
+	long double st0 = LoadFpu(0);
 
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"frndint\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	FpuBegin();
+	st0 = std::nearbyint(st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpRound,
 			Uinst::DepSt0,
@@ -1994,29 +1483,21 @@ void Context::ExecuteInst_frndint()
 
 void Context::ExecuteInst_fscale()
 {
-	unsigned char st0[10], st1[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(1, st1);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %3\n\t"
-		"fldt %2\n\t"
-		"fscale\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"fstp %%st(0)\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (*st1)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double st1 = LoadFpu(1);
+
+	// The exponent is truncated, and clamped to a range that already
+	// overflows or underflows any extended precision value.
+	long double exponent = std::trunc(st1);
+	FpuBegin();
+	if (std::isnan(exponent))
+		st0 += exponent;
+	else
+		st0 = std::scalbln(st0, (long) std::max(-65536.0L,
+				std::min(65536.0L, exponent)));
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpExp,
 			Uinst::DepSt0,
@@ -2031,26 +1512,13 @@ void Context::ExecuteInst_fscale()
 
 void Context::ExecuteInst_fsin()
 {
-	unsigned char st0[10];
-	short status;
-
-	LoadFpu(0, st0);
+	long double st0 = LoadFpu(0);
 
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fsin\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	FpuBegin();
+	st0 = std::sin(st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSin,
 			Uinst::DepSt0,
@@ -2065,30 +1533,15 @@ void Context::ExecuteInst_fsin()
 
 void Context::ExecuteInst_fsincos()
 {
-	unsigned char st0[10], vsin[10], vcos[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %3\n\t"
-		"fsin\n\t"
-		"fstpt %0\n\t"
-		"fldt %3\n\t"
-		"fcos\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %1\n\t"
-		"mov %%ax, %2\n\t"
-		: "=m" (*vsin), "=m" (*vcos), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpu(0, vsin);
-	PushFpu(vcos);
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	long double value_sin = std::sin(st0);
+	long double value_cos = std::cos(st0);
+	FpuEnd();
+
+	StoreFpu(0, value_sin);
+	PushFpu(value_cos);
 
 	newUinst(Uinst::OpcodeFpPush,
 			0,
@@ -2104,26 +1557,13 @@ void Context::ExecuteInst_fsincos()
 
 void Context::ExecuteInst_fsqrt()
 {
-	unsigned char st0[10];
-	unsigned short status;
+	long double st0 = LoadFpu(0);
 
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fsqrt\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	FpuBegin();
+	st0 = FpuRoundPrecision(std::sqrt(st0));
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSqrt,
 			Uinst::DepSt0,
@@ -2138,11 +1578,12 @@ void Context::ExecuteInst_fsqrt()
 
 void Context::ExecuteInst_fst_m32()
 {
-	unsigned char st0[10];
-	float m32;
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	float m32 = st0;
+	FpuEnd();
 
-	LoadFpu(0, st0);
-	m32 = Extended::ExtendedToFloat(st0);
 	StoreFloat(m32);
 
 	newUinst(Uinst::OpcodeFpMove,
@@ -2158,11 +1599,12 @@ void Context::ExecuteInst_fst_m32()
 
 void Context::ExecuteInst_fst_m64()
 {
-	unsigned char st0[10];
-	double m64;
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	double m64 = st0;
+	FpuEnd();
 
-	LoadFpu(0, st0);
-	m64 = Extended::ExtendedToDouble(st0);
 	StoreDouble(m64);
 
 	newUinst(Uinst::OpcodeFpMove,
@@ -2178,10 +1620,7 @@ void Context::ExecuteInst_fst_m64()
 
 void Context::ExecuteInst_fst_sti()
 {
-	unsigned char st0[10];
-
-	LoadFpu(0, st0);
-	StoreFpu(inst.getOpIndex(), st0);
+	StoreFpu(inst.getOpIndex(), LoadFpu(0));
 
 	newUinst(Uinst::OpcodeFpMove,
 			Uinst::DepSt0,
@@ -2197,7 +1636,7 @@ void Context::ExecuteInst_fst_sti()
 void Context::ExecuteInst_fstp_m32()
 {
 	ExecuteInst_fst_m32();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -2213,7 +1652,7 @@ void Context::ExecuteInst_fstp_m32()
 void Context::ExecuteInst_fstp_m64()
 {
 	ExecuteInst_fst_m64();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -2228,9 +1667,7 @@ void Context::ExecuteInst_fstp_m64()
 
 void Context::ExecuteInst_fstp_m80()
 {
-	unsigned char m80[10];
-
-	PopFpu(m80);
+	long double m80 = PopFpu();
 	StoreExtended(m80);
 
 	newUinst(Uinst::OpcodeFpMove,
@@ -2248,7 +1685,7 @@ void Context::ExecuteInst_fstp_m80()
 void Context::ExecuteInst_fstp_sti()
 {
 	ExecuteInst_fst_sti();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -2279,29 +1716,14 @@ void Context::ExecuteInst_fstsw_ax()
 
 void Context::ExecuteInst_fsub_m32()
 {
-	unsigned char st0[10];
-	float m32;
-	unsigned short status;
-
-	m32 = LoadFloat();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"flds %3\n\t"
-		"fsubrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (m32)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	float m32 = LoadFloat();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 - m32);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSub,
 			Uinst::DepSt0,
@@ -2316,29 +1738,14 @@ void Context::ExecuteInst_fsub_m32()
 
 void Context::ExecuteInst_fsub_m64()
 {
-	unsigned char st0[10];
-	double m64;
-	unsigned short status;
-
-	m64 = LoadDouble();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldl %3\n\t"
-		"fsubrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (m64)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	double m64 = LoadDouble();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 - m64);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSub,
 			Uinst::DepSt0,
@@ -2353,28 +1760,14 @@ void Context::ExecuteInst_fsub_m64()
 
 void Context::ExecuteInst_fsub_st0_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fsubrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*st0), "m" (*sti)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(st0 - sti);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSub,
 			Uinst::DepSt0,
@@ -2389,28 +1782,14 @@ void Context::ExecuteInst_fsub_st0_sti()
 
 void Context::ExecuteInst_fsub_sti_st0()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fsubrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*sti), "=g" (status)
-		: "m" (*sti), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	sti = FpuRoundPrecision(sti - st0);
+	FpuEnd();
 
 	StoreFpu(inst.getOpIndex(), sti);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSub,
 			Uinst::DepSt0,
@@ -2426,7 +1805,7 @@ void Context::ExecuteInst_fsub_sti_st0()
 void Context::ExecuteInst_fsubp_sti_st0()
 {
 	ExecuteInst_fsub_sti_st0();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -2441,29 +1820,14 @@ void Context::ExecuteInst_fsubp_sti_st0()
 
 void Context::ExecuteInst_fsubr_m32()
 {
-	unsigned char st0[10];
-	float m32;
-	unsigned short status;
-
-	m32 = LoadFloat();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"flds %2\n\t"
-		"fldt %3\n\t"
-		"fsubrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (m32), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	float m32 = LoadFloat();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(m32 - st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSub,
 			Uinst::DepSt0,
@@ -2478,29 +1842,14 @@ void Context::ExecuteInst_fsubr_m32()
 
 void Context::ExecuteInst_fsubr_m64()
 {
-	unsigned char st0[10];
-	double m64;
-	unsigned short status;
-
-	m64 = LoadDouble();
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldl %2\n\t"
-		"fldt %3\n\t"
-		"fsubrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (m64), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	double m64 = LoadDouble();
+	long double st0 = LoadFpu(0);
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(m64 - st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSub,
 			Uinst::DepSt0,
@@ -2515,28 +1864,14 @@ void Context::ExecuteInst_fsubr_m64()
 
 void Context::ExecuteInst_fsubr_st0_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fsubrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st0), "=g" (status)
-		: "m" (*sti), "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	st0 = FpuRoundPrecision(sti - st0);
+	FpuEnd();
 
 	StoreFpu(0, st0);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSub,
 			Uinst::DepSt0,
@@ -2551,28 +1886,14 @@ void Context::ExecuteInst_fsubr_st0_sti()
 
 void Context::ExecuteInst_fsubr_sti_st0()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %3\n\t"
-		"fsubrp %%st(0), %%st(1)\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*sti), "=g" (status)
-		: "m" (*st0), "m" (*sti)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+
+	FpuBegin();
+	sti = FpuRoundPrecision(st0 - sti);
+	FpuEnd();
 
 	StoreFpu(inst.getOpIndex(), sti);
-	StoreFpuCode(status);
 
 	newUinst(Uinst::OpcodeFpSub,
 			Uinst::DepSt0,
@@ -2588,7 +1909,7 @@ void Context::ExecuteInst_fsubr_sti_st0()
 void Context::ExecuteInst_fsubrp_sti_st0()
 {
 	ExecuteInst_fsubr_sti_st0();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -2608,7 +1929,8 @@ void Context::ExecuteInst_fstcw_m16()
 	// Store value of FP control word
 	unsigned address = getEffectiveAddress();
 	MemoryWrite(address, 2, &value);
-	emulator->isa_debug << misc::fmt(" [0x%x]<=0x%x", address, value);
+	if (emulator->isa_debug)
+		emulator->isa_debug << misc::fmt(" [0x%x]<=0x%x", address, value);
 
 	// Micro-instructions
 	newUinst(Uinst::OpcodeFpMove,
@@ -2624,25 +1946,8 @@ void Context::ExecuteInst_fstcw_m16()
 
 void Context::ExecuteInst_ftst()
 {
-	unsigned char st0[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %1\n\t"
-		"ftst\n\t"
-		"fnstsw %%ax\n\t"
-		"fstp %%st(0)\n\t"
-		"mov %%ax, %0\n\t"
-		: "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+	regs.setFpuCode(FpuCompareCode(st0, 0.0L));
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -2657,26 +1962,9 @@ void Context::ExecuteInst_ftst()
 
 void Context::ExecuteInst_fucom_sti()
 {
-	unsigned char st0[10], sti[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %1\n\t"
-		"fucompp\n\t"
-		"fnstsw %%ax\n\t"
-		"mov %%ax, %0\n\t"
-		: "=g" (status)
-		: "m" (*st0), "m" (*sti)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpuCode(status);
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
+	regs.setFpuCode(FpuCompareCode(st0, sti));
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -2692,7 +1980,7 @@ void Context::ExecuteInst_fucom_sti()
 void Context::ExecuteInst_fucomp_sti()
 {
 	ExecuteInst_fucom_sti();
-	PopFpu(nullptr);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpPop,
 			0,
@@ -2707,28 +1995,11 @@ void Context::ExecuteInst_fucomp_sti()
 
 void Context::ExecuteInst_fucompp()
 {
-	unsigned char st0[10], st1[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(1, st1);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %2\n\t"
-		"fldt %1\n\t"
-		"fucompp\n\t"
-		"fnstsw %%ax\n\t"
-		"mov %%ax, %0\n\t"
-		: "=g" (status)
-		: "m" (*st0), "m" (*st1)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
-
-	StoreFpuCode(status);
-	PopFpu(nullptr);
-	PopFpu(nullptr);
+	long double st0 = LoadFpu(0);
+	long double st1 = LoadFpu(1);
+	regs.setFpuCode(FpuCompareCode(st0, st1));
+	PopFpu();
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -2752,25 +2023,38 @@ void Context::ExecuteInst_fucompp()
 
 void Context::ExecuteInst_fxam()
 {
-	unsigned char st0[10];
-	unsigned short status;
+	long double st0 = LoadFpu(0);
+
+	// Sign in C1, class in C3, C2, and C0
+	int code = std::signbit(st0) ? FpuCodeC1 : 0;
+	switch (std::fpclassify(st0))
+	{
+
+	case FP_NAN:
 
-	LoadFpu(0, st0);
+		code |= FpuCodeC0;
+		break;
 
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %1\n\t"
-		"fxam\n\t"
-		"fstsw %%ax\n\t"
-		"mov %%ax, %0\n\t"
-		"fstp %%st(0)\n\t"
-		: "=g" (status)
-		: "m" (*st0)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	case FP_INFINITE:
 
-	StoreFpuCode(status);
+		code |= FpuCodeC2 | FpuCodeC0;
+		break;
+
+	case FP_ZERO:
+
+		code |= FpuCodeC3;
+		break;
+
+	case FP_SUBNORMAL:
+
+		code |= FpuCodeC3 | FpuCodeC2;
+		break;
+
+	default:
+
+		code |= FpuCodeC2;
+	}
+	regs.setFpuCode(code);
 
 	newUinst(Uinst::OpcodeFpComp,
 			Uinst::DepSt0,
@@ -2785,9 +2069,8 @@ void Context::ExecuteInst_fxam()
 
 void Context::ExecuteInst_fxch_sti()
 {
-	unsigned char st0[10], sti[10];
-	LoadFpu(0, st0);
-	LoadFpu(inst.getOpIndex(), sti);
+	long double st0 = LoadFpu(0);
+	long double sti = LoadFpu(inst.getOpIndex());
 	StoreFpu(0, sti);
 	StoreFpu(inst.getOpIndex(), st0);
 
@@ -2804,29 +2087,15 @@ void Context::ExecuteInst_fxch_sti()
 
 void Context::ExecuteInst_fyl2x()
 {
-	unsigned char st0[10], st1[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(1, st1);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %3\n\t"
-		"fldt %2\n\t"
-		"fyl2x\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st1), "=g" (status)
-		: "m" (*st0), "m" (*st1)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double st1 = LoadFpu(1);
+
+	FpuBegin();
+	st1 = st1 * std::log2(st0);
+	FpuEnd();
 
 	StoreFpu(1, st1);
-	PopFpu(nullptr);
-	StoreFpuCode(status);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpLog,
 			Uinst::DepSt0,
@@ -2842,29 +2111,15 @@ void Context::ExecuteInst_fyl2x()
 
 void Context::ExecuteInst_fyl2xp1()
 {
-	unsigned char st0[10], st1[10];
-	unsigned short status;
-
-	LoadFpu(0, st0);
-	LoadFpu(1, st1);
-
-	__X86_CONTEXT_FP_BEGIN__
-	asm volatile (
-		"fldt %3\n\t"
-		"fldt %2\n\t"
-		"fyl2xp1\n\t"
-		"fnstsw %%ax\n\t"
-		"fstpt %0\n\t"
-		"mov %%ax, %1\n\t"
-		: "=m" (*st1), "=g" (status)
-		: "m" (*st0), "m" (*st1)
-		: "ax"
-	);
-	__X86_CONTEXT_FP_END__
+	long double st0 = LoadFpu(0);
+	long double st1 = LoadFpu(1);
+
+	FpuBegin();
+	st1 = st1 * std::log1p(st0) / FpuLn2;
+	FpuEnd();
 
 	StoreFpu(1, st1);
-	PopFpu(nullptr);
-	StoreFpuCode(status);
+	PopFpu();
 
 	newUinst(Uinst::OpcodeFpLog,
 			Uinst::DepSt0,
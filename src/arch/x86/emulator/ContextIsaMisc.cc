@@ -17,6 +17,9 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <chrono>
+#include <cstdint>
+
 #include <lib/cpp/Misc.h>
 
 #include "Context.h"
@@ -36,6 +39,46 @@ namespace x86
 #define assert __COMPILATION_ERROR__
 
 
+// Shift 'dst' left by 'count' bits, filling it with the most significant bits
+// of 'src', as done by instruction 'shld'. The count is taken modulo 32, and
+// flags are left unchanged if it is 0.
+static inline unsigned ShiftDoubleLeft(Regs &regs, unsigned size,
+		unsigned dst, unsigned src, unsigned count)
+{
+	count &= 0x1f;
+	if (!count)
+		return dst;
+	unsigned bits = size * 8;
+	unsigned long long value = ((unsigned long long) dst << bits) | src;
+	unsigned result = (value << count) >> bits;
+
+	// Flags are those of a left shift of the destination
+	regs.setLazyFlags(Regs::FlagsOpShl, size, result, dst, count);
+	return result;
+}
+
+
+// Shift 'dst' right by 'count' bits, filling it with the least significant
+// bits of 'src', as done by instruction 'shrd'. The count is taken modulo
+// 32, and flags are left unchanged if it is 0.
+static inline unsigned ShiftDoubleRight(Regs &regs, unsigned size,
+		unsigned dst, unsigned src, unsigned count)
+{
+	count &= 0x1f;
+	if (!count)
+		return dst;
+	unsigned bits = size * 8;
+	unsigned long long value = ((unsigned long long) src << bits) | dst;
+	unsigned result = value >> count;
+
+	// Flags are those of a right shift of the destination, except for
+	// OF, which is set on a change of sign
+	regs.setLazyFlags(Regs::FlagsOpShr, size, result, dst, count);
+	regs.setFlag(Instruction::FlagOF, ((result ^ dst) >> (bits - 1)) & 1);
+	return result;
+}
+
+
 void Context::ExecuteInst_bound_r16_rm32()
 {
 	throw misc::Panic("Unimplemented instruction");
@@ -52,25 +95,13 @@ void Context::ExecuteInst_bsf_r32_rm32()
 {
 	unsigned int r32 = LoadR32();
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"bsf %3, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (r32)
-		: "g" (r32), "g" (rm32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	// The destination is left unchanged if the source is 0
+	if (rm32)
+		r32 = __builtin_ctz(rm32);
+	regs.setFlag(Instruction::FlagZF, !rm32);
 
 	StoreR32(r32);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -84,27 +115,13 @@ void Context::ExecuteInst_bsf_r32_rm32()
 
 void Context::ExecuteInst_tzcnt_r32_rm32()
 {
-	unsigned int r32 = LoadR32();
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"tzcnt %3, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (r32)
-		: "g" (r32), "g" (rm32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int r32 = rm32 ? __builtin_ctz(rm32) : 32;
+
+	regs.setFlag(Instruction::FlagCF, !rm32);
+	regs.setFlag(Instruction::FlagZF, !r32);
 
 	StoreR32(r32);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -121,25 +138,13 @@ void Context::ExecuteInst_bsr_r32_rm32()
 {
 	unsigned int r32 = LoadR32();
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"bsr %3, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (r32)
-		: "m" (r32), "m" (rm32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	// The destination is left unchanged if the source is 0
+	if (rm32)
+		r32 = 31 - __builtin_clz(rm32);
+	regs.setFlag(Instruction::FlagZF, !rm32);
 
 	StoreR32(r32);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -156,16 +161,7 @@ void Context::ExecuteInst_bswap_ir32()
 {
 	unsigned int ir32 = LoadIR32();
 
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"mov %1, %%eax\n\t"
-		"bswap %%eax\n\t"
-		"mov %%eax, %0\n\t"
-		: "=g" (ir32)
-		: "g" (ir32)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	ir32 = __builtin_bswap32(ir32);
 
 	StoreIR32(ir32);
 
@@ -184,24 +180,8 @@ void Context::ExecuteInst_bt_rm32_r32()
 {
 	unsigned int rm32 = LoadRm32();
 	unsigned int r32 = LoadR32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%ecx\n\t"
-		"mov %1, %%eax\n\t"
-		"bt %%ecx, %%eax\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags)
-		: "m" (rm32), "m" (r32), "g" (flags)
-		: "eax", "ecx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	regs.setEflags(flags);
+
+	regs.setFlag(Instruction::FlagCF, (rm32 >> (r32 & 0x1f)) & 1);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -218,24 +198,8 @@ void Context::ExecuteInst_bt_rm32_imm8()
 {
 	unsigned int rm32 = LoadRm32();
 	unsigned int imm8 = inst.getImmByte();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%ecx\n\t"
-		"mov %1, %%eax\n\t"
-		"bt %%ecx, %%eax\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags)
-		: "m" (rm32), "m" (imm8), "g" (flags)
-		: "eax", "ecx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	regs.setEflags(flags);
+
+	regs.setFlag(Instruction::FlagCF, (rm32 >> (imm8 & 0x1f)) & 1);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -252,26 +216,11 @@ void Context::ExecuteInst_bts_rm32_imm8()
 {
 	unsigned int rm32 = LoadRm32();
 	unsigned int imm8 = inst.getImmByte();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %3, %%ecx\n\t"
-		"mov %2, %%eax\n\t"
-		"btsl %%ecx, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (rm32)
-		: "m" (rm32), "m" (imm8), "g" (flags)
-		: "eax", "ecx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	regs.setFlag(Instruction::FlagCF, (rm32 >> (imm8 & 0x1f)) & 1);
+	rm32 |= 1u << (imm8 & 0x1f);
 
 	StoreRm32(rm32);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -437,29 +386,16 @@ void Context::ExecuteInst_cld()
 void Context::ExecuteInst_cmpxchg_rm32_r32()
 {
 	unsigned int eax = regs.getEax();
-	unsigned long flags = regs.getEflags();
 	unsigned int rm32 = LoadRm32();
 	unsigned int r32 = LoadR32();
 
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %4, %%eax\n\t"
-		"mov %5, %%ebx\n\t"
-		"mov %6, %%ecx\n\t"
-		"cmpxchg %%ecx, %%ebx\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		"mov %%eax, %1\n\t"
-		"mov %%ebx, %2\n\t"
-		: "=g" (flags), "=m" (eax), "=m" (rm32)
-		: "g" (flags), "m" (eax), "m" (rm32), "m" (r32)
-		: "eax", "ebx", "ecx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	regs.setEflags(flags);
+	// Compare the accumulator with the destination
+	regs.setLazyFlags(Regs::FlagsOpSub, 4, eax - rm32, eax, rm32);
+	if (eax == rm32)
+		rm32 = r32;
+	else
+		eax = rm32;
+
 	regs.Write(Instruction::RegEax, eax);
 	StoreRm32(rm32);
 
@@ -717,25 +653,13 @@ void Context::ExecuteInst_cwde()
 void Context::ExecuteInst_dec_rm8()
 {
 	unsigned char rm8 = LoadRm8();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%al\n\t"
-		"dec %%al\n\t"
-		"mov %%al, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (rm8)
-		: "g" (rm8), "g" (flags)
-		: "al"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	StoreRm8(rm8);
-	regs.setEflags(flags);
+	unsigned char result = rm8 - 1;
+
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpDec, 1, result, rm8, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreRm8(result);
 
 	newUinst(Uinst::OpcodeSub,
 			Uinst::DepRm8,
@@ -751,25 +675,13 @@ void Context::ExecuteInst_dec_rm8()
 void Context::ExecuteInst_dec_rm16()
 {
 	unsigned short rm16 = LoadRm16();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%ax\n\t"
-		"dec %%ax\n\t"
-		"mov %%ax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (rm16)
-		: "g" (rm16), "g" (flags)
-		: "ax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned short result = rm16 - 1;
 
-	StoreRm16(rm16);
-	regs.setEflags(flags);
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpDec, 2, result, rm16, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreRm16(result);
 
 	newUinst(Uinst::OpcodeSub,
 			Uinst::DepRm16,
@@ -785,25 +697,13 @@ void Context::ExecuteInst_dec_rm16()
 void Context::ExecuteInst_dec_rm32()
 {
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"dec %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (rm32)
-		: "g" (rm32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int result = rm32 - 1;
 
-	StoreRm32(rm32);
-	regs.setEflags(flags);
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpDec, 4, result, rm32, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreRm32(result);
 
 	newUinst(Uinst::OpcodeSub,
 			Uinst::DepRm32,
@@ -819,25 +719,13 @@ void Context::ExecuteInst_dec_rm32()
 void Context::ExecuteInst_dec_ir16()
 {
 	unsigned short ir16 = LoadIR16();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%ax\n\t"
-		"dec %%ax\n\t"
-		"mov %%ax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (ir16)
-		: "g" (ir16), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	StoreIR16(ir16);
-	regs.setEflags(flags);
+	unsigned short result = ir16 - 1;
+
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpDec, 2, result, ir16, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreIR16(result);
 
 	newUinst(Uinst::OpcodeSub,
 			Uinst::DepIr16,
@@ -853,25 +741,13 @@ void Context::ExecuteInst_dec_ir16()
 void Context::ExecuteInst_dec_ir32()
 {
 	unsigned int ir32 = LoadIR32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"dec %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (ir32)
-		: "g" (ir32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int result = ir32 - 1;
 
-	StoreIR32(ir32);
-	regs.setEflags(flags);
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpDec, 4, result, ir32, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreIR32(result);
 
 	newUinst(Uinst::OpcodeSub,
 			Uinst::DepIr32,
@@ -886,34 +762,23 @@ void Context::ExecuteInst_dec_ir32()
 
 void Context::ExecuteInst_div_rm8()
 {
-	int skip_emulation;
-	int spec_mode;
-
 	unsigned short ax = regs.Read(Instruction::RegAx);
 	unsigned char rm8 = LoadRm8();
 
 	if (!rm8)
 		throw Error("Division by 0");
 
-	/* A devide exception would occur in the host process if the 'div' instruction
-	 * in the assembly code below generates a result greater than 0xff. */
-	spec_mode = getState(StateSpecMode);
-	skip_emulation = spec_mode && ax > 0xff;
-
-	// Emulate
-	if (!skip_emulation)
+	// A quotient greater than 0xff causes a divide exception. Emulation
+	// is skipped in speculative mode.
+	unsigned quotient = ax / rm8;
+	if (quotient > 0xff)
+	{
+		if (!getState(StateSpecMode))
+			throw Error("Division overflow");
+	}
+	else
 	{
-		__X86_CONTEXT_SAVE_FLAGS__
-		asm volatile (
-			"mov %1, %%ax\n\t"
-			"mov %2, %%bl\n\t"
-			"div %%bl\n\t"
-			"mov %%ax, %0\n\t"
-			: "=m" (ax)
-			: "m" (ax), "m" (rm8)
-			: "ax", "bl"
-		);
-		__X86_CONTEXT_RESTORE_FLAGS__
+		ax = (ax % rm8) << 8 | quotient;
 	}
 
 	regs.Write(Instruction::RegAx, ax);
@@ -931,9 +796,6 @@ void Context::ExecuteInst_div_rm8()
 
 void Context::ExecuteInst_div_rm32()
 {
-	int spec_mode;
-	int skip_emulation;
-
 	unsigned int eax = regs.getEax();
 	unsigned int edx = regs.getEdx();
 	unsigned int rm32 = LoadRm32();
@@ -941,27 +803,19 @@ void Context::ExecuteInst_div_rm32()
 	if (!rm32)
 		throw Error("Division by 0");
 
-	/* A devide exception would occur in the host process if the 'div' instruction
-	 * in the assembly code below generates a result greater than 0xffffffff. */
-	spec_mode = getState(StateSpecMode);
-	skip_emulation = spec_mode && edx;
-
-	// Emulate
-	if (!skip_emulation)
+	// A quotient greater than 0xffffffff causes a divide exception.
+	// Emulation is skipped in speculative mode.
+	unsigned long long edx_eax = ((unsigned long long) edx << 32) | eax;
+	unsigned long long quotient = edx_eax / rm32;
+	if (quotient > 0xffffffffull)
+	{
+		if (!getState(StateSpecMode))
+			throw Error("Division overflow");
+	}
+	else
 	{
-		__X86_CONTEXT_SAVE_FLAGS__
-		asm volatile (
-			"mov %2, %%eax\n\t"
-			"mov %3, %%edx\n\t"
-			"mov %4, %%ebx\n\t"
-			"div %%ebx\n\t"
-			"mov %%eax, %0\n\t"
-			"mov %%edx, %1\n\t"
-			: "=m" (eax), "=m" (edx)
-			: "m" (eax), "m" (edx), "m" (rm32)
-			: "eax", "edx", "ebx"
-		);
-		__X86_CONTEXT_RESTORE_FLAGS__
+		eax = quotient;
+		edx = edx_eax % rm32;
 	}
 
 	regs.Write(Instruction::RegEax, eax);
@@ -986,9 +840,6 @@ void Context::ExecuteInst_hlt()
 
 void Context::ExecuteInst_idiv_rm32()
 {
-	int spec_mode;
-	int skip_emulation;
-
 	unsigned int eax = regs.getEax();
 	unsigned int edx = regs.getEdx();
 	unsigned int rm32 = LoadRm32();
@@ -996,32 +847,21 @@ void Context::ExecuteInst_idiv_rm32()
 	if (!rm32)
 		throw Error("Division by 0");
 
-	// Avoid emulation in speculative mode if it could cause a divide exception
-	skip_emulation = 0;
-	spec_mode = getState(StateSpecMode);
-	if (spec_mode)
+	// A quotient out of the range of a signed 32-bit integer causes a
+	// divide exception. Emulation is skipped in speculative mode.
+	long long edx_eax = ((unsigned long long) edx << 32) | eax;
+	long long divisor = (int) rm32;
+	bool overflow = divisor == -1 && edx_eax == INT64_MIN;
+	long long quotient = overflow ? 0 : edx_eax / divisor;
+	if (overflow || quotient > INT32_MAX || quotient < INT32_MIN)
 	{
-		long long edx_eax = ((unsigned long long) edx << 32) | eax;
-		if (edx_eax > (long long) 0x7fffffffll
-				|| edx_eax < (long long) 0xffffffff80000000ll)
-			skip_emulation = 1;
+		if (!getState(StateSpecMode))
+			throw Error("Division overflow");
 	}
-
-	if (!skip_emulation)
+	else
 	{
-		__X86_CONTEXT_SAVE_FLAGS__
-		asm volatile (
-			"mov %2, %%eax\n\t"
-			"mov %3, %%edx\n\t"
-			"mov %4, %%ebx\n\t"
-			"idiv %%ebx\n\t"
-			"mov %%eax, %0\n\t"
-			"mov %%edx, %1\n\t"
-			: "=m" (eax), "=m" (edx)
-			: "m" (eax), "m" (edx), "m" (rm32)
-			: "eax", "edx", "ebx"
-		);
-		__X86_CONTEXT_RESTORE_FLAGS__
+		eax = quotient;
+		edx = edx_eax % divisor;
 	}
 
 	regs.Write(Instruction::RegEax, eax);
@@ -1042,29 +882,15 @@ void Context::ExecuteInst_imul_rm32()
 {
 	unsigned int eax = regs.Read(Instruction::RegEax);
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-	unsigned int edx;
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %5\n\t"
-		"popf\n\t"
-		"mov %3, %%eax\n\t"
-		"mov %4, %%edx\n\t"
-		"imul %%edx\n\t"
-		"mov %%edx, %1\n\t"
-		"mov %%eax, %2\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (edx), "=m" (eax)
-		: "m" (eax), "m" (rm32), "g" (flags)
-		: "eax", "edx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
 
-	regs.Write(Instruction::RegEax, eax);
-	regs.Write(Instruction::RegEdx, edx);
-	regs.setEflags(flags);
+	// Flags CF and OF are set if the upper half is not a sign extension
+	long long product = (long long) (int) eax * (int) rm32;
+	bool overflow = product != (int) product;
+	regs.setFlag(Instruction::FlagCF, overflow);
+	regs.setFlag(Instruction::FlagOF, overflow);
+
+	regs.Write(Instruction::RegEax, product);
+	regs.Write(Instruction::RegEdx, product >> 32);
 
 	newUinst(Uinst::OpcodeMult,
 			Uinst::DepRm32,
@@ -1081,26 +907,14 @@ void Context::ExecuteInst_imul_r16_rm16()
 {
 	unsigned int r16 = LoadR16();
 	unsigned int rm16 = LoadRm16();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%ax\n\t"
-		"mov %3, %%bx\n\t"
-		"imul %%bx, %%ax\n\t"
-		"mov %%ax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (r16)
-		: "m" (r16), "m" (rm16), "g" (flags)
-		: "ax", "bx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	StoreR16(r16);
-	regs.setEflags(flags);
+
+	// Flags CF and OF are set if the result is truncated
+	int product = (short) r16 * (short) rm16;
+	bool overflow = product != (short) product;
+	regs.setFlag(Instruction::FlagCF, overflow);
+	regs.setFlag(Instruction::FlagOF, overflow);
+
+	StoreR16(product);
 
 	newUinst(Uinst::OpcodeMult,
 			Uinst::DepR16,
@@ -1117,26 +931,14 @@ void Context::ExecuteInst_imul_r32_rm32()
 {
 	unsigned int r32 = LoadR32();
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"mov %3, %%ebx\n\t"
-		"imul %%ebx, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (r32)
-		: "m" (r32), "m" (rm32), "g" (flags)
-		: "eax", "ebx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
 
-	StoreR32(r32);
-	regs.setEflags(flags);
+	// Flags CF and OF are set if the result is truncated
+	long long product = (long long) (int) r32 * (int) rm32;
+	bool overflow = product != (int) product;
+	regs.setFlag(Instruction::FlagCF, overflow);
+	regs.setFlag(Instruction::FlagOF, overflow);
+
+	StoreR32(product);
 
 	newUinst(Uinst::OpcodeMult,
 			Uinst::DepR32,
@@ -1151,29 +953,16 @@ void Context::ExecuteInst_imul_r32_rm32()
 
 void Context::ExecuteInst_imul_r32_rm32_imm8()
 {
-	unsigned int r32;
-	unsigned int rm32 = LoadRm32();
 	unsigned int imm8 = (char) inst.getImmByte();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"mov %3, %%ebx\n\t"
-		"imul %%ebx, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (r32)
-		: "m" (rm32), "m" (imm8), "g" (flags)
-		: "eax", "ebx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int rm32 = LoadRm32();
 
-	StoreR32(r32);
-	regs.setEflags(flags);
+	// Flags CF and OF are set if the result is truncated
+	long long product = (long long) (int) imm8 * (int) rm32;
+	bool overflow = product != (int) product;
+	regs.setFlag(Instruction::FlagCF, overflow);
+	regs.setFlag(Instruction::FlagOF, overflow);
+
+	StoreR32(product);
 
 	newUinst(Uinst::OpcodeMult,
 			Uinst::DepRm32,
@@ -1188,29 +977,16 @@ void Context::ExecuteInst_imul_r32_rm32_imm8()
 
 void Context::ExecuteInst_imul_r32_rm32_imm32()
 {
-	unsigned int r32;
-	unsigned int rm32 = LoadRm32();
 	unsigned int imm32 = inst.getImmDWord();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"mov %3, %%ebx\n\t"
-		"imul %%ebx, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (r32)
-		: "m" (rm32), "m" (imm32), "g" (flags)
-		: "eax", "ebx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int rm32 = LoadRm32();
 
-	StoreR32(r32);
-	regs.setEflags(flags);
+	// Flags CF and OF are set if the result is truncated
+	long long product = (long long) (int) imm32 * (int) rm32;
+	bool overflow = product != (int) product;
+	regs.setFlag(Instruction::FlagCF, overflow);
+	regs.setFlag(Instruction::FlagOF, overflow);
+
+	StoreR32(product);
 
 	newUinst(Uinst::OpcodeMult,
 			Uinst::DepRm32,
@@ -1226,25 +1002,13 @@ void Context::ExecuteInst_imul_r32_rm32_imm32()
 void Context::ExecuteInst_inc_rm8()
 {
 	unsigned char rm8 = LoadRm8();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%al\n\t"
-		"inc %%al\n\t"
-		"mov %%al, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (rm8)
-		: "g" (rm8), "g" (flags)
-		: "al"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	StoreRm8(rm8);
-	regs.setEflags(flags);
+	unsigned char result = rm8 + 1;
+
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpInc, 1, result, rm8, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreRm8(result);
 
 	newUinst(Uinst::OpcodeAdd,
 			Uinst::DepRm8,
@@ -1260,25 +1024,13 @@ void Context::ExecuteInst_inc_rm8()
 void Context::ExecuteInst_inc_rm16()
 {
 	unsigned short rm16 = LoadRm16();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%ax\n\t"
-		"inc %%ax\n\t"
-		"mov %%ax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (rm16)
-		: "g" (rm16), "g" (flags)
-		: "ax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned short result = rm16 + 1;
 
-	StoreRm16(rm16);
-	regs.setEflags(flags);
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpInc, 2, result, rm16, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreRm16(result);
 
 	newUinst(Uinst::OpcodeAdd,
 			Uinst::DepRm16,
@@ -1294,25 +1046,13 @@ void Context::ExecuteInst_inc_rm16()
 void Context::ExecuteInst_inc_rm32()
 {
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"inc %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (rm32)
-		: "g" (rm32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int result = rm32 + 1;
 
-	StoreRm32(rm32);
-	regs.setEflags(flags);
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpInc, 4, result, rm32, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreRm32(result);
 
 	newUinst(Uinst::OpcodeAdd,
 			Uinst::DepRm32,
@@ -1328,25 +1068,13 @@ void Context::ExecuteInst_inc_rm32()
 void Context::ExecuteInst_inc_ir16()
 {
 	unsigned short ir16 = LoadIR16();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%ax\n\t"
-		"inc %%ax\n\t"
-		"mov %%ax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (ir16)
-		: "g" (ir16), "g" (flags)
-		: "ax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	StoreIR16(ir16);
-	regs.setEflags(flags);
+	unsigned short result = ir16 + 1;
+
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpInc, 2, result, ir16, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreIR16(result);
 
 	newUinst(Uinst::OpcodeAdd,
 			Uinst::DepIr16,
@@ -1362,25 +1090,13 @@ void Context::ExecuteInst_inc_ir16()
 void Context::ExecuteInst_inc_ir32()
 {
 	unsigned int ir32 = LoadIR32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"inc %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (ir32)
-		: "g" (ir32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int result = ir32 + 1;
 
-	StoreIR32(ir32);
-	regs.setEflags(flags);
+	// The carry flag is preserved
+	regs.setLazyFlags(Regs::FlagsOpInc, 4, result, ir32, 1,
+			regs.getFlag(Instruction::FlagCF));
+
+	StoreIR32(result);
 
 	newUinst(Uinst::OpcodeAdd,
 			Uinst::DepIr32,
@@ -2062,29 +1778,15 @@ void Context::ExecuteInst_mul_rm32()
 {
 	unsigned int eax = regs.Read(Instruction::RegEax);
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-	unsigned int edx;
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %5\n\t"
-		"popf\n\t"
-		"mov %3, %%eax\n\t"
-		"mov %4, %%edx\n\t"
-		"mul %%edx\n\t"
-		"mov %%edx, %1\n\t"
-		"mov %%eax, %2\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (edx), "=m" (eax)
-		: "m" (eax), "m" (rm32), "g" (flags)
-		: "eax", "edx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
 
-	regs.Write(Instruction::RegEax, eax);
-	regs.Write(Instruction::RegEdx, edx);
-	regs.setEflags(flags);
+	// Flags CF and OF are set if the upper half is not 0
+	unsigned long long product = (unsigned long long) eax * rm32;
+	bool overflow = product >> 32;
+	regs.setFlag(Instruction::FlagCF, overflow);
+	regs.setFlag(Instruction::FlagOF, overflow);
+
+	regs.Write(Instruction::RegEax, product);
+	regs.Write(Instruction::RegEdx, product >> 32);
 
 	newUinst(Uinst::OpcodeMult,
 			Uinst::DepRm32,
@@ -2100,25 +1802,12 @@ void Context::ExecuteInst_mul_rm32()
 void Context::ExecuteInst_neg_rm8()
 {
 	unsigned char rm8 = LoadRm8();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%al\n\t"
-		"neg %%al\n\t"
-		"mov %%al, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (rm8)
-		: "g" (rm8), "g" (flags)
-		: "al"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	StoreRm8(rm8);
-	regs.setEflags(flags);
+	unsigned char result = -rm8;
+
+	// Flags are set as in a subtraction from 0
+	regs.setLazyFlags(Regs::FlagsOpSub, 1, result, 0, rm8);
+
+	StoreRm8(result);
 
 	newUinst(Uinst::OpcodeSub,
 			Uinst::DepRm8,
@@ -2134,25 +1823,12 @@ void Context::ExecuteInst_neg_rm8()
 void Context::ExecuteInst_neg_rm32()
 {
 	unsigned int rm32 = LoadRm32();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"neg %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=g" (rm32)
-		: "g" (rm32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int result = -rm32;
 
-	StoreRm32(rm32);
-	regs.setEflags(flags);
+	// Flags are set as in a subtraction from 0
+	regs.setLazyFlags(Regs::FlagsOpSub, 4, result, 0, rm32);
+
+	StoreRm32(result);
 
 	newUinst(Uinst::OpcodeSub,
 			Uinst::DepRm32,
@@ -2623,21 +2299,14 @@ void Context::ExecuteInst_pushf()
 
 void Context::ExecuteInst_rdtsc()
 {
-	unsigned int eax, edx;
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"rdtsc\n\t"
-		"mov %%eax, %0\n\t"
-		"mov %%edx, %1\n\t"
-		: "=g" (eax), "=g" (edx)
-		:
-		: "eax", "edx"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	// The time stamp counter is emulated with the host monotonic clock,
+	// advancing once per nanosecond.
+	unsigned long long tsc = std::chrono::duration_cast<
+			std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+			.time_since_epoch()).count();
 
-	regs.Write(Instruction::RegEdx, edx);
-	regs.Write(Instruction::RegEax, eax);
+	regs.Write(Instruction::RegEdx, tsc >> 32);
+	regs.Write(Instruction::RegEax, tsc);
 
 	newUinst(Uinst::OpcodeMove,
 			0,
@@ -2789,27 +2458,10 @@ void Context::ExecuteInst_shld_rm16_r16_imm8()
 	unsigned short rm16 = LoadRm16();
 	unsigned short r16 = LoadR16();
 	unsigned char imm8 = inst.getImmByte();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %5\n\t"
-		"popf\n\t"
-		"mov %4, %%cl\n\t"
-		"mov %3, %%bx\n\t"
-		"mov %2, %%ax\n\t"
-		"shld %%cl, %%bx, %%ax\n\t"
-		"mov %%ax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (rm16)
-		: "m" (rm16), "m" (r16), "m" (imm8), "g" (flags)
-		: "ax", "bx", "cl"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	rm16 = ShiftDoubleLeft(regs, 2, rm16, r16, imm8);
 
 	StoreRm16(rm16);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm16,
@@ -2827,27 +2479,10 @@ void Context::ExecuteInst_shld_rm16_r16_cl()
 	unsigned short rm16 = LoadRm16();
 	unsigned short r16 = LoadR16();
 	unsigned char cl = regs.Read(Instruction::RegCl);
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %5\n\t"
-		"popf\n\t"
-		"mov %4, %%cl\n\t"
-		"mov %3, %%bx\n\t"
-		"mov %2, %%ax\n\t"
-		"shld %%cl, %%bx, %%ax\n\t"
-		"mov %%ax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (rm16)
-		: "m" (rm16), "m" (r16), "m" (cl), "g" (flags)
-		: "ax", "bx", "cl"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	rm16 = ShiftDoubleLeft(regs, 2, rm16, r16, cl);
 
 	StoreRm16(rm16);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm16,
@@ -2865,27 +2500,10 @@ void Context::ExecuteInst_shld_rm32_r32_imm8()
 	unsigned int rm32 = LoadRm32();
 	unsigned int r32 = LoadR32();
 	unsigned char imm8 = inst.getImmByte();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %5\n\t"
-		"popf\n\t"
-		"mov %4, %%cl\n\t"
-		"mov %3, %%ebx\n\t"
-		"mov %2, %%eax\n\t"
-		"shld %%cl, %%ebx, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (rm32)
-		: "m" (rm32), "m" (r32), "m" (imm8), "g" (flags)
-		: "eax", "ebx", "cl"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	rm32 = ShiftDoubleLeft(regs, 4, rm32, r32, imm8);
 
 	StoreRm32(rm32);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -2903,27 +2521,10 @@ void Context::ExecuteInst_shld_rm32_r32_cl()
 	unsigned int rm32 = LoadRm32();
 	unsigned int r32 = LoadR32();
 	unsigned char cl = regs.Read(Instruction::RegCl);
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %5\n\t"
-		"popf\n\t"
-		"mov %4, %%cl\n\t"
-		"mov %3, %%ebx\n\t"
-		"mov %2, %%eax\n\t"
-		"shld %%cl, %%ebx, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (rm32)
-		: "m" (rm32), "m" (r32), "m" (cl), "g" (flags)
-		: "eax", "ebx", "cl"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	rm32 = ShiftDoubleLeft(regs, 4, rm32, r32, cl);
 
 	StoreRm32(rm32);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -2941,27 +2542,10 @@ void Context::ExecuteInst_shrd_rm32_r32_imm8()
 	unsigned int rm32 = LoadRm32();
 	unsigned int r32 = LoadR32();
 	unsigned char imm8 = inst.getImmByte();
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %5\n\t"
-		"popf\n\t"
-		"mov %4, %%cl\n\t"
-		"mov %3, %%ebx\n\t"
-		"mov %2, %%eax\n\t"
-		"shrd %%cl, %%ebx, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (rm32)
-		: "m" (rm32), "m" (r32), "m" (imm8), "g" (flags)
-		: "eax", "ebx", "cl"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	rm32 = ShiftDoubleRight(regs, 4, rm32, r32, imm8);
 
 	StoreRm32(rm32);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -2979,27 +2563,10 @@ void Context::ExecuteInst_shrd_rm32_r32_cl()
 	unsigned int rm32 = LoadRm32();
 	unsigned int r32 = LoadR32();
 	unsigned char cl = regs.Read(Instruction::RegCl);
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %5\n\t"
-		"popf\n\t"
-		"mov %4, %%cl\n\t"
-		"mov %3, %%ebx\n\t"
-		"mov %2, %%eax\n\t"
-		"shrd %%cl, %%ebx, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (rm32)
-		: "m" (rm32), "m" (r32), "m" (cl), "g" (flags)
-		: "eax", "ebx", "cl"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+
+	rm32 = ShiftDoubleRight(regs, 4, rm32, r32, cl);
 
 	StoreRm32(rm32);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeShift,
 			Uinst::DepRm32,
@@ -3031,27 +2598,12 @@ void Context::ExecuteInst_xadd_rm8_r8()
 {
 	unsigned char rm8 = LoadRm8();
 	unsigned char r8 = LoadR8();
-	unsigned char sum;
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%al\n\t"
-		"add %3, %%al\n\t"
-		"mov %%al, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (sum)
-		: "m" (rm8), "m" (r8), "g" (flags)
-		: "al"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned char sum = rm8 + r8;
+
+	regs.setLazyFlags(Regs::FlagsOpAdd, 1, sum, rm8, r8);
 
 	StoreR8(rm8);
 	StoreRm8(sum);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeAdd,
 			Uinst::DepRm8,
@@ -3084,27 +2636,12 @@ void Context::ExecuteInst_xadd_rm32_r32()
 {
 	unsigned int rm32 = LoadRm32();
 	unsigned int r32 = LoadR32();
-	unsigned int sum;
-	unsigned long flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %4\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"add %3, %%eax\n\t"
-		"mov %%eax, %1\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags), "=m" (sum)
-		: "m" (rm32), "m" (r32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
+	unsigned int sum = rm32 + r32;
+
+	regs.setLazyFlags(Regs::FlagsOpAdd, 4, sum, rm32, r32);
 
 	StoreR32(rm32);
 	StoreRm32(sum);
-	regs.setEflags(flags);
 
 	newUinst(Uinst::OpcodeAdd,
 			Uinst::DepRm32,
@@ -32,6 +32,128 @@ namespace x86
 #define assert __COMPILATION_ERROR__
 
 
+// Functions emulating rotations and shifts of an operand of 'size' bytes.
+// The count is masked to 5 bits, and a count of 0 does not change the
+// operand or the flags. Shifts record their arithmetic flags for lazy
+// evaluation in the register file, while rotations only set the carry and
+// overflow flags. The overflow flag is only defined for 1-bit rotations and
+// shifts, and it is computed the same way for any count.
+
+static inline unsigned RotOp_shl(Regs &regs, unsigned size,
+		unsigned value, unsigned count)
+{
+	count &= 0x1f;
+	if (!count)
+		return value;
+	unsigned result = value << count;
+	regs.setLazyFlags(Regs::FlagsOpShl, size, result, value, count);
+	return result;
+}
+
+static inline unsigned RotOp_shr(Regs &regs, unsigned size,
+		unsigned value, unsigned count)
+{
+	count &= 0x1f;
+	if (!count)
+		return value;
+	unsigned mask = size == 4 ? 0xffffffff : (1u << (size * 8)) - 1;
+	unsigned result = (value & mask) >> count;
+	regs.setLazyFlags(Regs::FlagsOpShr, size, result, value, count);
+	return result;
+}
+
+static inline unsigned RotOp_sar(Regs &regs, unsigned size,
+		unsigned value, unsigned count)
+{
+	count &= 0x1f;
+	if (!count)
+		return value;
+	unsigned shift = 32 - size * 8;
+	int svalue = (int) (value << shift) >> shift;
+	unsigned result = svalue >> count;
+	regs.setLazyFlags(Regs::FlagsOpSar, size, result, value, count);
+	return result;
+}
+
+static inline unsigned RotOp_rol(Regs &regs, unsigned size,
+		unsigned value, unsigned count)
+{
+	count &= 0x1f;
+	if (!count)
+		return value;
+	unsigned bits = size * 8;
+	unsigned long long mask = (1ull << bits) - 1;
+	unsigned long long x = value & mask;
+	unsigned n = count % bits;
+	unsigned result = ((x << n) | (x >> (bits - n))) & mask;
+	bool msb = (result >> (bits - 1)) & 1;
+	bool cf = result & 1;
+	regs.setFlag(Instruction::FlagCF, cf);
+	regs.setFlag(Instruction::FlagOF, msb != cf);
+	return result;
+}
+
+static inline unsigned RotOp_ror(Regs &regs, unsigned size,
+		unsigned value, unsigned count)
+{
+	count &= 0x1f;
+	if (!count)
+		return value;
+	unsigned bits = size * 8;
+	unsigned long long mask = (1ull << bits) - 1;
+	unsigned long long x = value & mask;
+	unsigned n = count % bits;
+	unsigned result = ((x >> n) | (x << (bits - n))) & mask;
+	bool msb = (result >> (bits - 1)) & 1;
+	bool msb2 = (result >> (bits - 2)) & 1;
+	regs.setFlag(Instruction::FlagCF, msb);
+	regs.setFlag(Instruction::FlagOF, msb != msb2);
+	return result;
+}
+
+static inline unsigned RotOp_rcl(Regs &regs, unsigned size,
+		unsigned value, unsigned count)
+{
+	// Rotate the operand extended with the carry flag
+	unsigned bits = size * 8;
+	unsigned n = (count & 0x1f) % (bits + 1);
+	if (!n)
+		return value;
+	unsigned long long mask = (1ull << (bits + 1)) - 1;
+	unsigned long long x = (value & (mask >> 1)) |
+			((unsigned long long) regs.getFlag(
+			Instruction::FlagCF) << bits);
+	x = ((x << n) | (x >> (bits + 1 - n))) & mask;
+	unsigned result = x & (mask >> 1);
+	bool msb = (result >> (bits - 1)) & 1;
+	bool cf = (x >> bits) & 1;
+	regs.setFlag(Instruction::FlagCF, cf);
+	regs.setFlag(Instruction::FlagOF, msb != cf);
+	return result;
+}
+
+static inline unsigned RotOp_rcr(Regs &regs, unsigned size,
+		unsigned value, unsigned count)
+{
+	// Rotate the operand extended with the carry flag
+	unsigned bits = size * 8;
+	unsigned n = (count & 0x1f) % (bits + 1);
+	if (!n)
+		return value;
+	unsigned long long mask = (1ull << (bits + 1)) - 1;
+	unsigned long long x = (value & (mask >> 1)) |
+			((unsigned long long) regs.getFlag(
+			Instruction::FlagCF) << bits);
+	x = ((x >> n) | (x << (bits + 1 - n))) & mask;
+	unsigned result = x & (mask >> 1);
+	bool msb = (result >> (bits - 1)) & 1;
+	bool msb2 = (result >> (bits - 2)) & 1;
+	regs.setFlag(Instruction::FlagCF, (x >> bits) & 1);
+	regs.setFlag(Instruction::FlagOF, msb != msb2);
+	return result;
+}
+
+
 
 
 #define op_xxx_rm8_1_impl(xxx, idep) \
@@ -39,24 +161,8 @@ void Context::ExecuteInst_##xxx##_rm8_1() \
 { \
 	unsigned char rm8 = LoadRm8(); \
 	unsigned char count = 1; \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%al\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%al\n\t" \
-		"mov %%al, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm8) \
-		: "m" (rm8), "m" (count), "g" (flags) \
-		: "al", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm8 = RotOp_##xxx(regs, 1, rm8, count); \
 	StoreRm8(rm8); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm8, \
@@ -73,24 +179,8 @@ void Context::ExecuteInst_##xxx##_rm8_cl() \
 { \
 	unsigned char rm8 = LoadRm8(); \
 	unsigned char count = regs.Read(Instruction::RegCl); \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%al\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%al\n\t" \
-		"mov %%al, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm8) \
-		: "m" (rm8), "m" (count), "g" (flags) \
-		: "al", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm8 = RotOp_##xxx(regs, 1, rm8, count); \
 	StoreRm8(rm8); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm8, \
@@ -107,24 +197,8 @@ void Context::ExecuteInst_##xxx##_rm8_imm8() \
 { \
 	unsigned char rm8 = LoadRm8(); \
 	unsigned char count = inst.getImmByte(); \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%al\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%al\n\t" \
-		"mov %%al, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm8) \
-		: "m" (rm8), "m" (count), "g" (flags) \
-		: "al", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm8 = RotOp_##xxx(regs, 1, rm8, count); \
 	StoreRm8(rm8); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm8, \
@@ -141,24 +215,8 @@ void Context::ExecuteInst_##xxx##_rm16_1() \
 { \
 	unsigned short rm16 = LoadRm16(); \
 	unsigned char count = 1; \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%ax\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%ax\n\t" \
-		"mov %%ax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm16) \
-		: "m" (rm16), "m" (count), "g" (flags) \
-		: "ax", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm16 = RotOp_##xxx(regs, 2, rm16, count); \
 	StoreRm16(rm16); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm16, \
@@ -175,24 +233,8 @@ void Context::ExecuteInst_##xxx##_rm16_cl() \
 { \
 	unsigned short rm16 = LoadRm16(); \
 	unsigned char count = regs.Read(Instruction::RegCl); \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%ax\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%ax\n\t" \
-		"mov %%ax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm16) \
-		: "m" (rm16), "m" (count), "g" (flags) \
-		: "ax", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm16 = RotOp_##xxx(regs, 2, rm16, count); \
 	StoreRm16(rm16); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm16, \
@@ -209,24 +251,8 @@ void Context::ExecuteInst_##xxx##_rm16_imm8() \
 { \
 	unsigned short rm16 = LoadRm16(); \
 	unsigned char count = inst.getImmByte(); \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%ax\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%ax\n\t" \
-		"mov %%ax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm16) \
-		: "m" (rm16), "m" (count), "g" (flags) \
-		: "ax", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm16 = RotOp_##xxx(regs, 2, rm16, count); \
 	StoreRm16(rm16); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm16, \
@@ -243,24 +269,8 @@ void Context::ExecuteInst_##xxx##_rm32_1() \
 { \
 	unsigned int rm32 = LoadRm32(); \
 	unsigned char count = 1; \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%eax\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%eax\n\t" \
-		"mov %%eax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm32) \
-		: "m" (rm32), "m" (count), "g" (flags) \
-		: "eax", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm32 = RotOp_##xxx(regs, 4, rm32, count); \
 	StoreRm32(rm32); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm32, \
@@ -277,24 +287,8 @@ void Context::ExecuteInst_##xxx##_rm32_cl() \
 { \
 	unsigned int rm32 = LoadRm32(); \
 	unsigned char count = regs.Read(Instruction::RegCl); \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%eax\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%eax\n\t" \
-		"mov %%eax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm32) \
-		: "m" (rm32), "m" (count), "g" (flags) \
-		: "eax", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm32 = RotOp_##xxx(regs, 4, rm32, count); \
 	StoreRm32(rm32); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm32, \
@@ -311,24 +305,8 @@ void Context::ExecuteInst_##xxx##_rm32_imm8() \
 { \
 	unsigned int rm32 = LoadRm32(); \
 	unsigned char count = inst.getImmByte(); \
-	unsigned long flags = regs.getEflags(); \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%eax\n\t" \
-		"mov %3, %%cl\n\t" \
-		#xxx " %%cl, %%eax\n\t" \
-		"mov %%eax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm32) \
-		: "m" (rm32), "m" (count), "g" (flags) \
-		: "eax", "cl" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm32 = RotOp_##xxx(regs, 4, rm32, count); \
 	StoreRm32(rm32); \
-	regs.setEflags(flags); \
 	newUinst(Uinst::OpcodeShift, \
 			idep, \
 			Uinst::DepRm32, \
@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <cmath>
+
 #include <lib/cpp/Misc.h>
 
 #include "Context.h"
@@ -44,21 +46,10 @@ void Context::ExecuteInst_addps_xmm_xmmm128()
 	this->LoadXmm(dest);
 	this->LoadXmmM128(src);
 
-	int spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"addps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 4; i++)
+		d[i] += s[i];
 
 	this->StoreXmm(dest);
 
@@ -78,28 +69,12 @@ void Context::ExecuteInst_addss_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"addss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	d[0] += s[0];
 
 	StoreXmm(dest);
 
@@ -122,17 +97,10 @@ void Context::ExecuteInst_andps_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"andps %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] &= s[i];
 
 	StoreXmm(dest);
 
@@ -147,51 +115,44 @@ void Context::ExecuteInst_andps_xmm_xmmm128()
 }
 
 
-#define X86_ISA_CMPP_ASM(__inst) \
-	__X86_ISA_ASM_START__ \
-	asm volatile ( \
-		"movdqu %1, %%xmm0\n\t" \
-		"movdqu %0, %%xmm1\n\t" \
-		__inst " %%xmm0, %%xmm1\n\t" \
-		"movdqu %%xmm1, %0\n\t" \
-		: "=m" (dest) \
-		: "m" (src) \
-		: "xmm0", "xmm1" \
-	); \
-	__X86_ISA_ASM_END__
+// Return whether the comparison predicate encoded in the immediate value of
+// instructions 'cmpps' and 'cmppd' holds for two values
+template<typename T> static bool XmmComparePredicate(int predicate, T a, T b)
+{
+	switch (predicate)
+	{
+	case 0: return a == b;
+	case 1: return a < b;
+	case 2: return a <= b;
+	case 3: return std::isunordered(a, b);
+	case 4: return !(a == b);
+	case 5: return !(a < b);
+	case 6: return !(a <= b);
+	default: return !std::isunordered(a, b);
+	}
+}
 
 void Context::ExecuteInst_cmppd_xmm_xmmm128_imm8()
 {
 	XmmValue dest;
 	XmmValue src;
+	XmmValue result;
 
-	int spec_mode;
 	int imm8 = inst.getImmByte();
+	if (imm8 > 7)
+		throw misc::Error(misc::fmt("%s: invalid value for 'imm8'",
+				__FUNCTION__));
 
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		switch (imm8)
-		{
-		case 0: X86_ISA_CMPP_ASM("cmpeqpd"); break;
-		case 1: X86_ISA_CMPP_ASM("cmpltpd"); break;
-		case 2: X86_ISA_CMPP_ASM("cmplepd"); break;
-		case 3: X86_ISA_CMPP_ASM("cmpunordpd"); break;
-		case 4: X86_ISA_CMPP_ASM("cmpneqpd"); break;
-		case 5: X86_ISA_CMPP_ASM("cmpnltpd"); break;
-		case 6: X86_ISA_CMPP_ASM("cmpnlepd"); break;
-		case 7: X86_ISA_CMPP_ASM("cmpordpd"); break;
-		default:
-			throw misc::Error(misc::fmt(
-					"%s: invalid value for 'imm8'",
-					__FUNCTION__));
-		}
-	}
+	// Lanes where the predicate holds are set to all ones
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	unsigned long long *r = result.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		r[i] = XmmComparePredicate(imm8, d[i], s[i]) ? -1 : 0;
+	dest = result;
 
 	StoreXmm(dest);
 	newUinst(Uinst::OpcodeXmmFpComp,
@@ -209,34 +170,23 @@ void Context::ExecuteInst_cmpps_xmm_xmmm128_imm8()
 {
 	XmmValue dest;
 	XmmValue src;
+	XmmValue result;
 
-	int spec_mode;
 	int imm8 = inst.getImmByte();
+	if (imm8 > 7)
+		throw misc::Error(misc::fmt("%s: invalid value for 'imm8'",
+				__FUNCTION__));
 
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		switch (imm8)
-		{
-		case 0: X86_ISA_CMPP_ASM("cmpeqps"); break;
-		case 1: X86_ISA_CMPP_ASM("cmpltps"); break;
-		case 2: X86_ISA_CMPP_ASM("cmpleps"); break;
-		case 3: X86_ISA_CMPP_ASM("cmpunordps"); break;
-		case 4: X86_ISA_CMPP_ASM("cmpneqps"); break;
-		case 5: X86_ISA_CMPP_ASM("cmpnltps"); break;
-		case 6: X86_ISA_CMPP_ASM("cmpnleps"); break;
-		case 7: X86_ISA_CMPP_ASM("cmpordps"); break;
-		default:
-			throw misc::Error(misc::fmt(
-					"%s: invalid value for 'imm8'",
-					__FUNCTION__));
-		}
-	}
+	// Lanes where the predicate holds are set to all ones
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	unsigned *r = result.getAsUInt();
+	for (int i = 0; i < 4; i++)
+		r[i] = XmmComparePredicate(imm8, d[i], s[i]) ? -1 : 0;
+	dest = result;
 
 	StoreXmm(dest);
 	newUinst(Uinst::OpcodeXmmFpComp,
@@ -255,28 +205,10 @@ void Context::ExecuteInst_cvtsi2ss_xmm_rm32()
 	XmmValue dest;
 	unsigned int src;
 
-	int spec_mode;
-
 	src = LoadRm32();
 	LoadXmm(dest);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %0, %%xmm0\n\t"
-			"mov %1, %%eax\n\t"
-			"cvtsi2ss %%eax, %%xmm0\n\t"
-			"movdqu %%xmm0, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "eax"
-		);
-		__X86_ISA_ASM_END__
-	}
+	dest.getAsFloat()[0] = (int) src;
 
 	StoreXmm(dest);
 
@@ -296,25 +228,9 @@ void Context::ExecuteInst_cvttss2si_r32_xmmm32()
 	XmmValue xmm;
 	unsigned int r32;
 
-	int spec_mode;
-
 	LoadXmmM32(xmm);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"cvttss2si %1, %%eax\n\t"
-			"mov %%eax, %0"
-			: "=m" (r32)
-			: "m" (xmm)
-			: "eax"
-		);
-		__X86_ISA_ASM_END__
-	}
+	r32 = XmmConvertToInt32(xmm.getAsFloat()[0], true);
 
 	StoreR32(r32);
 
@@ -334,28 +250,13 @@ void Context::ExecuteInst_divps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"divps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 4; i++)
+		d[i] /= s[i];
 
 	StoreXmm(dest);
 
@@ -375,28 +276,12 @@ void Context::ExecuteInst_divss_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"divss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	d[0] /= s[0];
 
 	StoreXmm(dest);
 
@@ -422,28 +307,13 @@ void Context::ExecuteInst_maxps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"maxps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 4; i++)
+		d[i] = d[i] > s[i] ? d[i] : s[i];
 
 	StoreXmm(dest);
 
@@ -463,28 +333,12 @@ void Context::ExecuteInst_maxss_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"maxss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	d[0] = d[0] > s[0] ? d[0] : s[0];
 
 	StoreXmm(dest);
 
@@ -504,28 +358,13 @@ void Context::ExecuteInst_minps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"minps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 4; i++)
+		d[i] = d[i] < s[i] ? d[i] : s[i];
 
 	StoreXmm(dest);
 
@@ -545,28 +384,12 @@ void Context::ExecuteInst_minss_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"minss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	d[0] = d[0] < s[0] ? d[0] : s[0];
 
 	StoreXmm(dest);
 
@@ -744,28 +567,13 @@ void Context::ExecuteInst_mulps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"mulps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 4; i++)
+		d[i] *= s[i];
 
 	StoreXmm(dest);
 
@@ -785,28 +593,12 @@ void Context::ExecuteInst_mulss_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"mulss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	d[0] *= s[0];
 
 	StoreXmm(dest);
 
@@ -829,17 +621,10 @@ void Context::ExecuteInst_orps_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"orps %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] |= s[i];
 
 	StoreXmm(dest);
 
@@ -914,16 +699,9 @@ void Context::ExecuteInst_pmovmskb_r32_xmmm128()
 
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"pmovmskb %%xmm0, %%eax\n\t"
-		"mov %%eax, %0"
-		: "=m" (r32)
-		: "m" (src)
-		: "xmm0", "eax"
-	);
-	__X86_ISA_ASM_END__
+	r32 = 0;
+	for (int i = 0; i < 16; i++)
+		r32 |= (src.getAsUChar()[i] >> 7) << i;
 
 	StoreR32(r32);
 
@@ -971,28 +749,13 @@ void Context::ExecuteInst_sqrtps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"sqrtps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 4; i++)
+		d[i] = std::sqrt(s[i]);
 
 	StoreXmm(dest);
 
@@ -1012,28 +775,12 @@ void Context::ExecuteInst_sqrtss_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"sqrtss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	d[0] = std::sqrt(s[0]);
 
 	StoreXmm(dest);
 
@@ -1059,28 +806,13 @@ void Context::ExecuteInst_subps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"subps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 4; i++)
+		d[i] -= s[i];
 
 	StoreXmm(dest);
 
@@ -1100,28 +832,12 @@ void Context::ExecuteInst_subss_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"subss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	float *s = src.getAsFloat();
+	d[0] -= s[0];
 
 	StoreXmm(dest);
 
@@ -1141,37 +857,10 @@ void Context::ExecuteInst_ucomisd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	unsigned long eflags = regs.getEflags();
-
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"push %3\n\t"
-			"popf\n\t"
-			"movdqu %2, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"ucomisd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			"pushf\n\t"
-			"pop %1\n\t"
-			: "=m" (dest), "=g" (eflags)
-			: "m" (src), "g" (eflags)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
-
-	StoreXmm(dest);
-	regs.setEflags(eflags);
+	CompareFlags(dest.getAsDouble()[0], src.getAsDouble()[0]);
 
 	newUinst(Uinst::OpcodeXmmFpComp,
 			Uinst::DepXmmm64,
@@ -1189,37 +878,10 @@ void Context::ExecuteInst_ucomiss_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	unsigned long eflags = regs.getEflags();
-
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"push %3\n\t"
-			"popf\n\t"
-			"movdqu %2, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"ucomiss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			"pushf\n\t"
-			"pop %1\n\t"
-			: "=m" (dest), "=g" (eflags)
-			: "m" (src), "g" (eflags)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
-
-	StoreXmm(dest);
-	regs.setEflags(eflags);
+	CompareFlags(dest.getAsFloat()[0], src.getAsFloat()[0]);
 
 	newUinst(Uinst::OpcodeXmmFpComp,
 			Uinst::DepXmmm32,
@@ -1237,28 +899,19 @@ void Context::ExecuteInst_unpckhps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
+	XmmValue result;
+	unsigned *d = dest.getAsUInt();
+	unsigned *s = src.getAsUInt();
+	unsigned *r = result.getAsUInt();
+	for (int i = 0; i < 2; i++)
 	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"unpckhps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
+		r[i * 2] = d[i + 2];
+		r[i * 2 + 1] = s[i + 2];
 	}
+	dest = result;
 
 	StoreXmm(dest);
 
@@ -1278,28 +931,19 @@ void Context::ExecuteInst_unpcklps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = this->getState(StateSpecMode);
-	if (!spec_mode)
+	XmmValue result;
+	unsigned *d = dest.getAsUInt();
+	unsigned *s = src.getAsUInt();
+	unsigned *r = result.getAsUInt();
+	for (int i = 0; i < 2; i++)
 	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"unpcklps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
+		r[i * 2] = d[i];
+		r[i * 2 + 1] = s[i];
 	}
+	dest = result;
 
 	StoreXmm(dest);
 
@@ -1322,17 +966,10 @@ void Context::ExecuteInst_xorps_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"xorps %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] ^= s[i];
 
 	StoreXmm(dest);
 
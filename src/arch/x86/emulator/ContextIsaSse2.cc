@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <cmath>
+
 #include <lib/cpp/Misc.h>
 
 #include "Context.h"
@@ -42,28 +44,13 @@ void Context::ExecuteInst_addpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"addpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] += s[i];
 
 	StoreXmm(dest);
 
@@ -83,28 +70,12 @@ void Context::ExecuteInst_addsd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"addsd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	d[0] += s[0];
 
 	StoreXmm(dest);
 
@@ -127,17 +98,10 @@ void Context::ExecuteInst_andpd_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"andpd %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] &= s[i];
 
 	StoreXmm(dest);
 
@@ -157,28 +121,13 @@ void Context::ExecuteInst_cvtdq2pd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"cvtdq2pd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	int *s = src.getAsInt();
+	for (int i = 0; i < 2; i++)
+		d[i] = s[i];
 
 	StoreXmm(dest);
 	newUinst(Uinst::OpcodeXmmConv,
@@ -197,28 +146,13 @@ void Context::ExecuteInst_cvtdq2ps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"cvtdq2ps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	int *s = src.getAsInt();
+	for (int i = 0; i < 4; i++)
+		d[i] = s[i];
 
 	StoreXmm(dest);
 
@@ -238,28 +172,13 @@ void Context::ExecuteInst_cvtps2pd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"cvtps2pd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 2; i++)
+		d[i] = s[i];
 
 	StoreXmm(dest);
 	newUinst(Uinst::OpcodeXmmConv,
@@ -278,28 +197,10 @@ void Context::ExecuteInst_cvtsi2sd_xmm_rm32()
 	XmmValue dest;
 	unsigned int src;
 
-	int spec_mode;
-
 	src = LoadRm32();
 	LoadXmm(dest);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %0, %%xmm0\n\t"
-			"mov %1, %%eax\n\t"
-			"cvtsi2sd %%eax, %%xmm0\n\t"
-			"movdqu %%xmm0, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "eax"
-		);
-		__X86_ISA_ASM_END__
-	}
+	dest.getAsDouble()[0] = (int) src;
 
 	StoreXmm(dest);
 
@@ -321,15 +222,7 @@ void Context::ExecuteInst_cvttsd2si_r32_xmmm64()
 
 	LoadXmmM64(xmm);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"cvttsd2si %1, %%eax\n\t"
-		"mov %%eax, %0"
-		: "=m" (r32)
-		: "m" (xmm)
-		: "eax"
-	);
-	__X86_ISA_ASM_END__
+	r32 = XmmConvertToInt32(xmm.getAsDouble()[0], true);
 
 	StoreR32(r32);
 
@@ -349,26 +242,9 @@ void Context::ExecuteInst_cvtsd2si_r32_xmmm64()
 	XmmValue src;
 	unsigned int r32;
 
-	int spec_mode;
-
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"cvtsd2si %%xmm0, %%eax\n\t"
-			"mov %%eax, %0"
-			: "=m" (r32)
-			: "m" (src)
-			: "xmm0", "eax"
-		);
-		__X86_ISA_ASM_END__
-	}
+	r32 = XmmConvertToInt32(src.getAsDouble()[0], false);
 
 	StoreR32(r32);
 	newUinst(Uinst::OpcodeXmmShift,
@@ -387,28 +263,12 @@ void Context::ExecuteInst_cvtsd2ss_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"cvtsd2ss %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	double *s = src.getAsDouble();
+	d[0] = s[0];
 
 	StoreXmm(dest);
 	newUinst(Uinst::OpcodeXmmConv,
@@ -427,28 +287,14 @@ void Context::ExecuteInst_cvtpd2ps_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"cvtpd2ps %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	float *d = dest.getAsFloat();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] = s[i];
+	dest.getAsUInt64()[1] = 0;
 
 	StoreXmm(dest);
 
@@ -468,28 +314,12 @@ void Context::ExecuteInst_cvtss2sd_xmm_xmmm32()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM32(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"cvtss2sd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	float *s = src.getAsFloat();
+	d[0] = s[0];
 
 	StoreXmm(dest);
 
@@ -509,28 +339,14 @@ void Context::ExecuteInst_cvttpd2dq_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"cvttpd2dq %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	int *d = dest.getAsInt();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] = XmmConvertToInt32(s[i], true);
+	dest.getAsUInt64()[1] = 0;
 
 	StoreXmm(dest);
 
@@ -550,28 +366,13 @@ void Context::ExecuteInst_cvttps2dq_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"cvttps2dq %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	int *d = dest.getAsInt();
+	float *s = src.getAsFloat();
+	for (int i = 0; i < 4; i++)
+		d[i] = XmmConvertToInt32(s[i], true);
 
 	StoreXmm(dest);
 
@@ -591,28 +392,13 @@ void Context::ExecuteInst_divpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"divpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] /= s[i];
 
 	StoreXmm(dest);
 
@@ -632,28 +418,12 @@ void Context::ExecuteInst_divsd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"divsd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	d[0] /= s[0];
 
 	StoreXmm(dest);
 
@@ -673,28 +443,13 @@ void Context::ExecuteInst_maxpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"maxpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] = d[i] > s[i] ? d[i] : s[i];
 
 	StoreXmm(dest);
 
@@ -714,28 +469,12 @@ void Context::ExecuteInst_maxsd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"maxsd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	d[0] = d[0] > s[0] ? d[0] : s[0];
 
 	StoreXmm(dest);
 
@@ -755,28 +494,13 @@ void Context::ExecuteInst_minpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"minpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] = d[i] < s[i] ? d[i] : s[i];
 
 	StoreXmm(dest);
 
@@ -796,28 +520,12 @@ void Context::ExecuteInst_minsd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"minsd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	d[0] = d[0] < s[0] ? d[0] : s[0];
 
 	StoreXmm(dest);
 
@@ -1060,16 +768,9 @@ void Context::ExecuteInst_movmskpd_r32_xmmm128()
 
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movmskpd %%xmm0, %%eax\n\t"
-		"mov %%eax, %0"
-		: "=m" (r32)
-		: "m" (src)
-		: "xmm0", "eax"
-	);
-	__X86_ISA_ASM_END__
+	r32 = 0;
+	for (int i = 0; i < 2; i++)
+		r32 |= (src.getAsUInt64()[i] >> 63) << i;
 
 	StoreR32(r32);
 
@@ -1091,16 +792,9 @@ void Context::ExecuteInst_movmskps_r32_xmmm128()
 
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movmskps %%xmm0, %%eax\n\t"
-		"mov %%eax, %0"
-		: "=m" (r32)
-		: "m" (src)
-		: "xmm0", "eax"
-	);
-	__X86_ISA_ASM_END__
+	r32 = 0;
+	for (int i = 0; i < 4; i++)
+		r32 |= (src.getAsUInt()[i] >> 31) << i;
 
 	StoreR32(r32);
 
@@ -1211,28 +905,13 @@ void Context::ExecuteInst_mulpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"mulpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] *= s[i];
 
 	StoreXmm(dest);
 
@@ -1252,28 +931,12 @@ void Context::ExecuteInst_mulsd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"mulsd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	d[0] *= s[0];
 
 	StoreXmm(dest);
 
@@ -1296,17 +959,10 @@ void Context::ExecuteInst_orpd_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"orpd %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] |= s[i];
 
 	StoreXmm(dest);
 
@@ -1329,17 +985,10 @@ void Context::ExecuteInst_paddb_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"paddb %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned char *d = dest.getAsUChar();
+	unsigned char *s = src.getAsUChar();
+	for (int i = 0; i < 16; i++)
+		d[i] += s[i];
 
 	StoreXmm(dest);
 
@@ -1362,17 +1011,10 @@ void Context::ExecuteInst_paddw_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"paddw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned short *d = dest.getAsUShort();
+	unsigned short *s = src.getAsUShort();
+	for (int i = 0; i < 8; i++)
+		d[i] += s[i];
 
 	StoreXmm(dest);
 
@@ -1395,17 +1037,10 @@ void Context::ExecuteInst_paddd_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"paddd %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned *d = dest.getAsUInt();
+	unsigned *s = src.getAsUInt();
+	for (int i = 0; i < 4; i++)
+		d[i] += s[i];
 
 	StoreXmm(dest);
 
@@ -1428,17 +1063,10 @@ void Context::ExecuteInst_paddq_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"paddq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] += s[i];
 
 	StoreXmm(dest);
 
@@ -1461,17 +1089,10 @@ void Context::ExecuteInst_pand_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pand %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] &= s[i];
 
 	StoreXmm(dest);
 
@@ -1494,17 +1115,10 @@ void Context::ExecuteInst_pandn_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pandn %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] = ~d[i] & s[i];
 
 	StoreXmm(dest);
 
@@ -1527,17 +1141,10 @@ void Context::ExecuteInst_pcmpeqb_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pcmpeqb %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	signed char *d = (signed char *) dest.getAsUChar();
+	signed char *s = (signed char *) src.getAsUChar();
+	for (int i = 0; i < 16; i++)
+		d[i] = d[i] == s[i] ? -1 : 0;
 
 	StoreXmm(dest);
 
@@ -1560,17 +1167,10 @@ void Context::ExecuteInst_pcmpeqw_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pcmpeqw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	short *d = (short *) dest.getAsUChar();
+	short *s = (short *) src.getAsUChar();
+	for (int i = 0; i < 8; i++)
+		d[i] = d[i] == s[i] ? -1 : 0;
 
 	StoreXmm(dest);
 
@@ -1593,17 +1193,10 @@ void Context::ExecuteInst_pcmpeqd_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pcmpeqd %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	int *d = (int *) dest.getAsUChar();
+	int *s = (int *) src.getAsUChar();
+	for (int i = 0; i < 4; i++)
+		d[i] = d[i] == s[i] ? -1 : 0;
 
 	StoreXmm(dest);
 
@@ -1626,17 +1219,10 @@ void Context::ExecuteInst_pcmpgtb_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pcmpgtb %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	signed char *d = (signed char *) dest.getAsUChar();
+	signed char *s = (signed char *) src.getAsUChar();
+	for (int i = 0; i < 16; i++)
+		d[i] = d[i] > s[i] ? -1 : 0;
 
 	StoreXmm(dest);
 
@@ -1659,17 +1245,10 @@ void Context::ExecuteInst_pcmpgtw_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pcmpgtw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	short *d = (short *) dest.getAsUChar();
+	short *s = (short *) src.getAsUChar();
+	for (int i = 0; i < 8; i++)
+		d[i] = d[i] > s[i] ? -1 : 0;
 
 	StoreXmm(dest);
 
@@ -1692,17 +1271,10 @@ void Context::ExecuteInst_pcmpgtd_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pcmpgtd %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	int *d = (int *) dest.getAsUChar();
+	int *s = (int *) src.getAsUChar();
+	for (int i = 0; i < 4; i++)
+		d[i] = d[i] > s[i] ? -1 : 0;
 
 	StoreXmm(dest);
 
@@ -1725,17 +1297,10 @@ void Context::ExecuteInst_por_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"por %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] |= s[i];
 
 	StoreXmm(dest);
 
@@ -1812,17 +1377,10 @@ void Context::ExecuteInst_pslld_xmmm128_imm8()
 	src.setWithMemset(0, 0, 16);
 	src.setAsUChar(0, inst.getImmByte());
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pslld %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned *d = dest.getAsUInt();
+	for (int i = 0; i < 4; i++)
+		d[i] = count > 31 ? 0 : d[i] << count;
 
 	StoreXmmM128(dest);
 
@@ -1845,17 +1403,10 @@ void Context::ExecuteInst_pslld_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pslld %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned *d = dest.getAsUInt();
+	for (int i = 0; i < 4; i++)
+		d[i] = count > 31 ? 0 : d[i] << count;
 
 	StoreXmm(dest);
 
@@ -1879,17 +1430,10 @@ void Context::ExecuteInst_psllw_xmmm128_imm8()
 	src.setWithMemset(0, 0, 16);
 	src.setAsUChar(0, inst.getImmByte());
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psllw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned short *d = dest.getAsUShort();
+	for (int i = 0; i < 8; i++)
+		d[i] = count > 15 ? 0 : d[i] << count;
 
 	StoreXmmM128(dest);
 
@@ -1912,17 +1456,10 @@ void Context::ExecuteInst_psllw_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psllw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned short *d = dest.getAsUShort();
+	for (int i = 0; i < 8; i++)
+		d[i] = count > 15 ? 0 : d[i] << count;
 
 	StoreXmm(dest);
 
@@ -1946,17 +1483,10 @@ void Context::ExecuteInst_psllq_xmmm128_imm8()
 	src.setWithMemset(0, 0, 16);
 	src.setAsUChar(0, inst.getImmByte());
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psllq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned long long *d = dest.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] = count > 63 ? 0 : d[i] << count;
 
 	StoreXmmM128(dest);
 
@@ -1979,17 +1509,10 @@ void Context::ExecuteInst_psllq_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psllq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned long long *d = dest.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] = count > 63 ? 0 : d[i] << count;
 
 	StoreXmm(dest);
 
@@ -2013,17 +1536,11 @@ void Context::ExecuteInst_psraw_xmmm128_imm8()
 	src.setWithMemset(0, 0, 16);
 	src.setAsUChar(0, inst.getImmByte());
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psraw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	int shift = count > 15 ? 15 : count;
+	short *d = dest.getAsShort();
+	for (int i = 0; i < 8; i++)
+		d[i] >>= shift;
 
 	StoreXmmM128(dest);
 
@@ -2046,17 +1563,11 @@ void Context::ExecuteInst_psraw_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psraw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	int shift = count > 15 ? 15 : count;
+	short *d = dest.getAsShort();
+	for (int i = 0; i < 8; i++)
+		d[i] >>= shift;
 
 	StoreXmm(dest);
 
@@ -2080,17 +1591,10 @@ void Context::ExecuteInst_psrlw_xmmm128_imm8()
 	src.setWithMemset(0, 0, 16);
 	src.setAsUChar(0, inst.getImmByte());
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psrlw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned short *d = dest.getAsUShort();
+	for (int i = 0; i < 8; i++)
+		d[i] = count > 15 ? 0 : d[i] >> count;
 
 	StoreXmmM128(dest);
 
@@ -2114,17 +1618,11 @@ void Context::ExecuteInst_psrad_xmmm128_imm8()
 	src.setWithMemset(0, 0, 16);
 	src.setAsUChar(0, inst.getImmByte());
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psrad %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	int shift = count > 31 ? 31 : count;
+	int *d = dest.getAsInt();
+	for (int i = 0; i < 4; i++)
+		d[i] >>= shift;
 
 	StoreXmmM128(dest);
 
@@ -2147,17 +1645,11 @@ void Context::ExecuteInst_psrad_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psrad %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	int shift = count > 31 ? 31 : count;
+	int *d = dest.getAsInt();
+	for (int i = 0; i < 4; i++)
+		d[i] >>= shift;
 
 	StoreXmm(dest);
 
@@ -2180,17 +1672,10 @@ void Context::ExecuteInst_psrlw_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psrlw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned short *d = dest.getAsUShort();
+	for (int i = 0; i < 8; i++)
+		d[i] = count > 15 ? 0 : d[i] >> count;
 
 	StoreXmm(dest);
 
@@ -2213,17 +1698,10 @@ void Context::ExecuteInst_psrld_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psrld %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned *d = dest.getAsUInt();
+	for (int i = 0; i < 4; i++)
+		d[i] = count > 31 ? 0 : d[i] >> count;
 
 	StoreXmm(dest);
 
@@ -2247,17 +1725,10 @@ void Context::ExecuteInst_psrld_xmmm128_imm8()
 	src.setWithMemset(0, 0, 16);
 	src.setAsUChar(0, inst.getImmByte());
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psrld %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned *d = dest.getAsUInt();
+	for (int i = 0; i < 4; i++)
+		d[i] = count > 31 ? 0 : d[i] >> count;
 
 	StoreXmmM128(dest);
 
@@ -2280,17 +1751,10 @@ void Context::ExecuteInst_psrlq_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psrlq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned long long *d = dest.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] = count > 63 ? 0 : d[i] >> count;
 
 	StoreXmm(dest);
 
@@ -2314,17 +1778,10 @@ void Context::ExecuteInst_psrlq_xmmm128_imm8()
 	src.setWithMemset(0, 0, 16);
 	src.setAsUChar(1, inst.getImmByte());
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psrlq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long count = src.getAsUInt64()[0];
+	unsigned long long *d = dest.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] = count > 63 ? 0 : d[i] >> count;
 
 	StoreXmmM128(dest);
 
@@ -2377,17 +1834,10 @@ void Context::ExecuteInst_psubb_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psubb %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned char *d = dest.getAsUChar();
+	unsigned char *s = src.getAsUChar();
+	for (int i = 0; i < 16; i++)
+		d[i] -= s[i];
 
 	StoreXmm(dest);
 
@@ -2410,17 +1860,10 @@ void Context::ExecuteInst_psubw_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psubw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned short *d = dest.getAsUShort();
+	unsigned short *s = src.getAsUShort();
+	for (int i = 0; i < 8; i++)
+		d[i] -= s[i];
 
 	StoreXmm(dest);
 
@@ -2443,17 +1886,10 @@ void Context::ExecuteInst_psubd_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psubd %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned *d = dest.getAsUInt();
+	unsigned *s = src.getAsUInt();
+	for (int i = 0; i < 4; i++)
+		d[i] -= s[i];
 
 	StoreXmm(dest);
 	newUinst(Uinst::OpcodeXmmSub,
@@ -2475,17 +1911,10 @@ void Context::ExecuteInst_psubq_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"psubq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] -= s[i];
 
 	StoreXmm(dest);
 	newUinst(Uinst::OpcodeXmmSub,
@@ -2507,17 +1936,16 @@ void Context::ExecuteInst_punpcklbw_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"punpcklbw %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	XmmValue result;
+	unsigned char *d = dest.getAsUChar();
+	unsigned char *s = src.getAsUChar();
+	unsigned char *r = result.getAsUChar();
+	for (int i = 0; i < 8; i++)
+	{
+		r[i * 2] = d[i];
+		r[i * 2 + 1] = s[i];
+	}
+	dest = result;
 
 	StoreXmm(dest);
 
@@ -2540,17 +1968,16 @@ void Context::ExecuteInst_punpcklwd_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"punpcklwd %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	XmmValue result;
+	unsigned short *d = dest.getAsUShort();
+	unsigned short *s = src.getAsUShort();
+	unsigned short *r = result.getAsUShort();
+	for (int i = 0; i < 4; i++)
+	{
+		r[i * 2] = d[i];
+		r[i * 2 + 1] = s[i];
+	}
+	dest = result;
 
 	StoreXmm(dest);
 
@@ -2573,17 +2000,16 @@ void Context::ExecuteInst_punpckldq_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"punpckldq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	XmmValue result;
+	unsigned *d = dest.getAsUInt();
+	unsigned *s = src.getAsUInt();
+	unsigned *r = result.getAsUInt();
+	for (int i = 0; i < 2; i++)
+	{
+		r[i * 2] = d[i];
+		r[i * 2 + 1] = s[i];
+	}
+	dest = result;
 
 	StoreXmm(dest);
 
@@ -2606,17 +2032,7 @@ void Context::ExecuteInst_punpcklqdq_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"punpcklqdq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	dest.getAsUInt64()[1] = src.getAsUInt64()[0];
 
 	StoreXmm(dest);
 
@@ -2639,17 +2055,10 @@ void Context::ExecuteInst_pxor_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pxor %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] ^= s[i];
 
 	StoreXmm(dest);
 
@@ -2669,28 +2078,13 @@ void Context::ExecuteInst_sqrtpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"sqrtpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] = std::sqrt(s[i]);
 
 	StoreXmm(dest);
 
@@ -2710,28 +2104,12 @@ void Context::ExecuteInst_sqrtsd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"sqrtsd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	d[0] = std::sqrt(s[0]);
 
 	StoreXmm(dest);
 
@@ -2751,28 +2129,13 @@ void Context::ExecuteInst_subpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"subpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	for (int i = 0; i < 2; i++)
+		d[i] -= s[i];
 
 	StoreXmm(dest);
 
@@ -2792,28 +2155,12 @@ void Context::ExecuteInst_subsd_xmm_xmmm64()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM64(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"subsd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	double *d = dest.getAsDouble();
+	double *s = src.getAsDouble();
+	d[0] -= s[0];
 
 	StoreXmm(dest);
 
@@ -2833,28 +2180,11 @@ void Context::ExecuteInst_unpckhpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"unpckhpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	dest.getAsUInt64()[0] = dest.getAsUInt64()[1];
+	dest.getAsUInt64()[1] = src.getAsUInt64()[1];
 
 	StoreXmm(dest);
 
@@ -2874,28 +2204,10 @@ void Context::ExecuteInst_unpcklpd_xmm_xmmm128()
 	XmmValue dest;
 	XmmValue src;
 
-	int spec_mode;
-
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	/* Prevent execution of the floating-point computation in speculative
-	 * mode, since it may cause host exceptions for garbage input operands. */
-	spec_mode = getState(StateSpecMode);
-	if (!spec_mode)
-	{
-		__X86_ISA_ASM_START__
-		asm volatile (
-			"movdqu %1, %%xmm0\n\t"
-			"movdqu %0, %%xmm1\n\t"
-			"unpcklpd %%xmm0, %%xmm1\n\t"
-			"movdqu %%xmm1, %0\n\t"
-			: "=m" (dest)
-			: "m" (src)
-			: "xmm0", "xmm1"
-		);
-		__X86_ISA_ASM_END__
-	}
+	dest.getAsUInt64()[1] = src.getAsUInt64()[0];
 
 	StoreXmm(dest);
 
@@ -2918,17 +2230,10 @@ void Context::ExecuteInst_xorpd_xmm_xmmm128()
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"xorpd %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	unsigned long long *d = dest.getAsUInt64();
+	unsigned long long *s = src.getAsUInt64();
+	for (int i = 0; i < 2; i++)
+		d[i] ^= s[i];
 
 	StoreXmm(dest);
 
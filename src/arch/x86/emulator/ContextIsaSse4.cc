@@ -39,35 +39,18 @@ namespace x86
 
 
 
-#ifndef HAVE_SSE4
-static char *x86_isa_err_sse4 =
-	"\tThis version of Multi2Sim has been built on a machine without support\n"
-	"\tfor SSE4 x86 instructions. While the implementation of this\n"
-	"\tinstruction is supported, it was disabled for compatibility with your\n"
-	"\tprocessor.\n";
-#endif
-
-
 void Context::ExecuteInst_pcmpeqq_xmm_xmmm128()
 {
-#ifdef HAVE_SSE4
 	XmmValue dest;
 	XmmValue src;
 
 	LoadXmm(dest);
 	LoadXmmM128(src);
 
-	__X86_ISA_ASM_START__
-	asm volatile (
-		"movdqu %1, %%xmm0\n\t"
-		"movdqu %0, %%xmm1\n\t"
-		"pcmpeqq %%xmm0, %%xmm1\n\t"
-		"movdqu %%xmm1, %0\n\t"
-		: "=m" (dest)
-		: "m" (src)
-		: "xmm0", "xmm1"
-	);
-	__X86_ISA_ASM_END__
+	long long *d = (long long *) dest.getAsUChar();
+	long long *s = (long long *) src.getAsUChar();
+	for (int i = 0; i < 2; i++)
+		d[i] = d[i] == s[i] ? -1 : 0;
 
 	StoreXmm(dest);
 
@@ -79,10 +62,6 @@ void Context::ExecuteInst_pcmpeqq_xmm_xmmm128()
 			0,
 			0,
 			0);
-
-#else
-	throw misc::Panic(x86_isa_err_sse4);
-#endif
 }
 
 void Context::ExecuteInst_pcmpistri_xmm_xmmm128_imm8()
@@ -32,27 +32,88 @@ namespace x86
 #define assert __COMPILATION_ERROR__
 
 
+// Functions emulating the standard operations on operands of 'size' bytes.
+// They return the result, and record the operation in the register file,
+// which computes the arithmetic flags only when they are read.
+
+static inline unsigned StdOp_add(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	unsigned result = src1 + src2;
+	regs.setLazyFlags(Regs::FlagsOpAdd, size, result, src1, src2);
+	return result;
+}
+
+static inline unsigned StdOp_adc(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	unsigned carry = regs.getFlag(Instruction::FlagCF);
+	unsigned result = src1 + src2 + carry;
+	regs.setLazyFlags(Regs::FlagsOpAdd, size, result, src1, src2, carry);
+	return result;
+}
+
+static inline unsigned StdOp_sub(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	unsigned result = src1 - src2;
+	regs.setLazyFlags(Regs::FlagsOpSub, size, result, src1, src2);
+	return result;
+}
+
+static inline unsigned StdOp_sbb(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	unsigned carry = regs.getFlag(Instruction::FlagCF);
+	unsigned result = src1 - src2 - carry;
+	regs.setLazyFlags(Regs::FlagsOpSub, size, result, src1, src2, carry);
+	return result;
+}
+
+static inline unsigned StdOp_cmp(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	return StdOp_sub(regs, size, src1, src2);
+}
+
+static inline unsigned StdOp_and(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	unsigned result = src1 & src2;
+	regs.setLazyFlags(Regs::FlagsOpLogic, size, result, src1, src2);
+	return result;
+}
+
+static inline unsigned StdOp_test(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	return StdOp_and(regs, size, src1, src2);
+}
+
+static inline unsigned StdOp_or(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	unsigned result = src1 | src2;
+	regs.setLazyFlags(Regs::FlagsOpLogic, size, result, src1, src2);
+	return result;
+}
+
+static inline unsigned StdOp_xor(Regs &regs, unsigned size,
+		unsigned src1, unsigned src2)
+{
+	unsigned result = src1 ^ src2;
+	regs.setLazyFlags(Regs::FlagsOpLogic, size, result, src1, src2);
+	return result;
+}
+
+
 #define op_stdop_al_imm8(stdop, wb, cin, uinst) \
 void Context::ExecuteInst_##stdop##_al_imm8() \
 { \
 	unsigned char al = regs.Read(Instruction::RegAl); \
 	unsigned char imm8 = inst.getImmByte(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%al\n\t" \
-		#stdop " %3, %%al\n\t" \
-		"mov %%al, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (al) \
-		: "m" (al), "m" (imm8), "g" (flags) \
-		: "al" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	al = StdOp_##stdop(regs, 1, al, imm8); \
 	if (wb) { \
 		regs.Write(Instruction::RegAl, al); \
 		newUinst(uinst, \
@@ -73,7 +134,6 @@ void Context::ExecuteInst_##stdop##_al_imm8() \
 				Uinst::DepOf, \
 				0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -82,22 +142,8 @@ void Context::ExecuteInst_##stdop##_ax_imm16() \
 { \
 	unsigned short ax = regs.Read(Instruction::RegAx); \
 	unsigned short imm16 = inst.getImmWord(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%ax\n\t" \
-		#stdop " %3, %%ax\n\t" \
-		"mov %%ax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (ax) \
-		: "m" (ax), "m" (imm16), "g" (flags) \
-		: "ax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	ax = StdOp_##stdop(regs, 2, ax, imm16); \
 	if (wb) { \
 		regs.Write(Instruction::RegAx, ax); \
 		newUinst(uinst, Uinst::DepEax, cin_dep, 0, Uinst::DepEax, \
@@ -106,7 +152,6 @@ void Context::ExecuteInst_##stdop##_ax_imm16() \
 		newUinst(uinst, Uinst::DepEax, cin_dep, 0, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -115,22 +160,8 @@ void Context::ExecuteInst_##stdop##_eax_imm32() \
 { \
 	unsigned int eax = regs.Read(Instruction::RegEax); \
 	unsigned int imm32 = inst.getImmDWord(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%eax\n\t" \
-		#stdop " %3, %%eax\n\t" \
-		"mov %%eax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (eax) \
-		: "m" (eax), "m" (imm32), "g" (flags) \
-		: "eax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	eax = StdOp_##stdop(regs, 4, eax, imm32); \
 	if (wb) { \
 		regs.Write(Instruction::RegEax, eax); \
 		newUinst(uinst, Uinst::DepEax, cin_dep, 0, Uinst::DepEax, \
@@ -139,7 +170,6 @@ void Context::ExecuteInst_##stdop##_eax_imm32() \
 		newUinst(uinst, Uinst::DepEax, cin_dep, 0, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -148,22 +178,8 @@ void Context::ExecuteInst_##stdop##_rm8_imm8() \
 { \
 	unsigned char rm8 = LoadRm8(); \
 	unsigned char imm8 = inst.getImmByte(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%al\n\t" \
-		#stdop " %3, %%al\n\t" \
-		"mov %%al, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm8) \
-		: "m" (rm8), "m" (imm8), "g" (flags) \
-		: "al" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm8 = StdOp_##stdop(regs, 1, rm8, imm8); \
 	if (wb) { \
 		StoreRm8(rm8); \
 		newUinst(uinst, Uinst::DepRm8, cin_dep, 0, Uinst::DepRm8, \
@@ -172,7 +188,6 @@ void Context::ExecuteInst_##stdop##_rm8_imm8() \
 		newUinst(uinst, Uinst::DepRm8, cin_dep, 0, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -181,22 +196,8 @@ void Context::ExecuteInst_##stdop##_rm16_imm16() \
 { \
 	unsigned short rm16 = LoadRm16(); \
 	unsigned short imm16 = inst.getImmWord(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%ax\n\t" \
-		#stdop " %3, %%ax\n\t" \
-		"mov %%ax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm16) \
-		: "m" (rm16), "m" (imm16), "g" (flags) \
-		: "ax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm16 = StdOp_##stdop(regs, 2, rm16, imm16); \
 	if (wb) { \
 		StoreRm16(rm16); \
 		newUinst(uinst, Uinst::DepRm16, cin_dep, 0, Uinst::DepRm16, \
@@ -205,7 +206,6 @@ void Context::ExecuteInst_##stdop##_rm16_imm16() \
 		newUinst(uinst, Uinst::DepRm16, cin_dep, 0, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -214,22 +214,8 @@ void Context::ExecuteInst_##stdop##_rm32_imm32() \
 { \
 	unsigned int rm32 = LoadRm32(); \
 	unsigned int imm32 = inst.getImmDWord(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%eax\n\t" \
-		#stdop " %3, %%eax\n\t" \
-		"mov %%eax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm32) \
-		: "m" (rm32), "m" (imm32), "g" (flags) \
-		: "eax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm32 = StdOp_##stdop(regs, 4, rm32, imm32); \
 	if (wb) { \
 		StoreRm32(rm32); \
 		newUinst(uinst, Uinst::DepRm32, cin_dep, 0, Uinst::DepRm32, \
@@ -238,7 +224,6 @@ void Context::ExecuteInst_##stdop##_rm32_imm32() \
 		newUinst(uinst, Uinst::DepRm32, cin_dep, 0, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -247,22 +232,8 @@ void Context::ExecuteInst_##stdop##_rm16_imm8() \
 { \
 	unsigned short rm16 = LoadRm16(); \
 	unsigned short imm8 = (char) inst.getImmByte(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%ax\n\t" \
-		#stdop " %3, %%ax\n\t" \
-		"mov %%ax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm16) \
-		: "m" (rm16), "m" (imm8), "g" (flags) \
-		: "ax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm16 = StdOp_##stdop(regs, 2, rm16, imm8); \
 	if (wb) { \
 		StoreRm16(rm16); \
 		newUinst(uinst, Uinst::DepRm16, cin_dep, 0, Uinst::DepRm16, \
@@ -271,7 +242,6 @@ void Context::ExecuteInst_##stdop##_rm16_imm8() \
 		newUinst(uinst, Uinst::DepRm16, cin_dep, 0, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -280,22 +250,8 @@ void Context::ExecuteInst_##stdop##_rm32_imm8() \
 { \
 	unsigned int rm32 = LoadRm32(); \
 	unsigned int imm8 = (char) inst.getImmByte(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%eax\n\t" \
-		#stdop " %3, %%eax\n\t" \
-		"mov %%eax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm32) \
-		: "m" (rm32), "m" (imm8), "g" (flags) \
-		: "eax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm32 = StdOp_##stdop(regs, 4, rm32, imm8); \
 	if (wb) { \
 		StoreRm32(rm32); \
 		newUinst(uinst, Uinst::DepRm32, cin_dep, 0, Uinst::DepRm32, \
@@ -304,7 +260,6 @@ void Context::ExecuteInst_##stdop##_rm32_imm8() \
 		newUinst(uinst, Uinst::DepRm32, cin_dep, 0, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -313,22 +268,8 @@ void Context::ExecuteInst_##stdop##_rm8_r8() \
 { \
 	unsigned char rm8 = LoadRm8(); \
 	unsigned char r8 = LoadR8(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%al\n\t" \
-		#stdop " %3, %%al\n\t" \
-		"mov %%al, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm8) \
-		: "m" (rm8), "m" (r8), "g" (flags) \
-		: "al" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm8 = StdOp_##stdop(regs, 1, rm8, r8); \
 	if (wb) { \
 		StoreRm8(rm8); \
 		newUinst(uinst, Uinst::DepRm8, Uinst::DepR8, cin_dep, Uinst::DepRm8, \
@@ -337,7 +278,6 @@ void Context::ExecuteInst_##stdop##_rm8_r8() \
 		newUinst(uinst, Uinst::DepRm8, Uinst::DepR8, cin_dep, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -346,22 +286,8 @@ void Context::ExecuteInst_##stdop##_rm16_r16() \
 { \
 	unsigned short rm16 = LoadRm16(); \
 	unsigned short r16 = LoadR16(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%ax\n\t" \
-		#stdop " %3, %%ax\n\t" \
-		"mov %%ax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm16) \
-		: "m" (rm16), "m" (r16), "g" (flags) \
-		: "ax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm16 = StdOp_##stdop(regs, 2, rm16, r16); \
 	if (wb) { \
 		StoreRm16(rm16); \
 		newUinst(uinst, Uinst::DepRm16, Uinst::DepR16, cin_dep, Uinst::DepRm16, \
@@ -370,7 +296,6 @@ void Context::ExecuteInst_##stdop##_rm16_r16() \
 		newUinst(uinst, Uinst::DepRm16, Uinst::DepR16, cin_dep, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -379,22 +304,8 @@ void Context::ExecuteInst_##stdop##_rm32_r32() \
 { \
 	unsigned int rm32 = LoadRm32(); \
 	unsigned int r32 = LoadR32(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%eax\n\t" \
-		#stdop " %3, %%eax\n\t" \
-		"mov %%eax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (rm32) \
-		: "m" (rm32), "m" (r32), "g" (flags) \
-		: "eax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	rm32 = StdOp_##stdop(regs, 4, rm32, r32); \
 	if (wb) { \
 		StoreRm32(rm32); \
 		newUinst(uinst, Uinst::DepRm32, Uinst::DepR32, cin_dep, Uinst::DepRm32, \
@@ -403,7 +314,6 @@ void Context::ExecuteInst_##stdop##_rm32_r32() \
 		newUinst(uinst, Uinst::DepRm32, Uinst::DepR32, cin_dep, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -412,22 +322,8 @@ void Context::ExecuteInst_##stdop##_r8_rm8() \
 { \
 	unsigned char r8 = LoadR8(); \
 	unsigned char rm8 = LoadRm8(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%al\n\t" \
-		#stdop " %3, %%al\n\t" \
-		"mov %%al, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (r8) \
-		: "m" (r8), "m" (rm8), "g" (flags) \
-		: "al" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	r8 = StdOp_##stdop(regs, 1, r8, rm8); \
 	if (wb) { \
 		StoreR8(r8); \
 		newUinst(uinst, Uinst::DepR8, Uinst::DepRm8, cin_dep, Uinst::DepR8, \
@@ -436,7 +332,6 @@ void Context::ExecuteInst_##stdop##_r8_rm8() \
 		newUinst(uinst, Uinst::DepR8, Uinst::DepRm8, cin_dep, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -445,22 +340,8 @@ void Context::ExecuteInst_##stdop##_r16_rm16() \
 { \
 	unsigned short r16 = LoadR16(); \
 	unsigned short rm16 = LoadRm16(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%ax\n\t" \
-		#stdop " %3, %%ax\n\t" \
-		"mov %%ax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (r16) \
-		: "m" (r16), "m" (rm16), "g" (flags) \
-		: "ax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	r16 = StdOp_##stdop(regs, 2, r16, rm16); \
 	if (wb) { \
 		StoreR16(r16); \
 		newUinst(uinst, Uinst::DepR16, Uinst::DepRm16, cin_dep, Uinst::DepR16, \
@@ -469,7 +350,6 @@ void Context::ExecuteInst_##stdop##_r16_rm16() \
 		newUinst(uinst, Uinst::DepR16, Uinst::DepRm16, cin_dep, Uinst::DepZps, \
 				Uinst::DepCf, Uinst::DepOf, 0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
@@ -478,22 +358,8 @@ void Context::ExecuteInst_##stdop##_r32_rm32() \
 { \
 	unsigned int r32 = LoadR32(); \
 	unsigned int rm32 = LoadRm32(); \
-	unsigned long flags = regs.getEflags(); \
 	Uinst::Dep cin_dep = cin ? Uinst::DepCf : Uinst::DepNone; \
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile ( \
-		"push %4\n\t" \
-		"popf\n\t" \
-		"mov %2, %%eax\n\t" \
-		#stdop " %3, %%eax\n\t" \
-		"mov %%eax, %1\n\t" \
-		"pushf\n\t" \
-		"pop %0\n\t" \
-		: "=g" (flags), "=m" (r32) \
-		: "m" (r32), "m" (rm32), "g" (flags) \
-		: "eax" \
-	); \
-	__X86_CONTEXT_RESTORE_FLAGS__ \
+	r32 = StdOp_##stdop(regs, 4, r32, rm32); \
 	if (wb) { \
 		StoreR32(r32); \
 		newUinst(uinst, \
@@ -514,7 +380,6 @@ void Context::ExecuteInst_##stdop##_r32_rm32() \
 				Uinst::DepOf, \
 				0); \
 	} \
-	regs.setEflags(flags); \
 }
 
 
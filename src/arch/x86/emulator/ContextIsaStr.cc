@@ -215,27 +215,12 @@ void Context::ExecuteStringInst_cmpsb()
 {
 	unsigned char op1;
 	unsigned char op2;
-	unsigned long flags;
 
 	MemoryRead(regs.getEsi(), 1, &op1);
 	MemoryRead(regs.getEdi(), 1, &op2);
-	flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__
-	asm volatile (
-		"push %1\n\t"
-		"popf\n\t"
-		"mov %2, %%al\n\t"
-		"cmp %3, %%al\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags)
-		: "g" (flags), "m" (op1), "m" (op2)
-		: "al"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__
-
-	regs.setEflags(flags);
+
+	// Compare
+	regs.setLazyFlags(Regs::FlagsOpSub, 1, op1 - op2, op1, op2);
 	regs.incEsi(regs.getFlag(Instruction::FlagDF) ? -1 : 1);
 	regs.incEdi(regs.getFlag(Instruction::FlagDF) ? -1 : 1);
 }
@@ -308,27 +293,12 @@ void Context::ExecuteStringInst_cmpsd()
 {
 	unsigned int op1;
 	unsigned int op2;
-	unsigned long flags;
-
-	MemoryRead(regs.getEdi(), 4, &op1);
-	MemoryRead(regs.getEsi(), 4, &op2);
-	flags = regs.getEflags();
-
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile (
-		"push %1\n\t"
-		"popf\n\t"
-		"mov %2, %%eax\n\t"
-		"cmp %3, %%eax\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags)
-		: "g" (flags), "m" (op1), "m" (op2)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__ \
-
-	regs.setEflags(flags);
+
+	MemoryRead(regs.getEsi(), 4, &op1);
+	MemoryRead(regs.getEdi(), 4, &op2);
+
+	// Compare
+	regs.setLazyFlags(Regs::FlagsOpSub, 4, op1 - op2, op1, op2);
 	regs.incEsi(regs.getFlag(Instruction::FlagDF) ? -4 : 4);
 	regs.incEdi(regs.getFlag(Instruction::FlagDF) ? -4 : 4);
 }
@@ -709,25 +679,11 @@ void Context::ExecuteStringInst_scasb()
 {
 	unsigned char al = regs.Read(Instruction::RegAl);
 	unsigned char m8;
-	unsigned long flags = regs.getEflags();
 
 	MemoryRead(regs.getEdi(), 1, &m8);
 
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %1, %%al\n\t"
-		"cmp %2, %%al\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags)
-		: "m" (al), "m" (m8), "g" (flags)
-		: "al"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__ \
-
-	regs.setEflags(flags);
+	// Compare
+	regs.setLazyFlags(Regs::FlagsOpSub, 1, al - m8, al, m8);
 	regs.incEdi(regs.getFlag(Instruction::FlagDF) ? -1 : 1);
 
 }
@@ -780,25 +736,11 @@ void Context::ExecuteStringInst_scasd()
 {
 	unsigned int eax = regs.Read(Instruction::RegEax);
 	unsigned int m32;
-	unsigned long flags = regs.getEflags();
 
 	MemoryRead(regs.getEdi(), 4, &m32);
 
-	__X86_CONTEXT_SAVE_FLAGS__ \
-	asm volatile (
-		"push %3\n\t"
-		"popf\n\t"
-		"mov %1, %%eax\n\t"
-		"cmp %2, %%eax\n\t"
-		"pushf\n\t"
-		"pop %0\n\t"
-		: "=g" (flags)
-		: "m" (eax), "m" (m32), "g" (flags)
-		: "eax"
-	);
-	__X86_CONTEXT_RESTORE_FLAGS__ \
-
-	regs.setEflags(flags);
+	// Compare
+	regs.setLazyFlags(Regs::FlagsOpSub, 4, eax - m32, eax, m32);
 	regs.incEdi(regs.getFlag(Instruction::FlagDF) ? -4 : 4);
 
 }
@@ -17,6 +17,9 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <cmath>
+#include <cstdint>
+
 #include <lib/cpp/Misc.h>
 
 #include "Context.h"
@@ -126,4 +129,12 @@ void Context::LoadXmmM128(XmmValue &value)
 	value.setAsUInt64(1, content_hi);
 }
 
+int Context::XmmConvertToInt32(double value, bool truncate)
+{
+	value = truncate ? std::trunc(value) : std::nearbyint(value);
+	if (!(value >= INT32_MIN && value <= INT32_MAX))
+		return INT32_MIN;
+	return (int) value;
+}
+
 } // namespace x86
@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include <arch/x86/disassembler/Disassembler.h>
 #include <lib/esim/Engine.h>
 
@@ -34,6 +36,8 @@ std::string Emulator::loader_debug_file;
 std::string Emulator::syscall_debug_file;
 
 long long Emulator::max_instructions;
+int Emulator::max_block_instructions = 1024;
+int Emulator::num_threads = 1;
 
 std::unique_ptr<Emulator> Emulator::instance;
 
@@ -91,11 +95,46 @@ void Emulator::RegisterOptions()
 			"instructions. On x86 detailed simulation, it is given as "
 			"the number of committed (non-speculative) instructions. "
 			"A value of 0 means no limit.");
+
+	// Option --x86-block-inst <number>
+	command_line->RegisterInt32("--x86-block-inst <number> (default = 1024)",
+			max_block_instructions,
+			"Maximum number of x86 instructions emulated for a context "
+			"in each iteration of the functional simulation. Basic "
+			"blocks of decoded instructions are emulated back to back "
+			"until this limit is reached, or the context stops "
+			"running. A value of 1 emulates one instruction at a "
+			"time.");
+
+	// Option --x86-threads <number>
+	command_line->RegisterInt32("--x86-threads <number> (default = 1)",
+			num_threads,
+			"Number of host threads emulating x86 contexts in "
+			"functional simulation. Running contexts are emulated in "
+			"parallel, and synchronize on system calls, instructions "
+			"with a lock prefix, and other atomic instructions. "
+			"Larger values of --x86-block-inst reduce the number of "
+			"synchronizations. The interleaving of contexts, and "
+			"thus the output of multi-threaded programs, can differ "
+			"across runs. A value of 0 uses one thread per host "
+			"core.");
 }
 
 
 void Emulator::ProcessOptions()
 {
+	// Check block size
+	if (max_block_instructions < 1)
+		throw Error(misc::fmt("Invalid value for --x86-block-inst "
+				"(%d), must be at least 1",
+				max_block_instructions));
+
+	// Check number of threads
+	if (num_threads < 0)
+		throw Error(misc::fmt("Invalid value for --x86-threads "
+				"(%d), must be 0 or greater",
+				num_threads));
+
 	// Debuggers
 	call_debug.setPath(call_debug_file);
 	context_debug.setPath(context_debug_file);
@@ -421,6 +460,130 @@ void Emulator::ProcessEvents()
 }
 
 
+Emulator::~Emulator()
+{
+	// Stop host threads
+	{
+		std::lock_guard<std::mutex> lock(parallel_mutex);
+		parallel_exit = true;
+	}
+	parallel_start.notify_all();
+	for (std::thread &thread : threads)
+		thread.join();
+}
+
+
+void Emulator::ParallelThread()
+{
+	long long iteration = 0;
+	while (true)
+	{
+		// Wait for a new iteration
+		{
+			std::unique_lock<std::mutex> lock(parallel_mutex);
+			parallel_start.wait(lock, [&] {
+				return parallel_exit ||
+						parallel_iteration != iteration;
+			});
+			if (parallel_exit)
+				return;
+			iteration = parallel_iteration;
+		}
+
+		// Emulate contexts
+		ParallelWork();
+
+		// Notify the main thread
+		std::lock_guard<std::mutex> lock(parallel_mutex);
+		if (!--parallel_num_busy)
+			parallel_finish.notify_one();
+	}
+}
+
+
+void Emulator::ParallelWork()
+{
+	while (true)
+	{
+		// Take next context
+		int index = parallel_next.fetch_add(1);
+		if (index >= (int) parallel_contexts.size())
+			return;
+
+		// Emulate it. Errors are thrown again by the main thread.
+		try
+		{
+			parallel_num_instructions[index] =
+					parallel_contexts[index]->ExecuteParallel(
+					parallel_max_instructions);
+		}
+		catch (...)
+		{
+			parallel_errors[index] = std::current_exception();
+		}
+	}
+}
+
+
+void Emulator::RunParallel(const std::vector<Context *> &contexts,
+		int max_instructions)
+{
+	// Create host threads the first time
+	int num_host_threads = num_threads ? num_threads :
+			std::max(1u, std::thread::hardware_concurrency());
+	while ((int) threads.size() < num_host_threads - 1)
+		threads.emplace_back(&Emulator::ParallelThread, this);
+
+	// Discard code written in the previous iteration before any thread
+	// uses the instruction caches, and check memory permissions
+	for (Context *context : contexts)
+	{
+		context->getInstructionCache()->Refresh();
+		context->getMemory()->setSafeDefault();
+	}
+
+	// Start iteration, with the main thread emulating contexts as well
+	parallel_contexts = contexts;
+	parallel_num_instructions.assign(contexts.size(), 0);
+	parallel_errors.assign(contexts.size(), nullptr);
+	parallel_max_instructions = max_instructions;
+	parallel_next = 0;
+	{
+		std::lock_guard<std::mutex> lock(parallel_mutex);
+		parallel_num_busy = threads.size();
+		parallel_iteration++;
+	}
+	parallel_start.notify_all();
+	ParallelWork();
+
+	// Wait for the host threads
+	{
+		std::unique_lock<std::mutex> lock(parallel_mutex);
+		parallel_finish.wait(lock, [&] {
+			return !parallel_num_busy;
+		});
+	}
+
+	// Count instructions, and throw the first error in context order
+	for (unsigned i = 0; i < contexts.size(); i++)
+		num_instructions += parallel_num_instructions[i];
+	for (std::exception_ptr &error : parallel_errors)
+		if (error)
+			std::rethrow_exception(error);
+
+	// Contexts that stopped early on a serializing instruction or a code
+	// write emulate their next instruction alone. Execute() counts it in
+	// the emulator.
+	for (unsigned i = 0; i < contexts.size(); i++)
+	{
+		Context *context = contexts[i];
+		if (parallel_num_instructions[i] < max_instructions &&
+				context->getState(Context::StateRunning))
+			context->Execute();
+	}
+}
+
+
 bool Emulator::Run()
 {
 	// Stop if there is no more contexts
@@ -435,17 +598,47 @@ bool Emulator::Run()
 	if (esim->hasFinished())
 		return true;
 
-	// Run an instruction from every running context. During execution, a
-	// context can remove itself from the running list, so traversing the
-	// running list is not an option.
-	for (auto &context : contexts)
+	// Contexts that can be emulated in parallel in this iteration
+	std::vector<Context *> running;
+	if (num_threads != 1 && !isa_debug && !call_debug &&
+			max_block_instructions > 1)
+		for (auto &context : contexts)
+			if (context->getState(Context::StateRunning) &&
+					!context->getState(Context::StateSpecMode))
+				running.push_back(context.get());
+
+	// Emulate running contexts on all host threads, as long as the
+	// maximum number of instructions cannot be reached in this iteration
+	if (running.size() > 1 && (!max_instructions ||
+			max_instructions - num_instructions >=
+			(long long) max_block_instructions *
+			(long long) running.size()))
 	{
-		// Skip if not running
-		if (!context->getState(Context::StateRunning))
-			continue;
+		RunParallel(running, max_block_instructions);
+	}
+	else
+	{
+		// Run instructions from every running context, limited by the
+		// maximum number of instructions. During execution, a context
+		// can remove itself from the running list, so traversing the
+		// running list is not an option.
+		for (auto &context : contexts)
+		{
+			// Skip if not running
+			if (!context->getState(Context::StateRunning))
+				continue;
+
+			// Number of instructions to run
+			long long count = max_block_instructions;
+			if (max_instructions)
+				count = std::min(count, max_instructions -
+						num_instructions);
+			if (count <= 0)
+				break;
 
-		// Run one iteration
-		context->Execute();
+			// Run one iteration
+			context->ExecuteBlock((int) count);
+		}
 	}
 
 	// Free finished contexts
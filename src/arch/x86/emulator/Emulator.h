@@ -22,6 +22,13 @@
 
 #include <pthread.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <arch/common/Arch.h>
 #include <arch/common/Emulator.h>
 #include <lib/cpp/CommandLine.h>
@@ -68,6 +75,14 @@ class Emulator : public comm::Emulator
 	// Maximum number of instructions
 	static long long max_instructions;
 
+	// Maximum number of instructions emulated for a context in each
+	// iteration of the functional simulation
+	static int max_block_instructions;
+
+	// Number of host threads emulating contexts in the functional
+	// simulation
+	static int num_threads;
+
 	// Unique instance of singleton
 	static std::unique_ptr<Emulator> instance;
 
@@ -111,6 +126,53 @@ class Emulator : public comm::Emulator
 	long long futex_sleep_count = 0;
 
 
+
+
+	//
+	// Parallel functional simulation
+	//
+
+	// Host threads helping the main thread, created on the first parallel
+	// iteration
+	std::vector<std::thread> threads;
+
+	// Mutex and condition variables used to start an iteration in the
+	// host threads, and to wait for them to finish
+	std::mutex parallel_mutex;
+	std::condition_variable parallel_start;
+	std::condition_variable parallel_finish;
+
+	// Identifier of the last iteration started, number of host threads
+	// still running it, and whether the host threads must exit
+	long long parallel_iteration = 0;
+	int parallel_num_busy = 0;
+	bool parallel_exit = false;
+
+	// Contexts emulated in the current iteration, and for each of them,
+	// the number of emulated instructions and the error thrown, if any
+	std::vector<Context *> parallel_contexts;
+	std::vector<int> parallel_num_instructions;
+	std::vector<std::exception_ptr> parallel_errors;
+
+	// Maximum number of instructions emulated by each context in the
+	// current iteration
+	int parallel_max_instructions = 0;
+
+	// Index of the next context to emulate by any thread
+	std::atomic<int> parallel_next{0};
+
+	// Main function of the host threads
+	void ParallelThread();
+
+	// Emulate contexts of the current iteration until none is left
+	void ParallelWork();
+
+	// Run one iteration emulating the given contexts on all host threads,
+	// with at most 'max_instructions' instructions each
+	void RunParallel(const std::vector<Context *> &contexts,
+			int max_instructions);
+
+
 public:
 
 	//
@@ -132,6 +194,17 @@ public:
 	/// Return the maximum number of instructions, as set up by the user
 	static long long getMaxInstructions() { return max_instructions; }
 
+	/// Return the maximum number of instructions emulated for a context in
+	/// each iteration of the functional simulation
+	static int getMaxBlockInstructions() { return max_block_instructions; }
+
+	/// Set the number of host threads emulating contexts in the functional
+	/// simulation, where 0 means one per host core
+	static void setNumThreads(int num_threads)
+	{
+		Emulator::num_threads = num_threads;
+	}
+
 	/// Debugger for function calls
 	static misc::Debug call_debug;
 
@@ -157,6 +230,10 @@ public:
 	/// Constructor
 	Emulator() : comm::Emulator("x86") { }
 
+	/// Destructor, stopping the host threads of the parallel functional
+	/// simulation
+	~Emulator();
+
 	/// Create a new context associated with the emulator. The context is
 	/// inserted in the main emulator context list. Its state is set to
 	/// ContextRunning, and it is inserted into the emulator list of running
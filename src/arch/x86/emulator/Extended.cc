@@ -17,44 +17,136 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
 #include <lib/cpp/String.h>
 
 #include "Extended.h"
 
 
+// The host 'long double' type uses the x87 80-bit format, stored in the
+// first 10 bytes of its representation
+#if LDBL_MANT_DIG == 64 && LDBL_MAX_EXP == 16384 && \
+		defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define EXTENDED_IS_LONG_DOUBLE 1
+#else
+#define EXTENDED_IS_LONG_DOUBLE 0
+#endif
+
+
 namespace x86
 {
 
 
+void Extended::LongDoubleToExtended(long double f, unsigned char *x)
+{
+#if EXTENDED_IS_LONG_DOUBLE
+	memcpy(x, &f, 10);
+#else
+	// Biased exponent and significand with an explicit integer bit
+	int exponent;
+	unsigned long long significand;
+	if (std::isnan(f))
+	{
+		exponent = 0x7fff;
+		significand = 0xc000000000000000ull;
+	}
+	else if (std::isinf(f))
+	{
+		exponent = 0x7fff;
+		significand = 0x8000000000000000ull;
+	}
+	else if (f == 0)
+	{
+		exponent = 0;
+		significand = 0;
+	}
+	else
+	{
+		// Denormals have exponent 0 and the weight of exponent 1. A
+		// significand rounded up to the next power of two increments the
+		// exponent.
+		int exp;
+		long double fraction = std::frexp(std::fabs(f), &exp);
+		exponent = exp + 16382;
+		int shift = exponent > 0 ? 64 : exp + 16445;
+		long double scaled = std::nearbyint(std::ldexp(fraction, shift));
+		if (exponent <= 0)
+		{
+			exponent = scaled >= 0x1p63L ? 1 : 0;
+		}
+		else if (scaled >= 0x1p64L)
+		{
+			scaled = 0x1p63L;
+			exponent++;
+		}
+		significand = (unsigned long long) scaled;
+
+		// Overflow to infinity
+		if (exponent >= 0x7fff)
+		{
+			exponent = 0x7fff;
+			significand = 0x8000000000000000ull;
+		}
+	}
+
+	// Store in little-endian order
+	for (int i = 0; i < 8; i++)
+		x[i] = significand >> (i * 8);
+	x[8] = exponent;
+	x[9] = (exponent >> 8) | (std::signbit(f) ? 0x80 : 0);
+#endif
+}
+
+
+long double Extended::ExtendedToLongDouble(const unsigned char *x)
+{
+#if EXTENDED_IS_LONG_DOUBLE
+	long double f;
+	memcpy(&f, x, 10);
+	return f;
+#else
+	unsigned long long significand = 0;
+	for (int i = 0; i < 8; i++)
+		significand |= (unsigned long long) x[i] << (i * 8);
+	int exponent = x[8] | (x[9] & 0x7f) << 8;
+	bool sign = x[9] & 0x80;
+
+	// Infinity and NaN
+	long double f;
+	if (exponent == 0x7fff)
+		f = significand << 1 ? NAN : INFINITY;
+	else
+		f = std::ldexp((long double) significand,
+				(exponent ? exponent : 1) - 16383 - 63);
+	return sign ? -f : f;
+#endif
+}
+
+
 void Extended::DoubleToExtended(double f, unsigned char *x)
 {
-	asm volatile ("fldl %1; fstpt %0\n\t"
-			: "=m" (*x) : "m" (f));
+	LongDoubleToExtended(f, x);
 }
 
 
 double Extended::ExtendedToDouble(const unsigned char *x)
 {
-	double f;
-	asm volatile ("fldt %1; fstpl %0\n\t"
-			: "=m" (f) : "m" (*x));
-	return f;
+	return ExtendedToLongDouble(x);
 }
 
 
 void Extended::FloatToExtended(float f, unsigned char *x)
 {
-	asm volatile ("flds %1; fstpt %0\n\t"
-			: "=m" (*x) : "m" (f));
+	LongDoubleToExtended(f, x);
 }
 
 
 float Extended::ExtendedToFloat(const unsigned char *x)
 {
-	float f;
-	asm volatile ("fldt %1; fstps %0\n\t"
-			: "=m" (f) : "m" (*x));
-	return f;
+	return ExtendedToLongDouble(x);
 }
 
 
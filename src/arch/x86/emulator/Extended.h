@@ -34,6 +34,14 @@ class Extended
 
 public:
 
+	/// Convert a \c long \c double into an extended. The conversion is
+	/// exact if the host \c long \c double type uses the 80-bit format of
+	/// the x87 FPU, and rounds to the nearest value otherwise.
+	static void LongDoubleToExtended(long double f, unsigned char *x);
+
+	/// Convert an extended into a \c long \c double
+	static long double ExtendedToLongDouble(const unsigned char *x);
+
 	/// Convert a double into an extended
 	static void DoubleToExtended(double f, unsigned char *x);
 
@@ -49,6 +57,11 @@ public:
 	/// Empty constructor, initializing the value to 0
 	Extended() : x() { }
 
+	/// Initialize with a value of type \c long \c double. This
+	/// constructor can be conveniently used as an implicit cast
+	/// constructor.
+	Extended(long double value) { LongDoubleToExtended(value, x); }
+
 	/// Initialize with a value of type \c double. This constructor can be
 	/// conveniently used as an implicit cast constructor.
 	Extended(double value) { DoubleToExtended(value, x); }
@@ -71,6 +84,9 @@ public:
 	/// Return the represented extended number as a 32-bit \c float.
 	float getFloat() const { return ExtendedToFloat(x); }
 
+	/// Return the \c long \c double representation
+	long double getLongDouble() const { return ExtendedToLongDouble(x); }
+
 	/// Return the 64-bit \c double representation
 	double getDouble() const { return ExtendedToDouble(x); }
 
@@ -0,0 +1,133 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "InstructionCache.h"
+
+
+namespace x86
+{
+
+void InstructionCache::InvalidatePage(unsigned tag)
+{
+	// Discard blocks. A block spanning several pages remains listed in
+	// the other pages, which is harmless. Links to the discarded blocks
+	// are dropped by moving to a new epoch.
+	auto block_it = page_blocks.find(tag);
+	if (block_it != page_blocks.end())
+	{
+		for (unsigned eip : block_it->second)
+			blocks.erase(eip);
+		page_blocks.erase(block_it);
+		epoch++;
+	}
+
+	// Nothing else to do if no instruction was cached from the page
+	auto it = page_entries.find(tag);
+	if (it == page_entries.end())
+		return;
+
+	// Discard instructions. An instruction crossing into another page
+	// remains listed in that page, which is harmless.
+	for (unsigned eip : it->second)
+		entries.erase(eip);
+	page_entries.erase(it);
+	num_invalidations++;
+}
+
+
+void InstructionCache::LinkBlock(Block *block, Block *next)
+{
+	// Drop stale links
+	if (block->epoch.load(std::memory_order_acquire) != epoch)
+	{
+		block->links[0].store(nullptr, std::memory_order_relaxed);
+		block->links[1].store(nullptr, std::memory_order_relaxed);
+		block->epoch.store(epoch, std::memory_order_release);
+	}
+
+	// Replace the oldest link. The release stores make the content of the
+	// linked block visible to threads following the link.
+	block->links[1].store(block->links[0].load(std::memory_order_relaxed),
+			std::memory_order_release);
+	block->links[0].store(next, std::memory_order_release);
+}
+
+
+InstructionCache::Block *InstructionCache::InsertBlock(Block &&block)
+{
+	// Mark the pages of the block, so that writes to them are reported
+	// by the memory.
+	unsigned eip = block.eip;
+	unsigned size = block.end_eip - eip;
+	if (block.entries.empty() || !memory->MarkCode(eip, size))
+		return nullptr;
+
+	// Add block, replacing an existing one
+	Block &new_block = blocks[eip];
+	new_block = std::move(block);
+	new_block.epoch.store(epoch, std::memory_order_relaxed);
+
+	// Record it in its pages
+	unsigned tag = eip & mem::Memory::PageMask;
+	unsigned last_tag = (eip + size - 1) & mem::Memory::PageMask;
+	while (true)
+	{
+		page_blocks[tag].push_back(eip);
+		if (tag == last_tag)
+			break;
+		tag += mem::Memory::PageSize;
+	}
+	return &new_block;
+}
+
+
+void InstructionCache::Insert(const Instruction &inst, ExecuteFn fn)
+{
+	// Mark the pages of the instruction, so that writes to them are
+	// reported by the memory.
+	unsigned eip = inst.getEip();
+	unsigned size = inst.getSize();
+	if (!size || !memory->MarkCode(eip, size))
+		return;
+
+	// Add entry
+	auto ret = entries.emplace(eip, Entry{ inst, fn });
+	if (!ret.second)
+		return;
+
+	// Record it in its pages
+	unsigned tag1 = eip & mem::Memory::PageMask;
+	unsigned tag2 = (eip + size - 1) & mem::Memory::PageMask;
+	page_entries[tag1].push_back(eip);
+	if (tag2 != tag1)
+		page_entries[tag2].push_back(eip);
+}
+
+
+void InstructionCache::Clear()
+{
+	entries.clear();
+	page_entries.clear();
+	blocks.clear();
+	page_blocks.clear();
+	epoch++;
+}
+
+
+}  // namespace x86
@@ -0,0 +1,272 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2012  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef ARCH_X86_EMU_INSTRUCTION_CACHE_H
+#define ARCH_X86_EMU_INSTRUCTION_CACHE_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <arch/x86/disassembler/Instruction.h>
+#include <memory/Memory.h>
+
+
+namespace x86
+{
+
+// Forward declarations
+class Context;
+
+
+/// Cache of decoded instructions of an address space, indexed by their
+/// address. Contexts sharing a memory object share its instruction cache,
+/// which skips the fetch and decoding of instructions executed before. The
+/// instructions cached from a page are discarded when the page is written,
+/// unmapped, or changes its permissions.
+///
+/// The cache also holds basic blocks of decoded instructions, used by the
+/// functional simulation to emulate a whole block per call. Blocks are
+/// discarded together with the instructions of their pages.
+///
+/// In the parallel functional simulation, contexts sharing the cache run
+/// blocks on different host threads. They look up and insert blocks
+/// holding the cache mutex, without discarding modified pages, which is
+/// only done with Refresh() while no other thread uses the cache.
+class InstructionCache
+{
+public:
+
+	/// Maximum number of instructions in a basic block
+	static const unsigned MaxBlockSize = 64;
+
+	/// Function emulating an instruction
+	typedef void (Context::*ExecuteFn)();
+
+	/// Cached instruction
+	struct Entry
+	{
+		// Decoded instruction
+		Instruction inst;
+
+		// Function emulating the instruction
+		ExecuteFn fn;
+
+		// Whether the instruction must be emulated while no other
+		// context runs on another host thread
+		bool serializing;
+	};
+
+	/// Basic block of decoded instructions, ending in a control transfer
+	/// instruction, or before an instruction that could not be decoded.
+	struct Block
+	{
+		// Address of the first instruction
+		unsigned eip = 0;
+
+		// Address following the last instruction
+		unsigned end_eip = 0;
+
+		// Instructions of the block
+		std::vector<Entry> entries;
+
+		// Blocks executed after this one, as found in previous
+		// executions, and the value of the cache epoch when they were
+		// linked. Links are dropped when any block is discarded. They
+		// are read without holding the cache mutex.
+		std::atomic<Block *> links[2];
+		std::atomic<long long> epoch{0};
+
+		/// Constructor
+		Block()
+		{
+			links[0] = nullptr;
+			links[1] = nullptr;
+		}
+
+		/// Move constructor. Links are not moved, since blocks are
+		/// only moved before they are inserted in the cache.
+		Block(Block &&block) : Block()
+		{
+			*this = std::move(block);
+		}
+
+		/// Move assignment, with the same considerations as the move
+		/// constructor
+		Block &operator=(Block &&block)
+		{
+			eip = block.eip;
+			end_eip = block.end_eip;
+			entries = std::move(block.entries);
+			links[0] = nullptr;
+			links[1] = nullptr;
+			return *this;
+		}
+	};
+
+private:
+
+	// Memory the instructions are decoded from
+	mem::Memory *memory;
+
+	// Cached instructions, indexed by their address
+	std::unordered_map<unsigned, Entry> entries;
+
+	// Addresses of the cached instructions of each page, indexed by the
+	// page tag. Instructions crossing a page boundary are listed in both
+	// pages.
+	std::unordered_map<unsigned, std::vector<unsigned>> page_entries;
+
+	// Basic blocks, indexed by the address of their first instruction
+	std::unordered_map<unsigned, Block> blocks;
+
+	// Start addresses of the blocks of each page, indexed by the page tag
+	std::unordered_map<unsigned, std::vector<unsigned>> page_blocks;
+
+	// Incremented every time blocks are discarded, invalidating all links
+	// between blocks
+	long long epoch = 0;
+
+	// Mutex held by host threads of the parallel functional simulation
+	// while looking up, inserting, or linking blocks
+	std::mutex mutex;
+
+	// Statistics
+	long long num_hits = 0;
+	long long num_misses = 0;
+	long long num_invalidations = 0;
+
+	// Discard the instructions cached from a page
+	void InvalidatePage(unsigned tag);
+
+public:
+
+	/// Constructor
+	InstructionCache(mem::Memory *memory) : memory(memory)
+	{
+	}
+
+	/// Return the cached instruction at the given address, or `nullptr`
+	/// if it is not cached. The returned pointer is valid until the next
+	/// call to Insert().
+	const Entry *Lookup(unsigned eip)
+	{
+		// Discard instructions of modified pages
+		Refresh();
+
+		// Look up
+		auto it = entries.find(eip);
+		if (it == entries.end())
+		{
+			num_misses++;
+			return nullptr;
+		}
+		num_hits++;
+		return &it->second;
+	}
+
+	/// Return the basic block starting at the given address, or `nullptr`
+	/// if it is not cached. The returned pointer is valid until the next
+	/// call to Lookup(), LookupBlock(), or Clear().
+	Block *LookupBlock(unsigned eip)
+	{
+		Refresh();
+		return FindBlock(eip);
+	}
+
+	/// Return the basic block starting at the given address, or `nullptr`
+	/// if it is not cached, without discarding the instructions of
+	/// modified pages first. Blocks are never discarded by this call, so
+	/// this is the look-up used while other threads run blocks.
+	Block *FindBlock(unsigned eip)
+	{
+		auto it = blocks.find(eip);
+		return it == blocks.end() ? nullptr : &it->second;
+	}
+
+	/// Discard the instructions and blocks of the pages that were
+	/// modified since the last call. No other thread can be using the
+	/// cache.
+	void Refresh()
+	{
+		if (memory->hasInvalidatedCode())
+			for (unsigned tag : memory->TakeInvalidatedCode())
+				InvalidatePage(tag);
+	}
+
+	/// Return the mutex held by host threads of the parallel functional
+	/// simulation while calling FindBlock(), InsertBlock(), and
+	/// LinkBlock()
+	std::mutex &getMutex() { return mutex; }
+
+	/// Return the block executed after the given one starting at address
+	/// \a eip, if it was linked before with LinkBlock(). This skips the
+	/// block lookup, and must only be used when the memory has no pending
+	/// code invalidations.
+	Block *getLinkedBlock(Block *block, unsigned eip) const
+	{
+		if (block->epoch.load(std::memory_order_acquire) != epoch)
+			return nullptr;
+		for (const std::atomic<Block *> &link : block->links)
+		{
+			Block *next = link.load(std::memory_order_acquire);
+			if (next && next->eip == eip)
+				return next;
+		}
+		return nullptr;
+	}
+
+	/// Record that \a next was executed after \a block, replacing the
+	/// oldest link of the block.
+	void LinkBlock(Block *block, Block *next);
+
+	/// Cache a basic block. The block is not cached if its bytes are not
+	/// in allocated pages. The function returns the cached block, or
+	/// `nullptr` if it could not be cached.
+	Block *InsertBlock(Block &&block);
+
+	/// Cache a decoded instruction, together with its emulation function.
+	/// The instruction is not cached if its bytes are not in allocated
+	/// pages.
+	void Insert(const Instruction &inst, ExecuteFn fn);
+
+	/// Discard all cached instructions
+	void Clear();
+
+	/// Return the number of cached instructions
+	int getNumEntries() const { return entries.size(); }
+
+	/// Return the number of cached basic blocks
+	int getNumBlocks() const { return blocks.size(); }
+
+	/// Return the number of lookups that found the instruction
+	long long getNumHits() const { return num_hits; }
+
+	/// Return the number of lookups that did not find the instruction
+	long long getNumMisses() const { return num_misses; }
+
+	/// Return the number of pages whose instructions were discarded
+	long long getNumInvalidations() const { return num_invalidations; }
+};
+
+
+}  // namespace x86
+
+#endif
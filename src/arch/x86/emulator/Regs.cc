@@ -17,9 +17,11 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <cstring>
 
 #include <arch/x86/disassembler/Instruction.h>
+#include <lib/cpp/Error.h>
 #include <lib/cpp/Misc.h>
 #include <lib/cpp/String.h>
 
@@ -117,20 +119,143 @@ Regs::Regs()
 }
 
 
-unsigned Regs::Read(int reg) const
+bool Regs::ComputeFlag(Instruction::Flag flag) const
 {
-	assert(misc::inRange(reg, Instruction::RegNone, Instruction::RegCount - 1));
-	unsigned *value_ptr = (unsigned *) ((char *) &eax + info[reg].offset);
-	return *value_ptr & mask[info[reg].size];
+	// Flags depending only on the result
+	unsigned sign = 1u << (flags_size * 8 - 1);
+	switch (flag)
+	{
+
+	case Instruction::FlagZF:
+
+		return !flags_result;
+
+	case Instruction::FlagSF:
+
+		return flags_result & sign;
+
+	case Instruction::FlagPF:
+
+		return !__builtin_parity(flags_result & 0xff);
+
+	default:
+
+		break;
+	}
+
+	// Carry flag, frequently read alone by conditional jumps
+	if (flag == Instruction::FlagCF)
+	{
+		switch (flags_op)
+		{
+
+		case FlagsOpAdd:
+
+			return flags_carry ? flags_result <= flags_src1 :
+					flags_result < flags_src1;
+
+		case FlagsOpSub:
+
+			return flags_carry ? flags_src1 <= flags_src2 :
+					flags_src1 < flags_src2;
+
+		default:
+
+			break;
+		}
+	}
+
+	// Other flags
+	return misc::getBit32(ComputeFlags(), flag);
 }
 
 
-void Regs::Write(int reg, unsigned value)
+unsigned Regs::ComputeFlags() const
 {
-	assert(misc::inRange(reg, Instruction::RegNone, Instruction::RegCount - 1));
-	unsigned mask = this->mask[info[reg].size];
-	unsigned *value_ptr = (unsigned *) ((char *) &eax + info[reg].offset);
-	*value_ptr = (*value_ptr & ~mask) | (value & mask);
+	unsigned bits = flags_size * 8;
+	unsigned sign = 1u << (bits - 1);
+	unsigned result = flags_result;
+	unsigned src1 = flags_src1;
+	unsigned src2 = flags_src2;
+
+	// Flags depending only on the result
+	bool zf = !result;
+	bool sf = result & sign;
+	bool pf = !__builtin_parity(result & 0xff);
+
+	// Carry, overflow, and auxiliary carry
+	bool cf = false;
+	bool of = false;
+	bool af = false;
+	switch (flags_op)
+	{
+
+	case FlagsOpAdd:
+
+		cf = flags_carry ? result <= src1 : result < src1;
+		of = (src1 ^ result) & (src2 ^ result) & sign;
+		af = (src1 ^ src2 ^ result) & 0x10;
+		break;
+
+	case FlagsOpSub:
+
+		cf = flags_carry ? src1 <= src2 : src1 < src2;
+		of = (src1 ^ src2) & (src1 ^ result) & sign;
+		af = (src1 ^ src2 ^ result) & 0x10;
+		break;
+
+	case FlagsOpLogic:
+
+		break;
+
+	case FlagsOpInc:
+
+		cf = flags_carry;
+		of = result == sign;
+		af = !(result & 0xf);
+		break;
+
+	case FlagsOpDec:
+
+		cf = flags_carry;
+		of = result == sign - 1;
+		af = (result & 0xf) == 0xf;
+		break;
+
+	case FlagsOpShl:
+
+		// The overflow flag is only defined for 1-bit shifts. It is
+		// computed the same way for all counts.
+		cf = src2 <= bits && ((src1 >> (bits - src2)) & 1);
+		of = bool(result & sign) != cf;
+		break;
+
+	case FlagsOpShr:
+
+		cf = (src1 >> (src2 - 1)) & 1;
+		of = src1 & sign;
+		break;
+
+	case FlagsOpSar:
+	{
+		// Sign-extend the operand to 32 bits
+		int value = (int) (src1 << (32 - bits)) >> (32 - bits);
+		cf = (value >> std::min(src2 - 1, 31u)) & 1;
+		break;
+	}
+
+	default:
+
+		throw misc::Panic("Invalid flags operation");
+	}
+
+	// Build flags
+	return (cf << Instruction::FlagCF) |
+			(pf << Instruction::FlagPF) |
+			(af << Instruction::FlagAF) |
+			(zf << Instruction::FlagZF) |
+			(sf << Instruction::FlagSF) |
+			(of << Instruction::FlagOF);
 }
 
 
@@ -211,6 +336,7 @@ void Regs::Dump(std::ostream &os) const
 	os << misc::fmt("  es=%x, cs=%x, ss=%x, ds=%x, fs=%x, gs=%x\n",
 		es, cs, ss, ds, fs, gs);
 	os << misc::fmt("  eip=%08x\n", eip);
+	unsigned eflags = getEflags();
 	os << misc::fmt("  flags=%04x (cf=%d  pf=%d  af=%d  zf=%d  sf=%d  df=%d  of=%d)\n",
 		eflags,
 		(eflags & (1 << Instruction::FlagCF)) > 0,
@@ -36,6 +36,35 @@ namespace x86
 /// Class representing the state of the x86 architected register file.
 class Regs
 {
+public:
+
+	/// Operations setting the arithmetic flags (CF, PF, AF, ZF, SF, OF) in
+	/// register \c eflags, whose value is computed lazily from the operands
+	/// and result of the last one executed.
+	enum FlagsOp
+	{
+		FlagsOpNone = 0,
+		FlagsOpAdd,
+		FlagsOpSub,
+		FlagsOpLogic,
+		FlagsOpInc,
+		FlagsOpDec,
+		FlagsOpShl,
+		FlagsOpShr,
+		FlagsOpSar
+	};
+
+	/// Mask of the arithmetic flags in register \c eflags
+	static const unsigned ArithmeticFlagsMask =
+			(1 << Instruction::FlagCF) |
+			(1 << Instruction::FlagPF) |
+			(1 << Instruction::FlagAF) |
+			(1 << Instruction::FlagZF) |
+			(1 << Instruction::FlagSF) |
+			(1 << Instruction::FlagOF);
+
+private:
+
 	union
 	{
 		// View of the main set of registers as defined in the register
@@ -74,6 +103,24 @@ class Regs
 	unsigned eip;
 	unsigned eflags;
 
+	// Last operation setting the arithmetic flags, or FlagsOpNone if their
+	// value is present in 'eflags'. Its operand size in bytes, operands,
+	// and result are stored truncated to the operand size. The carry is
+	// the input carry of 'adc' and 'sbb', or the carry flag preserved by
+	// 'inc' and 'dec'.
+	FlagsOp flags_op = FlagsOpNone;
+	unsigned flags_size = 4;
+	unsigned flags_src1 = 0;
+	unsigned flags_src2 = 0;
+	unsigned flags_result = 0;
+	unsigned flags_carry = 0;
+
+	// Compute the arithmetic flags of the last operation
+	unsigned ComputeFlags() const;
+
+	// Compute one arithmetic flag of the last operation
+	bool ComputeFlag(Instruction::Flag flag) const;
+
 	// Floating-point stack
 	struct
 	{
@@ -115,27 +162,83 @@ public:
 	/// is less than 32-bit wide, the read value is zero-extended. The type
 	/// of argument \a reg is \c int in order to avoid conversion warnings
 	/// when using arithmetic to compute it.
-	unsigned Read(int reg) const;
+	unsigned Read(int reg) const
+	{
+		assert(misc::inRange(reg, Instruction::RegNone,
+				Instruction::RegCount - 1));
+		unsigned *value_ptr = (unsigned *) ((char *) &eax +
+				info[reg].offset);
+		return *value_ptr & mask[info[reg].size];
+	}
 
 	/// Write one of the main x86 registers (register \a eax through \a gs),
 	/// identified with an \c Inst::RegXXX constant. Argument \a reg has type
 	/// \a int to avoid cast warnings when using integer arithmetic to
 	/// compute it.
-	void Write(int reg, unsigned value);
+	void Write(int reg, unsigned value)
+	{
+		assert(misc::inRange(reg, Instruction::RegNone,
+				Instruction::RegCount - 1));
+		unsigned mask = this->mask[info[reg].size];
+		unsigned *value_ptr = (unsigned *) ((char *) &eax +
+				info[reg].offset);
+		*value_ptr = (*value_ptr & ~mask) | (value & mask);
+	}
 
 	/// Set the value of a flag, given as an \c Inst::FlagXXX identifier.
 	void setFlag(Instruction::Flag flag) {
+		MaterializeFlags();
 		eflags = misc::setBit32(eflags, flag);
 	}
 
 	/// Clear the value of a flag, given as an \c Inst::FlagXXX identifier.
 	void clearFlag(Instruction::Flag flag) {
+		MaterializeFlags();
 		eflags = misc::clearBit32(eflags, flag);
 	}
 
+	/// Set or clear a flag, given as an \c Inst::FlagXXX identifier.
+	void setFlag(Instruction::Flag flag, bool value) {
+		if (value)
+			setFlag(flag);
+		else
+			clearFlag(flag);
+	}
+
 	/// Get the value of a flag, given as an \c Inst::FlagXXX constant.
-	bool getFlag(Instruction::Flag flag) {
-		return misc::getBit32(eflags, flag);
+	bool getFlag(Instruction::Flag flag) const {
+		if (flags_op == FlagsOpNone ||
+				!misc::getBit32(ArithmeticFlagsMask, flag))
+			return misc::getBit32(eflags, flag);
+		return ComputeFlag(flag);
+	}
+
+	/// Record the last operation setting the arithmetic flags. Their
+	/// value is computed only when read. Argument \a size is the operand
+	/// size in bytes (1, 2, or 4), and \a carry is the input carry of
+	/// 'adc' and 'sbb', or the current value of the carry flag for 'inc'
+	/// and 'dec'. For shifts, \a src2 is the shift count, which must not
+	/// be 0.
+	void setLazyFlags(FlagsOp op, unsigned size, unsigned result,
+			unsigned src1, unsigned src2 = 0, unsigned carry = 0)
+	{
+		unsigned mask = this->mask[size];
+		flags_op = op;
+		flags_size = size;
+		flags_result = result & mask;
+		flags_src1 = src1 & mask;
+		flags_src2 = src2 & mask;
+		flags_carry = carry;
+	}
+
+	/// Compute the arithmetic flags of the last operation and store them
+	/// in register \c eflags.
+	void MaterializeFlags()
+	{
+		if (flags_op == FlagsOpNone)
+			return;
+		eflags = (eflags & ~ArithmeticFlagsMask) | ComputeFlags();
+		flags_op = FlagsOpNone;
 	}
 
 	/// Read a 10-byte extended value from the FPU stack at \a index, given
@@ -242,7 +345,12 @@ public:
 	unsigned getEip() const { return eip; }
 
 	/// Get value of register \c eflags
-	unsigned getEflags() const { return eflags; }
+	unsigned getEflags() const
+	{
+		if (flags_op == FlagsOpNone)
+			return eflags;
+		return (eflags & ~ArithmeticFlagsMask) | ComputeFlags();
+	}
 
 	/// Get value of register \c es
 	unsigned short getEs() const { return es; }
@@ -386,7 +494,11 @@ public:
 	void decEip(int value) { eip -= value; }
 
 	/// Set value of register \c eflags
-	void setEflags(unsigned value) { eflags = value; }
+	void setEflags(unsigned value)
+	{
+		eflags = value;
+		flags_op = FlagsOpNone;
+	}
 
 	/// Get the top of the FP stack
 	int getFpuTop() const { return fpu_top; }
@@ -18,6 +18,7 @@
  */
 
 #include <arch/common/Arch.h>
+#include <lib/esim/IntervalStats.h>
 #include <memory/System.h>
 
 #include "Alu.h"
@@ -252,6 +253,20 @@ Timing::Timing() : comm::Timing("x86")
 	// Create CPU
 	cpu = misc::new_unique<Cpu>(this);
 
+	// Per-core IPC in interval statistics, measured in committed
+	// micro-instructions, as in the core sections of the x86 report.
+	esim::IntervalStats *interval_stats = esim::IntervalStats::getInstance();
+	if (interval_stats->isActive())
+	{
+		for (int i = 0; i < cpu->getNumCores(); i++)
+		{
+			Core *core = cpu->getCore(i);
+			interval_stats->RegisterRate(misc::fmt("x86.Core%d.IPC", i),
+					[core]() { return core->getNumCommittedUinsts(); },
+					getFrequencyDomain());
+		}
+	}
+
 	// Create the trace header related to CPU
 	trace.Header(misc::fmt("x86.init version=\"%d.%d\" "
 			"num_cores=%d num_threads=%d\n",
@@ -787,6 +802,12 @@ void Timing::DumpUopReport(std::ostream &os, const long long *uop_stats,
 }
 
 
+mem::Mmu *Timing::getMmu()
+{
+	return Emulator::getInstance()->getMmu();
+}
+
+
 void Timing::DumpReport() const
 {
 	// Ignore if no report file was specified
@@ -190,6 +190,10 @@ public:
 		assert(index >= 0 && index < (int) entry_modules.size());
 		return entry_modules[index];
 	}
+
+	/// Return the memory management unit of the x86 emulator, used by all
+	/// contexts to translate virtual addresses.
+	mem::Mmu *getMmu() override;
 	
 	
 	
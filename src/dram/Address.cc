@@ -17,8 +17,6 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 
-#include <cmath>
-
 #include <lib/cpp/String.h>
 
 #include "Address.h"
@@ -27,6 +25,14 @@
 namespace dram
 {
 
+misc::StringMap AddressMappingMap
+{
+	{ "ChRaBaRoCo", AddressMappingChRaBaRoCo },
+	{ "RoRaBaChCo", AddressMappingRoRaBaChCo },
+	{ "RoBaRaCoCh", AddressMappingRoBaRaCoCh },
+	{ "CacheLine", AddressMappingCacheLine }
+};
+
 
 Address::Address(long long encoded)
 		:
@@ -42,44 +48,27 @@ void Address::DecodeAddress()
 	// Get the DRAM system.
 	System *dram = System::getInstance();
 
-	// Get the sizes of each address component in number of bits required
-	// to represent it.
-	int physical_size = dram->getPhysicalSize();
-	int logical_size = dram->getLogicalSize();
-	int rank_size = dram->getRankSize();
-	int bank_size = dram->getBankSize();
-	int row_size = dram->getRowSize();
-	int column_size = dram->getColumnSize();
-
-	// Make a local copy of the address.  Don't use the one in the address
-	// struct because it will be altered during decoding.
-	long long decoding = encoded;
+	// Extract the segments of each address component, as precomputed
+	// by the DRAM system for the address mapping.
+	int fields[AddressNumFields] = {};
+	for (const AddressSegment &segment : dram->getAddressSegments())
+		fields[segment.field] |= ((encoded >> segment.shift) &
+				segment.mask) << segment.field_shift;
 
-	// Step through the address to parse out the components.
-	// This will be configurable, but for now the address mapping is
-	// (from MSB to LSB) physical:logical:rank:bank:row:column.
-	column = decoding & int(pow(2, column_size) - 1);
-	// Step to row.
-	decoding >>= column_size;
-	row = decoding & int(pow(2, row_size) - 1);
-	// Step to bank.
-	decoding >>= row_size;
-	bank = decoding & int(pow(2, bank_size) - 1);
-	// Step to rank.
-	decoding >>= bank_size;
-	rank = decoding & int(pow(2, rank_size) - 1);
-	// Step to logical.
-	decoding >>= rank_size;
-	logical = decoding & int(pow(2, logical_size) - 1);
-	// Step to physical.
-	decoding >>= logical_size;
-	physical = decoding & int(pow(2, physical_size) - 1);
+	// Permutation-based bank interleaving, where the bank is XORed with
+	// the low bits of the row, so that rows conflicting in the same bank
+	// are spread across banks.
+	if (dram->getXorBankHashing())
+		fields[AddressBank] ^= fields[AddressRow] &
+				((1 << dram->getBankSize()) - 1);
 
-	// Debug
-	// System::debug << misc::fmt("Sizes: %d, %d, %d, %d, %d, %d\n",
-	// 		physical_size, logical_size, rank_size, bank_size,
-	// 		row_size, column_size);
-	// dump(System::debug);
+	// Save components
+	physical = fields[AddressPhysical];
+	logical = fields[AddressLogical];
+	rank = fields[AddressRank];
+	bank = fields[AddressBank];
+	row = fields[AddressRow];
+	column = fields[AddressColumn];
 }
 
 
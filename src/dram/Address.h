@@ -22,10 +22,64 @@
 
 #include <iostream>
 
+#include <lib/cpp/String.h>
+
 
 namespace dram
 {
 
+/// Address components
+enum AddressField
+{
+	AddressPhysical = 0,
+	AddressLogical,
+	AddressRank,
+	AddressBank,
+	AddressRow,
+	AddressColumn,
+	AddressNumFields
+};
+
+
+/// Address mapping schemes, named after the order of the address components
+/// from the most to the least significant bits (Ch = channel, Ra = rank,
+/// Ba = bank, Ro = row, Co = column). The channel is made of the physical
+/// channel (controller) bits followed by the logical channel bits.
+enum AddressMapping
+{
+	AddressMappingChRaBaRoCo = 0,
+	AddressMappingRoRaBaChCo,
+	AddressMappingRoBaRaCoCh,
+
+	/// Cache-line interleaving. The low column bits addressing a cache
+	/// line are the least significant, followed by the channel, bank and
+	/// rank, so that consecutive lines go to different channels and banks.
+	/// The order is Ro:Co(high):Ra:Ba:Ch:Co(low).
+	AddressMappingCacheLine
+};
+
+/// String map for AddressMapping
+extern misc::StringMap AddressMappingMap;
+
+
+/// Segment of contiguous bits of an encoded address that maps to a
+/// component, or to part of it.
+struct AddressSegment
+{
+	// Address component
+	AddressField field;
+
+	// Position of the segment in the encoded address
+	int shift;
+
+	// Mask of the segment, once shifted to bit 0
+	long long mask;
+
+	// Position of the segment in the address component
+	int field_shift;
+};
+
+
 class Address
 {
 	// Encoded address
@@ -41,11 +95,8 @@ class Address
 
 	/// Decodes an encoded address into its components locations and stores
 	/// them in the class.  The encoded address is taken from the class's
-	/// encoded member
-	///
-	/// For now, this decodes in the order:
-	/// 	physical:logical:rank:bank:row:column.
-	/// This will eventually be configurable.
+	/// encoded member, and decoded with the address segments computed by
+	/// the DRAM system for the configured address mapping.
 	void DecodeAddress();
 
 public:
@@ -17,6 +17,9 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 
+#include <algorithm>
+#include <cassert>
+
 #include <lib/cpp/Error.h>
 #include <lib/cpp/String.h>
 #include <lib/esim/Engine.h>
@@ -27,6 +30,8 @@
 #include "Controller.h"
 #include "System.h"
 #include "Rank.h"
+#include "Request.h"
+#include "Scheduler.h"
 
 namespace dram
 {
@@ -62,8 +67,91 @@ void Bank::ProcessRequest(std::shared_ptr<Request> request)
 	// Get the current cycle.
 	long long cycle = System::frequency_domain->getCycle();
 
+	// Wake up the rank if it is in a low power state. This may close the
+	// open row.
+	rank->WakeUp();
+
+	// Account for the request in the channel, and add it to the queue of
+	// waiting requests.
+	Channel *channel = getRank()->getChannel();
+	channel->RequestAccepted(request.get());
+	request_queue.push_back(request);
+
+	// Let the scheduler select a request again, unless the commands of
+	// the selected one started to run.
+	ReleaseRequest();
+	SelectRequest();
+
+	// Update the scheduling state of the bank, and ensure the scheduler
+	// is running.
+	channel->UpdateBank(this);
+	channel->CallScheduler();
+
+	// Debug
+	System::debug << misc::fmt("[%lld] Processed request for 0x%llx in "
+			"bank %d\n", cycle,
+			request->getAddress()->getEncoded(), id);
+}
+
+
+bool Bank::isRowHit(Request *request) const
+{
+	return future_active_row == request->getAddress()->getRow();
+}
+
+
+void Bank::SelectRequest()
+{
+	// Nothing to do if a request is being served, or none is waiting
+	if (!command_queue.empty() || request_queue.empty())
+		return;
+
+	// Take the request selected by the scheduler
+	Scheduler *scheduler = rank->getChannel()->getScheduler();
+	int position = scheduler->SelectRequest(this);
+	assert(position >= 0 && position < (int) request_queue.size());
+	std::shared_ptr<Request> request = request_queue[position];
+	request_queue.erase(request_queue.begin() + position);
+
+	// Break it down into commands
+	ExpandRequest(request);
+}
+
+
+void Bank::ReleaseRequest()
+{
+	// Only a request whose commands did not start to run
+	if (command_queue.empty() || command_queue.front()->getRequest()->
+			getCycleFirstCommand() >= 0)
+		return;
+
+	// Put the request back in the queue, in arrival order
+	std::shared_ptr<Request> request =
+			command_queue.front()->getRequestPointer();
+	auto it = std::lower_bound(request_queue.begin(), request_queue.end(),
+			request, [](const std::shared_ptr<Request> &a,
+			const std::shared_ptr<Request> &b)
+	{
+		return a->getCycleArrival() < b->getCycleArrival();
+	});
+	request_queue.insert(it, request);
+
+	// Discard its commands. No command ran, so the bank stays in its
+	// current state.
+	rank->AddPendingCommands(-(int) command_queue.size());
+	command_queue.clear();
+	future_active_row = current_active_row;
+}
+
+
+void Bank::ExpandRequest(std::shared_ptr<Request> request)
+{
+	// Get the current cycle.
+	long long cycle = System::frequency_domain->getCycle();
+
 	// Pull the address out of the request.
 	Address *address = request->getAddress();
+	assert(command_queue.empty());
 
 	// Break the request down into its commands and add them to the queue.
 	// For all checks to the active row, the checks are made to what the
@@ -141,13 +229,8 @@ void Bank::ProcessRequest(std::shared_ptr<Request> request)
 		future_active_row = -1;
 	}
 
-	// Ensure the scheduler is running.
-	getRank()->getChannel()->CallScheduler();
-
-	// Debug
-	System::debug << misc::fmt("[%lld] Processed request for 0x%llx in "
-			"bank %d\n", cycle,
-			address->getEncoded(), id);
+	// Account for the new commands in the rank
+	rank->AddPendingCommands(command_queue.size());
 }
 
 
@@ -168,6 +251,34 @@ void Bank::RunFrontCommand()
 	// Add this command to the last scheduled command matrix.
 	setLastScheduledCommand(command->getType());
 
+	// The first command of a request shows whether it found its row open,
+	// the bank precharged, or another row open.
+	Request *request = command->getRequest();
+	if (request->getCycleFirstCommand() < 0)
+	{
+		if (command->isAccess())
+			num_row_hits++;
+		else if (command->getType() == CommandActivate)
+			num_row_misses++;
+		else
+			num_row_conflicts++;
+	}
+	request->CommandIssued(cycle, command->isAccess());
+
+	// Update the open row
+	if (command->getType() == CommandActivate)
+	{
+		if (current_active_row == -1)
+			rank->BankOpened();
+		current_active_row = command->getAddress()->getRow();
+	}
+	else if (command->getType() == CommandPrecharge &&
+			current_active_row != -1)
+	{
+		rank->BankClosed();
+		current_active_row = -1;
+	}
+
 	// Get the esim engine instance.
 	esim::Engine *esim = esim::Engine::getInstance();
 
@@ -182,8 +293,76 @@ void Bank::RunFrontCommand()
 			command->getId(), command->getTypeString().c_str(),
 			command->getAddress()->getEncoded());
 
-	// Command is being run, remove it from the queue.
+	// Command is being run, remove it from the queue, and continue with
+	// the next request when this one is done.
 	command_queue.pop_front();
+	SelectRequest();
+	rank->getChannel()->UpdateBank(this);
+}
+
+
+long long Bank::getRefreshReadyCycle() const
+{
+	// A precharged bank can be refreshed once the last precharge ends
+	Controller *controller = rank->getChannel()->getController();
+	long long cycle = System::frequency_domain->getCycle();
+	if (isPrecharged())
+		return std::max(cycle, getLastScheduledCommand(CommandPrecharge)
+				+ controller->getTimeRp());
+
+	// The open row is precharged first, following the same constraints
+	// as a precharge command.
+	long long ready = cycle;
+	ready = std::max(ready, getLastScheduledCommand(CommandActivate) +
+			controller->getTiming(TimingActivate, TimingPrecharge,
+			TimingSame, TimingSame));
+	ready = std::max(ready, getLastScheduledCommand(CommandRead) +
+			controller->getTiming(TimingRead, TimingPrecharge,
+			TimingSame, TimingSame));
+	ready = std::max(ready, getLastScheduledCommand(CommandWrite) +
+			controller->getTiming(TimingWrite, TimingPrecharge,
+			TimingSame, TimingSame));
+	return ready + controller->getTimeRp();
+}
+
+
+void Bank::Refresh(long long end)
+{
+	Close();
+	refresh_end = std::max(refresh_end, end);
+}
+
+
+void Bank::Close()
+{
+	// Close the row
+	if (current_active_row != -1)
+	{
+		rank->BankClosed();
+		current_active_row = -1;
+	}
+
+	// The commands in the queue were created for the row that will be
+	// open when they run. A column access at the front of the queue
+	// needs the row to be activated again. Any other command leaves the
+	// bank in the expected state.
+	if (command_queue.empty())
+	{
+		future_active_row = -1;
+	}
+	else if (command_queue.front()->isAccess())
+	{
+		std::shared_ptr<Command> access = command_queue.front();
+		long long cycle = System::frequency_domain->getCycle();
+		auto activate_command = std::make_shared<Command>(
+				access->getRequestPointer(), CommandActivate,
+				cycle, this);
+		command_queue.push_front(activate_command);
+		rank->AddPendingCommands(1);
+	}
+
+	// Update the scheduling state of the bank
+	rank->getChannel()->UpdateBank(this);
 }
 
 
@@ -203,6 +382,10 @@ void Bank::dump(std::ostream &os) const
 		os << misc::fmt("\t\t\t\t%d - %s\n", i,
 				command_queue[i]->getTypeString().c_str());
 	}
+
+	// Print the number of requests waiting
+	os << misc::fmt("\t\t\t%d Requests in queue\n",
+			(int) request_queue.size());
 }
 
 
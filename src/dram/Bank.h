@@ -47,9 +47,14 @@ class Bank
 	int num_columns;
 	int num_bits;
 
-	// Queue of commands to be sent to the Bank
+	// Queue of commands to be sent to the Bank. It holds the commands of
+	// the request selected by the scheduler of the channel.
 	std::deque<std::shared_ptr<Command>> command_queue;
 
+	// Requests waiting to be selected by the scheduler of the channel, in
+	// arrival order. They are broken down into commands once selected.
+	std::deque<std::shared_ptr<Request>> request_queue;
+
 	// Last scheduled command information
 	CommandType last_scheduled_command_type = CommandInvalid;
 	long long last_scheduled_commands[5] = {-100, -100, -100, -100, -100};
@@ -59,6 +64,29 @@ class Bank
 	int current_active_row = -1;
 	int future_active_row = -1;
 
+	// Cycle when the current refresh of the bank finishes
+	long long refresh_end = 0;
+
+	// Requests that found their row open (hits), the bank precharged
+	// (misses), or another row open (conflicts), when their first command
+	// was issued
+	long long num_row_hits = 0;
+	long long num_row_misses = 0;
+	long long num_row_conflicts = 0;
+
+	// Break the request down into its commands and add them to the
+	// command queue, which must be empty.
+	void ExpandRequest(std::shared_ptr<Request> request);
+
+	// Return the request in the command queue to the request queue, if
+	// none of its commands was issued yet, so that the scheduler can
+	// select a request again.
+	void ReleaseRequest();
+
+	// Expand the request selected by the scheduler of the channel among
+	// the waiting ones, if the command queue is empty.
+	void SelectRequest();
+
 public:
 
 	Bank(int id,
@@ -103,6 +131,30 @@ public:
 	/// Returns what row will be activated.
 	int getActiveRowFuture() const { return future_active_row; }
 
+	/// Returns the cycle when the current refresh of the bank finishes.
+	/// No command can run in the bank until then.
+	long long getRefreshEnd() const { return refresh_end; }
+
+	/// Returns the number of requests that found their row open.
+	long long getNumRowHits() const { return num_row_hits; }
+
+	/// Returns the number of requests that found the bank precharged.
+	long long getNumRowMisses() const { return num_row_misses; }
+
+	/// Returns the number of requests that found another row open.
+	long long getNumRowConflicts() const { return num_row_conflicts; }
+
+	/// Returns the first cycle a refresh can start in the bank, once the
+	/// open row, if any, was precharged.
+	long long getRefreshReadyCycle() const;
+
+	/// Refreshes the bank until the given cycle, closing the open row.
+	void Refresh(long long end);
+
+	/// Closes the open row. Commands in the queue that expected the row
+	/// to be open are preceded by an activate command.
+	void Close();
+
 	/// Returns how many commands are in the queue.
 	int getNumCommandsInQueue() const { return (int) command_queue.size(); }
 
@@ -112,22 +164,47 @@ public:
 		return command_queue[position]->getTypeString();
 	}
 
-	/// Returns the cycle when the command at the front of the queue was
-	/// created.
-	long long getFrontCommandCycleCreated()
+	/// Returns the command at the front of the queue.
+	Command *getFrontCommand() const
+	{
+		return command_queue.front().get();
+	}
+
+	/// Returns the command in the queue at a certain position.
+	Command *getCommandInQueue(int position) const
 	{
-		return command_queue.front()->getCycleCreated();
+		return command_queue[position].get();
 	}
 
+	/// Returns the number of requests waiting to be selected by the
+	/// scheduler, not including the request in the command queue.
+	int getNumRequestsInQueue() const { return (int) request_queue.size(); }
+
+	/// Returns a waiting request at a certain position, where position 0
+	/// is the oldest.
+	Request *getRequestInQueue(int position) const
+	{
+		return request_queue[position].get();
+	}
+
+	/// Returns whether a waiting request accesses the row that is open
+	/// when the command queue is empty (a row-buffer hit).
+	bool isRowHit(Request *request) const;
+
 	/// Returns the cycle when the command at the front of the queue will
 	/// be ready to be run.
 	long long getFrontCommandTiming();
 
-	/// Pops off the top command in the queue.
+	/// Pops off the top command in the queue. When the queue becomes
+	/// empty, the next request selected by the scheduler is broken down
+	/// into commands.
 	void RunFrontCommand();
 
-	/// Breaks a request down into it's component commands and adds them to the
-	/// bank's command queue.
+	/// Adds a request to the bank. Requests wait in a queue until the
+	/// scheduler of the channel selects them, and the selected request
+	/// is broken down into its component commands in the bank's command
+	/// queue. A request whose commands were not issued yet can be passed
+	/// by a request arriving later.
 	void ProcessRequest(std::shared_ptr<Request> request);
 
 	/// Dump the object to an output stream.
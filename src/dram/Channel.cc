@@ -18,6 +18,7 @@
  */
 
 #include <algorithm>
+#include <cassert>
 #include <iostream>
 
 #include <lib/cpp/String.h>
@@ -26,12 +27,21 @@
 #include "Bank.h"
 #include "Channel.h"
 #include "Controller.h"
+#include "Request.h"
 #include "System.h"
 
 
 namespace dram
 {
 
+misc::StringMap LatencyComponentMap
+{
+	{ "Total", LatencyTotal },
+	{ "Queueing", LatencyQueueing },
+	{ "Command", LatencyCommand },
+	{ "Transfer", LatencyTransfer }
+};
+
 
 Channel::Channel(int id,
 		Controller *parent,
@@ -52,6 +62,11 @@ Channel::Channel(int id,
 		ranks.emplace_back(new Rank(i, this, num_banks, num_rows,
 				num_columns, num_bits));
 
+	// Bank bitmasks
+	int num_words = (getNumBanksTotal() + 63) / 64;
+	pending_banks.resize(num_words);
+	row_hit_banks.resize(num_words);
+
 	switch(scheduler_type)
 	{
 	// Create a Rank Bank Round Robin scheduler.
@@ -65,6 +80,335 @@ Channel::Channel(int id,
 		scheduler = std::unique_ptr<Scheduler>(
 				new OldestFirst(this));
 		break;
+
+	// Create a First-Ready First-Come First-Served scheduler.
+	case SchedulerFRFCFS:
+		scheduler = std::unique_ptr<Scheduler>(
+				new FRFCFS(this));
+		break;
+
+	// Create a Parallelism-Aware Batch scheduler.
+	case SchedulerPARBS:
+		scheduler = std::unique_ptr<Scheduler>(
+				new PARBS(this));
+		break;
+
+	// Create an ATLAS scheduler.
+	case SchedulerATLAS:
+		scheduler = std::unique_ptr<Scheduler>(
+				new ATLAS(this));
+		break;
+	}
+}
+
+
+int Channel::FindBank(const std::vector<unsigned long long> &mask,
+		int start) const
+{
+	// Traverse the words of the mask, skipping the bits below 'start' in
+	// the first one.
+	int num_banks_total = getNumBanksTotal();
+	for (int word = start / 64; start < num_banks_total; word++)
+	{
+		unsigned long long bits = mask[word] >> (start % 64);
+		if (bits)
+			return start + __builtin_ctzll(bits);
+		start = (word + 1) * 64;
+	}
+
+	// None found
+	return -1;
+}
+
+
+int Channel::getBankIndex(Bank *bank) const
+{
+	return bank->getRank()->getId() * num_banks + bank->getId();
+}
+
+
+void Channel::UpdateBank(Bank *bank)
+{
+	// Bank position in the masks
+	int index = getBankIndex(bank);
+	unsigned long long bit = 1ULL << (index % 64);
+	unsigned long long &pending = pending_banks[index / 64];
+	unsigned long long &row_hit = row_hit_banks[index / 64];
+
+	// Update masks. A column access at the front of the queue always
+	// targets the open row, since the bank queues the row commands it
+	// needs ahead of it. Banks with waiting requests always have the
+	// commands of the selected one in their queue.
+	pending &= ~bit;
+	row_hit &= ~bit;
+	if (bank->getNumCommandsInQueue())
+	{
+		pending |= bit;
+		if (bank->getFrontCommand()->isAccess())
+			row_hit |= bit;
+	}
+}
+
+
+void Channel::UpdateOccupancy(int delta)
+{
+	// Account for the occupancy until now
+	long long cycle = System::frequency_domain->getCycle();
+	occupancy_integral += occupancy * std::max(0LL, cycle - occupancy_cycle);
+	occupancy_cycle = std::max(occupancy_cycle, cycle);
+
+	// New occupancy
+	occupancy += delta;
+	assert(occupancy >= 0);
+	max_occupancy = std::max(max_occupancy, occupancy);
+}
+
+
+void Channel::RequestArrived()
+{
+	UpdateOccupancy(1);
+}
+
+
+void Channel::RequestAccepted(Request *request)
+{
+	num_pending_requests++;
+	if (request->getType() == RequestRead)
+		num_reads++;
+	else
+		num_writes++;
+}
+
+
+long long Channel::getNumRowHits() const
+{
+	long long num_row_hits = 0;
+	for (int i = 0; i < getNumBanksTotal(); i++)
+		num_row_hits += getBank(i)->getNumRowHits();
+	return num_row_hits;
+}
+
+
+void Channel::RequestFinished(Request *request)
+{
+	// Record latency
+	long long cycle = System::frequency_domain->getCycle();
+	long long latency = std::max(0LL, cycle - request->getCycleArrival());
+	if ((long long) latency_histogram.size() <= latency)
+		latency_histogram.resize(latency + 1);
+	latency_histogram[latency]++;
+
+	// Record latency components. All commands of the request were issued
+	// once its column access finishes.
+	long long first_command = request->getCycleFirstCommand();
+	long long access = request->getCycleAccess();
+	assert(first_command >= 0 && access >= first_command);
+	long long components[LatencyComponentCount];
+	components[LatencyTotal] = latency;
+	components[LatencyQueueing] = std::max(0LL,
+			first_command - request->getCycleArrival());
+	components[LatencyCommand] = access - first_command;
+	components[LatencyTransfer] = std::max(0LL, cycle - access);
+	for (int i = 0; i < LatencyComponentCount; i++)
+	{
+		AddToLogHistogram(latency_log_histograms[i], components[i]);
+		latency_sums[i] += components[i];
+	}
+
+	// Request done
+	UpdateOccupancy(-1);
+	assert(num_pending_requests > 0);
+	num_pending_requests--;
+	last_finish_cycle = cycle;
+}
+
+
+void Channel::SampleOccupancy()
+{
+	// Average since the last sample
+	UpdateOccupancy(0);
+	long long cycle = occupancy_cycle;
+	long long cycles = cycle - sample_cycle;
+	if (cycles <= 0)
+		return;
+	occupancy_samples.push_back((double) (occupancy_integral -
+			sample_integral) / cycles);
+	sample_cycle = cycle;
+	sample_integral = occupancy_integral;
+}
+
+
+void Channel::AddToLogHistogram(std::vector<long long> &histogram,
+		long long latency)
+{
+	// Bucket i > 0 holds latencies between 2^(i-1) and 2^i - 1
+	int bucket = 0;
+	while (latency > 0)
+	{
+		latency >>= 1;
+		bucket++;
+	}
+	if ((int) histogram.size() <= bucket)
+		histogram.resize(bucket + 1);
+	histogram[bucket]++;
+}
+
+
+void Channel::DumpLatencyComponents(std::ostream &os,
+		const std::vector<long long> *histograms,
+		const long long *sums,
+		long long num_finished)
+{
+	// Lower bound of each bucket, for the longest histogram
+	unsigned num_buckets = 0;
+	for (int i = 0; i < LatencyComponentCount; i++)
+		num_buckets = std::max(num_buckets,
+				(unsigned) histograms[i].size());
+	os << "LatencyBuckets =";
+	for (unsigned bucket = 0; bucket < num_buckets; bucket++)
+		os << ' ' << (bucket ? 1LL << (bucket - 1) : 0);
+	os << '\n';
+
+	// Histogram of each component, with the same number of buckets
+	for (int i = 0; i < LatencyComponentCount; i++)
+	{
+		const std::vector<long long> &histogram = histograms[i];
+		os << LatencyComponentMap[i] << "LatencyHistogram =";
+		for (unsigned bucket = 0; bucket < num_buckets; bucket++)
+			os << ' ' << (bucket < histogram.size() ?
+					histogram[bucket] : 0);
+		os << '\n';
+	}
+
+	// Average of each component, other than the total latency
+	for (int i = LatencyQueueing; i < LatencyComponentCount; i++)
+		os << misc::fmt("Average%sLatency = %.4f\n",
+				LatencyComponentMap[i], num_finished ?
+				(double) sums[i] / num_finished : 0.0);
+}
+
+
+long long Channel::getPercentile(const std::vector<long long> &histogram,
+		double percentile)
+{
+	// Total number of requests
+	long long count = 0;
+	for (long long value : histogram)
+		count += value;
+	if (!count)
+		return 0;
+
+	// Find the latency where the fraction of requests is reached
+	long long accumulated = 0;
+	for (unsigned latency = 0; latency < histogram.size(); latency++)
+	{
+		accumulated += histogram[latency];
+		if (accumulated >= percentile * count)
+			return latency;
+	}
+	return histogram.size() - 1;
+}
+
+
+void Channel::DumpReport(std::ostream &os)
+{
+	// Row-buffer hits, misses and conflicts of all banks
+	long long num_row_hits = getNumRowHits();
+	long long num_row_misses = 0;
+	long long num_row_conflicts = 0;
+	for (int i = 0; i < getNumBanksTotal(); i++)
+	{
+		num_row_misses += getBank(i)->getNumRowMisses();
+		num_row_conflicts += getBank(i)->getNumRowConflicts();
+	}
+
+	// Latency
+	long long num_requests = num_reads + num_writes;
+	long long num_finished = 0;
+	long long accumulated_latency = 0;
+	for (unsigned latency = 0; latency < latency_histogram.size();
+			latency++)
+	{
+		num_finished += latency_histogram[latency];
+		accumulated_latency += latency_histogram[latency] * latency;
+	}
+
+	// Bandwidth, in MB/s
+	long long cycles = System::frequency_domain->getCycle();
+	long long bytes = num_requests * controller->getRequestSize();
+	double bandwidth = cycles ? (double) bytes *
+			System::frequency_domain->getFrequency() / cycles : 0.0;
+
+	// Requests
+	os << misc::fmt("[ MemoryController.%s.Channel%d ]\n",
+			controller->getName().c_str(), id);
+	os << misc::fmt("Cycles = %lld\n", cycles);
+	os << misc::fmt("Requests = %lld\n", num_requests);
+	os << misc::fmt("ReadRequests = %lld\n", num_reads);
+	os << misc::fmt("WriteRequests = %lld\n", num_writes);
+	os << misc::fmt("RowHits = %lld\n", num_row_hits);
+	os << misc::fmt("RowMisses = %lld\n", num_row_misses);
+	os << misc::fmt("RowConflicts = %lld\n", num_row_conflicts);
+	os << misc::fmt("RowHitRate = %.4g\n", num_requests ?
+			(double) num_row_hits / num_requests : 0.0);
+	os << misc::fmt("TransferredBytes = %lld\n", bytes);
+	os << misc::fmt("Bandwidth = %.4f\n", bandwidth);
+	os << misc::fmt("AverageLatency = %.4f\n", num_finished ?
+			(double) accumulated_latency / num_finished : 0.0);
+	os << misc::fmt("LatencyP50 = %lld\n",
+			getPercentile(latency_histogram, 0.5));
+	os << misc::fmt("LatencyP90 = %lld\n",
+			getPercentile(latency_histogram, 0.9));
+	os << misc::fmt("LatencyP99 = %lld\n",
+			getPercentile(latency_histogram, 0.99));
+	os << misc::fmt("MaxLatency = %d\n", latency_histogram.empty() ?
+			0 : (int) latency_histogram.size() - 1);
+	DumpLatencyComponents(os, latency_log_histograms, latency_sums,
+			num_finished);
+
+	// Queue occupancy time series
+	os << misc::fmt("MaxQueueOccupancy = %d\n", max_occupancy);
+	os << misc::fmt("QueueOccupancyInterval = %d\n",
+			System::getReportInterval());
+	os << "QueueOccupancy =";
+	for (double sample : occupancy_samples)
+		os << misc::fmt(" %.4g", sample);
+	os << '\n';
+
+	// Commands, refresh, power states, and energy of the ranks
+	std::vector<Rank *> rank_list;
+	for (auto &rank : ranks)
+		rank_list.push_back(rank.get());
+	controller->DumpRankReport(os, rank_list);
+	os << '\n';
+
+	// Row-buffer statistics of each bank
+	for (auto &rank : ranks)
+	{
+		for (int i = 0; i < rank->getNumBanks(); i++)
+		{
+			Bank *bank = rank->getBank(i);
+			long long num_bank_requests = bank->getNumRowHits() +
+					bank->getNumRowMisses() +
+					bank->getNumRowConflicts();
+			os << misc::fmt("[ MemoryController.%s.Channel%d."
+					"Rank%d.Bank%d ]\n",
+					controller->getName().c_str(), id,
+					rank->getId(), bank->getId());
+			os << misc::fmt("Requests = %lld\n",
+					num_bank_requests);
+			os << misc::fmt("RowHits = %lld\n",
+					bank->getNumRowHits());
+			os << misc::fmt("RowMisses = %lld\n",
+					bank->getNumRowMisses());
+			os << misc::fmt("RowConflicts = %lld\n",
+					bank->getNumRowConflicts());
+			os << misc::fmt("RowHitRate = %.4g\n",
+					num_bank_requests ?
+					(double) bank->getNumRowHits() /
+					num_bank_requests : 0.0);
+			os << '\n';
+		}
 	}
 }
 
@@ -136,6 +480,7 @@ void Channel::RunScheduler()
 	if (cycle >= cycle_ready)
 	{
 		// Run the command.
+		scheduler->CommandScheduled(bank->getFrontCommand());
 		bank->RunFrontCommand();
 		next_scheduled_bank = nullptr;
 
@@ -162,6 +507,11 @@ long long Channel::CalculateReadyCycle(Command *cmd)
 	// Set the ready cycle to be this cycle.
 	long long ready = System::frequency_domain->getCycle();
 
+	// The command waits for the refresh of its bank to finish, and for
+	// its rank to exit a low power state.
+	ready = std::max(ready, cmd->getBank()->getRefreshEnd());
+	ready = std::max(ready, cmd->getRank()->getPowerUpCycle());
+
 	// Get the rank and bank ids of the commands location.
 	int cmd_bank = cmd->getBankId();
 	int cmd_rank = cmd->getRankId();
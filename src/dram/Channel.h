@@ -21,8 +21,10 @@
 #define DRAM_CHANNEL_H
 
 #include <memory>
+#include <ostream>
 #include <vector>
 
+#include <lib/cpp/String.h>
 #include <lib/esim/Frame.h>
 
 #include "Rank.h"
@@ -34,9 +36,27 @@ namespace dram
 
 // Forward declarations
 class Controller;
+class Request;
 class Scheduler;
 
 
+/// Components of the latency of a request. The queueing latency runs from
+/// the arrival of the request to the issue of its first command, the command
+/// latency until the issue of its column access, and the transfer latency
+/// until the end of the column access and its data burst.
+enum LatencyComponent
+{
+	LatencyTotal = 0,
+	LatencyQueueing,
+	LatencyCommand,
+	LatencyTransfer,
+	LatencyComponentCount
+};
+
+/// String map for LatencyComponent
+extern misc::StringMap LatencyComponentMap;
+
+
 class Channel
 {
 	int id;
@@ -61,6 +81,48 @@ class Channel
 	// Total number of commands in bank queues under this channel
 	int num_commands_in_queue = 0;
 
+	// Bitmasks of the banks with commands in their queue, and of the
+	// banks whose front command is a column access to the open row. Bit i
+	// of the masks corresponds to bank i % num_banks of rank
+	// i / num_banks.
+	std::vector<unsigned long long> pending_banks;
+	std::vector<unsigned long long> row_hit_banks;
+
+	// Statistics of the requests served by the channel. The latency
+	// histogram counts requests by their latency in cycles, from their
+	// arrival to the end of their column access.
+	long long num_pending_requests = 0;
+	long long num_reads = 0;
+	long long num_writes = 0;
+	long long last_finish_cycle = 0;
+	std::vector<long long> latency_histogram;
+
+	// Histograms of each latency component in buckets of powers of two,
+	// and sum of each component over all finished requests
+	std::vector<long long> latency_log_histograms[LatencyComponentCount];
+	long long latency_sums[LatencyComponentCount] = {};
+
+	// Number of requests in the channel, from their arrival to the end of
+	// their column access, integrated over the cycles since the
+	// simulation started. The average of each sampling interval forms
+	// the queue occupancy time series.
+	int occupancy = 0;
+	int max_occupancy = 0;
+	long long occupancy_cycle = 0;
+	long long occupancy_integral = 0;
+	long long sample_cycle = 0;
+	long long sample_integral = 0;
+	std::vector<double> occupancy_samples;
+
+	// Account for the occupancy of the channel since the last update,
+	// and add the given number of requests to it.
+	void UpdateOccupancy(int delta);
+
+	// Return the index of the first bank set in a mask, starting at bank
+	// index 'start', or -1 if there is none.
+	int FindBank(const std::vector<unsigned long long> &mask,
+			int start) const;
+
 public:
 
 	Channel(int id,
@@ -82,6 +144,9 @@ public:
 	/// Returns the controller that this channel belongs to.
 	Controller *getController() const { return controller; }
 
+	/// Returns the scheduler of this channel.
+	Scheduler *getScheduler() const { return scheduler.get(); }
+
 	/// Returns the number of ranks in this channel.
 	int getNumRanks() const { return num_ranks; }
 
@@ -91,6 +156,127 @@ public:
 	/// Returns the total number of banks in this channel.
 	int getNumBanksTotal() const { return num_banks * num_ranks; }
 
+	/// Returns a bank of this channel given its index among all banks of
+	/// the channel, equal to rank * banks_per_rank + bank.
+	Bank *getBank(int index) const
+	{
+		return ranks[index / num_banks]->getBank(index % num_banks);
+	}
+
+	/// Returns the index of a bank among all banks of the channel.
+	int getBankIndex(Bank *bank) const;
+
+	/// Updates the scheduling state of a bank after its command queue
+	/// changed. Schedulers rely on this state to avoid scanning all
+	/// banks of the channel.
+	void UpdateBank(Bank *bank);
+
+	/// Returns the index of the first bank with commands in its queue,
+	/// starting at index 'start', or -1 if there is none.
+	int getNextPendingBank(int start = 0) const
+	{
+		return FindBank(pending_banks, start);
+	}
+
+	/// Returns the index of the first bank whose front command is a
+	/// column access to its open row (a row-buffer hit), starting at
+	/// index 'start', or -1 if there is none.
+	int getNextRowHitBank(int start = 0) const
+	{
+		return FindBank(row_hit_banks, start);
+	}
+
+	/// Returns whether the front command of the bank with the given index
+	/// is a row-buffer hit.
+	bool isRowHitBank(int index) const
+	{
+		return row_hit_banks[index / 64] & (1ULL << (index % 64));
+	}
+
+	/// Accounts for a request arriving to the controller of the channel.
+	void RequestArrived();
+
+	/// Accounts for a request accepted by a bank of the channel.
+	void RequestAccepted(Request *request);
+
+	/// Accounts for a request of the channel that finished.
+	void RequestFinished(Request *request);
+
+	/// Returns the number of requests accepted and not finished yet.
+	long long getNumPendingRequests() const { return num_pending_requests; }
+
+	/// Returns the number of read requests accepted.
+	long long getNumReads() const { return num_reads; }
+
+	/// Returns the number of write requests accepted.
+	long long getNumWrites() const { return num_writes; }
+
+	/// Returns the number of requests that found their row open, over all
+	/// banks of the channel.
+	long long getNumRowHits() const;
+
+	/// Returns the cycle when the last request finished.
+	long long getLastFinishCycle() const { return last_finish_cycle; }
+
+	/// Returns the histogram of request latencies, where entry i is the
+	/// number of requests that took i cycles.
+	const std::vector<long long> &getLatencyHistogram() const
+	{
+		return latency_histogram;
+	}
+
+	/// Returns the histogram of a latency component, where entry 0 is the
+	/// number of requests with no latency, and entry i > 0 the number of
+	/// requests with a latency between 2^(i-1) and 2^i - 1 cycles.
+	const std::vector<long long> &getLatencyLogHistogram(
+			LatencyComponent component) const
+	{
+		return latency_log_histograms[component];
+	}
+
+	/// Returns the sum of a latency component over all finished
+	/// requests.
+	long long getLatencySum(LatencyComponent component) const
+	{
+		return latency_sums[component];
+	}
+
+	/// Returns the average number of requests in the channel in each
+	/// sampling interval so far.
+	const std::vector<double> &getOccupancySamples() const
+	{
+		return occupancy_samples;
+	}
+
+	/// Returns the maximum number of requests in the channel.
+	int getMaxOccupancy() const { return max_occupancy; }
+
+	/// Takes a sample of the queue occupancy time series, with the
+	/// average number of requests in the channel since the last sample.
+	void SampleOccupancy();
+
+	/// Adds a latency to a histogram with buckets of powers of two.
+	static void AddToLogHistogram(std::vector<long long> &histogram,
+			long long latency);
+
+	/// Dumps the histograms and averages of the latency components,
+	/// given the histograms and sums of all components, and the number
+	/// of finished requests, as variables of an IniFile section.
+	static void DumpLatencyComponents(std::ostream &os,
+			const std::vector<long long> *histograms,
+			const long long *sums,
+			long long num_finished);
+
+	/// Returns the latency under which the given fraction of the
+	/// requests of a latency histogram finished.
+	static long long getPercentile(const std::vector<long long> &histogram,
+			double percentile);
+
+	/// Dump the request statistics of the channel and the statistics of
+	/// its ranks, followed by a section with the row-buffer statistics of
+	/// each bank, in the IniFile format.
+	void DumpReport(std::ostream &os);
+
 	/// Call the scheduler for this channel.  This function will only
 	/// invoke the scheduler if it is not already scheduled to run.  The
 	/// scheduler will keep reinvoking itself while there are commands in
@@ -98,7 +98,10 @@ void Command::setFinished()
 	// Mark the associated request as finished, too, if this is the read or
 	// write command for that request.
 	if (type == CommandRead || type == CommandWrite)
+	{
 		request->setFinished();
+		rank->getChannel()->RequestFinished(request.get());
+	}
 }
 
 }  // namespace dram
@@ -81,6 +81,20 @@ public:
 	/// Returns the type of the command.
 	CommandType getType() const { return type; }
 
+	/// Returns whether the command is a column access (read or write),
+	/// as opposed to a row command (precharge or activate).
+	bool isAccess() const
+	{
+		return type == CommandRead || type == CommandWrite;
+	}
+
+	/// Returns the request associated with the command.
+	Request *getRequest() const { return request.get(); }
+
+	/// Returns a shared pointer to the request associated with the
+	/// command, used to create other commands for the same request.
+	std::shared_ptr<Request> getRequestPointer() const { return request; }
+
 	/// Returns the type of the command as a string.
 	std::string getTypeString() const
 	{
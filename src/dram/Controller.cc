@@ -27,6 +27,7 @@
 #include "Channel.h"
 #include "Controller.h"
 #include "Command.h"
+#include "Rank.h"
 #include "Request.h"
 #include "Scheduler.h"
 #include "System.h"
@@ -44,7 +45,27 @@ misc::StringMap PagePolicyTypeMap
 	{ "Closed", PagePolicyClosed }
 };
 
-std::map<int, esim::Event *> Controller::REQUEST_PROCESSORS;
+misc::StringMap RefreshPolicyMap
+{
+	{ "None", RefreshPolicyNone },
+	{ "Rank", RefreshPolicyRank },
+	{ "Bank", RefreshPolicyBank }
+};
+
+misc::StringMap PowerDownPolicyMap
+{
+	{ "None", PowerDownPolicyNone },
+	{ "Active", PowerDownPolicyActive },
+	{ "Precharged", PowerDownPolicyPrecharged }
+};
+
+misc::StringMap PowerDownExitMap
+{
+	{ "Fast", PowerDownExitFast },
+	{ "Slow", PowerDownExitSlow }
+};
+
+thread_local std::map<int, esim::Event *> Controller::REQUEST_PROCESSORS;
 
 
 Controller::Controller(int id)
@@ -90,6 +111,67 @@ void Controller::ParseConfiguration(misc::IniFile *config,
 			"SchedulingPolicy", SchedulerTypeMap,
 			SchedulerOldestFirst);
 
+	// Scheduler parameters
+	marking_cap = config->ReadInt(section, "MarkingCap", 5);
+	if (marking_cap <= 0)
+		throw Error(misc::fmt("%s: MarkingCap must be at least 1.\n%s",
+				config->getPath().c_str(),
+				System::err_config_note));
+	quantum_length = config->ReadInt64(section, "QuantumLength",
+			10000000);
+	if (quantum_length <= 0)
+		throw Error(misc::fmt("%s: QuantumLength must be at least 1."
+				"\n%s",
+				config->getPath().c_str(),
+				System::err_config_note));
+	starvation_threshold = config->ReadInt64(section,
+			"StarvationThreshold", 100000);
+	if (starvation_threshold <= 0)
+		throw Error(misc::fmt("%s: StarvationThreshold must be at "
+				"least 1.\n%s",
+				config->getPath().c_str(),
+				System::err_config_note));
+
+	// Refresh and power-down policies
+	refresh_policy = (RefreshPolicy) config->ReadEnum(section,
+			"Refresh", RefreshPolicyMap, RefreshPolicyRank);
+	power_down_policy = (PowerDownPolicy) config->ReadEnum(section,
+			"PowerDown", PowerDownPolicyMap, PowerDownPolicyNone);
+	power_down_exit = (PowerDownExit) config->ReadEnum(section,
+			"PowerDownExit", PowerDownExitMap, PowerDownExitFast);
+	power_down_threshold = config->ReadInt64(section,
+			"PowerDownThreshold", 100);
+	if (power_down_threshold < 0)
+		throw Error(misc::fmt("%s: PowerDownThreshold must be at "
+				"least 0.\n%s",
+				config->getPath().c_str(),
+				System::err_config_note));
+	self_refresh_threshold = config->ReadInt64(section,
+			"SelfRefreshThreshold", 0);
+	if (self_refresh_threshold < 0)
+		throw Error(misc::fmt("%s: SelfRefreshThreshold must be at "
+				"least 0.\n%s",
+				config->getPath().c_str(),
+				System::err_config_note));
+
+	// Energy parameters, defaulting to a typical 4Gb x8 DDR3-1600 device
+	num_devices = config->ReadInt(section, "NumDevices", 8);
+	if (num_devices <= 0)
+		throw Error(misc::fmt("%s: NumDevices must be at least 1.\n%s",
+				config->getPath().c_str(),
+				System::err_config_note));
+	vdd = config->ReadDouble(section, "VDD", 1.5);
+	idd0 = config->ReadDouble(section, "IDD0", 55);
+	idd2p0 = config->ReadDouble(section, "IDD2P0", 12);
+	idd2p1 = config->ReadDouble(section, "IDD2P1", 25);
+	idd2n = config->ReadDouble(section, "IDD2N", 32);
+	idd3p = config->ReadDouble(section, "IDD3P", 38);
+	idd3n = config->ReadDouble(section, "IDD3N", 38);
+	idd4r = config->ReadDouble(section, "IDD4R", 157);
+	idd4w = config->ReadDouble(section, "IDD4W", 128);
+	idd5 = config->ReadDouble(section, "IDD5", 235);
+	idd6 = config->ReadDouble(section, "IDD6", 12);
+
 	// Read DRAM size settings
 	num_channels = config->ReadInt(section, "NumChannels", 1);
 	if (num_channels <= 0)
@@ -124,7 +206,8 @@ void Controller::ParseConfiguration(misc::IniFile *config,
 				config->getPath().c_str(),
 				System::err_config_note));
 
-	// Create channels 
+	// Create channels and their incoming request queues
+	incoming_requests.resize(num_channels);
 	for (int i = 0; i < num_channels; i++)
 		channels.emplace_back(new Channel(i, this, num_ranks,
 				num_banks, num_rows, num_columns, num_bits,
@@ -135,6 +218,11 @@ void Controller::ParseConfiguration(misc::IniFile *config,
 
 	// Create a set of new scheduler events for all the channels.
 	CreateSchedulers(num_channels);
+
+	// Start refreshing all ranks
+	for (auto &channel : channels)
+		for (int i = 0; i < num_ranks; i++)
+			channel->getRank(i)->StartRefresh();
 }
 
 
@@ -199,6 +287,25 @@ void Controller::ParseConfigurationTiming(misc::IniFile *ini_file,
 			parameters.getTimeCwd() + parameters.getTimeBurst() +
 			parameters.getTimeWr();
 
+	// Timings used by refresh, power-down, and energy accounting
+	time_rc = parameters.getTimeRc();
+	time_ras = parameters.getTimeRas();
+	time_rp = parameters.getTimeRp();
+	time_burst = parameters.getTimeBurst();
+	time_rfc = parameters.getTimeRfc();
+	time_rfc_pb = parameters.getTimeRfcPb();
+	time_refi = parameters.getTimeRefi();
+	time_xp = parameters.getTimeXp();
+	time_xpdll = parameters.getTimeXpdll();
+	time_xs = parameters.getTimeXs();
+	int refresh_interval = refresh_policy == RefreshPolicyBank ?
+			time_refi / num_banks : time_refi;
+	if (refresh_policy != RefreshPolicyNone && refresh_interval <= 0)
+		throw Error(misc::fmt("%s: tREFI must be at least 1 for each "
+				"refreshed bank.\n%s",
+				ini_file->getPath().c_str(),
+				System::err_config_note));
+
 	// Store command durations.
 	command_durations[CommandPrecharge] = parameters.getTimeRp();
 	command_durations[CommandActivate] = parameters.getTimeRcd();
@@ -211,8 +318,11 @@ void Controller::ParseConfigurationTiming(misc::IniFile *ini_file,
 
 void Controller::AddRequest(std::shared_ptr<Request> request)
 {
-	// Add the request to the controller incoming request queue.
-	incoming_requests.push(request);
+	// Add the request to the incoming request queue of its channel.
+	int channel = request->getAddress()->getLogical();
+	incoming_requests[channel].push(request);
+	num_incoming_requests++;
+	channels[channel]->RequestArrived();
 
 	// Ensure the request processor is running.
 	CallRequestProcessor();
@@ -283,27 +393,29 @@ void Controller::RequestProcessorHandler(esim::Event *type, esim::Frame *frame)
 
 void Controller::RunRequestProcessor()
 {
-	// Just in case, make sure there are actually requests to process.
-	if (incoming_requests.size() == 0)
-		return;
-
-	// Get the front request in the queue.
-	std::shared_ptr<Request> request = incoming_requests.front();
-
-	// Get the bank the request is destined for.
-	Address *address = request->getAddress();
-	Bank *bank = channels[address->getLogical()]->
-			getRank(address->getRank())->
-			getBank(address->getBank());
-
-	// Send the request to the bank to be processed.
-	bank->ProcessRequest(request);
-
-	// Remove the request from the queue.
-	incoming_requests.pop();
+	// Take the front request of each channel queue.
+	for (auto &queue : incoming_requests)
+	{
+		if (queue.empty())
+			continue;
+		std::shared_ptr<Request> request = queue.front();
+
+		// Get the bank the request is destined for.
+		Address *address = request->getAddress();
+		Bank *bank = channels[address->getLogical()]->
+				getRank(address->getRank())->
+				getBank(address->getBank());
+
+		// Send the request to the bank to be processed.
+		bank->ProcessRequest(request);
+
+		// Remove the request from the queue.
+		queue.pop();
+		num_incoming_requests--;
+	}
 
 	// If there are still requests to be processed, schedule again next cycle.
-	if (incoming_requests.size() > 0)
+	if (num_incoming_requests > 0)
 		CallRequestProcessor();
 }
 
@@ -319,6 +431,7 @@ void Controller::CommandReturnHandler(esim::Event *type, esim::Frame *frame)
 	// the command to decrement the number of in flight commands for
 	// its request.
 	command->setFinished();
+	command->getRank()->CommandFinished();
 
 	// Debug
 	long long cycle = System::frequency_domain->getCycle();
@@ -330,14 +443,130 @@ void Controller::CommandReturnHandler(esim::Event *type, esim::Frame *frame)
 }
 
 
+void Controller::DumpRankReport(std::ostream &os,
+		const std::vector<Rank *> &ranks)
+{
+	// Add up the statistics of all ranks
+	long long num_commands[5] = {};
+	long long num_refreshes = 0;
+	long long num_refresh_bank_cycles = 0;
+	long long power_state_cycles[RankPowerNumStates] = {};
+	long long num_power_down_exits = 0;
+	long long num_self_refresh_exits = 0;
+	for (Rank *rank : ranks)
+	{
+		rank->UpdatePowerState();
+		for (int type = 0; type < 5; type++)
+			num_commands[type] += rank->getNumCommands(
+					(CommandType) type);
+		num_refreshes += rank->getNumRefreshes();
+		num_refresh_bank_cycles += rank->getNumRefreshBankCycles();
+		for (int state = 0; state < RankPowerNumStates; state++)
+			power_state_cycles[state] += rank->getPowerStateCycles(
+					(RankPowerState) state);
+		num_power_down_exits += rank->getNumPowerDownExits();
+		num_self_refresh_exits += rank->getNumSelfRefreshExits();
+	}
+
+	// Energy of each operation in one device, in pJ, computed from the
+	// datasheet currents as in DRAMPower. The current of an activate
+	// and precharge pair is in excess of the background current during
+	// tRC, and the current of reads, writes, and refreshes in excess of
+	// the active standby current.
+	long long cycles = System::frequency_domain->getCycle();
+	double cycle_time = 1000.0 / System::frequency_domain->getFrequency();
+	double activate_energy = vdd * cycle_time * (idd0 * time_rc -
+			(idd3n * time_ras + idd2n * (time_rc - time_ras)));
+	double read_energy = vdd * cycle_time * (idd4r - idd3n) * time_burst;
+	double write_energy = vdd * cycle_time * (idd4w - idd3n) * time_burst;
+	double refresh_energy = vdd * cycle_time * (idd5 - idd3n) *
+			(refresh_policy == RefreshPolicyBank ?
+			(double) time_rfc_pb / num_banks : time_rfc);
+	double idd2p = power_down_exit == PowerDownExitSlow ? idd2p0 : idd2p1;
+	double background_energy = vdd * cycle_time * (
+			idd3n * power_state_cycles[RankPowerActiveStandby] +
+			idd2n * power_state_cycles[RankPowerPrechargedStandby] +
+			idd3p * power_state_cycles[RankPowerActivePowerDown] +
+			idd2p * power_state_cycles[RankPowerPrechargedPowerDown] +
+			idd6 * power_state_cycles[RankPowerSelfRefresh]);
+
+	// Total energy of all devices, in nJ
+	double scale = num_devices / 1000.0;
+	activate_energy *= num_commands[CommandActivate] * scale;
+	read_energy *= num_commands[CommandRead] * scale;
+	write_energy *= num_commands[CommandWrite] * scale;
+	refresh_energy *= num_refreshes * scale;
+	background_energy *= scale;
+	double total_energy = activate_energy + read_energy + write_energy +
+			refresh_energy + background_energy;
+
+	// Commands
+	int num_banks_total = ranks.size() * num_banks;
+	os << misc::fmt("Activates = %lld\n", num_commands[CommandActivate]);
+	os << misc::fmt("Precharges = %lld\n",
+			num_commands[CommandPrecharge]);
+	os << misc::fmt("Reads = %lld\n", num_commands[CommandRead]);
+	os << misc::fmt("Writes = %lld\n", num_commands[CommandWrite]);
+
+	// Refresh and power states
+	os << misc::fmt("Refreshes = %lld\n", num_refreshes);
+	os << misc::fmt("RefreshBankCycles = %lld\n",
+			num_refresh_bank_cycles);
+	os << misc::fmt("RefreshOverhead = %.4g\n", cycles ?
+			(double) num_refresh_bank_cycles /
+			cycles / num_banks_total : 0.0);
+	os << misc::fmt("ActiveStandbyCycles = %lld\n",
+			power_state_cycles[RankPowerActiveStandby]);
+	os << misc::fmt("PrechargedStandbyCycles = %lld\n",
+			power_state_cycles[RankPowerPrechargedStandby]);
+	os << misc::fmt("ActivePowerDownCycles = %lld\n",
+			power_state_cycles[RankPowerActivePowerDown]);
+	os << misc::fmt("PrechargedPowerDownCycles = %lld\n",
+			power_state_cycles[RankPowerPrechargedPowerDown]);
+	os << misc::fmt("SelfRefreshCycles = %lld\n",
+			power_state_cycles[RankPowerSelfRefresh]);
+	os << misc::fmt("PowerDownExits = %lld\n", num_power_down_exits);
+	os << misc::fmt("SelfRefreshExits = %lld\n", num_self_refresh_exits);
+
+	// Energy
+	os << misc::fmt("ActivateEnergy = %.4f\n", activate_energy);
+	os << misc::fmt("ReadEnergy = %.4f\n", read_energy);
+	os << misc::fmt("WriteEnergy = %.4f\n", write_energy);
+	os << misc::fmt("RefreshEnergy = %.4f\n", refresh_energy);
+	os << misc::fmt("BackgroundEnergy = %.4f\n", background_energy);
+	os << misc::fmt("TotalEnergy = %.4f\n", total_energy);
+	os << misc::fmt("AveragePower = %.4f\n", cycles ?
+			total_energy / (cycles * cycle_time) * 1000.0 : 0.0);
+}
+
+
+void Controller::DumpReport(std::ostream &os)
+{
+	// Statistics of all ranks
+	std::vector<Rank *> ranks;
+	for (auto &channel : channels)
+		for (int i = 0; i < num_ranks; i++)
+			ranks.push_back(channel->getRank(i));
+	os << misc::fmt("[ MemoryController.%s ]\n", name.c_str());
+	os << misc::fmt("Cycles = %lld\n",
+			System::frequency_domain->getCycle());
+	DumpRankReport(os, ranks);
+	os << '\n';
+
+	// Channels
+	for (auto &channel : channels)
+		channel->DumpReport(os);
+}
+
+
 void Controller::dump(std::ostream &os) const
 {
 	// Print header
 	os << misc::fmt("Dumping Controller %d (%s)\n", id, name.c_str());
 
 	// Print the requests currently in queue
-	os << misc::fmt("%d requests in the incoming queue\n",
-			(int) incoming_requests.size());
+	os << misc::fmt("%d requests in the incoming queues\n",
+			num_incoming_requests);
 
 	// Print channels owned by this controller
 	os << misc::fmt("%d Channels\nChannel dump:\n", (int) channels.size());
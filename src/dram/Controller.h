@@ -39,6 +39,7 @@ namespace dram
 // Forward declarations
 class Channel;
 class Command;
+class Rank;
 class Request;
 
 
@@ -73,6 +74,41 @@ enum PagePolicyType
 extern misc::StringMap PagePolicyTypeMap;
 
 
+/// Refresh policies
+enum RefreshPolicy
+{
+	RefreshPolicyNone = 0,
+	RefreshPolicyRank,
+	RefreshPolicyBank
+};
+
+/// String map for RefreshPolicy
+extern misc::StringMap RefreshPolicyMap;
+
+
+/// Policies to enter the power-down state
+enum PowerDownPolicy
+{
+	PowerDownPolicyNone = 0,
+	PowerDownPolicyActive,
+	PowerDownPolicyPrecharged
+};
+
+/// String map for PowerDownPolicy
+extern misc::StringMap PowerDownPolicyMap;
+
+
+/// Ways to exit the precharged power-down state
+enum PowerDownExit
+{
+	PowerDownExitFast = 0,
+	PowerDownExitSlow
+};
+
+/// String map for PowerDownExit
+extern misc::StringMap PowerDownExitMap;
+
+
 class Controller
 {
 	int id;
@@ -90,20 +126,62 @@ class Controller
 	// The page policy that command processors in this controller follow
 	PagePolicyType page_policy;
 
+	// Parameters of the PAR-BS and ATLAS schedulers
+	int marking_cap;
+	long long quantum_length;
+	long long starvation_threshold;
+
+	// Refresh and power-down policies
+	RefreshPolicy refresh_policy;
+	PowerDownPolicy power_down_policy;
+	PowerDownExit power_down_exit;
+	long long power_down_threshold;
+	long long self_refresh_threshold;
+
 	// Timing matrix
 	int timings[4][4][2][2] = {};
 
+	// Timings used by refresh, power-down, and energy accounting
+	int time_rc = 0;
+	int time_ras = 0;
+	int time_rp = 0;
+	int time_burst = 0;
+	int time_rfc = 0;
+	int time_rfc_pb = 0;
+	int time_refi = 0;
+	int time_xp = 0;
+	int time_xpdll = 0;
+	int time_xs = 0;
+
+	// Number of devices in each rank, supply voltage in V, and currents
+	// of each device in mA, as given in the device datasheet
+	int num_devices;
+	double vdd;
+	double idd0;
+	double idd2p0;
+	double idd2p1;
+	double idd2n;
+	double idd3p;
+	double idd3n;
+	double idd4r;
+	double idd4w;
+	double idd5;
+	double idd6;
+
 	// Command durations
 	int command_durations[5] = {};
 
 	// List of physical channels contained in this controller
 	std::vector<std::unique_ptr<Channel>> channels;
 
-	// Incoming request queue
-	std::queue<std::shared_ptr<Request>> incoming_requests;
+	// Incoming request queues of each channel, and total number of
+	// requests in them
+	std::vector<std::queue<std::shared_ptr<Request>>> incoming_requests;
+	int num_incoming_requests = 0;
 
-	// Map of ids to EventTypes for each controller's request processor
-	static std::map<int, esim::Event *> REQUEST_PROCESSORS;
+	// Map of ids to EventTypes for each controller's request processor,
+	// in the engine of the current host thread
+	static thread_local std::map<int, esim::Event *> REQUEST_PROCESSORS;
 
 	// Map of ids to EventTypes for each channel's scheduler for the
 	// controller
@@ -118,6 +196,9 @@ public:
 	/// controllers.
 	int getId() const { return id; }
 
+	/// Returns the name of this controller.
+	const std::string &getName() const { return name; }
+
 	/// Returns a channel that belongs to this controller with the
 	/// specified id.
 	Channel *getChannel(int id) { return channels[id].get(); }
@@ -132,6 +213,63 @@ public:
 	/// controller follow.
 	PagePolicyType getPagePolicy() { return page_policy; }
 
+	/// Returns the maximum number of requests of a core marked in each
+	/// bank when the PAR-BS scheduler forms a batch.
+	int getMarkingCap() const { return marking_cap; }
+
+	/// Returns the length in cycles of a quantum of the ATLAS scheduler.
+	long long getQuantumLength() const { return quantum_length; }
+
+	/// Returns the age in cycles after which the ATLAS scheduler runs a
+	/// command ahead of all others.
+	long long getStarvationThreshold() const
+	{
+		return starvation_threshold;
+	}
+
+	/// Returns the refresh policy.
+	RefreshPolicy getRefreshPolicy() const { return refresh_policy; }
+
+	/// Returns the policy to enter the power-down state.
+	PowerDownPolicy getPowerDownPolicy() const { return power_down_policy; }
+
+	/// Returns how ranks exit the precharged power-down state.
+	PowerDownExit getPowerDownExit() const { return power_down_exit; }
+
+	/// Returns the number of idle cycles after which a rank enters the
+	/// power-down state.
+	long long getPowerDownThreshold() const { return power_down_threshold; }
+
+	/// Returns the number of idle cycles after which a rank enters the
+	/// self-refresh state, or 0 if self-refresh is disabled.
+	long long getSelfRefreshThreshold() const
+	{
+		return self_refresh_threshold;
+	}
+
+	/// Returns the average interval between refreshes of a rank (tREFI).
+	int getTimeRefi() const { return time_refi; }
+
+	/// Returns the duration of an all-bank refresh (tRFC).
+	int getTimeRfc() const { return time_rfc; }
+
+	/// Returns the duration of a per-bank refresh (tRFCpb).
+	int getTimeRfcPb() const { return time_rfc_pb; }
+
+	/// Returns the duration of a precharge (tRP).
+	int getTimeRp() const { return time_rp; }
+
+	/// Returns the exit latency of the power-down state, given whether
+	/// all banks of the rank were precharged when it was entered.
+	int getPowerDownExitLatency(bool precharged) const
+	{
+		return precharged && power_down_exit == PowerDownExitSlow ?
+				time_xpdll : time_xp;
+	}
+
+	/// Returns the exit latency of the self-refresh state (tXS).
+	int getTimeXs() const { return time_xs; }
+
 	/// Returns the minimum timing seperation (in number of cycles) between
 	/// two commands in two locations, based on the timing protocol matrix.
 	int getTiming(TimingCommand prev, TimingCommand next,
@@ -140,6 +278,13 @@ public:
 		return std::max(timings[prev][next][rank][bank], 1);
 	}
 
+	/// Returns the number of bytes transferred by a request, as a burst
+	/// of column accesses on both clock edges to all devices of a rank.
+	int getRequestSize() const
+	{
+		return num_bits * num_devices * 2 * time_burst / 8;
+	}
+
 	/// Returns the duration of a command of the specified type.
 	int getCommandDuration(CommandType type)
 	{
@@ -182,13 +327,24 @@ public:
 	/// Event handler that runs the request processor.
 	static void RequestProcessorHandler(esim::Event *, esim::Frame *);
 
-	/// Process requests in the incoming requests queue, breaking them
-	/// down into their commands.
+	/// Process requests in the incoming requests queues, breaking them
+	/// down into their commands. Each channel takes one request per cycle
+	/// from its own queue, so that channels do not interfere with each
+	/// other.
 	void RunRequestProcessor();
 
 	/// Event handler that for when a command finishes executing.
 	static void CommandReturnHandler(esim::Event *, esim::Frame *);
 
+	/// Dump the command counts, refresh and power-down statistics, and
+	/// the energy breakdown of a group of ranks of the controller, as
+	/// variables of an IniFile section. Energies are given in nJ.
+	void DumpRankReport(std::ostream &os, const std::vector<Rank *> &ranks);
+
+	/// Dump the report of the controller, followed by the report of each
+	/// of its channels, in the IniFile format.
+	void DumpReport(std::ostream &os = std::cout);
+
 	/// Dump the object to an output stream.
 	void dump(std::ostream &os = std::cout) const;
 
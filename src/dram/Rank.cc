@@ -17,9 +17,17 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 
+#include <algorithm>
+#include <cassert>
+#include <climits>
+
+#include "lib/cpp/Error.h"
 #include "lib/cpp/String.h"
+#include "lib/esim/Engine.h"
 
 #include "Bank.h"
+#include "Channel.h"
+#include "Controller.h"
 #include "Rank.h"
 #include "System.h"
 
@@ -45,10 +53,254 @@ Rank::Rank(int id,
 }
 
 
+// Return the number of cycles of interval [start, end) that fall in
+// interval [begin, finish)
+static long long Overlap(long long start, long long end,
+		long long begin, long long finish)
+{
+	return std::max(0LL, std::min(end, finish) - std::max(start, begin));
+}
+
+
 void Rank::setLastScheduledCommand(CommandType type)
 {
 	last_scheduled_commands[type] = System::frequency_domain->getCycle();
 	last_scheduled_command_type = type;
+	num_commands[type]++;
+}
+
+
+long long Rank::getPowerDownCycle() const
+{
+	Controller *controller = channel->getController();
+	if (controller->getPowerDownPolicy() == PowerDownPolicyNone)
+		return getSelfRefreshCycle();
+	return std::min(idle_since + controller->getPowerDownThreshold(),
+			getSelfRefreshCycle());
+}
+
+
+long long Rank::getSelfRefreshCycle() const
+{
+	Controller *controller = channel->getController();
+	if (!controller->getSelfRefreshThreshold())
+		return LLONG_MAX;
+	return idle_since + controller->getSelfRefreshThreshold();
+}
+
+
+void Rank::UpdatePowerState()
+{
+	// Nothing to do if no cycles elapsed
+	long long cycle = System::frequency_domain->getCycle();
+	long long start = last_power_update;
+	if (cycle <= start)
+		return;
+	last_power_update = cycle;
+
+	// Standby while the rank is busy
+	RankPowerState standby = num_open_banks ? RankPowerActiveStandby :
+			RankPowerPrechargedStandby;
+	if (!idle)
+	{
+		power_state_cycles[standby] += cycle - start;
+		return;
+	}
+
+	// An idle rank stays in standby until it enters power-down, and then
+	// self-refresh. Open rows are closed when entering precharged
+	// power-down.
+	Controller *controller = channel->getController();
+	RankPowerState power_down = num_open_banks &&
+			controller->getPowerDownPolicy() ==
+			PowerDownPolicyActive ? RankPowerActivePowerDown :
+			RankPowerPrechargedPowerDown;
+	long long power_down_cycle = getPowerDownCycle();
+	long long self_refresh_cycle = getSelfRefreshCycle();
+	power_state_cycles[standby] += Overlap(start, cycle,
+			LLONG_MIN, power_down_cycle);
+	power_state_cycles[power_down] += Overlap(start, cycle,
+			power_down_cycle, self_refresh_cycle);
+	power_state_cycles[RankPowerSelfRefresh] += Overlap(start, cycle,
+			self_refresh_cycle, LLONG_MAX);
+}
+
+
+void Rank::CloseBanks()
+{
+	for (auto &bank : banks)
+		bank->Close();
+}
+
+
+void Rank::ExitPowerDown()
+{
+	// Account the cycles of the idle period so far
+	long long cycle = System::frequency_domain->getCycle();
+	UpdatePowerState();
+
+	// Exit self-refresh. The rows were closed when it was entered.
+	Controller *controller = channel->getController();
+	if (cycle >= getSelfRefreshCycle())
+	{
+		CloseBanks();
+		power_up_cycle = cycle + controller->getTimeXs();
+		num_self_refresh_exits++;
+	}
+
+	// Exit power-down
+	else if (cycle >= getPowerDownCycle())
+	{
+		if (controller->getPowerDownPolicy() ==
+				PowerDownPolicyPrecharged)
+			CloseBanks();
+		power_up_cycle = cycle + controller->getPowerDownExitLatency(
+				!num_open_banks);
+		num_power_down_exits++;
+	}
+
+	// Debug
+	if (power_up_cycle > cycle)
+		System::debug << misc::fmt("[%lld] Rank %d of channel %d "
+				"powered up, ready in cycle %lld\n", cycle, id,
+				channel->getId(), power_up_cycle);
+}
+
+
+void Rank::WakeUp()
+{
+	// Only idle ranks can be in a low power state
+	if (!idle)
+		return;
+
+	// Exit the low power state and start a busy period
+	ExitPowerDown();
+	idle = false;
+}
+
+
+void Rank::AddPendingCommands(int count)
+{
+	// The rank must have been woken up before commands are added
+	if (idle)
+		throw misc::Panic("Commands added to an idle rank");
+	num_pending_commands += count;
+}
+
+
+void Rank::CommandFinished()
+{
+	// Start an idle period when the last command finishes
+	assert(num_pending_commands > 0);
+	num_pending_commands--;
+	if (num_pending_commands)
+		return;
+	UpdatePowerState();
+	idle = true;
+	idle_since = System::frequency_domain->getCycle();
+}
+
+
+void Rank::BankOpened()
+{
+	UpdatePowerState();
+	num_open_banks++;
+}
+
+
+void Rank::BankClosed()
+{
+	assert(num_open_banks > 0);
+	UpdatePowerState();
+	num_open_banks--;
+}
+
+
+void Rank::StartRefresh()
+{
+	// Nothing to do if refresh is disabled
+	Controller *controller = channel->getController();
+	RefreshPolicy policy = controller->getRefreshPolicy();
+	if (policy == RefreshPolicyNone)
+		return;
+
+	// With per-bank refresh, one bank is refreshed in each fraction of
+	// the refresh interval.
+	int interval = controller->getTimeRefi();
+	if (policy == RefreshPolicyBank)
+		interval /= getNumBanks();
+
+	// Schedule the periodic event, staggering the first refresh of the
+	// ranks of the channel.
+	esim::Engine *esim = esim::Engine::getInstance();
+	auto frame = std::make_shared<RefreshFrame>();
+	frame->rank = this;
+	esim->Call(System::event_refresh, frame, nullptr,
+			(long long) interval * (id + 1) /
+			channel->getNumRanks(), interval);
+}
+
+
+void Rank::RefreshHandler(esim::Event *type, esim::Frame *frame)
+{
+	// Get the rank pointer out of the frame.
+	RefreshFrame *refresh_frame = dynamic_cast<RefreshFrame *>(frame);
+	Rank *rank = refresh_frame->rank;
+
+	// Refresh the rank
+	rank->Refresh();
+}
+
+
+void Rank::Refresh()
+{
+	// The device refreshes itself in self-refresh
+	long long cycle = System::frequency_domain->getCycle();
+	if (idle && cycle >= getSelfRefreshCycle())
+		return;
+
+	// An idle rank exits power-down for the refresh
+	if (idle)
+		ExitPowerDown();
+
+	// Banks to refresh
+	Controller *controller = channel->getController();
+	int first_bank = 0;
+	int num_refreshed_banks = getNumBanks();
+	int duration = controller->getTimeRfc();
+	if (controller->getRefreshPolicy() == RefreshPolicyBank)
+	{
+		first_bank = next_refresh_bank;
+		num_refreshed_banks = 1;
+		duration = controller->getTimeRfcPb();
+		next_refresh_bank = (next_refresh_bank + 1) % getNumBanks();
+	}
+
+	// The refresh starts when all banks can be precharged, and blocks
+	// them until it finishes.
+	long long start = std::max(cycle, power_up_cycle);
+	for (int i = first_bank; i < first_bank + num_refreshed_banks; i++)
+		start = std::max(start, banks[i]->getRefreshReadyCycle());
+	long long end = start + duration;
+	for (int i = first_bank; i < first_bank + num_refreshed_banks; i++)
+		banks[i]->Refresh(end);
+
+	// Statistics
+	num_refreshes++;
+	num_refresh_bank_cycles += (end - cycle) * num_refreshed_banks;
+
+	// An idle rank stays idle, and can enter power-down again after
+	// the refresh.
+	if (idle)
+	{
+		UpdatePowerState();
+		idle_since = end;
+	}
+
+	// Debug
+	System::activity << misc::fmt("[%lld] [%d] Refreshing %d bank(s) "
+			"from bank %d until cycle %lld\n", cycle, id,
+			num_refreshed_banks, first_bank, end);
 }
 
 
@@ -23,6 +23,9 @@
 #include <vector>
 #include <iostream>
 
+#include <lib/esim/Event.h>
+#include <lib/esim/Frame.h>
+
 #include "Command.h"
 
 
@@ -34,6 +37,18 @@ class Bank;
 class Channel;
 
 
+/// Power states of a rank, used to account for background energy
+enum RankPowerState
+{
+	RankPowerActiveStandby = 0,
+	RankPowerPrechargedStandby,
+	RankPowerActivePowerDown,
+	RankPowerPrechargedPowerDown,
+	RankPowerSelfRefresh,
+	RankPowerNumStates
+};
+
+
 class Rank
 {
 	int id;
@@ -48,6 +63,51 @@ class Rank
 	CommandType last_scheduled_command_type = CommandInvalid;
 	long long last_scheduled_commands[5] = {-100, -100, -100, -100, -100};
 
+	// Number of commands of each type run in the rank
+	long long num_commands[5] = {};
+
+	// Next bank refreshed with per-bank refresh
+	int next_refresh_bank = 0;
+
+	// Number of refreshes, and number of cycles that banks were blocked
+	// by them, added over all banks
+	long long num_refreshes = 0;
+	long long num_refresh_bank_cycles = 0;
+
+	// Number of banks with an open row
+	int num_open_banks = 0;
+
+	// Number of commands queued or in flight in the banks of the rank.
+	// The rank is idle when there are none, and it can enter power-down
+	// or self-refresh after a number of idle cycles.
+	int num_pending_commands = 0;
+	bool idle = true;
+	long long idle_since = 0;
+
+	// First cycle a command can run after exiting a low power state
+	long long power_up_cycle = 0;
+
+	// Cycles spent in each power state, accounted up to cycle
+	// 'last_power_update'
+	long long power_state_cycles[RankPowerNumStates] = {};
+	long long last_power_update = 0;
+
+	// Number of exits from the power-down and self-refresh states
+	long long num_power_down_exits = 0;
+	long long num_self_refresh_exits = 0;
+
+	// Return the cycles when the rank enters power-down and self-refresh
+	// in the current idle period, as long as it stays idle.
+	long long getPowerDownCycle() const;
+	long long getSelfRefreshCycle() const;
+
+	// Exit the low power state the idle rank is in at the current cycle,
+	// if any.
+	void ExitPowerDown();
+
+	// Close the open rows of all banks
+	void CloseBanks();
+
 public:
 
 	Rank(int id,
@@ -64,6 +124,9 @@ public:
 	/// Returns a bank that belongs to this rank with the specified id.
 	Bank *getBank(int id) const { return banks[id].get(); }
 
+	/// Returns the number of banks in this rank.
+	int getNumBanks() const { return banks.size(); }
+
 	/// Returns the channel that this rank belongs to.
 	Channel *getChannel() const { return channel; }
 
@@ -84,6 +147,77 @@ public:
 	/// type and updates the last scheduled command type.
 	void setLastScheduledCommand(CommandType type);
 
+	/// Returns the number of commands of the specified type run in the
+	/// rank.
+	long long getNumCommands(CommandType type) const
+	{
+		return num_commands[type];
+	}
+
+	/// Schedule the periodic refresh of the rank, according to the
+	/// refresh policy of the controller. Refreshes of the ranks of a
+	/// channel are staggered evenly over the refresh interval.
+	void StartRefresh();
+
+	/// Event handler that refreshes a rank.
+	static void RefreshHandler(esim::Event *, esim::Frame *);
+
+	/// Refresh all banks of the rank, or the next bank with per-bank
+	/// refresh. Banks are precharged first, and blocked for the duration
+	/// of the refresh. Refreshes are skipped while the rank is in
+	/// self-refresh.
+	void Refresh();
+
+	/// Returns the number of refreshes, all-bank or per-bank.
+	long long getNumRefreshes() const { return num_refreshes; }
+
+	/// Returns the number of cycles banks were blocked by refreshes,
+	/// added over all banks of the rank.
+	long long getNumRefreshBankCycles() const
+	{
+		return num_refresh_bank_cycles;
+	}
+
+	/// Exits the low power state, if any, before commands are added to
+	/// an idle rank.
+	void WakeUp();
+
+	/// Adds commands queued in a bank of the rank.
+	void AddPendingCommands(int count);
+
+	/// Notifies that a command of the rank finished.
+	void CommandFinished();
+
+	/// Notifies that a bank opened a row.
+	void BankOpened();
+
+	/// Notifies that a bank closed its row.
+	void BankClosed();
+
+	/// Returns the first cycle a command can run after the rank exited a
+	/// low power state.
+	long long getPowerUpCycle() const { return power_up_cycle; }
+
+	/// Accounts the cycles spent in each power state up to the current
+	/// cycle.
+	void UpdatePowerState();
+
+	/// Returns the number of cycles spent in a power state, as of the
+	/// last call to UpdatePowerState().
+	long long getPowerStateCycles(RankPowerState state) const
+	{
+		return power_state_cycles[state];
+	}
+
+	/// Returns the number of exits from the power-down state.
+	long long getNumPowerDownExits() const { return num_power_down_exits; }
+
+	/// Returns the number of exits from the self-refresh state.
+	long long getNumSelfRefreshExits() const
+	{
+		return num_self_refresh_exits;
+	}
+
 	/// Dump the object to an output stream.
 	void dump(std::ostream &os = std::cout) const;
 
@@ -97,6 +231,18 @@ public:
 };
 
 
+class RefreshFrame : public esim::Frame
+{
+
+public:
+	RefreshFrame()
+	{
+	}
+
+	Rank *rank;
+};
+
+
 }  // namespace dram
 
 #endif
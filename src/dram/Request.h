@@ -43,6 +43,20 @@ class Request
 	RequestType type;
 	std::unique_ptr<Address> address;
 
+	// Core that issued the request, used by thread-aware schedulers
+	int core = 0;
+
+	// Whether the request belongs to the current batch of the PAR-BS
+	// scheduler
+	bool marked = false;
+
+	// Cycle when the request arrived to the DRAM system, when its first
+	// command was issued, and when its column access was issued. A value
+	// of -1 means that the command was not issued yet.
+	long long cycle_arrival = 0;
+	long long cycle_first_command = -1;
+	long long cycle_access = -1;
+
 public:
 
 	Request();
@@ -53,6 +67,42 @@ public:
 	/// Sets the type of the request.
 	void setType(RequestType new_type) { type = new_type; }
 
+	/// Returns the core that issued the request.
+	int getCore() const { return core; }
+
+	/// Sets the core that issued the request.
+	void setCore(int core) { this->core = core; }
+
+	/// Returns whether the request is marked as part of a batch.
+	bool isMarked() const { return marked; }
+
+	/// Marks or unmarks the request as part of a batch.
+	void setMarked(bool marked) { this->marked = marked; }
+
+	/// Returns the cycle when the request arrived to the DRAM system.
+	long long getCycleArrival() const { return cycle_arrival; }
+
+	/// Sets the cycle when the request arrived to the DRAM system.
+	void setCycleArrival(long long cycle) { cycle_arrival = cycle; }
+
+	/// Returns the cycle when the first command of the request was
+	/// issued, or -1 if none was issued yet.
+	long long getCycleFirstCommand() const { return cycle_first_command; }
+
+	/// Returns the cycle when the column access of the request was
+	/// issued, or -1 if it was not issued yet.
+	long long getCycleAccess() const { return cycle_access; }
+
+	/// Records that a command of the request was issued in the given
+	/// cycle, given whether it is its column access.
+	void CommandIssued(long long cycle, bool access)
+	{
+		if (cycle_first_command < 0)
+			cycle_first_command = cycle;
+		if (access)
+			cycle_access = cycle;
+	}
+
 	/// Marks the request as completed, which should happen when the
 	/// associated read or write command finishes.
 	void setFinished();
@@ -17,12 +17,15 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 
+#include <algorithm>
 #include <climits>
 
 #include <lib/cpp/String.h>
 
 #include "Bank.h"
 #include "Channel.h"
+#include "Controller.h"
+#include "Request.h"
 #include "System.h"
 #include "Scheduler.h"
 
@@ -33,36 +36,31 @@ namespace dram
 misc::StringMap SchedulerTypeMap
 {
 	{ "RankBankRoundRobin", SchedulerRankBankRoundRobin},
-	{ "OldestFirst", SchedulerOldestFirst }
+	{ "OldestFirst", SchedulerOldestFirst },
+	{ "FRFCFS", SchedulerFRFCFS },
+	{ "PARBS", SchedulerPARBS },
+	{ "ATLAS", SchedulerATLAS }
 };
 
 
-Bank *OldestFirst::FindNext()
+Bank *Scheduler::FindOldest(bool row_hit)
 {
 	// Keep track of the bank with the oldest command found so far.
 	long long oldest_cycle = LLONG_MAX;
 	Bank *oldest_bank = nullptr;
 
-	// Get the number of banks in each rank of the channel.
-	int num_banks = channel->getNumBanks();
-
-	// Iterate through all the ranks and banks.
-	for (int i = 0; i < channel->getNumBanksTotal(); i++)
+	// Iterate through the banks with commands in their queue, or with a
+	// row-buffer hit at the front of their queue.
+	for (int i = row_hit ? channel->getNextRowHitBank() :
+			channel->getNextPendingBank(); i >= 0;
+			i = row_hit ? channel->getNextRowHitBank(i + 1) :
+			channel->getNextPendingBank(i + 1))
 	{
-		// Get the current bank
-		Bank *bank = channel->getRank(i / num_banks)
-				->getBank(i % num_banks);
-
-		// Move to the next bank if this one has no commands in queue.
-		if (bank->getNumCommandsInQueue() == 0)
-		{
-			continue;
-		}
-
-		// Get the cycle when the front command in this bank was
-		// created.
-		long long current_bank_cycle =
-				bank->getFrontCommandCycleCreated();
+		// Get the cycle when the request of the front command in this
+		// bank arrived.
+		Bank *bank = channel->getBank(i);
+		long long current_bank_cycle = bank->getFrontCommand()->
+				getRequest()->getCycleArrival();
 
 		// Make this the bank with the oldest command if it is.
 		if (current_bank_cycle < oldest_cycle)
@@ -72,60 +70,345 @@ Bank *OldestFirst::FindNext()
 		}
 	}
 
-	// Return the bank with the oldest command at the front of its queue.
 	// If no bank was found, then the value of oldest_bank will still be
 	// nullptr, which is the return value that indicates none was found.
 	return oldest_bank;
 }
 
 
+Bank *OldestFirst::FindNext()
+{
+	// Return the bank with the oldest command at the front of its queue.
+	return FindOldest(false);
+}
+
+
 Bank *RankBankRoundRobin::FindNext()
 {
-	// Iterate through all the ranks and banks.  No more, no less.
-	for (int i = 0; i < channel->getNumBanksTotal(); i++)
+	// Look for the first bank with commands after the current one, and
+	// wrap around to the first bank of the first rank if there is none.
+	// The current bank is considered last.
+	int num_banks = channel->getNumBanks();
+	int current = current_rank * num_banks + current_bank;
+	int index = channel->getNextPendingBank(current + 1);
+	if (index < 0)
+		index = channel->getNextPendingBank();
+
+	// If we reach this point with no bank, then no bank in the channel
+	// has a command. Return nullptr to indicate that no command has been
+	// found.
+	if (index < 0)
+		return nullptr;
+
+	// Make it the current bank.
+	current_rank = index / num_banks;
+	current_bank = index % num_banks;
+
+	// Debug
+	long long cycle = System::frequency_domain->getCycle();
+	System::debug << misc::fmt("[%lld] Scheduler returns %d : %d "
+			"for next command scheduling\n", cycle,
+			current_rank, current_bank);
+
+	// This bank has a command, so it's the one to be scheduled.
+	return channel->getBank(index);
+}
+
+
+Bank *FRFCFS::FindNext()
+{
+	// Oldest row-buffer hit first
+	Bank *bank = FindOldest(true);
+	if (bank)
+		return bank;
+
+	// Oldest command otherwise
+	return FindOldest(false);
+}
+
+
+int FRFCFS::SelectRequest(Bank *bank)
+{
+	// Oldest row-buffer hit first
+	for (int position = 0; position < bank->getNumRequestsInQueue();
+			position++)
+		if (bank->isRowHit(bank->getRequestInQueue(position)))
+			return position;
+
+	// Oldest request otherwise
+	return 0;
+}
+
+
+PARBS::PARBS(Channel *owner)
+		:
+		Scheduler(owner)
+{
+	marking_cap = channel->getController()->getMarkingCap();
+}
+
+
+void PARBS::FormBatch()
+{
+	// Number of requests marked for each core in the current bank, and
+	// the maximum and total over all banks.
+	std::vector<int> bank_load;
+	std::vector<int> max_load;
+	std::vector<int> total_load;
+
+	// Mark the oldest requests of each core in each bank, starting with
+	// the request in the command queue if its column access was not
+	// issued yet, followed by the waiting requests.
+	for (int i = channel->getNextPendingBank(); i >= 0;
+			i = channel->getNextPendingBank(i + 1))
+	{
+		Bank *bank = channel->getBank(i);
+		std::vector<Request *> requests;
+		for (int position = 0; position < bank->getNumCommandsInQueue();
+				position++)
+		{
+			Command *command = bank->getCommandInQueue(position);
+			if (command->isAccess())
+				requests.push_back(command->getRequest());
+		}
+		for (int position = 0; position < bank->getNumRequestsInQueue();
+				position++)
+			requests.push_back(bank->getRequestInQueue(position));
+
+		// Mark requests
+		std::fill(bank_load.begin(), bank_load.end(), 0);
+		for (Request *request : requests)
+		{
+			// Check the marking cap of the core
+			int core = request->getCore();
+			if (core >= (int) bank_load.size())
+			{
+				bank_load.resize(core + 1);
+				max_load.resize(core + 1);
+				total_load.resize(core + 1);
+			}
+			if (bank_load[core] >= marking_cap)
+				continue;
+
+			// Mark
+			request->setMarked(true);
+			bank_load[core]++;
+			num_marked++;
+		}
+
+		// Update loads
+		for (unsigned core = 0; core < bank_load.size(); core++)
+		{
+			max_load[core] = std::max(max_load[core],
+					bank_load[core]);
+			total_load[core] += bank_load[core];
+		}
+	}
+
+	// Rank the cores with marked requests by their maximum load in a
+	// single bank, breaking ties with their total load.
+	std::vector<int> cores;
+	for (unsigned core = 0; core < total_load.size(); core++)
+		if (total_load[core])
+			cores.push_back(core);
+	std::sort(cores.begin(), cores.end(), [&](int a, int b)
+	{
+		return std::make_tuple(max_load[a], total_load[a], a) <
+				std::make_tuple(max_load[b], total_load[b], b);
+	});
+	core_ranks.assign(total_load.size(), total_load.size());
+	for (unsigned rank = 0; rank < cores.size(); rank++)
+		core_ranks[cores[rank]] = rank;
+
+	// Debug
+	long long cycle = System::frequency_domain->getCycle();
+	System::debug << misc::fmt("[%lld] Channel %d: new batch with %d "
+			"requests\n", cycle, channel->getId(), num_marked);
+}
+
+
+std::tuple<bool, bool, int, long long> PARBS::getPriority(Request *request,
+		bool row_hit) const
+{
+	return std::make_tuple(!request->isMarked(), !row_hit,
+			getCoreRank(request->getCore()),
+			request->getCycleArrival());
+}
+
+
+Bank *PARBS::FindNext()
+{
+	// Start a new batch when the current one is done
+	if (!num_marked)
+		FormBatch();
+
+	// Find the bank with the highest priority front command.
+	Bank *best_bank = nullptr;
+	std::tuple<bool, bool, int, long long> best_priority;
+	for (int i = channel->getNextPendingBank(); i >= 0;
+			i = channel->getNextPendingBank(i + 1))
 	{
-		// Increment the bank we're working on.
-		current_bank++;
+		Bank *bank = channel->getBank(i);
+		auto priority = getPriority(bank->getFrontCommand()->
+				getRequest(), channel->isRowHitBank(i));
+		if (!best_bank || priority < best_priority)
+		{
+			best_bank = bank;
+			best_priority = priority;
+		}
+	}
 
-		// If we've finished all the banks in this rank, continue to
-		// the beginning of the next rank.
-		if (current_bank == channel->getNumBanks())
+	// Return the bank found, if any
+	return best_bank;
+}
+
+
+int PARBS::SelectRequest(Bank *bank)
+{
+	// Find the waiting request with the highest priority
+	int best_position = 0;
+	std::tuple<bool, bool, int, long long> best_priority;
+	for (int position = 0; position < bank->getNumRequestsInQueue();
+			position++)
+	{
+		Request *request = bank->getRequestInQueue(position);
+		auto priority = getPriority(request, bank->isRowHit(request));
+		if (!position || priority < best_priority)
 		{
-			current_bank = 0;
-			current_rank++;
+			best_position = position;
+			best_priority = priority;
 		}
+	}
+	return best_position;
+}
+
+
+void PARBS::CommandScheduled(Command *command)
+{
+	// The request leaves the batch with its column access
+	Request *request = command->getRequest();
+	if (command->isAccess() && request->isMarked())
+	{
+		request->setMarked(false);
+		num_marked--;
+	}
+}
+
+
+const double ATLAS::history_weight = 0.875;
+
+
+ATLAS::ATLAS(Channel *owner)
+		:
+		Scheduler(owner)
+{
+	Controller *controller = channel->getController();
+	quantum_length = controller->getQuantumLength();
+	starvation_threshold = controller->getStarvationThreshold();
+	quantum_end = System::frequency_domain->getCycle() + quantum_length;
+}
+
+
+void ATLAS::EndQuantum()
+{
+	// Update the attained service of each core
+	int num_cores = quantum_service.size();
+	total_service.resize(num_cores);
+	for (int core = 0; core < num_cores; core++)
+	{
+		total_service[core] = history_weight * total_service[core] +
+				(1 - history_weight) * quantum_service[core];
+		quantum_service[core] = 0;
+	}
+
+	// Rank the cores, least attained service first
+	std::vector<int> cores(num_cores);
+	for (int core = 0; core < num_cores; core++)
+		cores[core] = core;
+	std::stable_sort(cores.begin(), cores.end(), [&](int a, int b)
+	{
+		return total_service[a] < total_service[b];
+	});
+	core_ranks.resize(num_cores);
+	for (int rank = 0; rank < num_cores; rank++)
+		core_ranks[cores[rank]] = rank;
+
+	// Start next quantum
+	long long cycle = System::frequency_domain->getCycle();
+	quantum_end = cycle + quantum_length;
+
+	// Debug
+	System::debug << misc::fmt("[%lld] Channel %d: new ATLAS quantum\n",
+			cycle, channel->getId());
+}
+
+
+std::tuple<bool, int, bool, long long> ATLAS::getPriority(Request *request,
+		bool row_hit, long long cycle) const
+{
+	long long arrival = request->getCycleArrival();
+	return std::make_tuple(cycle - arrival <= starvation_threshold,
+			getCoreRank(request->getCore()), !row_hit, arrival);
+}
 
-		// If we've finished all the ranks in this channel, move back
-		// to the first one.
-		if (current_rank == channel->getNumRanks())
-			current_rank = 0;
 
-		// Get a pointer to this bank.
-		Bank *bank = channel->getRank(current_rank)->
-				getBank(current_bank);
+Bank *ATLAS::FindNext()
+{
+	// End of quantum
+	long long cycle = System::frequency_domain->getCycle();
+	if (cycle >= quantum_end)
+		EndQuantum();
 
-		// Move to the next bank if this one has no commands in queue.
-		if (bank->getNumCommandsInQueue() == 0)
+	// Find the bank with the highest priority front command.
+	Bank *best_bank = nullptr;
+	std::tuple<bool, int, bool, long long> best_priority;
+	for (int i = channel->getNextPendingBank(); i >= 0;
+			i = channel->getNextPendingBank(i + 1))
+	{
+		Bank *bank = channel->getBank(i);
+		auto priority = getPriority(bank->getFrontCommand()->
+				getRequest(), channel->isRowHitBank(i), cycle);
+		if (!best_bank || priority < best_priority)
 		{
-			continue;
+			best_bank = bank;
+			best_priority = priority;
 		}
+	}
 
-		// Debug
-		long long cycle = System::frequency_domain->getCycle();
-		System::debug << misc::fmt("[%lld] Scheduler returns %d : %d "
-				"for next command scheduling\n", cycle,
-				current_rank, current_bank);
+	// Return the bank found, if any
+	return best_bank;
+}
 
-		// This bank has a command, so it's the one to be scheduled.
-		return bank;
+
+int ATLAS::SelectRequest(Bank *bank)
+{
+	// Find the waiting request with the highest priority
+	long long cycle = System::frequency_domain->getCycle();
+	int best_position = 0;
+	std::tuple<bool, int, bool, long long> best_priority;
+	for (int position = 0; position < bank->getNumRequestsInQueue();
+			position++)
+	{
+		Request *request = bank->getRequestInQueue(position);
+		auto priority = getPriority(request, bank->isRowHit(request),
+				cycle);
+		if (!position || priority < best_priority)
+		{
+			best_position = position;
+			best_priority = priority;
+		}
 	}
+	return best_position;
+}
 
-	// If we reach this point, then every bank in every rank of the channel
-	// has been searched and no command that can be scheduled has been
-	// found.
 
-	// Return nullptr to indicate that no command has been found.
-	return nullptr;
+void ATLAS::CommandScheduled(Command *command)
+{
+	// Account the time the command keeps the bank busy
+	int core = command->getRequest()->getCore();
+	if (core >= (int) quantum_service.size())
+		quantum_service.resize(core + 1);
+	quantum_service[core] += command->getDuration();
 }
 
 }  // namespace dram
@@ -20,7 +20,9 @@
 #ifndef DRAM_SCHEDULER_H
 #define DRAM_SCHEDULER_H
 
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include <lib/cpp/String.h>
 
@@ -33,13 +35,17 @@ namespace dram
 // Forward declarations
 class Bank;
 class Channel;
+class Request;
 
 
 // Possible scheduling algorithms
 enum SchedulerType
 {
 	SchedulerRankBankRoundRobin,
-	SchedulerOldestFirst
+	SchedulerOldestFirst,
+	SchedulerFRFCFS,
+	SchedulerPARBS,
+	SchedulerATLAS
 };
 
 // String map for SchedulerType
@@ -50,9 +56,14 @@ extern misc::StringMap SchedulerTypeMap;
 /// constructor must contain at least a pointer to the channel that owns it
 /// and should call the base class constructor.  The FindNext method should
 /// be implemented with the scheduling algorithm, and any state variables
-/// required should be added to the class.
+/// required should be added to the class. The SelectRequest method can be
+/// overridden to choose which of the requests waiting in a bank is served
+/// next.
 /// After the new scheduler is made, add it to the SchedulerType enum,
 /// SchedulerTypeMap StringMap and the switch block in Channel::Channel.
+/// Schedulers should traverse the bank bitmasks of the channel
+/// (Channel::getNextPendingBank() and Channel::getNextRowHitBank()) instead
+/// of all of its banks.
 class Scheduler
 {
 
@@ -61,6 +72,11 @@ protected:
 	// Pointer to the owning channel.
 	Channel *channel;
 
+	// Returns the bank with the oldest request at the front of its
+	// command queue, considering only row-buffer hits if 'row_hit' is
+	// set, or nullptr if there is none.
+	Bank *FindOldest(bool row_hit);
+
 public:
 
 	Scheduler(Channel *owner)
@@ -69,10 +85,28 @@ public:
 	{
 	}
 
+	virtual ~Scheduler()
+	{
+	}
+
 	/// Returns the pointer to the next bank that should have its command
 	/// scheduled next.  In the case that one isn't found, nullptr is
 	/// returned.
 	virtual Bank *FindNext() = 0;
+
+	/// Returns the position of the waiting request of a bank that should
+	/// be broken down into commands next, when the bank has no commands
+	/// left. The default is the oldest request.
+	virtual int SelectRequest(Bank *bank)
+	{
+		return 0;
+	}
+
+	/// Notifies the scheduler that a command is about to run, so that
+	/// schedulers keeping per-request or per-core state can update it.
+	virtual void CommandScheduled(Command *command)
+	{
+	}
 };
 
 
@@ -111,6 +145,150 @@ public:
 	Bank *FindNext();
 };
 
+
+/// First-Ready First-Come First-Served scheduler. Requests that access the
+/// open row of their bank (row-buffer hits) are scheduled first, oldest
+/// first, followed by the oldest of the remaining requests. Within a bank,
+/// a row hit passes older requests to other rows.
+class FRFCFS : public Scheduler
+{
+
+public:
+
+	FRFCFS(Channel *owner)
+			:
+			Scheduler(owner)
+	{
+	}
+
+	/// Returns the pointer to the next bank that should have its command
+	/// scheduled next based on the FR-FCFS algorithm.
+	Bank *FindNext();
+
+	/// Returns the oldest row-buffer hit waiting in the bank, or the
+	/// oldest request if there is none.
+	int SelectRequest(Bank *bank);
+};
+
+
+/// Parallelism-Aware Batch Scheduler (PAR-BS). Requests are grouped into
+/// batches, formed by marking up to 'MarkingCap' of the oldest requests of
+/// each core in each bank whenever no marked requests remain. Marked
+/// requests are scheduled first. Among them, row-buffer hits go first, then
+/// requests of the cores with the lowest maximum number of marked requests
+/// in a single bank (shortest job first), then the oldest.
+class PARBS : public Scheduler
+{
+	// Maximum number of requests marked per core and bank in a batch
+	int marking_cap;
+
+	// Number of marked requests not scheduled yet
+	int num_marked = 0;
+
+	// Rank of each core in the current batch, lower is better. Cores
+	// without marked requests have the worst rank.
+	std::vector<int> core_ranks;
+
+	// Mark the requests of a new batch and rank the cores
+	void FormBatch();
+
+	// Return the rank of a core in the current batch
+	int getCoreRank(int core) const
+	{
+		return core < (int) core_ranks.size() ? core_ranks[core] :
+				(int) core_ranks.size();
+	}
+
+	// Return the priority of a request, given whether it is a row-buffer
+	// hit. Priorities are compared as tuples, lower is better.
+	std::tuple<bool, bool, int, long long> getPriority(Request *request,
+			bool row_hit) const;
+
+public:
+
+	PARBS(Channel *owner);
+
+	/// Returns the pointer to the next bank that should have its command
+	/// scheduled next based on the PAR-BS algorithm.
+	Bank *FindNext();
+
+	/// Returns the waiting request of the bank with the highest priority.
+	int SelectRequest(Bank *bank);
+
+	/// Unmarks the request of a scheduled column access.
+	void CommandScheduled(Command *command);
+};
+
+
+/// Adaptive per-Thread Least-Attained-Service scheduler (ATLAS). Time is
+/// divided into quanta of 'QuantumLength' cycles. At the end of each
+/// quantum, cores are ranked by the service they attained from the channel
+/// so far, as an exponential average over quanta, with the least serviced
+/// core ranked first. Requests older than 'StarvationThreshold' cycles are
+/// scheduled first. Otherwise, requests of higher-ranked cores go first,
+/// then row-buffer hits, then the oldest.
+class ATLAS : public Scheduler
+{
+	// Weight of the previous quanta in the attained service
+	static const double history_weight;
+
+	// Length of a quantum in cycles
+	long long quantum_length;
+
+	// Age in cycles after which a command is scheduled first
+	long long starvation_threshold;
+
+	// Cycle when the current quantum ends
+	long long quantum_end;
+
+	// Attained service of each core in previous quanta, and in the
+	// current quantum, in cycles of bank activity.
+	std::vector<double> total_service;
+	std::vector<long long> quantum_service;
+
+	// Rank of each core, lower is better. Cores that have not been
+	// serviced yet have the best rank.
+	std::vector<int> core_ranks;
+
+	// Update the attained service of all cores and rank them
+	void EndQuantum();
+
+	// Return the rank of a core
+	int getCoreRank(int core) const
+	{
+		return core < (int) core_ranks.size() ? core_ranks[core] : 0;
+	}
+
+	// Return the priority of a request in the given cycle, given whether
+	// it is a row-buffer hit. Priorities are compared as tuples, lower is
+	// better.
+	std::tuple<bool, int, bool, long long> getPriority(Request *request,
+			bool row_hit, long long cycle) const;
+
+public:
+
+	ATLAS(Channel *owner);
+
+	/// Returns the pointer to the next bank that should have its command
+	/// scheduled next based on the ATLAS algorithm.
+	Bank *FindNext();
+
+	/// Returns the waiting request of the bank with the highest priority.
+	int SelectRequest(Bank *bank);
+
+	/// Accounts the duration of the command as service attained by the
+	/// core that issued it.
+	void CommandScheduled(Command *command);
+
+	/// Returns the attained service of a core, as computed at the end of
+	/// the last quantum.
+	double getTotalService(int core) const
+	{
+		return core < (int) total_service.size() ?
+				total_service[core] : 0.0;
+	}
+};
+
 }  // namespace dram
 
 #endif
@@ -19,19 +19,28 @@
 
 #include <vector>
 #include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 #include <lib/cpp/CommandLine.h>
 #include <lib/cpp/Misc.h>
 #include <lib/cpp/String.h>
+#include <lib/cpp/Timer.h>
 #include <lib/esim/Engine.h>
 
 #include "Address.h"
 #include "Bank.h"
 #include "Controller.h"
 #include "Channel.h"
+#include "Rank.h"
 #include "Scheduler.h"
 #include "System.h"
+#include "Trace.h"
 
 
 namespace dram
@@ -47,11 +56,19 @@ std::string activity_file;
 
 std::string config_file;
 
+std::string report_file;
+
+std::string trace_file;
+
+int trace_threads = 0;
+
+int System::report_interval = 10000;
+
 bool System::stand_alone = false;
 
 bool System::help = false;
 
-int System::frequency = 667;
+thread_local int System::frequency = 667;
 
 
 //
@@ -62,11 +79,15 @@ misc::Debug System::debug;
 
 misc::Debug System::activity;
 
-std::unique_ptr<System> System::instance;
+thread_local std::unique_ptr<System> System::instance;
 
-esim::FrequencyDomain *System::frequency_domain(nullptr);
+thread_local esim::FrequencyDomain *System::frequency_domain(nullptr);
 
-esim::Event *System::event_command_return(nullptr);
+thread_local esim::Event *System::event_command_return(nullptr);
+
+thread_local esim::Event *System::event_refresh(nullptr);
+
+thread_local esim::Event *System::event_sample(nullptr);
 
 const char *System::err_config_note =
 		"Please run 'm2s --dram-help' or consult the Multi2Sim Guide for "
@@ -85,6 +106,19 @@ const std::string System::help_message =
 		"\n"
 		"  Frequency = <value>  (Default = 1000)\n"
 		"      Frequency of the DRAM system in MHz.\n"
+		"  AddressMapping = {ChRaBaRoCo|RoRaBaChCo|RoBaRaCoCh|CacheLine}\n"
+		"      (Default = ChRaBaRoCo)\n"
+		"      Order of the address components, from the most to the least\n"
+		"      significant bits, where Ch is the channel (controller and channel\n"
+		"      within it), Ra the rank, Ba the bank, Ro the row, and Co the\n"
+		"      column. CacheLine interleaves cache lines across channels, banks\n"
+		"      and ranks, with order Ro:Co:Ra:Ba:Ch:Co.\n"
+		"  LineSize = <columns> (Default = 64)\n"
+		"      Number of columns of a cache line, for the CacheLine mapping. Must\n"
+		"      be a power of two.\n"
+		"  XorBankHashing = {t|f} (Default = False)\n"
+		"      XOR the bank with the low bits of the row, spreading rows that\n"
+		"      would conflict in one bank across all banks.\n"
 		"\n"
 		"Section [MemoryController <name>] defines a generic DRAM device. This section is\n"
 		"used to define the modes of the DRAM, the size of the componants and the timings.\n"
@@ -93,8 +127,45 @@ const std::string System::help_message =
 		"\n"
 		"  PagePolicy = {Open|Closed} (Default = Open) \n"
 		"      Policy that dictates whether the row of a bank remains open or closed.\n"
-		"  SchedulingPolicy = {OldestFirst|BankRoundRobin} (Default = OldestFirst)\n"
+		"  SchedulingPolicy = {OldestFirst|RankBankRoundRobin|FRFCFS|PARBS|ATLAS}\n"
+		"      (Default = OldestFirst)\n"
 		"      Policy that determines which bank is allowed to execute a command.\n"
+		"      FRFCFS runs row-buffer hits first. PARBS and ATLAS are thread-aware\n"
+		"      and prioritize requests based on the core that issued them.\n"
+		"  MarkingCap = <num> (Default = 5)\n"
+		"      Maximum number of requests of each core marked in each bank when\n"
+		"      the PARBS scheduler forms a new batch.\n"
+		"  QuantumLength = <cycles> (Default = 10000000)\n"
+		"      Interval after which the ATLAS scheduler ranks cores again based on\n"
+		"      the service they attained.\n"
+		"  StarvationThreshold = <cycles> (Default = 100000)\n"
+		"      Age after which the ATLAS scheduler runs a command before any\n"
+		"      other.\n"
+		"  Refresh = {None|Rank|Bank} (Default = Rank)\n"
+		"      Refresh policy. Rank refreshes all banks of a rank every tREFI\n"
+		"      cycles, blocking them for tRFC cycles. Bank refreshes one bank at\n"
+		"      a time every tREFI / NumBanks cycles, blocking it for tRFCpb\n"
+		"      cycles. Refreshes of the ranks of a channel are staggered.\n"
+		"  PowerDown = {None|Active|Precharged} (Default = None)\n"
+		"      Policy to enter the power-down state when a rank is idle. Active\n"
+		"      keeps the open rows, while Precharged closes them first.\n"
+		"  PowerDownExit = {Fast|Slow} (Default = Fast)\n"
+		"      Exit of the precharged power-down state, taking tXP cycles with\n"
+		"      IDD2P1 current when fast, or tXPDLL cycles with IDD2P0 when slow.\n"
+		"  PowerDownThreshold = <cycles> (Default = 100)\n"
+		"      Number of idle cycles after which a rank enters power-down.\n"
+		"  SelfRefreshThreshold = <cycles> (Default = 0)\n"
+		"      Number of idle cycles after which a rank enters self-refresh,\n"
+		"      where it refreshes itself and takes tXS cycles to exit. A value\n"
+		"      of 0 disables self-refresh.\n"
+		"  NumDevices = <num> (Default = 8)\n"
+		"      Number of devices in each rank, for energy accounting.\n"
+		"  VDD = <volts> (Default = 1.5)\n"
+		"  IDD0, IDD2P0, IDD2P1, IDD2N, IDD3P, IDD3N, IDD4R, IDD4W, IDD5, IDD6 =\n"
+		"      <mA> (Default = 55, 12, 25, 32, 38, 38, 157, 128, 235, 12)\n"
+		"      Supply voltage and currents of a device, from its datasheet. They\n"
+		"      are used to compute the activate, read, write, refresh, and\n"
+		"      background energy in the DRAM report.\n"
 		"  NumChannels = <num> (Default =  1)\n"
 		"      Number of channels in the DRAM system.\n"
 		"  NumRanks = <num> (Default = 2)\n"
@@ -121,7 +192,22 @@ const std::string System::help_message =
 		"  tRAS = <num> (Default = 28)\n"
 		"  tWR = <num> (Default = 12)\n"
 		"  tRTP = <num> (Default = 6)\n"
-		"  tBURST = <num> (Default = 4)\n";
+		"  tBURST = <num> (Default = 4)\n"
+		"  tREFI = <num> (Default = 6240)\n"
+		"  tRFCpb = <num> (Default = 64)\n"
+		"  tXP = <num> (Default = 5)\n"
+		"  tXPDLL = <num> (Default = 20)\n"
+		"  tXS = <num> (Default = 136)\n"
+		"\n"
+		"Option '--dram-trace <file>' runs a stand-alone simulation driven by a\n"
+		"binary request trace. Each record is 24 bytes long, with packed fields\n"
+		"in host byte order: a 64-bit arrival cycle, a 64-bit encoded address, a\n"
+		"32-bit request type (0 for reads, 1 for writes), and a 32-bit source id,\n"
+		"used as the core issuing the request, between 0 and 1023. Records must\n"
+		"be sorted by cycle.\n"
+		"Channels are simulated on separate host threads, as given in option\n"
+		"'--dram-threads <num>', with the same results for any number of\n"
+		"threads.\n";
 
 
 System *System::getInstance()
@@ -181,20 +267,11 @@ int System::getCapacity()
 
 void System::RegisterOptions()
 {
-/*
 	//
-	// FIXME: These options are removed, in order to be excluded from
-	// the m2s --help. However, later when we hook up the DRAM model to
-	// the memory system, it will come back.
-	// 
-	// FIXME 2: A whole --dram-trace option should be added as an 
-	// input to the stand-alone DRAM. Otherwise, the stand-alone
-	// does not make any sense. It cannot be actions, as part of the
-	// configuration file.
-	//
-	// FIXME 3: The debug and debug_activity files should be combined
+	// FIXME: The debug and debug_activity files should be combined
 	// into one. It does not make sense to have both of them as two
-	// separate file.  
+	// separate file.
+	//
 	// Get command line object
 	misc::CommandLine *command_line = misc::CommandLine::getInstance();
 
@@ -219,6 +296,23 @@ void System::RegisterOptions()
 			"DRAM configuration file. Memory controllers and "
 			"their components can be defined here.");
 
+	// Report for dram
+	command_line->RegisterString("--dram-report <file>",
+			report_file,
+			"File to dump the DRAM report, with the command counts, "
+			"refresh and power-down statistics, and the energy of "
+			"each memory controller, and the request latencies, "
+			"queue occupancy, and row-buffer statistics of each "
+			"channel and bank.");
+
+	// Sampling interval of the queue occupancy
+	command_line->RegisterInt32("--dram-report-interval <cycles> "
+			"(default = 10000)",
+			report_interval,
+			"Interval in DRAM cycles of the queue occupancy time "
+			"series of each channel in the DRAM report. A value of "
+			"0 disables the time series.");
+
 	// Help message for dram configuration
 	command_line->RegisterBool("--dram-help",
 			help,
@@ -231,13 +325,27 @@ void System::RegisterOptions()
 			"Runs a DRAM simulation using the actions provided "
 			"in the DRAM configuration file (option "
 			"'--dram-config').");
-*/
+
+	// Trace-driven stand-alone simulator
+	command_line->RegisterString("--dram-trace <file>",
+			trace_file,
+			"Runs a stand-alone DRAM simulation driven by the "
+			"binary request trace in the given file. The format of "
+			"the trace is described in option '--dram-help'. "
+			"This option implies '--dram-sim'.");
+
+	// Host threads of the trace-driven simulator
+	command_line->RegisterInt32("--dram-threads <number> "
+			"(default = 0)",
+			trace_threads,
+			"Number of host threads simulating the channels in a "
+			"trace-driven DRAM simulation. A value of 0 uses one "
+			"thread per host core.");
 }
 
 
 void System::ProcessOptions()
 {
-/*
 	// DRAM help
 	if (help)
 	{
@@ -253,11 +361,19 @@ void System::ProcessOptions()
 	if (!activity_file.empty())
 		setActivityDebugPath(activity_file);
 
+	// A trace runs the stand-alone simulator
+	if (!trace_file.empty())
+		stand_alone = true;
+
+	// Sampling interval
+	if (report_interval < 0)
+		throw Error(misc::fmt("Invalid value for --dram-report-interval "
+				"(%d)", report_interval));
+
 	// Stand-Alone requires config file
 	if (stand_alone && config_file.empty())
 		throw Error(misc::fmt("Option --dram-sim requires "
 				" --dram-config option "));
-*/
 }
 
 
@@ -279,6 +395,12 @@ void System::ParseConfiguration(misc::IniFile *ini_file)
 	System::debug << ini_file->getPath() << ": Loading DRAM "
 		"Configuration file\n";
 
+	// Save the configuration, for the systems of other host threads in
+	// a trace-driven simulation
+	std::ostringstream config_stream;
+	ini_file->Dump(config_stream);
+	config = config_stream.str();
+
 	// Get the frequency
 	frequency = ini_file->ReadInt("General", "Frequency", frequency);
 	if (!esim::Engine::isValidFrequency(frequency))
@@ -287,6 +409,19 @@ void System::ParseConfiguration(misc::IniFile *ini_file)
 				ini_file->getPath().c_str(),
 				err_config_note));
 
+	// Address mapping
+	address_mapping = (AddressMapping) ini_file->ReadEnum("General",
+			"AddressMapping", AddressMappingMap,
+			AddressMappingChRaBaRoCo);
+	line_size = ini_file->ReadInt("General", "LineSize", line_size);
+	if (line_size < 1 || (line_size & (line_size - 1)))
+		throw Error(misc::fmt("%s: The value for 'LineSize' must be "
+				"a power of two.\n%s",
+				ini_file->getPath().c_str(),
+				err_config_note));
+	xor_bank_hashing = ini_file->ReadBool("General", "XorBankHashing",
+			false);
+
 	// Register frequency domain
 	esim::Engine *esim = esim::Engine::getInstance();
 	frequency_domain = esim->RegisterFrequencyDomain(
@@ -295,6 +430,10 @@ void System::ParseConfiguration(misc::IniFile *ini_file)
 	// Create events used by the entire system
 	event_command_return = esim->RegisterEvent("command_return",
 			Controller::CommandReturnHandler, frequency_domain);
+	event_refresh = esim->RegisterEvent("refresh",
+			Rank::RefreshHandler, frequency_domain);
+	event_sample = esim->RegisterEvent("sample",
+			SampleHandler, frequency_domain);
 
 	// Iterate through each section.
 	// Parse it if it is a MemoryController section.
@@ -314,13 +453,36 @@ void System::ParseConfiguration(misc::IniFile *ini_file)
 	ini_file->Check();
 
 	// All controllers and all the memory hierarchy under them has been
-	// made, so now calculate the sizes of address components.
+	// made, so now calculate the sizes of address components and the
+	// segments of the address mapping.
 	GenerateAddressSizes();
+	GenerateAddressSegments();
+
+	// Sample the queue occupancy periodically
+	if (report_interval)
+		esim->Call(event_sample, nullptr, nullptr, report_interval,
+				report_interval);
+}
+
+
+void System::SampleHandler(esim::Event *event, esim::Frame *frame)
+{
+	System *system = getInstance();
+	for (auto &controller : system->controllers)
+		for (int i = 0; i < controller->getNumChannels(); i++)
+			controller->getChannel(i)->SampleOccupancy();
 }
 
 
 void System::Run()
 {
+	// Trace-driven simulation
+	if (!trace_file.empty())
+	{
+		TraceSimulation(trace_file, trace_threads);
+		return;
+	}
+
 	// Get the simulation engine.
 	esim::Engine *engine = esim::Engine::getInstance();
 
@@ -332,6 +494,345 @@ void System::Run()
 }
 
 
+//
+// Trace-driven simulation
+//
+
+namespace
+{
+
+// Barrier aligning the host threads of a trace-driven simulation at the end
+// of their simulation, returning the latest cycle reached by any of them.
+class TraceBarrier
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	int num_threads;
+	int num_arrived = 0;
+	long long cycle = 0;
+
+public:
+
+	TraceBarrier(int num_threads) : num_threads(num_threads)
+	{
+	}
+
+	long long Wait(long long cycle)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		this->cycle = std::max(this->cycle, cycle);
+		if (++num_arrived == num_threads)
+			condition.notify_all();
+		else
+			condition.wait(lock, [this] {
+				return num_arrived == num_threads;
+			});
+		return this->cycle;
+	}
+};
+
+
+// Results of a channel in a trace-driven simulation
+struct TraceChannelResult
+{
+	std::string report;
+	long long num_reads = 0;
+	long long num_writes = 0;
+	long long num_row_hits = 0;
+	long long num_bytes = 0;
+	std::vector<long long> latency_histogram;
+	std::vector<long long> latency_log_histograms[LatencyComponentCount];
+	long long latency_sums[LatencyComponentCount] = {};
+};
+
+
+// State shared by the host threads of a trace-driven simulation
+struct TraceState
+{
+	const Trace *trace;
+	std::string config;
+	int num_threads;
+	TraceBarrier barrier;
+	long long cycle = 0;
+	std::vector<TraceChannelResult> results;
+	std::vector<std::exception_ptr> errors;
+
+	TraceState(const Trace *trace, const std::string &config,
+			int num_threads, int num_channels) :
+			trace(trace),
+			config(config),
+			num_threads(num_threads),
+			barrier(num_threads),
+			results(num_channels),
+			errors(num_threads)
+	{
+	}
+};
+
+}  // anonymous namespace
+
+
+// Save the report and statistics of a channel at the end of a trace-driven
+// simulation
+static void SaveTraceResult(TraceChannelResult &result, Channel *channel)
+{
+	std::ostringstream os;
+	channel->DumpReport(os);
+	result.report = os.str();
+	result.num_reads = channel->getNumReads();
+	result.num_writes = channel->getNumWrites();
+	result.num_row_hits = channel->getNumRowHits();
+	result.num_bytes = (result.num_reads + result.num_writes) *
+			channel->getController()->getRequestSize();
+	result.latency_histogram = channel->getLatencyHistogram();
+	for (int i = 0; i < LatencyComponentCount; i++)
+	{
+		LatencyComponent component = (LatencyComponent) i;
+		result.latency_log_histograms[i] =
+				channel->getLatencyLogHistogram(component);
+		result.latency_sums[i] = channel->getLatencySum(component);
+	}
+}
+
+
+// Simulate the channels of a trace owned by one host thread. Channels are
+// numbered across controllers, and thread 't' owns the channels whose
+// number modulo the number of threads is 't'. The first thread uses the
+// system already configured, while the others build their own from the same
+// configuration.
+static void TraceThread(TraceState *state, int thread_id)
+{
+	long long cycle = 0;
+	try
+	{
+		// Configure the system of this host thread
+		System *system = System::getInstance();
+		if (thread_id)
+		{
+			misc::IniFile ini_file;
+			ini_file.LoadFromString(state->config);
+			system->ParseConfiguration(&ini_file);
+		}
+
+		// First channel number of each controller
+		std::vector<int> first_channel;
+		int num_channels = 0;
+		for (int i = 0; i < system->getNumControllers(); i++)
+		{
+			first_channel.push_back(num_channels);
+			num_channels += system->getController(i)->getNumChannels();
+		}
+
+		// Issue the requests to the channels of this thread, in the
+		// cycles given in the trace
+		esim::Engine *engine = esim::Engine::getInstance();
+		const Trace *trace = state->trace;
+		long long num_issued = 0;
+		for (long long i = 0; i < trace->getNumRecords(); i++)
+		{
+			const Trace::Record &record = trace->getRecord(i);
+			Address address(record.address);
+			int channel = first_channel[address.getPhysical()] +
+					address.getLogical();
+			if (channel % state->num_threads != thread_id)
+				continue;
+
+			// Advance to the arrival cycle of the request
+			while (System::frequency_domain->getCycle() < record.cycle)
+				engine->ProcessEvents();
+
+			// Issue
+			if (record.type)
+				system->Write(record.address, record.source);
+			else
+				system->Read(record.address, record.source);
+			num_issued++;
+		}
+
+		// Run until all requests finished
+		while (true)
+		{
+			long long num_finished = 0;
+			for (int i = 0; i < system->getNumControllers(); i++)
+			{
+				Controller *controller = system->getController(i);
+				for (int j = 0; j < controller->getNumChannels(); j++)
+				{
+					Channel *channel = controller->getChannel(j);
+					num_finished += channel->getNumReads() +
+							channel->getNumWrites() -
+							channel->getNumPendingRequests();
+				}
+			}
+			if (num_finished == num_issued)
+				break;
+			engine->ProcessEvents();
+		}
+		cycle = System::frequency_domain->getCycle();
+	}
+	catch (...)
+	{
+		state->errors[thread_id] = std::current_exception();
+	}
+
+	// All threads end in the same cycle, so that the background energy
+	// of all channels is accounted for the same time.
+	cycle = state->barrier.Wait(cycle);
+	if (thread_id == 0)
+		state->cycle = cycle;
+	if (state->errors[thread_id])
+		return;
+
+	// Results of the channels of this thread
+	try
+	{
+		System *system = System::getInstance();
+		esim::Engine *engine = esim::Engine::getInstance();
+		while (System::frequency_domain->getCycle() < cycle)
+			engine->ProcessEvents();
+		int channel_id = 0;
+		for (int i = 0; i < system->getNumControllers(); i++)
+		{
+			Controller *controller = system->getController(i);
+			for (int j = 0; j < controller->getNumChannels(); j++)
+			{
+				if (channel_id % state->num_threads == thread_id)
+					SaveTraceResult(state->results[channel_id],
+							controller->getChannel(j));
+				channel_id++;
+			}
+		}
+	}
+	catch (...)
+	{
+		state->errors[thread_id] = std::current_exception();
+	}
+
+	// Systems of other threads are discarded with the thread
+	if (thread_id)
+	{
+		System::Destroy();
+		esim::Engine::Destroy();
+	}
+}
+
+
+void System::TraceSimulation(const std::string &path, int num_threads)
+{
+	// Load and check the trace
+	Trace trace(path);
+	trace.Check(getCapacity());
+
+	// Number of host threads. Debug logs are shared by all threads, so
+	// a single thread is used when they are active.
+	int num_channels = 0;
+	for (auto &controller : controllers)
+		num_channels += controller->getNumChannels();
+	if (num_threads <= 0)
+		num_threads = std::thread::hardware_concurrency();
+	num_threads = std::max(1, std::min(num_threads, num_channels));
+	if (debug || activity)
+		num_threads = 1;
+
+	// Simulate the channels, using the calling thread as the first one
+	misc::Timer timer("dram::TraceSimulation");
+	timer.Start();
+	TraceState state(&trace, config, num_threads, num_channels);
+	std::vector<std::thread> threads;
+	for (int i = 1; i < num_threads; i++)
+		threads.emplace_back(TraceThread, &state, i);
+	TraceThread(&state, 0);
+	for (std::thread &thread : threads)
+		thread.join();
+	timer.Stop();
+
+	// Report the first error
+	for (std::exception_ptr &error : state.errors)
+		if (error)
+			std::rethrow_exception(error);
+
+	// Merge the results of all channels
+	long long num_reads = 0;
+	long long num_writes = 0;
+	long long num_row_hits = 0;
+	long long num_bytes = 0;
+	std::vector<long long> latency_histogram;
+	std::vector<long long> latency_log_histograms[LatencyComponentCount];
+	long long latency_sums[LatencyComponentCount] = {};
+	for (TraceChannelResult &result : state.results)
+	{
+		num_reads += result.num_reads;
+		num_writes += result.num_writes;
+		num_row_hits += result.num_row_hits;
+		num_bytes += result.num_bytes;
+		if (latency_histogram.size() < result.latency_histogram.size())
+			latency_histogram.resize(result.latency_histogram.size());
+		for (unsigned i = 0; i < result.latency_histogram.size(); i++)
+			latency_histogram[i] += result.latency_histogram[i];
+		for (int i = 0; i < LatencyComponentCount; i++)
+		{
+			std::vector<long long> &histogram =
+					latency_log_histograms[i];
+			const std::vector<long long> &channel_histogram =
+					result.latency_log_histograms[i];
+			if (histogram.size() < channel_histogram.size())
+				histogram.resize(channel_histogram.size());
+			for (unsigned j = 0; j < channel_histogram.size(); j++)
+				histogram[j] += channel_histogram[j];
+			latency_sums[i] += result.latency_sums[i];
+		}
+	}
+	long long num_requests = num_reads + num_writes;
+	long long num_finished = 0;
+	long long accumulated_latency = 0;
+	for (unsigned latency = 0; latency < latency_histogram.size();
+			latency++)
+	{
+		num_finished += latency_histogram[latency];
+		accumulated_latency += latency_histogram[latency] * latency;
+	}
+
+	// Summary of the whole system, in MB/s and cycles
+	long long cycles = state.cycle;
+	double seconds = (double) timer.getValue() / 1e6;
+	std::ostringstream os;
+	os << "[ Trace ]\n";
+	os << "File = " << path << '\n';
+	os << misc::fmt("Records = %lld\n", trace.getNumRecords());
+	os << misc::fmt("Threads = %d\n", num_threads);
+	os << misc::fmt("Cycles = %lld\n", cycles);
+	os << misc::fmt("HostTime = %.4f\n", seconds);
+	os << misc::fmt("RecordsPerSecond = %.4g\n", seconds > 0 ?
+			trace.getNumRecords() / seconds : 0.0);
+	os << misc::fmt("Requests = %lld\n", num_requests);
+	os << misc::fmt("ReadRequests = %lld\n", num_reads);
+	os << misc::fmt("WriteRequests = %lld\n", num_writes);
+	os << misc::fmt("RowHitRate = %.4g\n", num_requests ?
+			(double) num_row_hits / num_requests : 0.0);
+	os << misc::fmt("TransferredBytes = %lld\n", num_bytes);
+	os << misc::fmt("Bandwidth = %.4f\n", cycles ?
+			(double) num_bytes * frequency / cycles : 0.0);
+	os << misc::fmt("AverageLatency = %.4f\n", num_finished ?
+			(double) accumulated_latency / num_finished : 0.0);
+	os << misc::fmt("LatencyP50 = %lld\n",
+			Channel::getPercentile(latency_histogram, 0.5));
+	os << misc::fmt("LatencyP90 = %lld\n",
+			Channel::getPercentile(latency_histogram, 0.9));
+	os << misc::fmt("LatencyP99 = %lld\n",
+			Channel::getPercentile(latency_histogram, 0.99));
+	os << misc::fmt("MaxLatency = %d\n", latency_histogram.empty() ?
+			0 : (int) latency_histogram.size() - 1);
+	Channel::DumpLatencyComponents(os, latency_log_histograms,
+			latency_sums, num_finished);
+	os << '\n';
+
+	// Channels, in the order of their controllers
+	for (TraceChannelResult &result : state.results)
+		os << result.report;
+	trace_report = os.str();
+}
+
+
 int System::getNextCommandId()
 {
 	next_command_id++;
@@ -343,6 +844,7 @@ void System::AddRequest(std::shared_ptr<Request> request)
 {
 	// Decode the address and move the request to the correct controller.
 	Address *address = request->getAddress();
+	request->setCycleArrival(frequency_domain->getCycle());
 	controllers[address->getPhysical()]->AddRequest(request);
 
 	// Debug
@@ -388,10 +890,96 @@ void System::GenerateAddressSizes()
 }
 
 
-void System::Read(long long address)
+void System::GenerateAddressSegments()
+{
+	// Components from the most to the least significant bits, given as
+	// the component, its number of bits, and their position in the
+	// component. Only the column is split, in cache-line interleaving.
+	struct Field
+	{
+		AddressField field;
+		int size;
+		int field_shift;
+	};
+	int line_bits = std::min(Log2(line_size), column_size);
+	std::vector<Field> fields;
+	switch (address_mapping)
+	{
+
+	case AddressMappingChRaBaRoCo:
+
+		fields = {
+			{ AddressPhysical, physical_size, 0 },
+			{ AddressLogical, logical_size, 0 },
+			{ AddressRank, rank_size, 0 },
+			{ AddressBank, bank_size, 0 },
+			{ AddressRow, row_size, 0 },
+			{ AddressColumn, column_size, 0 }
+		};
+		break;
+
+	case AddressMappingRoRaBaChCo:
+
+		fields = {
+			{ AddressRow, row_size, 0 },
+			{ AddressRank, rank_size, 0 },
+			{ AddressBank, bank_size, 0 },
+			{ AddressPhysical, physical_size, 0 },
+			{ AddressLogical, logical_size, 0 },
+			{ AddressColumn, column_size, 0 }
+		};
+		break;
+
+	case AddressMappingRoBaRaCoCh:
+
+		fields = {
+			{ AddressRow, row_size, 0 },
+			{ AddressBank, bank_size, 0 },
+			{ AddressRank, rank_size, 0 },
+			{ AddressColumn, column_size, 0 },
+			{ AddressPhysical, physical_size, 0 },
+			{ AddressLogical, logical_size, 0 }
+		};
+		break;
+
+	case AddressMappingCacheLine:
+
+		fields = {
+			{ AddressRow, row_size, 0 },
+			{ AddressColumn, column_size - line_bits, line_bits },
+			{ AddressRank, rank_size, 0 },
+			{ AddressBank, bank_size, 0 },
+			{ AddressPhysical, physical_size, 0 },
+			{ AddressLogical, logical_size, 0 },
+			{ AddressColumn, line_bits, 0 }
+		};
+		break;
+
+	default:
+
+		throw misc::Panic("Invalid address mapping");
+	}
+
+	// Create the segments from the least significant bits
+	address_segments.clear();
+	int shift = 0;
+	for (auto it = fields.rbegin(); it != fields.rend(); ++it)
+	{
+		if (!it->size)
+			continue;
+		address_segments.push_back({ it->field, shift,
+				(1LL << it->size) - 1, it->field_shift });
+		shift += it->size;
+	}
+}
+
+
+void System::Read(long long address, int core)
 {
 	if (address < 0 || address > getCapacity())
 		throw misc::Error("Invalid Address");
+	if (core < 0)
+		throw misc::Error("Invalid core");
 
 	// Create the request object that will be inserted into the queue.
 	std::shared_ptr<Request> request = std::make_shared<Request>();
@@ -399,8 +987,9 @@ void System::Read(long long address)
 	// Set the request's address
 	request->setEncodedAddress(address);
 
-	// Set the request's type.
+	// Set the request's type and core.
 	request->setType(RequestRead);
+	request->setCore(core);
 
 	// Add request to the system
 	System *dram = System::getInstance();
@@ -408,10 +997,12 @@ void System::Read(long long address)
 }
 
 
-void System::Write(long long address)
+void System::Write(long long address, int core)
 {
 	if (address < 0 || address > getCapacity())
 		throw misc::Error("Invalid Address");
+	if (core < 0)
+		throw misc::Error("Invalid core");
 
 	// Create the request object that will be inserted into the queue.
 	std::shared_ptr<Request> request = std::make_shared<Request>();
@@ -419,8 +1010,9 @@ void System::Write(long long address)
 	// Set the request's address
 	request->setEncodedAddress(address);
 
-	// Set the request's type.
+	// Set the request's type and core.
 	request->setType(RequestWrite);
+	request->setCore(core);
 
 	// Add request to the system
 	System *dram = System::getInstance();
@@ -428,6 +1020,36 @@ void System::Write(long long address)
 }
 
 
+void System::DumpReport(std::ostream &os)
+{
+	// Report of the trace-driven simulation, including its channels
+	if (!trace_report.empty())
+	{
+		os << trace_report;
+		return;
+	}
+
+	// Controllers
+	for (auto &controller : controllers)
+		controller->DumpReport(os);
+}
+
+
+void System::DumpReport()
+{
+	// Nothing to do if no report was requested
+	if (report_file.empty())
+		return;
+
+	// Open file
+	std::ofstream f(report_file);
+	if (!f)
+		throw Error(misc::fmt("%s: cannot open DRAM report file",
+				report_file.c_str()));
+	DumpReport(f);
+}
+
+
 void System::Dump(std::ostream &os) const
 {
 	
@@ -31,6 +31,7 @@
 #include <lib/esim/FrequencyDomain.h>
 #include <lib/esim/Event.h>
 
+#include "Address.h"
 
 namespace dram
 {
@@ -56,8 +57,10 @@ public:
 
 class System
 {
-	// Unique instance of this class
-	static std::unique_ptr<System> instance;
+	// Unique instance of this class in each host thread. Trace-driven
+	// simulations run groups of channels on separate host threads, each
+	// with its own instance of the system.
+	static thread_local std::unique_ptr<System> instance;
 
 	// Private constructor, used internally to instantiate a singleton. Use
 	// a call to getInstance() instead.
@@ -74,15 +77,37 @@ class System
 	int row_size = 0;
 	int column_size = 0;
 
+	// Address mapping scheme
+	AddressMapping address_mapping = AddressMappingChRaBaRoCo;
+
+	// Number of columns in a cache line, for cache-line interleaving
+	int line_size = 64;
+
+	// Whether the bank is XORed with the low bits of the row
+	bool xor_bank_hashing = false;
+
+	// Segments of an encoded address for the address mapping, from the
+	// least to the most significant bits
+	std::vector<AddressSegment> address_segments;
+
 	/// Frequency
-	static int frequency;
+	static thread_local int frequency;
 
 	// Stand-alone simulator instantiator
 	static bool stand_alone;
 
+	// Interval in cycles of the queue occupancy time series
+	static int report_interval;
+
 	// Message to display with '--net-help'
 	static const std::string help_message;
 
+	// Configuration the system was created with, in the IniFile format
+	std::string config;
+
+	// Report of the last trace-driven simulation
+	std::string trace_report;
+
 	// Counter of commands created in the system.  This serves to let every
 	// command have a unique id for logging purposes.
 	int next_command_id = -1;
@@ -94,6 +119,10 @@ class System
 	/// required to represent it.
 	void GenerateAddressSizes();
 
+	/// Computes the address segments for the address mapping scheme,
+	/// once the sizes of the address components are known.
+	void GenerateAddressSegments();
+
 public:
 
 	// Error messages
@@ -111,18 +140,37 @@ public:
 	/// Activity log
 	static misc::Debug activity;
 
-	// EventTypes and FrequencyDomains for DRAM
-	static esim::FrequencyDomain *frequency_domain;
-	static esim::Event *event_request;
-	static esim::Event *event_command_return;
+	// EventTypes and FrequencyDomains for DRAM, in the engine of the
+	// current host thread
+	static thread_local esim::FrequencyDomain *frequency_domain;
+	static thread_local esim::Event *event_command_return;
+	static thread_local esim::Event *event_refresh;
+	static thread_local esim::Event *event_sample;
 
 	/// Obtain the instance of the dram simulator singleton.
 	static System *getInstance();
 
+	/// Return whether the dram system has been instantiated.
+	static bool hasInstance() { return instance.get(); }
+
 	/// Returns a channel that belongs to this controller with the
 	/// specified id.
 	Controller *getController(int id) { return controllers[id].get(); }
 
+	/// Returns the number of memory controllers.
+	int getNumControllers() const { return controllers.size(); }
+
+	/// Returns the interval in cycles of the queue occupancy time series
+	/// of the report, or 0 if disabled.
+	static int getReportInterval() { return report_interval; }
+
+	/// Sets the interval in cycles of the queue occupancy time series of
+	/// the report. It applies to systems configured afterwards.
+	static void setReportInterval(int report_interval)
+	{
+		System::report_interval = report_interval;
+	}
+
 	/// Returns whether or not DRAM is running as a stand alone simulator.
 	static bool isStandAlone() { return stand_alone; }
 
@@ -144,6 +192,20 @@ public:
 	/// Returns the size in bits of the column address component.
 	int getColumnSize() const { return column_size; }
 
+	/// Returns the address mapping scheme.
+	AddressMapping getAddressMapping() const { return address_mapping; }
+
+	/// Returns whether the bank is XORed with the low bits of the row
+	/// when decoding an address.
+	bool getXorBankHashing() const { return xor_bank_hashing; }
+
+	/// Returns the segments of an encoded address for the address mapping
+	/// scheme, from the least to the most significant bits.
+	const std::vector<AddressSegment> &getAddressSegments() const
+	{
+		return address_segments;
+	}
+
 	/// Return the maximum address
 	int getCapacity();
 
@@ -160,9 +222,23 @@ public:
 	// file passed with '--dram-config'
 	void ReadConfiguration();
 
+	/// Event handler taking a sample of the queue occupancy of all
+	/// channels.
+	static void SampleHandler(esim::Event *, esim::Frame *);
+
 	/// Run the stand-alone DRAM simulation loop.
 	void Run();
 
+	/// Run a stand-alone simulation driven by the binary request trace in
+	/// the given file, with the record format described in Trace::Record.
+	/// Channels are distributed over the given number of host threads,
+	/// each with its own simulation engine and instance of the system,
+	/// where 0 uses one thread per host core. The results do not depend
+	/// on the number of threads, since channels do not interact. The
+	/// system must have been configured, and the engine must be at cycle
+	/// 0.
+	void TraceSimulation(const std::string &path, int num_threads);
+
 	/// Returns the next available unique command id.
 	int getNextCommandId();
 
@@ -195,11 +271,18 @@ public:
 		activity.setPrefix("[dram-activity]");
 	}
 
-	/// Send a read request to the dram device
-	void Read(long long address);
+	/// Send a read request to the dram device, issued by the given core.
+	void Read(long long address, int core = 0);
+
+	/// Send a write request to the dram device, issued by the given core.
+	void Write(long long address, int core = 0);
+
+	/// Dump the report of all memory controllers to an output stream.
+	void DumpReport(std::ostream &os);
 
-	/// Send a write request to the dram device
-	void Write(long long address);
+	/// Dump the report to the file given in option '--dram-report', if
+	/// any.
+	void DumpReport();
 
 	/// Dump the object to an output stream.
 	void Dump(std::ostream &os = std::cout) const;
@@ -53,6 +53,14 @@ void TimingParameters::ParseTiming(misc::IniFile *ini_file,
 	time_wr = ini_file->ReadInt(section, "tWR", 12);
 	time_rtp = ini_file->ReadInt(section, "tRTP", 6);
 	time_burst = ini_file->ReadInt(section, "tBURST", 4);
+
+	// Refresh interval, per-bank refresh cycle time, and exit latencies
+	// of the power-down and self-refresh states
+	time_refi = ini_file->ReadInt(section, "tREFI", 6240);
+	time_rfc_pb = ini_file->ReadInt(section, "tRFCpb", 64);
+	time_xp = ini_file->ReadInt(section, "tXP", 5);
+	time_xpdll = ini_file->ReadInt(section, "tXPDLL", 20);
+	time_xs = ini_file->ReadInt(section, "tXS", 136);
 }
 
 
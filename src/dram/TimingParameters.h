@@ -45,6 +45,11 @@ class TimingParameters
 	int time_wr;
 	int time_rtp;
 	int time_burst;
+	int time_refi;
+	int time_rfc_pb;
+	int time_xp;
+	int time_xpdll;
+	int time_xs;
 
 public:
 
@@ -72,6 +77,11 @@ public:
 	int getTimeWr() { return time_wr; }
 	int getTimeRtp() { return time_rtp; }
 	int getTimeBurst() { return time_burst; }
+	int getTimeRefi() { return time_refi; }
+	int getTimeRfcPb() { return time_rfc_pb; }
+	int getTimeXp() { return time_xp; }
+	int getTimeXpdll() { return time_xpdll; }
+	int getTimeXs() { return time_xs; }
 };
 
 }  // namespace dram
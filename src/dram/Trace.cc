@@ -0,0 +1,124 @@
+/*
+ * Multi2Sim
+ * Copyright (C) 2014 Agamemnon Despopoulos (agdespopoulos@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <lib/cpp/String.h>
+
+#include "System.h"
+#include "Trace.h"
+
+
+namespace dram
+{
+
+Trace::Trace(const std::string &path) :
+		path(path)
+{
+	// Open file
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw Error(misc::fmt("%s: cannot open request trace",
+				path.c_str()));
+
+	// Check size
+	struct stat st;
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		throw Error(misc::fmt("%s: cannot read request trace",
+				path.c_str()));
+	}
+	size = st.st_size;
+	if (size % sizeof(Record))
+	{
+		close(fd);
+		throw Error(misc::fmt("%s: truncated record in request trace "
+				"(%lld bytes, records of %d bytes)",
+				path.c_str(),
+				(long long) size,
+				(int) sizeof(Record)));
+	}
+
+	// An empty trace has no records, and cannot be mapped
+	if (!size)
+	{
+		close(fd);
+		return;
+	}
+
+	// Map file. The descriptor is not needed once the file is mapped.
+	data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		data = nullptr;
+		throw Error(misc::fmt("%s: cannot map request trace",
+				path.c_str()));
+	}
+
+	// Records are read sequentially
+	madvise(data, size, MADV_SEQUENTIAL);
+	records = (const Record *) data;
+	num_records = size / sizeof(Record);
+}
+
+
+Trace::~Trace()
+{
+	if (data)
+		munmap(data, size);
+}
+
+
+void Trace::Check(long long capacity) const
+{
+	long long cycle = 0;
+	for (long long i = 0; i < num_records; i++)
+	{
+		const Record &record = records[i];
+		if (record.cycle < cycle)
+			throw Error(misc::fmt("%s: record %lld: cycle %lld "
+					"is lower than the cycle of the previous "
+					"record (%lld)",
+					path.c_str(), i,
+					(long long) record.cycle, cycle));
+		if (record.type != 0 && record.type != 1)
+			throw Error(misc::fmt("%s: record %lld: invalid "
+					"request type (%d)",
+					path.c_str(), i, record.type));
+		if (record.source < 0 || record.source >= MaxSources)
+			throw Error(misc::fmt("%s: record %lld: invalid "
+					"source (%d), must be between 0 and %d",
+					path.c_str(), i, record.source,
+					MaxSources - 1));
+		if (record.address < 0 || record.address > capacity)
+			throw Error(misc::fmt("%s: record %lld: address "
+					"0x%llx out of range",
+					path.c_str(), i,
+					(long long) record.address));
+		cycle = record.cycle;
+	}
+}
+
+
+}  // namespace dram
@@ -0,0 +1,99 @@
+/*
+ * Multi2Sim
+ * Copyright (C) 2014 Agamemnon Despopoulos (agdespopoulos@gmail.com)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef DRAM_TRACE_H
+#define DRAM_TRACE_H
+
+#include <cstdint>
+#include <string>
+
+
+namespace dram
+{
+
+/// Binary request trace for the stand-alone DRAM simulator. The file is
+/// mapped in memory, so that records are streamed from it as the simulation
+/// advances, and shared by all host threads of the simulation.
+class Trace
+{
+public:
+
+	/// Record of a request trace. Records are stored in the file as
+	/// packed fields in host byte order: a 64-bit arrival cycle, a 64-bit
+	/// encoded address, a 32-bit request type (0 for reads, 1 for
+	/// writes), and a 32-bit source id, used as the core that issued the
+	/// request by thread-aware schedulers. Records are sorted by cycle.
+	struct Record
+	{
+		int64_t cycle;
+		int64_t address;
+		int32_t type;
+		int32_t source;
+	};
+
+	/// Maximum number of different sources in a trace. Source ids index
+	/// the per-core state of thread-aware schedulers, so they must be
+	/// lower than this value.
+	static const int MaxSources = 1024;
+
+private:
+
+	// Path of the trace file
+	std::string path;
+
+	// Mapped file
+	void *data = nullptr;
+	size_t size = 0;
+
+	// Records in the mapped file
+	const Record *records = nullptr;
+	long long num_records = 0;
+
+public:
+
+	/// Map a trace file in memory. Throws an error if the file cannot be
+	/// mapped or its size is not a multiple of the record size.
+	Trace(const std::string &path);
+
+	/// Destructor, unmapping the file
+	~Trace();
+
+	/// Return the path of the trace file
+	const std::string &getPath() const { return path; }
+
+	/// Return the number of records
+	long long getNumRecords() const { return num_records; }
+
+	/// Return the record with the given index
+	const Record &getRecord(long long index) const
+	{
+		return records[index];
+	}
+
+	/// Check that records are sorted by cycle, and have a valid type, a
+	/// source id between 0 and MaxSources - 1, and an address below the
+	/// given capacity. Throws an error describing the first invalid
+	/// record.
+	void Check(long long capacity) const;
+};
+
+
+}  // namespace dram
+
+#endif
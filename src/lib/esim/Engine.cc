@@ -30,7 +30,7 @@ namespace esim
 
 misc::Debug Engine::debug;
 
-std::unique_ptr<Engine> Engine::instance;
+thread_local std::unique_ptr<Engine> Engine::instance;
 
 const char *engine_err_finalization =
 	"The finalization process of the event-driven simulation is trying to "
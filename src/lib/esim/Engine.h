@@ -63,8 +63,10 @@ public:
 /// Event-driven simulator engine
 class Engine
 {
-	// Unique instance of this class
-	static std::unique_ptr<Engine> instance;
+	// Unique instance of this class in each host thread. Stand-alone
+	// simulators can run independent simulations on separate host
+	// threads, each with its own engine.
+	static thread_local std::unique_ptr<Engine> instance;
 
 	/// Debugger
 	static misc::Debug debug;
@@ -149,10 +151,11 @@ public:
 	// Constructor
 	Engine();
 
-	/// Obtain the instance of the event-driven simulator singleton.
+	/// Obtain the instance of the event-driven simulator singleton for
+	/// the current host thread.
 	static Engine *getInstance();
 
-	/// Destroy the singleton if allocated.
+	/// Destroy the singleton of the current host thread if allocated.
 	static void Destroy() { instance = nullptr; }
 
 	/// Force end of simulation with a specific reason.
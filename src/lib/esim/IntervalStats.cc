@@ -0,0 +1,220 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2014  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <climits>
+
+#include <lib/cpp/Error.h>
+#include <lib/cpp/Misc.h>
+#include <lib/cpp/String.h>
+
+#include "Engine.h"
+#include "IntervalStats.h"
+
+
+namespace esim
+{
+
+std::unique_ptr<IntervalStats> IntervalStats::instance;
+
+
+IntervalStats *IntervalStats::getInstance()
+{
+	// Instance already exists
+	if (instance.get())
+		return instance.get();
+
+	// Create instance
+	instance.reset(new IntervalStats());
+	return instance.get();
+}
+
+
+void IntervalStats::EventSampleHandler(Event *event, Frame *frame)
+{
+	// Periodic samples drained from the event heap after the simulation
+	// finished are ignored. The last interval is dumped by the end event.
+	IntervalStats *interval_stats = getInstance();
+	Engine *engine = Engine::getInstance();
+	if (event == interval_stats->event_sample && engine->hasFinished())
+		return;
+
+	// Take sample
+	interval_stats->Sample();
+}
+
+
+void IntervalStats::setPath(const std::string &path, long long interval)
+{
+	// Interval statistics must not have been activated yet
+	if (active)
+		throw misc::Panic("Interval statistics already active");
+
+	// Check valid interval
+	if (interval < 1 || interval > INT_MAX)
+		throw misc::Error(misc::fmt("%lld: invalid interval for "
+				"interval statistics", interval));
+
+	// Open file
+	file.open(path);
+	if (!file)
+		throw misc::Error(misc::fmt("%s: cannot open interval "
+				"statistics file", path.c_str()));
+
+	// Save values
+	this->path = path;
+	this->interval = interval;
+	active = true;
+}
+
+
+void IntervalStats::AddColumn(const std::string &name,
+		ColumnKind kind,
+		Getter getter,
+		FrequencyDomain *frequency_domain)
+{
+	// Ignore if not active
+	if (!active)
+		return;
+
+	// Columns cannot be added once the header was dumped
+	if (started)
+		throw misc::Panic(misc::fmt("%s: column registered after "
+				"interval statistics started", name.c_str()));
+
+	// Add column
+	columns.emplace_back();
+	Column &column = columns.back();
+	column.name = name;
+	column.kind = kind;
+	column.getter = getter;
+	column.frequency_domain = frequency_domain;
+}
+
+
+void IntervalStats::RegisterCounter(const std::string &name, Getter getter)
+{
+	AddColumn(name, ColumnCounter, getter);
+}
+
+
+void IntervalStats::RegisterGauge(const std::string &name, Getter getter)
+{
+	AddColumn(name, ColumnGauge, getter);
+}
+
+
+void IntervalStats::RegisterRate(const std::string &name, Getter getter,
+		FrequencyDomain *frequency_domain)
+{
+	assert(frequency_domain);
+	AddColumn(name, ColumnRate, getter, frequency_domain);
+}
+
+
+void IntervalStats::Start()
+{
+	// Ignore if not active or already started
+	if (!active || started)
+		return;
+	started = true;
+
+	// Header
+	file << "Cycle";
+	for (Column &column : columns)
+		file << ',' << column.name;
+	file << '\n';
+
+	// Initial values
+	Engine *engine = Engine::getInstance();
+	last_cycle = engine->getCycle();
+	for (Column &column : columns)
+	{
+		column.last_value = column.getter();
+		if (column.frequency_domain)
+			column.last_cycle = column.frequency_domain->getCycle();
+	}
+
+	// Create a frequency domain running at the frequency of the fastest
+	// domain, so that the interval is given in global cycles.
+	frequency_domain = engine->RegisterFrequencyDomain("IntervalStats",
+			engine->getFrequency());
+	event_sample = engine->RegisterEvent("interval_stats_sample",
+			EventSampleHandler,
+			frequency_domain);
+	event_sample_end = engine->RegisterEvent("interval_stats_sample_end",
+			EventSampleHandler);
+
+	// Schedule periodic sample, and a last sample at the end
+	engine->Call(event_sample, nullptr, nullptr, interval, interval);
+	engine->EndEvent(event_sample_end);
+}
+
+
+void IntervalStats::Sample()
+{
+	// Skip if no cycles elapsed since the last sample
+	Engine *engine = Engine::getInstance();
+	long long cycle = engine->getCycle();
+	if (cycle <= last_cycle)
+		return;
+	last_cycle = cycle;
+
+	// Dump row
+	file << cycle;
+	for (Column &column : columns)
+	{
+		long long value = column.getter();
+		switch (column.kind)
+		{
+
+		case ColumnCounter:
+
+			file << ',' << value - column.last_value;
+			break;
+
+		case ColumnGauge:
+
+			file << ',' << value;
+			break;
+
+		case ColumnRate:
+		{
+			long long column_cycle =
+					column.frequency_domain->getCycle();
+			long long cycles = column_cycle - column.last_cycle;
+			file << misc::fmt(",%.4g", cycles ?
+					(double) (value - column.last_value)
+					/ cycles : 0.0);
+			column.last_cycle = column_cycle;
+			break;
+		}
+
+		default:
+
+			throw misc::Panic("Invalid column kind");
+		}
+
+		// Save last value
+		column.last_value = value;
+	}
+	file << '\n';
+}
+
+
+}  // namespace esim
@@ -0,0 +1,171 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2014  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LIB_CPP_ESIM_INTERVAL_STATS_H
+#define LIB_CPP_ESIM_INTERVAL_STATS_H
+
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace esim
+{
+
+// Forward declarations
+class Event;
+class Frame;
+class FrequencyDomain;
+
+
+/// Periodic sampling of simulation statistics. Timing models register the
+/// counters they want to expose as columns, and every given number of cycles
+/// a row is dumped into a CSV file with the values of all columns. When the
+/// interval statistics are not activated with setPath(), registering columns
+/// has no effect and no event is ever scheduled, so the cost for the rest of
+/// the simulation is zero.
+class IntervalStats
+{
+public:
+
+	/// Signature of the functions returning the current value of a column
+	typedef std::function<long long()> Getter;
+
+private:
+
+	// Kind of column
+	enum ColumnKind
+	{
+		ColumnInvalid = 0,
+		ColumnCounter,
+		ColumnGauge,
+		ColumnRate
+	};
+
+	// Column of the output file
+	struct Column
+	{
+		// Column name as printed in the header
+		std::string name;
+
+		// Column kind
+		ColumnKind kind = ColumnInvalid;
+
+		// Function returning the current value of the statistic
+		Getter getter;
+
+		// For rates, frequency domain providing the cycles that the
+		// delta of the statistic is divided by.
+		FrequencyDomain *frequency_domain = nullptr;
+
+		// Values of the statistic and of the cycle in its frequency
+		// domain in the last sample.
+		long long last_value = 0;
+		long long last_cycle = 0;
+	};
+
+	// Unique instance of this class
+	static std::unique_ptr<IntervalStats> instance;
+
+	// Event handler for the periodic sampling event
+	static void EventSampleHandler(Event *event, Frame *frame);
+
+	// Path of the output file
+	std::string path;
+
+	// Output file
+	std::ofstream file;
+
+	// Sampling interval in cycles of the fastest frequency domain
+	long long interval = 0;
+
+	// Flag indicating whether the interval statistics are active
+	bool active = false;
+
+	// Flag indicating whether sampling has started
+	bool started = false;
+
+	// Registered columns
+	std::vector<Column> columns;
+
+	// Cycle of the last sample taken
+	long long last_cycle = 0;
+
+	// Periodic sampling event
+	Event *event_sample = nullptr;
+
+	// Event scheduled for the end of the simulation to dump the last,
+	// possibly partial, interval.
+	Event *event_sample_end = nullptr;
+
+	// Frequency domain for the sampling events
+	FrequencyDomain *frequency_domain = nullptr;
+
+	// Add a column of the given kind
+	void AddColumn(const std::string &name,
+			ColumnKind kind,
+			Getter getter,
+			FrequencyDomain *frequency_domain = nullptr);
+
+public:
+
+	/// Return the unique instance of the interval statistics.
+	static IntervalStats *getInstance();
+
+	/// Activate interval statistics, setting the output file and the
+	/// sampling interval in cycles of the fastest frequency domain.
+	void setPath(const std::string &path, long long interval);
+
+	/// Return whether interval statistics were activated by the user
+	bool isActive() const { return active; }
+
+	/// Return the sampling interval in cycles
+	long long getInterval() const { return interval; }
+
+	/// Register a monotonically increasing counter. The value dumped in
+	/// every row is the increment of the counter since the last sample.
+	void RegisterCounter(const std::string &name, Getter getter);
+
+	/// Register a gauge, whose instantaneous value is dumped in every row
+	/// (e.g., the occupancy of a structure).
+	void RegisterGauge(const std::string &name, Getter getter);
+
+	/// Register a rate. The value dumped in every row is the increment of
+	/// the counter since the last sample, divided by the number of cycles
+	/// elapsed in \a frequency_domain (e.g., instructions per cycle).
+	void RegisterRate(const std::string &name, Getter getter,
+			FrequencyDomain *frequency_domain);
+
+	/// Dump the header of the output file and schedule the periodic
+	/// sampling event. This function must be invoked after all timing
+	/// models have been configured and their columns registered. It has no
+	/// effect if interval statistics are not active.
+	void Start();
+
+	/// Dump a row with the values of all columns for the interval elapsed
+	/// since the last sample.
+	void Sample();
+};
+
+
+}  // namespace esim
+
+#endif
@@ -54,6 +54,7 @@
 #include <lib/cpp/Misc.h>
 #include <lib/cpp/Terminal.h>
 #include <lib/esim/Engine.h>
+#include <lib/esim/IntervalStats.h>
 #include <lib/esim/Trace.h>
 
 extern "C"
@@ -79,6 +80,12 @@ std::string m2s_debug_inifile;
 // Call stack debugger
 std::string m2s_debug_callstack;
 
+// Interval statistics file
+std::string m2s_interval_stats_file;
+
+// Interval statistics sampling period in cycles
+long long m2s_interval_stats_cycles = 10000;
+
 // Maximum simulation time
 long long m2s_max_time = 0;
 
@@ -292,6 +299,24 @@ void RegisterOptions()
 			"Dump debug information about all processed INI files "
 			"into the specified path.");
 	
+	// Interval statistics
+	command_line->RegisterString("--interval-stats <file>",
+			m2s_interval_stats_file,
+			"Dump time-series statistics into a CSV file, with one "
+			"row for every interval of cycles given in option "
+			"'--interval-stats-cycles'. Columns include hits, "
+			"misses, evictions, and MSHR occupancy for each memory "
+			"module, IPC for each x86 core, and utilization for "
+			"each network link. Each row contains the increments "
+			"of the counters during the last interval.");
+
+	// Interval for interval statistics
+	command_line->RegisterInt64("--interval-stats-cycles <cycles> "
+			"(default = 10000)",
+			m2s_interval_stats_cycles,
+			"Sampling period in cycles for the statistics dumped "
+			"with option '--interval-stats'.");
+	
 	// Maximum simulation time
 	command_line->RegisterInt64("--max-time <time> (default = 0)",
 			m2s_max_time,
@@ -404,6 +429,15 @@ void ProcessOptions()
 	if (!m2s_opencl_binary.empty())
 		environment->addVariable("M2S_OPENCL_BINARY", m2s_opencl_binary);
 
+	// Interval statistics
+	if (!m2s_interval_stats_file.empty())
+	{
+		esim::IntervalStats *interval_stats =
+				esim::IntervalStats::getInstance();
+		interval_stats->setPath(m2s_interval_stats_file,
+				m2s_interval_stats_cycles);
+	}
+
 	// Trace file
 	if (!m2s_trace_file.empty())
 	{
@@ -563,6 +597,16 @@ void DumpReports()
 		mem_system->DumpReport();
 	}
 
+	// Dumping memory manager report
+	mem::Manager::DumpReport();
+
+	// Dumping DRAM report
+	if (dram::System::hasInstance())
+	{
+		dram::System *dram_system = dram::System::getInstance();
+		dram_system->DumpReport();
+	}
+
 	// Dumping network report
 	if (net::System::hasInstance())
 	{
@@ -676,6 +720,9 @@ int MainProgram(int argc, char **argv)
 		// Parse the memory configuration file
 		mem::System *memory_system = mem::System::getInstance();
 		memory_system->ReadConfiguration();
+
+		// Start sampling interval statistics
+		esim::IntervalStats::getInstance()->Start();
 	}
 
 	// Initialize network system, only if the option --net-sim is used
@@ -683,6 +730,7 @@ int MainProgram(int argc, char **argv)
 	{
 		net::System *net_system = net::System::getInstance();
 		net_system->ReadConfiguration();
+		esim::IntervalStats::getInstance()->Start();
 		net_system->StandAlone();
 	}
 
@@ -17,7 +17,12 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <cstdint>
+#include <cstring>
+
 #include "Cache.h"
+#include "Memory.h"
+#include "Mmu.h"
 #include "System.h"
 
 
@@ -50,6 +55,57 @@ const misc::StringMap Cache::BlockStateMap =
 };
 
 
+const misc::StringMap Cache::CompressionMap =
+{
+	{ "None", CompressionNone },
+	{ "BDI", CompressionBDI },
+	{ "FPC", CompressionFPC }
+};
+
+
+// Return whether a signed value can be represented in the given number of
+// bytes.
+static bool FitsInBytes(long long value, unsigned bytes)
+{
+	if (bytes >= 8)
+		return true;
+	long long limit = 1ll << (bytes * 8 - 1);
+	return value >= -limit && value < limit;
+}
+
+
+// Read a sign-extended little-endian value of 2, 4, or 8 bytes
+static long long ReadValue(const char *data, unsigned bytes)
+{
+	switch (bytes)
+	{
+	case 2:
+	{
+		int16_t value;
+		memcpy(&value, data, sizeof value);
+		return value;
+	}
+
+	case 4:
+	{
+		int32_t value;
+		memcpy(&value, data, sizeof value);
+		return value;
+	}
+
+	case 8:
+	{
+		int64_t value;
+		memcpy(&value, data, sizeof value);
+		return value;
+	}
+
+	default:
+		throw misc::Panic("Invalid value size");
+	}
+}
+
+
 Cache::Cache(const std::string &name,
 		unsigned num_sets,
 		unsigned num_ways,
@@ -155,6 +211,34 @@ void Cache::setBlock(unsigned set_id,
 		set->lru_list.PushFront(block->lru_node);
 	}
 
+	// Update the space occupied by the block in the data array of a
+	// compressed cache. Statistics on the compressed size are recorded
+	// every time a new block is brought to the cache.
+	if (compression != CompressionNone)
+	{
+		bool was_valid = block->state != BlockInvalid;
+		bool valid = state != BlockInvalid;
+		unsigned size = valid ? getCompressedSize(tag) : 0;
+		num_valid_blocks += valid - was_valid;
+		if (valid && (!was_valid || block->tag != tag))
+		{
+			num_compressed_fills++;
+			num_compressed_fill_bytes += size;
+			num_valid_blocks_sum += num_valid_blocks;
+		}
+
+		// A valid block releases the space reserved for it. Count the
+		// update as an overflow if the set now needs more space than
+		// available in its data array. The tag-level coherence
+		// protocol can only evict one block per miss, so the overflow
+		// is tolerated and accounted for.
+		unsigned old_used_size = set->used_size;
+		setBlockSize(set, block, size, valid ? 0 : block->reserved_size);
+		if (set->used_size > old_used_size &&
+				set->used_size > set_data_size)
+			num_overflows++;
+	}
+
 	// Set new values for block
 	block->tag = tag;
 	block->state = state;
@@ -223,5 +307,299 @@ unsigned Cache::ReplaceBlock(unsigned set_id)
 }
 
 
+unsigned Cache::ReplaceBlock(unsigned set_id, unsigned tag)
+{
+	// Only LRU and FIFO are size-aware in a compressed cache
+	if (compression == CompressionNone ||
+			replacement_policy == ReplacementRandom)
+		return ReplaceBlock(set_id);
+
+	// Space needed by the incoming block, and space currently free
+	Set *set = getSet(set_id);
+	unsigned size = getCompressedSize(tag);
+	unsigned free_size = set->used_size < set_data_size ?
+			set_data_size - set->used_size : 0;
+
+	// Traverse the set from the most to the least recently used block,
+	// keeping the last one whose eviction leaves enough space for the
+	// incoming block. An invalid tag entry qualifies only if the free space
+	// is already enough.
+	Block *victim = nullptr;
+	for (Block *block : set->lru_list)
+		if (std::max(block->size, block->reserved_size) +
+				free_size >= size)
+			victim = block;
+
+	// If no victim frees enough space, fall back to the least recently
+	// used block. The overflow is accounted for once the new block is set.
+	if (!victim)
+		victim = misc::cast<Block *>(set->lru_list.Back());
+	assert(victim);
+
+	// Reserve space for the incoming block, and move the victim to the
+	// head to avoid making it a candidate in the next call.
+	setBlockSize(set, victim, victim->size, size);
+	set->lru_list.Erase(victim->lru_node);
+	set->lru_list.PushFront(victim->lru_node);
+	return victim->way_id;
+}
+
+
+void Cache::setCompression(Compression compression,
+		unsigned set_data_size,
+		int decompression_latency)
+{
+	assert(compression != CompressionInvalid);
+	assert(set_data_size >= block_size);
+	assert(decompression_latency >= 0);
+	this->compression = compression;
+	this->set_data_size = set_data_size;
+	this->decompression_latency = decompression_latency;
+}
+
+
+int Cache::getDecompressionLatency(unsigned set_id, unsigned way_id)
+{
+	// Blocks stored uncompressed are read directly
+	Block *block = getBlock(set_id, way_id);
+	if (compression == CompressionNone || block->size >= block_size)
+		return 0;
+	
+	// Statistics
+	num_decompressions++;
+	return decompression_latency;
+}
+
+
+unsigned Cache::getCompressedSize(unsigned tag) const
+{
+	// Find the virtual address space and functional memory holding the
+	// block. Blocks whose contents are unknown are stored uncompressed.
+	Mmu::Space *space;
+	unsigned virtual_address;
+	if (!mmu || !mmu->TranslatePhysicalAddress(tag, space,
+			virtual_address))
+		return block_size;
+	std::shared_ptr<Memory> memory = space->getMemory();
+	if (!memory)
+		return block_size;
+
+	// Get block contents. A page with no data allocated was never written
+	// and reads as zeros.
+	assert(block_size <= Memory::PageSize);
+	Memory::Page *page = memory->getPage(virtual_address);
+	if (!page)
+		return block_size;
+	const char *data = page->getData();
+	static const char zeros[Memory::PageSize] = { };
+	data = data ? data + (virtual_address & (Memory::PageSize - 1)) :
+			zeros;
+
+	// Compress
+	switch (compression)
+	{
+	case CompressionBDI:
+
+		return getBDISize(data, block_size);
+
+	case CompressionFPC:
+
+		return getFPCSize(data, block_size);
+
+	default:
+
+		return block_size;
+	}
+}
+
+
+void Cache::setBlockSize(Set *set,
+		Block *block,
+		unsigned size,
+		unsigned reserved_size)
+{
+	unsigned old_used_size = std::max(block->size, block->reserved_size);
+	unsigned used_size = std::max(size, reserved_size);
+	assert(set->used_size >= old_used_size);
+	set->used_size = set->used_size - old_used_size + used_size;
+	num_valid_bytes += (long long) size - block->size;
+	block->size = size;
+	block->reserved_size = reserved_size;
+}
+
+
+unsigned Cache::getBDISize(const char *data, unsigned size)
+{
+	// A block of zeros is compressed into a single byte
+	unsigned index;
+	for (index = 0; index < size; index++)
+		if (data[index])
+			break;
+	if (index == size)
+		return 1;
+
+	// A block of repeated 8-byte values is compressed into one value
+	if (size % 8 == 0)
+	{
+		for (index = 8; index < size; index++)
+			if (data[index] != data[index % 8])
+				break;
+		if (index == size)
+			return 8;
+	}
+
+	// Try all combinations of base and delta sizes, keeping the best one.
+	// Each value is encoded as a delta either from an implicit zero base
+	// (immediate) or from an explicit base, which is the first value that
+	// cannot be encoded as an immediate. One bit per value selects the
+	// base.
+	static const unsigned configs[][2] =
+	{
+		{ 8, 1 }, { 8, 2 }, { 8, 4 },
+		{ 4, 1 }, { 4, 2 },
+		{ 2, 1 }
+	};
+	unsigned best_size = size;
+	for (auto &config : configs)
+	{
+		// Block must contain a whole number of values
+		unsigned base_size = config[0];
+		unsigned delta_size = config[1];
+		if (size % base_size)
+			continue;
+
+		// Check that all values can be encoded
+		unsigned num_values = size / base_size;
+		bool has_base = false;
+		long long base = 0;
+		bool compressible = true;
+		for (index = 0; index < num_values && compressible; index++)
+		{
+			long long value = ReadValue(data + index * base_size,
+					base_size);
+			if (FitsInBytes(value, delta_size))
+				continue;
+			if (!has_base)
+			{
+				has_base = true;
+				base = value;
+				continue;
+			}
+			long long delta = (long long) ((unsigned long long) value
+					- (unsigned long long) base);
+			compressible = FitsInBytes(delta, delta_size);
+		}
+		if (!compressible)
+			continue;
+
+		// Base, deltas, and base selection bit mask
+		unsigned compressed_size = base_size +
+				num_values * delta_size +
+				(num_values + 7) / 8;
+		best_size = std::min(best_size, compressed_size);
+	}
+
+	// Done
+	return best_size;
+}
+
+
+unsigned Cache::getFPCSize(const char *data, unsigned size)
+{
+	// Each 32-bit word is encoded with a 3-bit prefix followed by a
+	// variable number of bits, depending on the pattern it matches.
+	unsigned num_words = size / 4;
+	unsigned num_bits = 0;
+	unsigned index = 0;
+	while (index < num_words)
+	{
+		int32_t word;
+		memcpy(&word, data + index * 4, sizeof word);
+		index++;
+
+		// Run of up to 8 zero words
+		if (!word)
+		{
+			unsigned run_length = 1;
+			while (index < num_words && run_length < 8)
+			{
+				int32_t next_word;
+				memcpy(&next_word, data + index * 4,
+						sizeof next_word);
+				if (next_word)
+					break;
+				index++;
+				run_length++;
+			}
+			num_bits += 3 + 3;
+			continue;
+		}
+
+		// Halfwords and bytes of the word
+		int16_t low_halfword = word;
+		int16_t high_halfword = word >> 16;
+		uint8_t byte = word;
+		bool repeated_bytes = ((uint32_t) word ==
+				byte * 0x01010101u);
+
+		// Sign-extended 4-bit, 8-bit, and 16-bit values, halfword padded
+		// with a zero halfword, two halfwords consisting each of a
+		// sign-extended byte, word of repeated bytes, or uncompressed.
+		if (word >= -8 && word < 8)
+			num_bits += 3 + 4;
+		else if (word >= -128 && word < 128)
+			num_bits += 3 + 8;
+		else if (word >= -32768 && word < 32768)
+			num_bits += 3 + 16;
+		else if (!low_halfword)
+			num_bits += 3 + 16;
+		else if (FitsInBytes(low_halfword, 1) &&
+				FitsInBytes(high_halfword, 1))
+			num_bits += 3 + 16;
+		else if (repeated_bytes)
+			num_bits += 3 + 8;
+		else
+			num_bits += 3 + 32;
+	}
+
+	// Round up to bytes
+	return std::min(size, (num_bits + 7) / 8);
+}
+
+
+void Cache::DumpCompressionReport(std::ostream &os) const
+{
+	// Nothing if compression is disabled
+	if (compression == CompressionNone)
+		return;
+
+	// Effective capacity is the average number of valid blocks at the
+	// time of a fill, relative to the number of uncompressed blocks that
+	// fit in the data arrays.
+	unsigned num_data_blocks = set_data_size / block_size * num_sets;
+	double average_valid_blocks = num_compressed_fills ?
+			(double) num_valid_blocks_sum / num_compressed_fills :
+			0.0;
+	os << misc::fmt("Compression = %s\n", CompressionMap[compression]);
+	os << misc::fmt("DataBlocks = %u\n", num_data_blocks);
+	os << misc::fmt("DecompressionLatency = %d\n",
+			decompression_latency);
+	os << misc::fmt("CompressedFills = %lld\n", num_compressed_fills);
+	os << misc::fmt("CompressionRatio = %.4g\n",
+			num_compressed_fill_bytes ?
+			(double) num_compressed_fills * block_size /
+			num_compressed_fill_bytes : 0.0);
+	os << misc::fmt("AverageValidBlocks = %.4g\n", average_valid_blocks);
+	os << misc::fmt("EffectiveCapacity = %.4g\n",
+			average_valid_blocks / num_data_blocks);
+	os << misc::fmt("ValidBlocks = %lld\n", num_valid_blocks);
+	os << misc::fmt("ValidBytes = %lld\n", num_valid_bytes);
+	os << misc::fmt("Overflows = %lld\n", num_overflows);
+	os << misc::fmt("Decompressions = %lld\n", num_decompressions);
+	os << misc::fmt("DecompressionCycles = %lld\n",
+			num_decompressions * decompression_latency);
+}
+
+
 }  // namespace mem
 
@@ -20,6 +20,7 @@
 #ifndef MEMORY_CACHE_H
 #define MEMORY_CACHE_H
 
+#include <iostream>
 #include <memory>
 
 #include <lib/cpp/List.h>
@@ -29,6 +30,10 @@
 namespace mem
 {
 
+// Forward declarations
+class Mmu;
+
+
 class Cache
 {
 public:
@@ -70,6 +75,18 @@ public:
 	/// String map for BlockState
 	static const misc::StringMap BlockStateMap;
 
+	/// Possible values for the block compression algorithm
+	enum Compression
+	{
+		CompressionInvalid,
+		CompressionNone,
+		CompressionBDI,
+		CompressionFPC
+	};
+
+	/// String map for Compression
+	static const misc::StringMap CompressionMap;
+
 	/// Cache block. This class is a child of misc::List::Node because one
 	/// block will belong to one set's LRU list. See documentation of
 	/// misc::List::Node for details.
@@ -90,6 +107,16 @@ public:
 		// Block state
 		BlockState state = BlockInvalid;
 
+		// Size in bytes that the block occupies in the data array of a
+		// compressed cache, or 0 if the block is invalid.
+		unsigned size = 0;
+
+		// Space in the data array reserved for an incoming block that
+		// selected this block as a victim, until the incoming block is
+		// set. This prevents concurrent misses in the same set from
+		// claiming the same free space.
+		unsigned reserved_size = 0;
+
 		// The block belongs to an LRU list
 		misc::List<Block>::Node lru_node;
 	
@@ -112,6 +139,10 @@ public:
 		/// Get the block state
 		BlockState getState() const { return state; }
 
+		/// Get the size that the block occupies in the data array of a
+		/// compressed cache.
+		unsigned getSize() const { return size; }
+
 		/// Set new state and tag
 		void setStateTag(BlockState state, unsigned tag)
 		{
@@ -133,6 +164,10 @@ private:
 
 		// Position in Cache::blocks where the blocks start for this set
 		Block *blocks;
+
+		// Bytes of the data array occupied by valid blocks in a
+		// compressed cache.
+		unsigned used_size = 0;
 	};
 
 	// Name of the cache, used for debugging purposes
@@ -164,6 +199,46 @@ private:
 	// Array of blocks
 	std::unique_ptr<Block[]> blocks;
 
+	// Compression algorithm
+	Compression compression = CompressionNone;
+
+	// Size in bytes of the data array of each set when compression is
+	// enabled. Tags and data are decoupled, so that the number of tags in
+	// a set (num_ways) can exceed the number of uncompressed blocks that
+	// fit in its data array.
+	unsigned set_data_size = 0;
+
+	// Extra latency to read a compressed block
+	int decompression_latency = 0;
+
+	// Memory management unit used to read the contents of a block from
+	// its physical address, or null if not available.
+	Mmu *mmu = nullptr;
+
+	// Number of valid blocks and data bytes across all sets
+	long long num_valid_blocks = 0;
+	long long num_valid_bytes = 0;
+
+	// Compression statistics
+	long long num_compressed_fills = 0;
+	long long num_compressed_fill_bytes = 0;
+	long long num_valid_blocks_sum = 0;
+	long long num_overflows = 0;
+	long long num_decompressions = 0;
+
+	// Return the size that the block with the given tag (physical block
+	// address) would occupy in the data array, as per the contents of the
+	// functional memory.
+	unsigned getCompressedSize(unsigned tag) const;
+
+	// Update the size of a block and the space reserved in its data array
+	// for an incoming block. The space occupied in the data array is the
+	// maximum of both.
+	void setBlockSize(Set *set,
+			Block *block,
+			unsigned size,
+			unsigned reserved_size);
+
 	/// Return a pointer to a cache set
 	Set *getSet(unsigned set_id)
 	{
@@ -281,6 +356,50 @@ public:
 	/// as per the current block replacement policy.
 	unsigned ReplaceBlock(unsigned set_id);
 
+	/// Return the way index of the block to be replaced in the given set
+	/// to make room for the block with tag \a tag. In a compressed cache,
+	/// the victim is the least recently used block whose eviction frees
+	/// enough space in the data array for the incoming block. Otherwise,
+	/// this is equivalent to ReplaceBlock(set_id).
+	unsigned ReplaceBlock(unsigned set_id, unsigned tag);
+
+	/// Enable block compression.
+	///
+	/// \param compression
+	///	Compression algorithm.
+	///
+	/// \param set_data_size
+	///	Size in bytes of the data array of each set.
+	///
+	/// \param decompression_latency
+	///	Extra latency in cycles to read a compressed block.
+	///
+	void setCompression(Compression compression,
+			unsigned set_data_size,
+			int decompression_latency);
+
+	/// Set the memory management unit used to obtain the contents of a
+	/// block from its physical address, in order to compute its compressed
+	/// size.
+	void setMmu(Mmu *mmu) { this->mmu = mmu; }
+
+	/// Return the extra latency incurred when reading the given block. This
+	/// is the decompression latency for blocks stored in compressed form,
+	/// or 0 otherwise.
+	int getDecompressionLatency(unsigned set_id, unsigned way_id);
+
+	/// Return the size of a block compressed with the base-delta-immediate
+	/// algorithm, or \a size if the block is not compressible.
+	static unsigned getBDISize(const char *data, unsigned size);
+
+	/// Return the size of a block compressed with the frequent pattern
+	/// compression algorithm, or \a size if the block is not
+	/// compressible.
+	static unsigned getFPCSize(const char *data, unsigned size);
+
+	/// Dump compression statistics into an output stream
+	void DumpCompressionReport(std::ostream &os) const;
+
 	/// Set the transient tag of a block.
 	void setTransientTag(unsigned set_id, unsigned way_id, unsigned tag)
 	{
@@ -312,6 +431,12 @@ public:
 	/// Return the write policy
 	WritePolicy getWritePolicy() const { return write_policy; }
 
+	/// Return the compression algorithm
+	Compression getCompression() const { return compression; }
+
+	/// Return the memory management unit, as set by setMmu()
+	Mmu *getMmu() const { return mmu; }
+
 	/// Return a mask used to extract the bits corresponding to the block
 	/// offset of an address.
 	unsigned getBlockMask() const { return block_mask; }
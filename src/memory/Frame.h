@@ -224,6 +224,10 @@ public:
 	// of a block
 	bool partial_invalidation = false;
 
+	/// Write requests of an invalidation to be sent to the sharers of
+	/// each sub-block in a single multicast message, sorted by address
+	std::list<std::shared_ptr<Frame>> multicast_frames;
+
 
 
 	//
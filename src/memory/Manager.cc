@@ -17,7 +17,9 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <chrono>
 #include <cmath>
+#include <fstream>
 
 #include <lib/cpp/String.h>
 
@@ -26,8 +28,23 @@
 namespace mem
 {
 
-Manager::Manager(Memory *memory)
+const misc::StringMap Manager::AllocatorMap =
 {
+	{ "FirstFit", AllocatorFirstFit },
+	{ "Segregated", AllocatorSegregated }
+};
+
+
+Manager::Manager(Memory *memory) :
+		Manager(memory, (Allocator) default_allocator)
+{
+}
+
+
+Manager::Manager(Memory *memory, Allocator allocator) :
+		allocator(allocator)
+{
+	assert(allocator != AllocatorInvalid);
 	this->memory = memory;
 }
 
@@ -35,9 +52,23 @@ Manager::Manager(Memory *memory)
 // Debug file name, as set by user
 std::string Manager::debug_file;
 
+// Report file name, as set by user
+std::string Manager::report_file;
+
+// Allocation policy, as set by user
+int Manager::default_allocator = AllocatorFirstFit;
+
 // Debugger
 misc::Debug Manager::debug;
 
+// Statistics aggregated over all managers
+long long Manager::total_num_allocations = 0;
+long long Manager::total_num_frees = 0;
+long long Manager::total_requested_bytes = 0;
+long long Manager::total_allocated_bytes = 0;
+long long Manager::total_num_pages = 0;
+long long Manager::total_allocation_time = 0;
+
 
 void Manager::RegisterOptions()
 {
@@ -51,6 +82,23 @@ void Manager::RegisterOptions()
 	command_line->RegisterString("--mem-manager-debug <file>", debug_file,
 			"Dump debug information for the memory manager, "
 			"including how much memory allocated, fragmentation.");
+
+	// Option '--mem-manager-allocator <policy>'
+	command_line->RegisterEnum("--mem-manager-allocator "
+			"{FirstFit|Segregated} (default = FirstFit)",
+			default_allocator, AllocatorMap,
+			"Allocation policy for chunks of guest device memory up "
+			"to the page size. 'FirstFit' searches a list of holes "
+			"and creates one chunk per allocation. 'Segregated' "
+			"keeps free lists of power-of-two blocks per size "
+			"class, split and coalesced with the buddy system.");
+
+	// Option '--mem-manager-report <file>'
+	command_line->RegisterString("--mem-manager-report <file>",
+			report_file,
+			"Dump allocation statistics of the memory managers, "
+			"including fragmentation and host time spent per "
+			"allocation.");
 }
 
 
@@ -61,6 +109,37 @@ void Manager::ProcessOptions()
 }
 
 
+void Manager::DumpReport()
+{
+	// Ignore if no report file was given
+	if (report_file.empty())
+		return;
+
+	// Open file
+	std::ofstream f(report_file);
+	if (!f)
+		throw misc::Error(misc::fmt("%s: cannot open report file",
+				report_file.c_str()));
+
+	// Dump statistics
+	f << "[ MemoryManager ]\n";
+	f << "Allocator = " << AllocatorMap[default_allocator] << '\n';
+	f << misc::fmt("Allocations = %lld\n", total_num_allocations);
+	f << misc::fmt("Frees = %lld\n", total_num_frees);
+	f << misc::fmt("RequestedBytes = %lld\n", total_requested_bytes);
+	f << misc::fmt("AllocatedBytes = %lld\n", total_allocated_bytes);
+	f << misc::fmt("InternalFragmentation = %.4g\n",
+			total_allocated_bytes ? 1.0 - (double)
+			total_requested_bytes / total_allocated_bytes : 0.0);
+	f << misc::fmt("PagesMapped = %lld\n", total_num_pages);
+	f << misc::fmt("AllocationTime = %lld\n", total_allocation_time);
+	f << misc::fmt("AverageAllocationLatency = %.4g\n",
+			total_num_allocations ? (double) total_allocation_time /
+			total_num_allocations : 0.0);
+	f << '\n';
+}
+
+
 unsigned Manager::Allocate(unsigned size, unsigned alignment)
 {
 	// Assert the alignment is smaller than page size
@@ -70,14 +149,46 @@ unsigned Manager::Allocate(unsigned size, unsigned alignment)
 	debug << misc::fmt("%d bytes of memory requested, align to %d byte\n",
 			size, alignment);
 
-	// If requested size is larger than a page, allocate whole pages for it
+	// Measure the host time spent in the allocation
+	auto start_time = std::chrono::steady_clock::now();
+
+	// If requested size is larger than a page, allocate whole pages for it.
+	// Otherwise, use the allocation policy of the manager.
+	unsigned address;
+	unsigned allocated_size = size;
 	if (size > Memory::PageSize)
 	{
-		unsigned address = AllocateLarge(size);
-		if (debug) Dump(debug);
-		return address;
+		address = AllocateLarge(size);
+		allocated_size = chunks[address]->getSize();
+	}
+	else if (allocator == AllocatorSegregated)
+	{
+		address = AllocateBlock(size, alignment);
+		allocated_size = 1u << blocks[address].order;
+	}
+	else
+	{
+		address = AllocateFirstFit(size, alignment);
 	}
 
+	// Statistics, with time in nanoseconds
+	long long time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start_time).count();
+	num_allocations++;
+	allocation_time += time;
+	total_num_allocations++;
+	total_allocation_time += time;
+	total_requested_bytes += size;
+	total_allocated_bytes += allocated_size;
+
+	// After allocating memory space, dump summary of managed memory
+	if (debug) Dump(debug);
+	return address;
+}
+
+
+unsigned Manager::AllocateFirstFit(unsigned size, unsigned alignment)
+{
 	// Traverse all holes that have a bigger size than the required space to
 	// find an available slot
 	for (auto it = holes.lower_bound(size); it != holes.end(); it++)
@@ -86,24 +197,99 @@ unsigned Manager::Allocate(unsigned size, unsigned alignment)
 		{
 			debug << misc::fmt("Allocating in hole 0x%x\n",
 					it->second->getAddress());
-			unsigned address = AllocateIn(it->second,
-					size, alignment);
-			if (debug)
-			{
-				Dump(debug);
-			}
-			return address;
+			return AllocateIn(it->second, size, alignment);
 		}
 	}
 	
 	// No available space, need a new page
 	Chunk *hole = RequestOnePage(MapBaseAddress);
-	unsigned addr = hole->getAddress();
-	AllocateIn(hole, size, alignment);
+	return AllocateIn(hole, size, alignment);
+}
 
-	// After allocating memory space, dump summary of managed memory
-	if(debug) Dump(debug);
-	return addr;
+
+unsigned Manager::AllocateBlock(unsigned size, unsigned alignment)
+{
+	// Size class of the block. Blocks are aligned to their size within a
+	// page, so a block at least as large as the alignment is aligned.
+	unsigned order = MinBlockOrder;
+	while ((1u << order) < size || (1u << order) < alignment)
+		order++;
+	assert(order <= MaxBlockOrder);
+
+	// Find the smallest non-empty size class with blocks large enough
+	unsigned free_order = order;
+	while (free_order <= MaxBlockOrder && free_blocks[free_order].empty())
+		free_order++;
+
+	// Take the free block with the lowest address, or map a new page
+	unsigned address;
+	if (free_order > MaxBlockOrder)
+	{
+		address = MapPage(MapBaseAddress);
+		free_order = MaxBlockOrder;
+		num_pages++;
+	}
+	else
+	{
+		auto it = free_blocks[free_order].begin();
+		address = *it;
+		free_blocks[free_order].erase(it);
+	}
+
+	// Split the block down to the requested size class, releasing the
+	// upper half (buddy) at each step.
+	while (free_order > order)
+	{
+		free_order--;
+		free_blocks[free_order].insert(address + (1u << free_order));
+	}
+
+	// Record allocated block
+	blocks[address] = Block{ size, order };
+	requested_bytes += size;
+	block_bytes += 1u << order;
+	debug << misc::fmt("Allocating block 0x%x of %d bytes\n",
+			address, 1u << order);
+	return address;
+}
+
+
+bool Manager::FreeBlock(unsigned address)
+{
+	// Find block
+	auto it = blocks.find(address);
+	if (it == blocks.end())
+		return false;
+
+	// Remove it
+	unsigned order = it->second.order;
+	requested_bytes -= it->second.size;
+	block_bytes -= 1u << order;
+	blocks.erase(it);
+
+	// Coalesce with the buddy as long as it is free
+	while (order < MaxBlockOrder)
+	{
+		unsigned buddy = address ^ (1u << order);
+		auto buddy_it = free_blocks[order].find(buddy);
+		if (buddy_it == free_blocks[order].end())
+			break;
+		free_blocks[order].erase(buddy_it);
+		address = std::min(address, buddy);
+		order++;
+	}
+
+	// Release the page if it became entirely free
+	if (order == MaxBlockOrder)
+	{
+		DeallocatePage(address);
+		num_pages--;
+		return true;
+	}
+
+	// Add to free list
+	free_blocks[order].insert(address);
+	return true;
 }
 
 
@@ -170,6 +356,7 @@ unsigned Manager::AllocateLarge(unsigned size)
 
 	// Use map to allocate a new page
 	memory->Map(address, size, 0x07);
+	total_num_pages += page_aligned_size / Memory::PageSize;
 
 	// Allocate the chunk
 	CreatePointer(address, page_aligned_size);
@@ -239,6 +426,15 @@ void Manager::Free(unsigned address)
 	// Dump information into debug file
 	debug << misc::fmt("Free pointer at 0x%x.\n", address);
 
+	// Block allocated by the segregated fit allocator
+	if (FreeBlock(address))
+	{
+		num_frees++;
+		total_num_frees++;
+		if (debug) Dump(debug);
+		return;
+	}
+
 	// Get the chunk to be freed
 	auto it = chunks.find(address);
 	if (it == chunks.end())
@@ -247,6 +443,10 @@ void Manager::Free(unsigned address)
 				"or has already been freed.");
 	}
 
+	// Statistics
+	num_frees++;
+	total_num_frees++;
+
 	// If the chunk is larger than a page size, use special rule for it.
 	unsigned size = it->second->getSize();
 	if (size > Memory::PageSize)
@@ -373,17 +573,24 @@ void Manager::DeallocatePage(unsigned addr)
 }
 
 
-Manager::Chunk *Manager::RequestOnePage(unsigned base_address)
+unsigned Manager::MapPage(unsigned base_address)
 {
-	unsigned int addr = base_address;
-
 	// Find a good place to allocate a new page
-	addr = memory->MapSpace(addr, Memory::PageSize);
-	if (addr == (unsigned)-1)
+	unsigned address = memory->MapSpace(base_address, Memory::PageSize);
+	if (address == (unsigned)-1)
 		throw misc::Error("Guest program out of memory.");
 
 	// Use map to allocate a new page
-	memory->Map(addr, memory->PageSize, 0x07);
+	memory->Map(address, Memory::PageSize, 0x07);
+	total_num_pages++;
+	return address;
+}
+
+
+Manager::Chunk *Manager::RequestOnePage(unsigned base_address)
+{
+	// Map a new page
+	unsigned addr = MapPage(base_address);
 
 	// Make the whole page a big hole
 	Chunk *hole = CreateHole(addr, memory->PageSize);
@@ -451,8 +658,20 @@ void Manager::RemovePointer(Chunk *pointer)
 
 bool Manager::isValidAddress(unsigned address)
 {
+	// Find the possible block of the segregated fit allocator it can
+	// locate in.
+	auto block_it = blocks.upper_bound(address);
+	if (block_it != blocks.begin())
+	{
+		--block_it;
+		if (address - block_it->first < block_it->second.size)
+			return true;
+	}
+
 	// Find the possible chunk it can locate in
 	auto it = chunks.lower_bound(address);
+	if (it == chunks.end())
+		return false;
 
 	// Determine if the address falls in the chunk and if the chunk is
 	// allocated
@@ -476,7 +695,7 @@ unsigned Manager::getAllocatedSize() const
 			size_allocated += chunk->getSize();
 		}
 	}
-	return size_allocated;
+	return size_allocated + requested_bytes;
 }
 
 
@@ -488,7 +707,39 @@ unsigned Manager::getOccupiedSize() const
 		Chunk *chunk = it->second.get();
 		size_occupied += chunk->getSize();
 	}
-	return size_occupied;
+	return size_occupied + num_pages * Memory::PageSize;
+}
+
+
+double Manager::getInternalFragmentation() const
+{
+	return block_bytes ? 1.0 - (double) requested_bytes / block_bytes :
+			0.0;
+}
+
+
+double Manager::getExternalFragmentation() const
+{
+	// Free holes
+	unsigned free_size = 0;
+	unsigned largest_free_size = 0;
+	for (auto &pair : holes)
+	{
+		free_size += pair.first;
+		largest_free_size = std::max(largest_free_size, pair.first);
+	}
+
+	// Free blocks
+	for (unsigned order = MinBlockOrder; order <= MaxBlockOrder; order++)
+	{
+		if (free_blocks[order].empty())
+			continue;
+		free_size += free_blocks[order].size() << order;
+		largest_free_size = std::max(largest_free_size, 1u << order);
+	}
+
+	// Fraction of free memory not in the largest hole or block
+	return free_size ? 1.0 - (double) largest_free_size / free_size : 0.0;
 }
 
 
@@ -536,6 +787,17 @@ void Manager::Dump(std::ostream &os = std::cout) const
 	os << misc::fmt("  Occupied Size: %d,\n", getOccupiedSize());
 	os << misc::fmt("  Fragmentation: %f\n",
 			(double)getAllocatedSize()/(double)getOccupiedSize() );
+	os << misc::fmt("  Allocator: %s\n", AllocatorMap[allocator]);
+	os << misc::fmt("  Allocated Blocks: %d\n", (int) blocks.size());
+	os << misc::fmt("  Internal Fragmentation: %f\n",
+			getInternalFragmentation());
+	os << misc::fmt("  External Fragmentation: %f\n",
+			getExternalFragmentation());
+	os << misc::fmt("  Allocations: %lld, Frees: %lld\n",
+			num_allocations, num_frees);
+	os << misc::fmt("  Average Allocation Latency: %f ns\n",
+			num_allocations ? (double) allocation_time /
+			num_allocations : 0.0);
 	os << misc::fmt("\n***** ****** *****\n\n");
 }
 
@@ -23,6 +23,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <set>
 
 #include <lib/cpp/String.h>
 #include <lib/cpp/Debug.h>
@@ -37,11 +38,43 @@ namespace mem
 // A delegate of a memory object for memory allocation and deallocation
 class Manager
 {
+public:
+
+	/// Allocation policies for chunks up to the page size
+	enum Allocator
+	{
+		AllocatorInvalid = 0,
+
+		// First fit over a list of holes, one chunk per allocation
+		AllocatorFirstFit,
+
+		// Segregated free lists of power-of-two blocks, split and
+		// coalesced with the buddy system
+		AllocatorSegregated
+	};
+
+	/// String map for Allocator
+	static const misc::StringMap AllocatorMap;
+
 protected:
 
 	// Debug file name, as set by user
 	static std::string debug_file;
 
+	// Report file name, as set by user
+	static std::string report_file;
+
+	// Allocation policy for new managers, as set by user
+	static int default_allocator;
+
+	// Statistics aggregated over all managers
+	static long long total_num_allocations;
+	static long long total_num_frees;
+	static long long total_requested_bytes;
+	static long long total_allocated_bytes;
+	static long long total_num_pages;
+	static long long total_allocation_time;
+
 	// Memory object it manage
 	Memory *memory;
 
@@ -169,6 +202,59 @@ protected:
 	// Memory holes, map the size of the holes to chunks
 	std::multimap<unsigned, Chunk*> holes;
 
+	// Allocation policy of this manager
+	Allocator allocator;
+
+	// Statistics
+	long long num_allocations = 0;
+	long long num_frees = 0;
+	long long allocation_time = 0;
+
+
+
+	//
+	// Segregated fit allocator
+	//
+
+	// Log base 2 of the smallest and largest blocks. The largest block is
+	// a whole page.
+	static const unsigned MinBlockOrder = 4;
+	static const unsigned MaxBlockOrder = Memory::LogPageSize;
+
+	// Block allocated by the segregated fit allocator
+	struct Block
+	{
+		// Size requested by the user
+		unsigned size;
+
+		// Log base 2 of the block size
+		unsigned order;
+	};
+
+	// Free blocks of each size class, indexed by order and sorted by
+	// address, so that allocations reuse low addresses first.
+	std::set<unsigned> free_blocks[MaxBlockOrder + 1];
+
+	// Allocated blocks, indexed by address
+	std::map<unsigned, Block> blocks;
+
+	// Bytes requested by the user and occupied by allocated blocks
+	unsigned requested_bytes = 0;
+	unsigned block_bytes = 0;
+
+	// Number of pages currently mapped by the allocator
+	unsigned num_pages = 0;
+
+	// Allocate a block, return its address
+	unsigned AllocateBlock(unsigned size, unsigned alignment);
+
+	// Free the block at the given address, coalescing it with its buddies.
+	// Return false if no block was allocated at that address.
+	bool FreeBlock(unsigned address);
+
+	// Map a new page and return its address
+	unsigned MapPage(unsigned base_address);
+
 	// Request a memory page
 	//
 	// \return
@@ -184,6 +270,10 @@ protected:
 	// Merge 2 consecutive holes
 	void Merge2Holes(Chunk *hole1, Chunk *hole2);
 
+	// Allocate memory with the first fit allocator, return the allocated
+	// base address
+	unsigned AllocateFirstFit(unsigned size, unsigned alignment);
+
 	// Allocate memory in a big enough hole, return the allocated base
 	// address
 	unsigned AllocateIn(Chunk *hole, unsigned size, unsigned alignment);
@@ -225,9 +315,13 @@ protected:
 
 public:
 
-	/// Constructor, assign the memory to manager
+	/// Constructor, assign the memory to manager. The allocation policy
+	/// is the one selected with option '--mem-manager-allocator'.
 	Manager(Memory *memory);
 
+	/// Constructor with an explicit allocation policy
+	Manager(Memory *memory, Allocator allocator);
+
 	/// Destroctur
 	virtual ~Manager() { };
 
@@ -240,6 +334,22 @@ public:
 	/// Process command-line options
 	static void ProcessOptions();
 
+	/// Dump the statistics aggregated over all managers into the report
+	/// file given by the user, if any.
+	static void DumpReport();
+
+	/// Return the allocation policy of the manager
+	Allocator getAllocator() const { return allocator; }
+
+	/// Return the internal fragmentation, i.e., the fraction of the memory
+	/// occupied by allocated blocks that was not requested by the user.
+	double getInternalFragmentation() const;
+
+	/// Return the external fragmentation, i.e., the fraction of the free
+	/// memory in mapped pages not contained in the largest free hole or
+	/// block.
+	double getExternalFragmentation() const;
+
 	/// Allocate a piece of memory
 	/// 
 	/// \param size
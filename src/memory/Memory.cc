@@ -114,6 +114,7 @@ void Memory::Copy(unsigned dest, unsigned src, unsigned size)
 		Page *page_dest = getPage(dest);
 		Page *page_src = getPage(src);
 		assert(page_src && page_dest);
+		InvalidateCode(page_dest);
 		
 		// Different actions depending on whether source and
 		// destination page data are allocated.
@@ -152,6 +153,10 @@ char *Memory::getBuffer(unsigned address, unsigned size, AccessType access)
 	// Check page permissions
 	if ((page->getPerm() & access) != access && safe)
 		throw Error(misc::fmt("[0x%x] Permission denied", address));
+
+	// The content may be modified through the returned pointer
+	if (access & (AccessWrite | AccessInit))
+		InvalidateCode(page);
 	
 	// Return pointer to page data
 	page->AllocateData();
@@ -210,6 +215,7 @@ void Memory::AccessAtPageBoundary(unsigned address, unsigned size,
 	// Write/initialize access
 	if (access == AccessWrite || access == AccessInit)
 	{
+		InvalidateCode(page);
 		page->AllocateData();
 		memcpy(page->getData() + offset, buffer, size);
 		return;
@@ -223,7 +229,7 @@ void Memory::AccessAtPageBoundary(unsigned address, unsigned size,
 void Memory::Access(unsigned address, unsigned size, char *buf,
 			AccessType access)
 {
-	last_address = address;
+	last_address.store(address, std::memory_order_relaxed);
 	while (size)
 	{
 		unsigned offset = address & (PageSize - 1);
@@ -237,6 +243,15 @@ void Memory::Access(unsigned address, unsigned size, char *buf,
 }
 
 
+void Memory::Clear()
+{
+	// Instructions cached from any page are no longer valid
+	for (auto &it : pages)
+		InvalidateCode(it.second.get());
+	pages.clear();
+}
+
+
 Memory::Memory()
 {
 	// Initialize
@@ -364,7 +379,13 @@ void Memory::Unmap(unsigned address, unsigned size)
 
 	// Deallocate pages
 	for (unsigned tag = tag1; tag <= tag2; tag += PageSize)
+	{
+		Page *page = getPage(tag);
+		if (!page)
+			continue;
+		InvalidateCode(page);
 		pages.erase(tag);
+	}
 }
 
 
@@ -384,6 +405,7 @@ void Memory::Protect(unsigned address, unsigned size, unsigned perm)
 			continue;
 
 		// Set page new protection flags
+		InvalidateCode(page);
 		page->setPerm(perm);
 	}
 }
@@ -503,5 +525,56 @@ void Memory::Clone(const Memory &memory)
 }
 
 
+bool Memory::MarkCode(unsigned address, unsigned size)
+{
+	// Calculate page boundaries
+	unsigned tag1 = address & ~(PageSize-1);
+	unsigned tag2 = (address + size - 1) & ~(PageSize-1);
+
+	// All pages must exist, or a later write creating them would not
+	// invalidate the instructions.
+	for (unsigned tag = tag1; ; tag += PageSize)
+	{
+		if (!getPage(tag))
+			return false;
+		if (tag == tag2)
+			break;
+	}
+
+	// Mark pages
+	for (unsigned tag = tag1; ; tag += PageSize)
+	{
+		Page *page = getPage(tag);
+		if (page)
+			page->setCode(true);
+		if (tag == tag2)
+			break;
+	}
+	return true;
+}
+
+
+void Memory::InvalidateCodePage(Page *page)
+{
+	// Only the first thread clearing the flag adds the page
+	std::lock_guard<std::mutex> lock(invalidated_code_mutex);
+	if (!page->isCode())
+		return;
+	page->setCode(false);
+	invalidated_code.push_back(page->getTag());
+	has_invalidated_code.store(true, std::memory_order_release);
+}
+
+
+std::vector<unsigned> Memory::TakeInvalidatedCode()
+{
+	std::lock_guard<std::mutex> lock(invalidated_code_mutex);
+	std::vector<unsigned> tags;
+	tags.swap(invalidated_code);
+	has_invalidated_code.store(false, std::memory_order_release);
+	return tags;
+}
+
+
 } // namespace mem
 
@@ -20,10 +20,13 @@
 #ifndef MEMORY_MEMORY_H
 #define MEMORY_MEMORY_H
 
+#include <atomic>
 #include <cassert>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <lib/cpp/Error.h>
 #include <lib/cpp/Misc.h>
@@ -70,7 +73,11 @@ public:
 		AccessModified = 1 << 4
 	};
 
-	/// A 4KB page of memory
+	/// A 4KB page of memory. The page data, permissions, and code flag
+	/// can be accessed by several host threads emulating contexts that
+	/// share the memory. Writes from any thread add the modified flag to
+	/// the permissions, while the rest of the permissions are only
+	/// changed when no other thread accesses the page.
 	class Page
 	{
 		// Page tag, equal to the address of the first byte contained
@@ -78,10 +85,13 @@ public:
 		unsigned tag;
 
 		// Page permissions
-		unsigned perm;
+		std::atomic<unsigned> perm;
 
-		// The page data
-		std::unique_ptr<char[]> data;
+		// Whether instructions decoded from the page are cached
+		std::atomic<bool> code{false};
+
+		// The page data, allocated on the first write
+		std::atomic<char *> data{nullptr};
 	
 	public:
 
@@ -93,33 +103,67 @@ public:
 			assert((tag & (PageSize - 1)) == 0);
 		}
 
+		/// Destructor
+		~Page() { delete[] data.load(); }
+
 		/// Return the page tag, equal to the address of the first byte
 		/// contained in the page.
 		unsigned getTag() const { return tag; }
 
 		/// Return the page permissions. This is a bitmap of flags
 		/// contained in AccessType.
-		unsigned getPerm() const { return perm; }
+		unsigned getPerm() const
+		{
+			return perm.load(std::memory_order_relaxed);
+		}
 
 		/// Return a pointer to the page data, or `nullptr` if the data
 		/// was not allocated.
-		char *getData() { return data.get(); }
+		char *getData() { return data.load(std::memory_order_acquire); }
 
 		/// Allocate the page data. If the data buffer was allocated
-		/// before, this call is ignored.
+		/// before, this call is ignored. When several threads allocate
+		/// the data at the same time, only one buffer is kept.
 		void AllocateData()
 		{
-			if (data == nullptr)
-				data = misc::new_unique_array<char>(PageSize);
+			if (getData())
+				return;
+			char *buffer = new char[PageSize]();
+			char *expected = nullptr;
+			if (!data.compare_exchange_strong(expected, buffer,
+					std::memory_order_acq_rel))
+				delete[] buffer;
 		}
 
 		/// Set the page permissions, given as a bitmap of flags of
 		/// type AccessType.
-		void setPerm(unsigned perm) { this->perm = perm; }
+		void setPerm(unsigned perm)
+		{
+			this->perm.store(perm, std::memory_order_relaxed);
+		}
 
 		/// Add a flag to the page permissions, given as a bitmap of
-		/// flags of type AccessType.
-		void addPerm(unsigned perm) { this->perm |= perm; }
+		/// flags of type AccessType. Flags already present are not
+		/// written again.
+		void addPerm(unsigned perm)
+		{
+			if ((getPerm() & perm) != perm)
+				this->perm.fetch_or(perm, std::memory_order_relaxed);
+		}
+
+		/// Return whether instructions decoded from the page are
+		/// cached by an emulator.
+		bool isCode() const
+		{
+			return code.load(std::memory_order_relaxed);
+		}
+
+		/// Set whether instructions decoded from the page are cached
+		/// by an emulator.
+		void setCode(bool code)
+		{
+			this->code.store(code, std::memory_order_relaxed);
+		}
 	};
 
 private:
@@ -137,8 +181,28 @@ private:
 	/// Heap break for CPU contexts
 	unsigned heap_break = 0;
 
-	/// Last accessed address
-	unsigned last_address = 0;
+	/// Last accessed address, written by all threads accessing memory
+	std::atomic<unsigned> last_address{0};
+
+	/// Tags of the pages holding cached instructions that were written,
+	/// unmapped, or changed their permissions since the last call to
+	/// TakeInvalidatedCode(). The list is protected by a mutex, since
+	/// contexts emulated on different host threads can write code pages
+	/// at the same time.
+	std::vector<unsigned> invalidated_code;
+	std::mutex invalidated_code_mutex;
+	std::atomic<bool> has_invalidated_code{false};
+
+	/// Record that the instructions cached from a page are no longer
+	/// valid, if there were any.
+	void InvalidateCode(Page *page)
+	{
+		if (page->isCode())
+			InvalidateCodePage(page);
+	}
+
+	// Add a page to the list of invalidated code pages
+	void InvalidateCodePage(Page *page);
 
 	/// Create a new page and add it to the page table. The value given in
 	/// \a perm is an *or*'ed bitmap of AccessType flags.
@@ -169,7 +233,7 @@ public:
 	bool getSafe() const { return safe; }
 
 	/// Clear content of memory
-	void Clear() { pages.clear(); }
+	void Clear();
 
 	/// Return the memory page corresponding to an address, or `nullptr` if
 	/// there is currently no page allocated for that address.
@@ -450,6 +514,27 @@ public:
 	/// Copy the content and attributes from another memory object
 	void Clone(const Memory &memory);
 
+	/// Mark the pages containing \a size bytes after \a address as
+	/// holding instructions cached by an emulator. Writing, unmapping, or
+	/// changing the permissions of these pages afterwards invalidates the
+	/// cached instructions, as reported by TakeInvalidatedCode(). The
+	/// function returns false and marks no page if some page is not
+	/// allocated, in which case the instructions must not be cached.
+	bool MarkCode(unsigned address, unsigned size);
+
+	/// Return whether the instructions cached from some page were
+	/// invalidated since the last call to TakeInvalidatedCode().
+	bool hasInvalidatedCode() const
+	{
+		return has_invalidated_code.load(std::memory_order_acquire);
+	}
+
+	/// Return the tags of the pages whose cached instructions were
+	/// invalidated since the last call to this function, and clear the
+	/// list. The pages must be marked again with MarkCode() once their
+	/// instructions are cached again.
+	std::vector<unsigned> TakeInvalidatedCode();
+
 };
 
 
@@ -20,6 +20,7 @@
 #include <cassert>
 
 #include <lib/cpp/CommandLine.h>
+#include <lib/cpp/Error.h>
 #include <lib/cpp/String.h>
 
 #include "Memory.h"
@@ -69,10 +70,61 @@ Mmu::Page *Mmu::Space::getPage(unsigned virtual_address)
 // Class 'Mmu'
 //
 
+const misc::StringMap Mmu::PolicyMap =
+{
+	{ "Sequential", PolicySequential },
+	{ "Coloring", PolicyColoring },
+	{ "HugePage", PolicyHugePage },
+	{ "Numa", PolicyNuma }
+};
+
 std::string Mmu::debug_file;
 
 misc::Debug Mmu::debug;
 
+int Mmu::default_policy = PolicySequential;
+
+int Mmu::default_num_colors = 16;
+
+int Mmu::default_num_nodes = 2;
+
+std::string Mmu::numa_bind;
+
+std::vector<Mmu::Region> Mmu::default_regions;
+
+
+void Mmu::ParseRegions(const std::string &list, std::vector<Region> &regions)
+{
+	std::vector<std::string> tokens;
+	misc::StringTokenize(list, tokens, ",");
+	for (const std::string &token : tokens)
+	{
+		// Split in bounds and node
+		std::vector<std::string> fields;
+		misc::StringTokenize(token, fields, "-:");
+		if (fields.size() != 3)
+			throw misc::Error(misc::fmt("%s: invalid NUMA binding, "
+					"format is <low>-<high>:<node>",
+					token.c_str()));
+
+		// Convert values
+		misc::StringError error;
+		Region region;
+		long long low = misc::StringToInt64(fields[0], error);
+		long long high = error ? 0 : misc::StringToInt64(fields[1],
+				error);
+		int node = error ? 0 : misc::StringToInt(fields[2], error);
+		if (error || low < 0 || high > 0xffffffffll || low > high ||
+				node < 0)
+			throw misc::Error(misc::fmt("%s: invalid NUMA binding",
+					token.c_str()));
+		region.low = low;
+		region.high = high;
+		region.node = node;
+		regions.push_back(region);
+	}
+}
+
 
 void Mmu::RegisterOptions()
 {
@@ -87,6 +139,50 @@ void Mmu::RegisterOptions()
 			"Dump debug information related with the memory "
 			"management unit, virtual/physical memory address "
 			"spaces, and address translations.");
+
+	// Option --mmu-policy <policy>
+	command_line->RegisterEnum("--mmu-policy "
+			"{Sequential|Coloring|HugePage|Numa} "
+			"(default = Sequential)",
+			default_policy, PolicyMap,
+			"Policy to choose the physical page of a virtual page "
+			"on its first access. 'Sequential' allocates pages in "
+			"first-touch order. 'Coloring' keeps the page color "
+			"of the virtual page in the physical page (see option "
+			"'--mmu-page-colors'). 'HugePage' backs every 2MB "
+			"virtual region with a contiguous 2MB physical "
+			"region. 'Numa' places pages in the physical slice "
+			"of a node (see options '--mmu-numa-nodes' and "
+			"'--mmu-numa-bind').");
+
+	// Option --mmu-page-colors <num>
+	command_line->RegisterInt32("--mmu-page-colors <num> "
+			"(default = 16)",
+			default_num_colors,
+			"Number of page colors for the 'Coloring' page "
+			"allocation policy. To control the sets used in a "
+			"cache, this should be the cache size divided by its "
+			"associativity and the page size.");
+
+	// Option --mmu-numa-nodes <num>
+	command_line->RegisterInt32("--mmu-numa-nodes <num> "
+			"(default = 2)",
+			default_num_nodes,
+			"Number of nodes for the 'Numa' page allocation "
+			"policy, as a power of two. Node i owns the i-th "
+			"equally sized slice of the 32-bit physical address "
+			"space. Main memory modules or DRAM channels are "
+			"assigned to nodes with 'AddressRange = BOUNDS' in "
+			"the memory configuration file.");
+
+	// Option --mmu-numa-bind <list>
+	command_line->RegisterString("--mmu-numa-bind "
+			"<low>-<high>:<node>[,...]",
+			numa_bind,
+			"Bind ranges of virtual addresses to nodes for the "
+			"'Numa' page allocation policy. Pages in virtual "
+			"regions not bound to any node are interleaved "
+			"across nodes.");
 }
 
 
@@ -95,11 +191,34 @@ void Mmu::ProcessOptions()
 	// Debug file
 	if (!debug_file.empty())
 		debug.setPath(debug_file);
+
+	// Number of colors
+	if (default_num_colors < 1)
+		throw misc::Error(misc::fmt("%d: invalid number of page colors",
+				default_num_colors));
+
+	// Number of nodes
+	if (default_num_nodes < 1 || (default_num_nodes & (default_num_nodes - 1)))
+		throw misc::Error(misc::fmt("%d: number of NUMA nodes must be "
+				"a power of two", default_num_nodes));
+
+	// NUMA bindings
+	ParseRegions(numa_bind, default_regions);
+	for (Region &region : default_regions)
+		if (region.node >= (unsigned) default_num_nodes)
+			throw misc::Error(misc::fmt("%d: invalid NUMA node in "
+					"option '--mmu-numa-bind'", region.node));
 }
 
 
 Mmu::Mmu(const std::string &name) :
-		name(name)
+		name(name),
+		policy((Policy) default_policy),
+		num_colors(default_num_colors),
+		num_nodes(default_num_nodes),
+		regions(default_regions),
+		num_color_pages(num_colors),
+		num_node_pages(num_nodes)
 {
 	// Debug
 	debug << misc::fmt("[MMU %s] Memory management unit created\n",
@@ -107,6 +226,138 @@ Mmu::Mmu(const std::string &name) :
 }
 
 
+void Mmu::setPolicy(Policy policy)
+{
+	if (!pages.empty())
+		throw misc::Panic("Page allocation policy set after the first "
+				"page was allocated");
+	this->policy = policy;
+}
+
+
+void Mmu::setNumColors(unsigned num_colors)
+{
+	if (!pages.empty())
+		throw misc::Panic("Number of colors set after the first page "
+				"was allocated");
+	assert(num_colors > 0);
+	this->num_colors = num_colors;
+	num_color_pages.assign(num_colors, 0);
+}
+
+
+void Mmu::setNumNodes(unsigned num_nodes)
+{
+	if (!pages.empty())
+		throw misc::Panic("Number of NUMA nodes set after the first "
+				"page was allocated");
+	assert(num_nodes > 0 && !(num_nodes & (num_nodes - 1)));
+	this->num_nodes = num_nodes;
+	num_node_pages.assign(num_nodes, 0);
+	regions.clear();
+}
+
+
+void Mmu::BindRegion(unsigned low, unsigned high, unsigned node)
+{
+	assert(low <= high);
+	assert(node < num_nodes);
+	Region region;
+	region.low = low;
+	region.high = high;
+	region.node = node;
+	regions.push_back(region);
+}
+
+
+unsigned Mmu::AllocatePhysicalPage(Space *space, unsigned virtual_tag)
+{
+	unsigned physical_address;
+	switch (policy)
+	{
+
+	case PolicySequential:
+
+		// Next page
+		physical_address = top_physical_address;
+		top_physical_address += PageSize;
+		break;
+
+	case PolicyColoring:
+	{
+		// Next page of the same color as the virtual page
+		unsigned color = (virtual_tag >> LogPageSize) % num_colors;
+		unsigned long long page_number = (unsigned long long)
+				num_color_pages[color] * num_colors + color;
+		if (page_number >= (1ull << (32 - LogPageSize)))
+			throw misc::Error(misc::fmt("[MMU %s] Out of physical "
+					"pages of color %d", name.c_str(),
+					color));
+		num_color_pages[color]++;
+		physical_address = page_number << LogPageSize;
+		break;
+	}
+
+	case PolicyHugePage:
+	{
+		// Find the huge page, or allocate a new one
+		unsigned virtual_huge_tag = virtual_tag & HugePageMask;
+		auto key = std::make_pair(space, virtual_huge_tag);
+		auto it = huge_pages.find(key);
+		if (it == huge_pages.end())
+		{
+			if (top_physical_address + HugePageSize > 1ull << 32)
+				throw misc::Error(misc::fmt("[MMU %s] Out of "
+						"physical huge pages",
+						name.c_str()));
+			it = huge_pages.emplace(key, top_physical_address).first;
+			top_physical_address += HugePageSize;
+		}
+
+		// Same offset within the huge page
+		physical_address = it->second + (virtual_tag & ~HugePageMask);
+		break;
+	}
+
+	case PolicyNuma:
+	{
+		// Node of the region containing the virtual page. Pages not
+		// bound to any node are interleaved.
+		unsigned node = (virtual_tag >> LogPageSize) % num_nodes;
+		for (Region &region : regions)
+		{
+			if (virtual_tag >= (region.low & PageMask) &&
+					virtual_tag <= region.high)
+			{
+				node = region.node;
+				break;
+			}
+		}
+
+		// Next page in the node's slice of the physical space
+		unsigned node_num_pages = (1u << (32 - LogPageSize)) /
+				num_nodes;
+		if (num_node_pages[node] >= node_num_pages)
+			throw misc::Error(misc::fmt("[MMU %s] Out of physical "
+					"pages in NUMA node %d", name.c_str(),
+					node));
+		physical_address = (node * node_num_pages +
+				num_node_pages[node]) << LogPageSize;
+		num_node_pages[node]++;
+		break;
+	}
+
+	default:
+
+		throw misc::Panic("Invalid page allocation policy");
+	}
+
+	// Physical page must be free
+	assert(physical_pages.find(physical_address) == physical_pages.end());
+	return physical_address;
+}
+
+
 Mmu::Space *Mmu::newSpace(const std::string &name)
 {
 	spaces.emplace_back(new Space(name, this));
@@ -130,16 +381,13 @@ unsigned Mmu::TranslateVirtualAddress(Space *space,
 	{
 		// Create new page
 		pages.emplace_back(new Page(space, virtual_tag,
-				top_physical_address));
+				AllocatePhysicalPage(space, virtual_tag)));
 		
 		// Add page to virtual and physical maps
 		page = pages.back().get();
 		physical_pages[page->getPhysicalAddress()] = page;
 		space->addPage(page);
 
-		// Increment top of physical address space
-		top_physical_address += PageSize;
-
 		// Debug
 		if (debug)
 			debug << misc::fmt("[MMU %s] Page created. "
@@ -20,16 +20,21 @@
 #ifndef MEMORY_MMU_H
 #define MEMORY_MMU_H
 
+#include <map>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include <lib/cpp/Debug.h>
+#include <lib/cpp/String.h>
 
 
 namespace mem
 {
 
+// Forward declarations
+class Memory;
+
 
 /// Memory management unit. This class represents a 32-bit physical memory
 /// space and provides virtual-to-physical memory translations. The physical
@@ -50,6 +55,39 @@ public:
 	/// Mask to apply on a byte address to discard the page offset
 	static const unsigned PageMask = ~(PageSize - 1);
 
+	/// Log base 2 of the huge page size
+	static const unsigned LogHugePageSize = 21;
+
+	/// Size of a huge page
+	static const unsigned HugePageSize = 1u << LogHugePageSize;
+
+	/// Mask to apply on a byte address to discard the huge page offset
+	static const unsigned HugePageMask = ~(HugePageSize - 1);
+
+	/// Policies to choose the physical page for a new virtual page
+	enum Policy
+	{
+		PolicyInvalid = 0,
+
+		// Pages are allocated in first-touch order
+		PolicySequential,
+
+		// The color of the physical page (its page number modulo the
+		// number of colors) matches the color of the virtual page, so
+		// that the virtual address decides the cache sets used.
+		PolicyColoring,
+
+		// Contiguous 2MB physical regions back each 2MB virtual region
+		PolicyHugePage,
+
+		// The physical address space is split in nodes, and each page
+		// is placed in the node that its virtual region is bound to.
+		PolicyNuma
+	};
+
+	/// String map for Policy
+	static const misc::StringMap PolicyMap;
+
 	/// Access types to memory pages
 	enum AccessType
 	{
@@ -113,6 +151,10 @@ public:
 		// virtual address.
 		std::unordered_map<unsigned, Page *> virtual_pages;
 
+		// Functional memory holding the contents of the virtual
+		// address space, if any.
+		std::weak_ptr<Memory> memory;
+
 	public:
 
 		/// Constructor
@@ -133,6 +175,22 @@ public:
 		/// or `nullptr` if none is. Argument \a virtual_address must be
 		/// a multiple of the page size.
 		Page *getPage(unsigned virtual_address);
+
+		/// Associate the functional memory holding the contents of the
+		/// virtual address space. Timing models use it to inspect the
+		/// data of a block given its physical address.
+		void setMemory(std::shared_ptr<Memory> memory)
+		{
+			this->memory = memory;
+		}
+
+		/// Return the functional memory associated with the virtual
+		/// address space, or `nullptr` if none was set or it was
+		/// already released.
+		std::shared_ptr<Memory> getMemory() const
+		{
+			return memory.lock();
+		}
 	};
 
 private:
@@ -145,13 +203,45 @@ private:
 
 	// Debugger for MMU
 	static misc::Debug debug;
+
+	// Region of virtual memory bound to a NUMA node
+	struct Region
+	{
+		// First and last virtual address of the region
+		unsigned low;
+		unsigned high;
+
+		// Node that the region is bound to
+		unsigned node;
+	};
+
+	// Page allocation policy, as set by the user
+	static int default_policy;
+
+	// Number of page colors, as set by the user
+	static int default_num_colors;
+
+	// Number of NUMA nodes, as set by the user
+	static int default_num_nodes;
+
+	// Bindings of virtual regions to NUMA nodes, as set by the user
+	static std::string numa_bind;
+
+	// Bindings parsed from 'numa_bind'
+	static std::vector<Region> default_regions;
+
+	// Parse a list of bindings with format <low>-<high>:<node>[,...]
+	static void ParseRegions(const std::string &list,
+			std::vector<Region> &regions);
 	
 	// Name of the MMU
 	std::string name;
 
 	// Top of the physical address space. Every time a new page is
-	// allocated, this value is incremented by PageSize.
-	unsigned top_physical_address = 0;
+	// allocated, this value is incremented by PageSize, or by
+	// HugePageSize with the huge page policy. It is kept in 64 bits so
+	// that it does not wrap around after the last page.
+	unsigned long long top_physical_address = 0;
 
 	// Vector containing all virtual address spaces
 	std::vector<std::unique_ptr<Space>> spaces;
@@ -162,6 +252,32 @@ private:
 	// Hash table of pages indexed by their physical address
 	std::unordered_map<unsigned, Page *> physical_pages;
 
+	// Page allocation policy
+	Policy policy;
+
+	// Number of page colors for the coloring policy
+	unsigned num_colors;
+
+	// Number of NUMA nodes for the NUMA policy
+	unsigned num_nodes;
+
+	// Virtual regions bound to NUMA nodes
+	std::vector<Region> regions;
+
+	// Number of pages allocated of each color
+	std::vector<unsigned> num_color_pages;
+
+	// Number of pages allocated in each NUMA node
+	std::vector<unsigned> num_node_pages;
+
+	// Physical base address of the huge pages of each virtual space,
+	// indexed by the space and the virtual address of the huge page.
+	std::map<std::pair<Space *, unsigned>, unsigned> huge_pages;
+
+	// Return the physical address of the page that a new virtual page is
+	// mapped to, according to the allocation policy.
+	unsigned AllocatePhysicalPage(Space *space, unsigned virtual_tag);
+
 public:
 
 	//
@@ -191,6 +307,40 @@ public:
 	/// Return the name of the MMU
 	const std::string &getName() const { return name; }
 
+	/// Set the page allocation policy. The policy can only change before
+	/// the first page is allocated. The number of colors and NUMA nodes,
+	/// as well as the NUMA bindings, are initialized with the values
+	/// given in the command line.
+	void setPolicy(Policy policy);
+
+	/// Return the page allocation policy
+	Policy getPolicy() const { return policy; }
+
+	/// Set the number of page colors used by the coloring policy
+	void setNumColors(unsigned num_colors);
+
+	/// Set the number of NUMA nodes, which must be a power of two. Node
+	///  i owns the  i-th equally sized slice of the physical address
+	/// space.
+	void setNumNodes(unsigned num_nodes);
+
+	/// Bind the range of virtual addresses between  low and  high
+	/// (both included) to the given NUMA node. Pages in virtual regions not
+	/// bound to any node are interleaved across nodes.
+	void BindRegion(unsigned low, unsigned high, unsigned node);
+
+	/// Return the color of a physical address
+	unsigned getColor(unsigned physical_address) const
+	{
+		return (physical_address >> LogPageSize) % num_colors;
+	}
+
+	/// Return the NUMA node that owns a physical address
+	unsigned getNode(unsigned physical_address) const
+	{
+		return ((unsigned long long) physical_address * num_nodes) >> 32;
+	}
+
 	/// Create a new virtual address space
 	///
 	/// \param name
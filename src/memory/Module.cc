@@ -17,6 +17,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <climits>
 #include <fstream>
 #include <iostream>
@@ -52,6 +53,56 @@ Module::Module(const std::string &name,
 }
 
 
+void Module::setBanks(int num_banks, int bank_interleave, bool pipelined)
+{
+	// Checks
+	assert(num_banks > 0 && !(num_banks & (num_banks - 1)));
+	assert(bank_interleave > 0 && !(bank_interleave & (bank_interleave - 1)));
+
+	// Create banks
+	banks.clear();
+	banks.resize(num_banks);
+	this->bank_interleave = bank_interleave;
+	log_bank_interleave = misc::LogBase2(bank_interleave);
+	banks_pipelined = pipelined;
+}
+
+
+int Module::AccessBank(unsigned address, bool data)
+{
+	// Banks not modeled
+	if (banks.empty())
+		return 0;
+
+	// Get bank and stage
+	Bank &bank = banks[getBankIndex(address)];
+	long long &ready_cycle = data ? bank.data_ready_cycle :
+			bank.tag_ready_cycle;
+	if (data)
+		bank.num_data_accesses++;
+	else
+		bank.num_tag_accesses++;
+
+	// The access starts as soon as the stage is free, and occupies it for
+	// one cycle if pipelined, or for the entire stage latency otherwise.
+	long long cycle = System::getInstance()->getFrequencyDomain()->
+			getCycle();
+	long long start_cycle = std::max(cycle, ready_cycle);
+	int latency = data ? data_latency : directory_latency;
+	ready_cycle = start_cycle + (banks_pipelined ? 1 :
+			std::max(latency, 1));
+
+	// Bank conflict
+	int wait_cycles = start_cycle - cycle;
+	if (wait_cycles)
+	{
+		bank.num_conflicts++;
+		bank.num_conflict_cycles += wait_cycles;
+	}
+	return wait_cycles;
+}
+
+
 bool Module::ServesAddress(unsigned address) const
 {
 	// Address bounds
@@ -153,9 +204,7 @@ bool Module::canAccess(int address) const
 
 	// Module can be accessed if number of non-coalesced in-flight accesses
 	// is smaller than the MSHR size.
-	int num_non_coalesced_accesses = accesses.size() -
-			num_coalesced_accesses;
-	return num_non_coalesced_accesses < mshr_size;
+	return getMSHROccupancy() < mshr_size;
 }
 
 
@@ -786,6 +835,13 @@ void Module::DumpReport(std::ostream &os) const
 	os << misc::fmt("BlockSize = %d\n", block_size);
 	os << misc::fmt("DataLatency = %d\n", data_latency);
 	os << misc::fmt("Ports = %d\n", num_ports);
+	if (banks.size())
+	{
+		os << misc::fmt("Banks = %d\n", (int) banks.size());
+		os << misc::fmt("BankInterleave = %d\n", bank_interleave);
+		os << misc::fmt("BankPipelined = %s\n", banks_pipelined ?
+				"True" : "False");
+	}
 	os << "\n";
 
 	// Statistics - Accesses
@@ -851,6 +907,40 @@ void Module::DumpReport(std::ostream &os) const
 	if (type == TypeCache)
 		os << misc::fmt("ConflictInvalidation = %lld\n",
 				num_conflict_invalidations);
+
+	// Statistics - Banks
+	if (banks.size())
+	{
+		long long num_conflicts = 0;
+		long long num_conflict_cycles = 0;
+		for (const Bank &bank : banks)
+		{
+			num_conflicts += bank.num_conflicts;
+			num_conflict_cycles += bank.num_conflict_cycles;
+		}
+		os << "\n";
+		os << misc::fmt("BankConflicts = %lld\n", num_conflicts);
+		os << misc::fmt("BankConflictCycles = %lld\n",
+				num_conflict_cycles);
+		for (unsigned i = 0; i < banks.size(); i++)
+		{
+			const Bank &bank = banks[i];
+			os << misc::fmt("Bank[%u].TagAccesses = %lld\n", i,
+					bank.num_tag_accesses);
+			os << misc::fmt("Bank[%u].DataAccesses = %lld\n", i,
+					bank.num_data_accesses);
+			os << misc::fmt("Bank[%u].Conflicts = %lld\n", i,
+					bank.num_conflicts);
+		}
+	}
+
+	// Statistics - Compression
+	if (type == TypeCache && cache->getCompression() !=
+			Cache::CompressionNone)
+	{
+		os << "\n";
+		cache->DumpCompressionReport(os);
+	}
 	
 	// Separating line between modules
 	os << "\n\n";
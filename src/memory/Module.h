@@ -174,6 +174,46 @@ private:
 
 
 
+	//
+	// Banks
+	//
+
+	// Bank of the tag and data arrays. Each bank has independent tag and
+	// data stages, each of which can start a new access once it is done
+	// with the previous one.
+	struct Bank
+	{
+		// First cycle when the tag and data stages can start a new
+		// access.
+		long long tag_ready_cycle = 0;
+		long long data_ready_cycle = 0;
+
+		// Statistics
+		long long num_tag_accesses = 0;
+		long long num_data_accesses = 0;
+		long long num_conflicts = 0;
+		long long num_conflict_cycles = 0;
+	};
+
+	// Array of banks, empty if banks are not modeled
+	std::vector<Bank> banks;
+
+	// Number of bytes of consecutive addresses mapped to the same bank
+	int bank_interleave = 0;
+
+	// Log base 2 of the bank interleaving
+	int log_bank_interleave = 0;
+
+	// If true, the tag and data stages of a bank can start a new access
+	// every cycle. Otherwise, a stage is busy for its entire latency.
+	bool banks_pipelined = true;
+
+	// Reserve a stage of the bank serving the given address, and return
+	// the number of cycles that the access must wait for it.
+	int AccessBank(unsigned address, bool data);
+
+
+
 	//
 	// Directory
 	//
@@ -376,6 +416,13 @@ public:
 	/// if there are available ports and enough room in the MSHR register.
 	bool canAccess(int address) const;
 
+	/// Return the number of MSHR entries currently in use, that is, the
+	/// number of in-flight accesses that were not coalesced.
+	int getMSHROccupancy() const
+	{
+		return accesses.size() - num_coalesced_accesses;
+	}
+
 	/// Return module name
 	const std::string &getName() const { return name; }
 
@@ -385,6 +432,41 @@ public:
 	/// Return number of ports
 	int getNumPorts() const { return num_ports; }
 
+	/// Model banked tag and data arrays.
+	///
+	/// \param num_banks
+	///	Number of banks, a power of two.
+	///
+	/// \param bank_interleave
+	///	Number of bytes of consecutive addresses mapped to the same bank,
+	///	a power of two.
+	///
+	/// \param pipelined
+	///	Whether the tag and data stages of a bank are pipelined, i.e.,
+	///	they can start a new access every cycle.
+	///
+	void setBanks(int num_banks, int bank_interleave, bool pipelined);
+
+	/// Return the number of banks, or 0 if banks are not modeled
+	int getNumBanks() const { return banks.size(); }
+
+	/// Return the index of the bank serving an address
+	int getBankIndex(unsigned address) const
+	{
+		assert(banks.size());
+		return (address >> log_bank_interleave) & (banks.size() - 1);
+	}
+
+	/// Access the tag array in the bank serving the given address, and
+	/// return the number of cycles that the access must wait before its
+	/// tag stage can start. Return 0 if banks are not modeled.
+	int AccessTagBank(unsigned address) { return AccessBank(address, false); }
+
+	/// Access the data array in the bank serving the given address, and
+	/// return the number of cycles that the access must wait before its
+	/// data stage can start. Return 0 if banks are not modeled.
+	int AccessDataBank(unsigned address) { return AccessBank(address, true); }
+
 	/// Return block size
 	int getBlockSize() const { return block_size; }
 
@@ -792,6 +874,19 @@ public:
 	// Statistics
 	//
 
+	/// Return the number of accesses
+	long long getNumAccesses() const { return num_accesses; }
+
+	/// Return the number of hits for reads, writes, and non-coherent
+	/// writes.
+	long long getNumHits() const
+	{
+		return num_read_hits + num_write_hits + num_nc_write_hits;
+	}
+
+	/// Return the number of evictions
+	long long getNumEvictions() const { return num_evictions; }
+
 	/// Increment number of accesses
 	void incAccesses() { num_accesses++; }
 
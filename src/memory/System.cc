@@ -236,6 +236,10 @@ System::System()
 	event_invalidate = esim_engine->RegisterEvent("invalidate",
 			EventInvalidateHandler,
 			frequency_domain);
+	event_invalidate_multicast = esim_engine->RegisterEvent(
+			"invalidate_multicast",
+			EventInvalidateHandler,
+			frequency_domain);
 	event_invalidate_finish = esim_engine->RegisterEvent("invalidate_finish",
 			EventInvalidateHandler,
 			frequency_domain);
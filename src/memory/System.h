@@ -40,6 +40,7 @@ namespace mem
 
 
 // Forward declarations
+class Mmu;
 class Module;
 
 
@@ -224,8 +225,12 @@ class System
 
 	void ConfigCalculateModuleLevels();
 
+	void ConfigSetModuleMmu(Module *module, Mmu *mmu);
+
 	void ConfigTrace();
 
+	void ConfigIntervalStats();
+
 	void ConfigReadCommands(misc::IniFile *ini_file);
 
 
@@ -254,6 +259,12 @@ public:
 		return it == module_map.end() ? nullptr : it->second;
 	}
 
+	/// Return the frequency domain of the memory system
+	esim::FrequencyDomain *getFrequencyDomain() const
+	{
+		return frequency_domain;
+	}
+
 	/// Return a network given its name, or nullptr if no network with that
 	/// name exists.
 	net::Network *getNetwork(const std::string &name) const
@@ -356,6 +367,7 @@ public:
 	static esim::Event *event_read_request_finish;
 
 	static esim::Event *event_invalidate;
+	static esim::Event *event_invalidate_multicast;
 	static esim::Event *event_invalidate_finish;
 
 	static esim::Event *event_message;
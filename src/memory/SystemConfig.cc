@@ -20,10 +20,13 @@
 #include <arch/common/Arch.h>
 #include <arch/common/Timing.h>
 #include <lib/esim/Engine.h>
+#include <lib/esim/IntervalStats.h>
 #include <network/EndNode.h>
 #include <network/Node.h>
 #include <network/Switch.h>
 
+#include "Memory.h"
+#include "Mmu.h"
 #include "Module.h"
 #include "System.h"
 
@@ -164,12 +167,40 @@ const std::string System::help_message =
 	"      value determines the maximum number of accesses that can be in flight\n"
 	"      for the cache, including the time since the access request is\n"
 	"      received, until a potential miss is resolved.\n"
-	"  Ports = <num> (Default = 2)\n"
+	"  Ports = <num> (Default = 2, or the number of banks if 'Banks' is given)\n"
 	"      Number of ports. The number of ports in a cache limits the number of\n"
 	"      concurrent hits. If an access is a miss, it remains in the MSHR while\n"
 	"      it is resolved, but releases the cache port.\n"
+	"  Banks = <num> (Default = 0)\n"
+	"      Number of address-interleaved banks in the tag and data arrays, as a\n"
+	"      power of two. Each bank has independent tag and data stages, with\n"
+	"      latencies 'DirectoryLatency' and 'Latency', respectively. An access\n"
+	"      waits until the stage of its bank is free, so that accesses to the\n"
+	"      same bank are serialized while accesses to different banks proceed\n"
+	"      in parallel. A value of 0 disables the bank model.\n"
+	"  BankInterleave = <bytes> (Default = <block_size>)\n"
+	"      Number of bytes of consecutive addresses mapped to the same bank, as\n"
+	"      a power of two. A value smaller than the block size spreads the words\n"
+	"      of a block across banks.\n"
+	"  BankPipelined = {t|f} (Default = t)\n"
+	"      If true, the tag and data stages of a bank can start a new access\n"
+	"      every cycle. If false, a stage is busy for its entire latency.\n"
 	"  DirectoryLatency = <cycles> (Default = 1)\n"
 	"      Latency for a directory access in number of cycles.\n"
+	"  Compression = {None|BDI|FPC} (Default = None)\n"
+	"      Block compression algorithm. With compression enabled, tags and data\n"
+	"      are decoupled: each set has room for 'Assoc' uncompressed blocks in\n"
+	"      its data array, and 'Assoc' * 'CompressionTagFactor' tags. The\n"
+	"      compressed size of each block is computed with base-delta-immediate\n"
+	"      (BDI) or frequent pattern compression (FPC) over the block contents\n"
+	"      in the functional memory.\n"
+	"  CompressionTagFactor = <factor> (Default = 2)\n"
+	"      Number of tags per uncompressed block in the data array of a set,\n"
+	"      which limits the maximum number of compressed blocks that fit in it.\n"
+	"      Only allowed when 'Compression' is enabled.\n"
+	"  DecompressionLatency = <cycles> (Default = 1 for BDI, 5 for FPC)\n"
+	"      Extra latency for a hit on a block stored in compressed form. Only\n"
+	"      allowed when 'Compression' is enabled.\n"
 	"\n"
 	"Section [Network <net>] defines an internal default interconnect, formed of\n"
 	"a single switch connecting all modules pointing to the network. For every\n"
@@ -183,6 +214,10 @@ const std::string System::help_message =
 	"      Size of output buffers for end nodes and switch. \n"
 	"  DefaultBandwidth = <bandwidth>\n"
 	"      Bandwidth for links and switch crossbar in number of bytes per cycle.\n"
+	"  Multicast = <bool> (Default = False)\n"
+	"      If true, invalidations are sent to all sharers of a block in a single\n"
+	"      multicast message, replicated by the switch. External networks enable\n"
+	"      this with variable 'Multicast' in their own configuration.\n"
 	"\n"
 	"Section [Entry <name>] creates an entry into the memory system. An entry is\n"
 	"a connection between a CPU core/thread or a GPU compute unit with a module\n"
@@ -310,6 +345,10 @@ void System::ConfigReadNetworks(misc::IniFile *ini_file)
 		// Add pointer
 		ini_file->WritePointer(section, "ptr", network);
 
+		// Multicast messages
+		network->setMulticast(ini_file->ReadBool(section, "Multicast",
+				false));
+
 		// Check section integrity
 		ini_file->Enforce(section, "DefaultInputBufferSize");
 		ini_file->Enforce(section, "DefaultOutputBufferSize");
@@ -499,7 +538,38 @@ Module *System::ConfigReadCache(misc::IniFile *ini_file,
 	std::string write_policy_str = ini_file->ReadString(geometry_section,
 			"WritePolicy", "WriteBack");
 	int mshr_size = ini_file->ReadInt(geometry_section, "MSHR", 16);
-	int num_ports = ini_file->ReadInt(geometry_section, "Ports", 2);
+	int num_banks = ini_file->ReadInt(geometry_section, "Banks", 0);
+	int bank_interleave = ini_file->ReadInt(geometry_section,
+			"BankInterleave", block_size);
+	bool bank_pipelined = ini_file->ReadBool(geometry_section,
+			"BankPipelined", true);
+	int num_ports = ini_file->ReadInt(geometry_section, "Ports",
+			num_banks ? num_banks : 2);
+	std::string compression_str = ini_file->ReadString(geometry_section,
+			"Compression", "None");
+
+	// Check compression
+	Cache::Compression compression = (Cache::Compression)
+			Cache::CompressionMap.MapString(compression_str);
+	if (!compression)
+		throw Error(misc::fmt("%s: Cache %s: %s: "
+				"Invalid compression algorithm.\n%s",
+				ini_file->getPath().c_str(),
+				module_name.c_str(),
+				compression_str.c_str(),
+				err_config_note));
+
+	// Compression parameters
+	int compression_tag_factor = 1;
+	int decompression_latency = 0;
+	if (compression != Cache::CompressionNone)
+	{
+		compression_tag_factor = ini_file->ReadInt(geometry_section,
+				"CompressionTagFactor", 2);
+		decompression_latency = ini_file->ReadInt(geometry_section,
+				"DecompressionLatency",
+				compression == Cache::CompressionFPC ? 5 : 1);
+	}
 
 	// Check replacement policy
 	Cache::ReplacementPolicy replacement_policy =
@@ -576,6 +646,43 @@ Module *System::ConfigReadCache(misc::IniFile *ini_file,
 				ini_file->getPath().c_str(),
 				module_name.c_str(),
 				err_config_note));
+	if (num_banks < 0 || (num_banks & (num_banks - 1)))
+		throw Error(misc::fmt("%s: cache %s: number of banks must be "
+				"a power of two.\n%s",
+				ini_file->getPath().c_str(),
+				module_name.c_str(),
+				err_config_note));
+	if (bank_interleave < 1 || (bank_interleave & (bank_interleave - 1)))
+		throw Error(misc::fmt("%s: cache %s: bank interleaving must be "
+				"a power of two.\n%s",
+				ini_file->getPath().c_str(),
+				module_name.c_str(),
+				err_config_note));
+	if (compression_tag_factor < 1 || (compression_tag_factor &
+			(compression_tag_factor - 1)))
+		throw Error(misc::fmt("%s: cache %s: compression tag factor "
+				"must be a power of two.\n%s",
+				ini_file->getPath().c_str(),
+				module_name.c_str(),
+				err_config_note));
+	if (decompression_latency < 0)
+		throw Error(misc::fmt("%s: cache %s: invalid value for "
+				"variable 'DecompressionLatency'.\n%s",
+				ini_file->getPath().c_str(),
+				module_name.c_str(),
+				err_config_note));
+	if (compression != Cache::CompressionNone &&
+			block_size > (int) Memory::PageSize)
+		throw Error(misc::fmt("%s: cache %s: block size cannot exceed "
+				"the page size in a compressed cache.\n%s",
+				ini_file->getPath().c_str(),
+				module_name.c_str(),
+				err_config_note));
+
+	// With compression, the number of tags per set exceeds the number of
+	// uncompressed blocks that fit in the data array of the set. The
+	// directory has one entry per tag.
+	int num_tags = num_ways * compression_tag_factor;
 
 	// Create module
 	Module *module = addModule(module_name,
@@ -585,8 +692,10 @@ Module *System::ConfigReadCache(misc::IniFile *ini_file,
 			latency);
 	
 	// Initialize module
-	module->setDirectoryProperties(num_sets, num_ways, directory_latency);
+	module->setDirectoryProperties(num_sets, num_tags, directory_latency);
 	module->setMSHRSize(mshr_size);
+	if (num_banks)
+		module->setBanks(num_banks, bank_interleave, bank_pipelined);
 
 	// High network
 	std::string network_name = ini_file->ReadString(section, "HighNetwork");
@@ -616,10 +725,14 @@ Module *System::ConfigReadCache(misc::IniFile *ini_file,
 
 	// Create cache
 	module->setCache(num_sets,
-			num_ways,
+			num_tags,
 			block_size,
 			replacement_policy,
 			write_policy);
+	if (compression != Cache::CompressionNone)
+		module->getCache()->setCompression(compression,
+				num_ways * block_size,
+				decompression_latency);
 
 	// Done
 	return module;
@@ -1180,7 +1293,7 @@ void System::ConfigCreateSwitches(misc::IniFile *ini_file)
 		// Calculate routes
 		net::RoutingTable *routing_table = network->getRoutingTable();
 		routing_table->Initialize();
-		routing_table->FloydWarshall();
+		routing_table->CalculateRoutes();
 
 		// Debug
 		debug << '\n';
@@ -1218,10 +1331,10 @@ void System::ConfigCheckRoutes(misc::IniFile *ini_file)
 			// Check that there is a route
 			net::Network *network = module->getLowNetwork();
 			net::RoutingTable *routing_table = network->getRoutingTable();
-			net::RoutingTable::Entry *entry = routing_table->Lookup(
+			net::RoutingTable::Entry entry = routing_table->Lookup(
 					module->getLowNetworkNode(),
 					low_module->getHighNetworkNode());
-			if (!entry->getBuffer())
+			if (!entry.getBuffer())
 				throw Error(misc::fmt("%s: %s: network does not "
 						"connect '%s' with '%s'. %s",
 						ini_file->getPath().c_str(),
@@ -1251,10 +1364,10 @@ void System::ConfigCheckRoutes(misc::IniFile *ini_file)
 			// Check that there is a route
 			net::Network *network = module->getHighNetwork();
 			net::RoutingTable *routing_table = network->getRoutingTable();
-			net::RoutingTable::Entry *entry = routing_table->Lookup(
+			net::RoutingTable::Entry entry = routing_table->Lookup(
 					module->getHighNetworkNode(),
 					high_module->getLowNetworkNode());
-			if (!entry->getBuffer())
+			if (!entry.getBuffer())
 				throw Error(misc::fmt("%s: %s: network does not "
 						"connect '%s' with '%s'. %s",
 						ini_file->getPath().c_str(),
@@ -1334,6 +1447,25 @@ void System::ConfigSetModuleLevel(Module *module, int level)
 }
 
 
+void System::ConfigSetModuleMmu(Module *module, Mmu *mmu)
+{
+	// The MMU of an architecture translates the physical addresses of the
+	// blocks in all modules reachable from its entries. Ignore if not
+	// available or if the module was already visited.
+	Cache *cache = module->getCache();
+	if (!mmu || cache->getMmu())
+		return;
+	cache->setMmu(mmu);
+
+	// Set MMU of lower level modules
+	for (int i = 0; i < module->getNumLowModules(); i++)
+	{
+		Module *low_module = module->getLowModule(i);
+		ConfigSetModuleMmu(low_module, mmu);
+	}
+}
+
+
 void System::ConfigCalculateModuleLevels()
 {
 	// Start recursive level assignment with L1 modules (entries to memory)
@@ -1353,6 +1485,7 @@ void System::ConfigCalculateModuleLevels()
 		{
 			Module *module = timing->getEntryModule(i);
 			ConfigSetModuleLevel(module, 1);
+			ConfigSetModuleMmu(module, timing->getMmu());
 		}
 	}
 
@@ -1471,6 +1604,45 @@ void System::ConfigTrace()
 }
 
 
+void System::ConfigIntervalStats()
+{
+	// Ignore if interval statistics are not active
+	esim::IntervalStats *interval_stats = esim::IntervalStats::getInstance();
+	if (!interval_stats->isActive())
+		return;
+
+	// Internal networks
+	for (auto &network : networks)
+		network->RegisterIntervalStats();
+
+	// Modules
+	for (auto &module : modules)
+	{
+		// If module is unreachable, ignore it
+		Module *mod = module.get();
+		if (!mod->getLevel())
+			continue;
+
+		// Accesses, hits, misses, and evictions
+		const std::string &name = mod->getName();
+		interval_stats->RegisterCounter(name + ".Accesses",
+				[mod]() { return mod->getNumAccesses(); });
+		interval_stats->RegisterCounter(name + ".Hits",
+				[mod]() { return mod->getNumHits(); });
+		interval_stats->RegisterCounter(name + ".Misses",
+				[mod]() { return mod->getNumAccesses() -
+				mod->getNumHits(); });
+		interval_stats->RegisterCounter(name + ".Evictions",
+				[mod]() { return mod->getNumEvictions(); });
+
+		// MSHR occupancy at the time of the sample
+		interval_stats->RegisterGauge(name + ".MSHR",
+				[mod]() { return (long long)
+				mod->getMSHROccupancy(); });
+	}
+}
+
+
 void System::ConfigReadCommands(misc::IniFile *ini_file)
 {
 }
@@ -1553,6 +1725,9 @@ void System::ReadConfiguration(misc::IniFile *ini_file)
 
 	// Dump configuration to trace file
 	ConfigTrace();
+
+	// Register module and network statistics for interval statistics
+	ConfigIntervalStats();
 }
 
 
@@ -85,6 +85,7 @@ esim::Event *System::event_read_request_reply;
 esim::Event *System::event_read_request_finish;
 
 esim::Event *System::event_invalidate;
+esim::Event *System::event_invalidate_multicast;
 esim::Event *System::event_invalidate_finish;
 
 esim::Event *System::event_message;
@@ -358,9 +359,16 @@ void System::EventLoadHandler(esim::Event *event, esim::Frame *esim_frame)
 		// Stats
 		module->incDataAccesses();
 
+		// A hit on a compressed block needs decompression
+		int decompression_latency = frame->state ?
+				cache->getDecompressionLatency(frame->set,
+				frame->way) : 0;
+
 		// Continue with 'load-finish' after latency
 		esim_engine->Next(event_load_finish,
-				module->getDataLatency());
+				module->getDataLatency() +
+				module->AccessDataBank(frame->getAddress()) +
+				decompression_latency);
 		return;
 	}
 
@@ -634,7 +642,8 @@ void System::EventStoreHandler(esim::Event *event,
 		// Continue to 'store-finish' after data latency
 		module->incDataAccesses();
 		esim_engine->Next(event_store_finish,
-				module->getDataLatency());
+				module->getDataLatency() +
+				module->AccessDataBank(frame->getAddress()));
 		return;
 	}
 
@@ -1021,7 +1030,8 @@ void System::EventNCStoreHandler(esim::Event *event,
 
 		// Continue with 'store-finish' after access latency
 		esim_engine->Next(event_nc_store_finish,
-				module->getDataLatency());
+				module->getDataLatency() +
+				module->AccessDataBank(frame->getAddress()));
 		return;
 	}
 
@@ -1175,7 +1185,8 @@ void System::EventFindAndLockHandler(esim::Event *event,
 
 			// Find a victim to evict, only in up-down accesses.
 			assert(!frame->way);
-			frame->way = cache->ReplaceBlock(frame->set);
+			frame->way = cache->ReplaceBlock(frame->set,
+					frame->tag);
 		}
 		assert(frame->way >= 0);
 
@@ -1284,7 +1295,8 @@ void System::EventFindAndLockHandler(esim::Event *event,
 		// Access latency
 		module->incDirectoryAccesses();
 		esim_engine->Next(event_find_and_lock_action,
-				module->getDirectoryLatency());
+				module->getDirectoryLatency() +
+				module->AccessTagBank(frame->getAddress()));
 
 		// Done
 		return;
@@ -1720,7 +1732,8 @@ void System::EventEvictHandler(esim::Event *event,
 
 		// Continue with 'evict-reply', after data latency
 		esim_engine->Next(event_evict_reply,
-				target_module->getDataLatency());
+				target_module->getDataLatency() +
+				target_module->AccessDataBank(frame->getAddress()));
 		return;
 	}
 
@@ -1828,7 +1841,8 @@ void System::EventEvictHandler(esim::Event *event,
 		
 		// Continue with 'evict-reply' after latency
 		esim_engine->Next(event_evict_reply,
-				target_module->getDataLatency());
+				target_module->getDataLatency() +
+				target_module->AccessDataBank(frame->getAddress()));
 		return;
 	}
 
@@ -1983,6 +1997,14 @@ void System::EventWriteRequestHandler(esim::Event *event,
 			destination_node = target_module->getLowNetworkNode();
 		}
 
+		// Requests sent to several sharers in a multicast message by
+		// the 'invalidate' event chain wait for their copy
+		if (frame->message)
+		{
+			network->WaitMulticast(frame->message, destination_node);
+			return;
+		}
+
 		// Send message
 		frame->message = network->TrySend(source_node,
 				destination_node,
@@ -2303,9 +2325,16 @@ void System::EventWriteRequestHandler(esim::Event *event,
 		// Stats
 		target_module->incDataAccesses();
 
+		// A hit on a compressed block needs decompression
+		int decompression_latency = frame->state ?
+				target_cache->getDecompressionLatency(
+				frame->set, frame->way) : 0;
+
 		// Continue with 'write-request-reply' after data latency
 		esim_engine->Next(event_write_request_reply,
-				target_module->getDataLatency());
+				target_module->getDataLatency() +
+				target_module->AccessDataBank(frame->getAddress()) +
+				decompression_latency);
 		return;
 	}
 
@@ -2403,7 +2432,8 @@ void System::EventWriteRequestHandler(esim::Event *event,
 			// Data latency
 			target_module->incDataAccesses();
 			esim_engine->Next(event_write_request_reply,
-					target_module->getDataLatency());
+					target_module->getDataLatency() +
+					target_module->AccessDataBank(frame->getAddress()));
 			break;
 		}
 
@@ -2977,9 +3007,17 @@ void System::EventReadRequestHandler(esim::Event *event,
 		// Stats
 		target_module->incDataAccesses();
 
+		// A hit on a compressed block needs decompression
+		int decompression_latency = frame->state ?
+				target_module->getCache()->
+				getDecompressionLatency(frame->set,
+				frame->way) : 0;
+
 		// Continue with 'read-request-reply' after latency
 		esim_engine->Next(event_read_request_reply,
-				target_module->getDataLatency());
+				target_module->getDataLatency() +
+				target_module->AccessDataBank(frame->getAddress()) +
+				decompression_latency);
 		return;
 	}
 
@@ -3175,7 +3213,8 @@ void System::EventReadRequestHandler(esim::Event *event,
 
 		// Continue with 'read-request-reply' after data latency
 		esim_engine->Next(event_read_request_reply,
-				target_module->getDataLatency());
+				target_module->getDataLatency() +
+				target_module->AccessDataBank(frame->getAddress()));
 		return;
 	}
 
@@ -3380,9 +3419,98 @@ void System::EventInvalidateHandler(esim::Event *event,
 						directory_entry_tag);
 				new_frame->target_module = sharer;
 				new_frame->request_direction = Frame::RequestDirectionDownUp;
+
+				// With multicast, the requests to the sharers
+				// of a sub-block are sent later in one message
+				if (high_network->hasMulticast())
+				{
+					frame->multicast_frames.push_back(
+							new_frame);
+					continue;
+				}
+				esim_engine->Call(event_write_request,
+						new_frame,
+						event_invalidate_finish);
+			}
+		}
+
+		// Continue with 'invalidate-multicast' or 'invalidate-finish'
+		// event
+		esim_engine->Next(frame->multicast_frames.empty() ?
+				event_invalidate_finish :
+				event_invalidate_multicast);
+		return;
+	}
+
+	// Event "invalidate_multicast"
+	if (event == event_invalidate_multicast)
+	{
+		// Debug and trace
+		debug << misc::fmt("  %lld A-%lld 0x%x %s invalidate_multicast\n",
+				esim_engine->getTime(),
+				frame->getId(),
+				frame->tag,
+				module->getName().c_str());
+		trace << misc::fmt("mem.access "
+				"name=\"A-%lld\" "
+				"state=\"%s:invalidate_multicast\"\n",
+				frame->getId(),
+				module->getName().c_str());
+
+		// Send the requests for one sub-block at a time
+		net::Network *network = module->getHighNetwork();
+		while (!frame->multicast_frames.empty())
+		{
+			// Sharers of the first sub-block
+			unsigned address = frame->multicast_frames.front()->
+					getAddress();
+			std::vector<net::EndNode *> destination_nodes;
+			for (auto &new_frame : frame->multicast_frames)
+			{
+				if (new_frame->getAddress() != address)
+					break;
+				destination_nodes.push_back(new_frame->
+						target_module->
+						getLowNetworkNode());
+			}
+
+			// A single sharer gets a regular request
+			if (destination_nodes.size() == 1)
+			{
+				esim_engine->Call(event_write_request,
+						frame->multicast_frames.front(),
+						event_invalidate_finish);
+				frame->multicast_frames.pop_front();
+				continue;
+			}
+
+			// Send message, or retry later
+			net::Message *message = network->TrySendMulticast(
+					module->getHighNetworkNode(),
+					destination_nodes,
+					8,
+					event_write_request_receive,
+					event);
+			if (!message)
+				return;
+			net::System::trace << misc::fmt("net.msg_access "
+					"net=\"%s\" "
+					"name=\"M-%lld\" "
+					"access=\"A-%lld\"\n",
+					network->getName().c_str(),
+					message->getId(),
+					frame->getId());
+
+			// Start the requests, which wait for their copy of the
+			// message to arrive
+			for (unsigned i = 0; i < destination_nodes.size(); i++)
+			{
+				auto new_frame = frame->multicast_frames.front();
+				new_frame->message = message;
 				esim_engine->Call(event_write_request,
 						new_frame,
 						event_invalidate_finish);
+				frame->multicast_frames.pop_front();
 			}
 		}
 
@@ -4115,7 +4243,8 @@ void System::EventLocalFindAndLockHandler(esim::Event *event,
 
 		// Schedule event
 		esim_engine->Next(event_local_find_and_lock_action,
-				module->getDataLatency());
+				module->getDataLatency() +
+				module->AccessDataBank(frame->getAddress()));
 
 		return;
 	}
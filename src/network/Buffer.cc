@@ -17,8 +17,7 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <algorithm>
-
+#include "Link.h"
 #include "Message.h"
 #include "Network.h"
 #include "Buffer.h"
@@ -46,12 +45,16 @@ void Buffer::InsertPacket(Packet *packet)
 
 	// Update count
 	count += packet->getSize();
+	written_bytes += packet->getSize();
 
 	// Update statistics
 	UpdateOccupancyInformation();
 
 	// Insert the packet into buffer
-	packets.push_back(packet);
+	if (num_packets == (int) packets.size())
+		GrowPackets();
+	getPacket(num_packets) = packet;
+	num_packets++;
 
 	// Debug
 	Message *message = packet->getMessage();
@@ -65,18 +68,40 @@ void Buffer::InsertPacket(Packet *packet)
 }
 
 
+void Buffer::GrowPackets()
+{
+	// Copy packets in order into a ring with double capacity
+	std::vector<Packet *> new_packets(packets.empty() ? 4 :
+			packets.size() * 2);
+	for (int i = 0; i < num_packets; i++)
+		new_packets[i] = getPacket(i);
+	packets.swap(new_packets);
+	packets_head = 0;
+}
+
+
 void Buffer::RemovePacket(Packet *packet)
 {
 	// Check if the packet is in the buffer
-	if (std::find(packets.begin(), packets.end(), packet) == packets.end())
+	int index = 0;
+	while (index < num_packets && getPacket(index) != packet)
+		index++;
+	if (index == num_packets)
 		throw misc::Panic("Trying to remove a packet that is not in"
 				" current buffer");
 
 	// Reduce the occupied size of the buffer
 	count -= packet->getSize();
+	read_bytes += packet->getSize();
+
+	// Remove the packet, shifting the following ones. Packets are
+	// usually removed from the head.
+	for (int i = index; i < num_packets - 1; i++)
+		getPacket(i) = getPacket(i + 1);
+	num_packets--;
 
-	// Remove the packet
-	packets.remove(packet);
+	// Return credits to the other side of the link
+	ReturnUpstreamCredits(packet);
 
 	// Wake up the buffer event queue
 	if (!event_queue.isEmpty())
@@ -97,28 +122,41 @@ void Buffer::UpdateOccupancyInformation()
 
 	// Storing the new samples for next use
 	occupancy_in_bytes = count;
-	occupancy_in_packets = packets.size();
+	occupancy_in_packets = num_packets;
 	occupancy_measured_cycle = cycle;
 }
 
 
+long long Buffer::getAccumulatedOccupancyInBytes() const
+{
+	long long cycle = System::getInstance()->getCycle();
+	return accumulated_occupancy_in_bytes + occupancy_in_bytes *
+			(cycle - occupancy_measured_cycle);
+}
+
+
 void Buffer::ExtractPacket()
 {
 	// Check if there is a packet to be poped
-	if (packets.size() == 0)
+	if (num_packets == 0)
 		throw misc::Panic("No packets to pop");
 
 	// Get the reference of packet that is going to be poped
-	Packet *packet = packets.front();
+	Packet *packet = packets[packets_head];
 
 	// Remove the packet from the queue
-	packets.pop_front();
+	packets_head = (packets_head + 1) & (packets.size() - 1);
+	num_packets--;
 
 	// Updating the statistics
 	UpdateOccupancyInformation();
 
 	// Reduce the count of the packet
 	count -= packet->getSize();
+	read_bytes += packet->getSize();
+
+	// Return credits to the other side of the link
+	ReturnUpstreamCredits(packet);
 
 	// Wake up the buffer event queue
 	if (!event_queue.isEmpty())
@@ -136,6 +174,47 @@ void Buffer::ExtractPacket()
 }
 
 
+void Buffer::ReturnUpstreamCredits(Packet *packet)
+{
+	// Credits are only used in flit-level networks, and only for the
+	// input buffers of links.
+	Network *network = packet->getMessage()->getNetwork();
+	if (!network->isFlitLevel())
+		return;
+	Link *link = dynamic_cast<Link *>(connection);
+	if (!link || link->getDestinationNode() != node)
+		return;
+
+	// Return credits to the paired output buffer
+	Buffer *source_buffer = link->getSourceBufferFromDestination(this);
+	source_buffer->ReturnCredits(packet->getSize(),
+			network->getCreditDelay());
+}
+
+
+int Buffer::getCredits()
+{
+	// Collect credits that arrived by the current cycle
+	long long cycle = System::getInstance()->getCycle();
+	while (!returned_credits.empty() &&
+			returned_credits.front().first <= cycle)
+	{
+		credits += returned_credits.front().second;
+		returned_credits.pop_front();
+	}
+
+	// Return available credits
+	return credits;
+}
+
+
+void Buffer::ReturnCredits(int size, int delay)
+{
+	long long cycle = System::getInstance()->getCycle();
+	returned_credits.emplace_back(cycle + delay, size);
+}
+
+
 void Buffer::Dump(std::ostream &os)
 {
 	// Update the occupancy information before the report
@@ -20,6 +20,9 @@
 #ifndef NETWORK_BUFFER_H
 #define NETWORK_BUFFER_H
 
+#include <deque>
+#include <vector>
+
 #include <lib/esim/Engine.h>
 #include <lib/esim/Event.h>
 #include <lib/esim/Queue.h>
@@ -29,6 +32,7 @@
 namespace net
 {
 class Connection;
+class Message;
 class Node;
 class Packet;
 
@@ -65,8 +69,48 @@ class Buffer
 	// or a bus.
 	Buffer *scheduled_buffer = nullptr;
 
-	// A list of packets in the buffer
-	std::list<Packet *> packets;
+	// Packets in the buffer, stored as a ring starting at index
+	// 'packets_head'. The capacity is a power of two that only grows when
+	// the buffer holds more packets than ever before, which is bounded by
+	// the buffer size.
+	std::vector<Packet *> packets;
+
+	// Index of the first packet in the ring
+	int packets_head = 0;
+
+	// Number of packets in the buffer
+	int num_packets = 0;
+
+	// Return the packet at position 'index' from the head of the ring
+	Packet *&getPacket(int index)
+	{
+		return packets[(packets_head + index) & (packets.size() - 1)];
+	}
+
+	// Double the capacity of the ring
+	void GrowPackets();
+
+
+
+	//
+	// Flit-level switching
+	//
+
+	// For output buffers, message that holds the buffer as its virtual
+	// channel between its head and tail flits.
+	Message *owner = nullptr;
+
+	// For input buffers, output buffer allocated to the message whose
+	// flits are currently at the head of the buffer.
+	Buffer *allocated_buffer = nullptr;
+
+	// For output buffers of links, credits available for the paired
+	// input buffer on the other side of the link, in bytes.
+	int credits = 0;
+
+	// Credits returned by the paired input buffer that are still in
+	// flight, with the cycle when they become available.
+	std::deque<std::pair<long long, int>> returned_credits;
 
 
 
@@ -89,6 +133,14 @@ class Buffer
 	// Accumulated packets that occupied the buffer
 	long long accumulated_occupancy_in_packets = 0;
 
+	// Bytes written into and read from the buffer
+	long long written_bytes = 0;
+	long long read_bytes = 0;
+
+	// In flit-level networks, return the credits for a packet leaving
+	// an input buffer to the output buffer on the other side of its link.
+	void ReturnUpstreamCredits(Packet *packet);
+
 public:
 
 	/// Constructor
@@ -160,23 +212,71 @@ public:
 	/// Get number of packets in the buffer
 	int getNumPacket()
 	{
-		return packets.size();
+		return num_packets;
 	}
 
 	/// Get the first packet in the buffer
 	Packet *getBufferHead() 
 	{
-		if (packets.empty())
+		if (!num_packets)
 			return nullptr;
-		return packets.front();
+		return packets[packets_head];
 	}
 
 	/// Remove a certain packet from the buffer
 	void RemovePacket(Packet *packet);
 
+	/// Return the message holding this output buffer as its virtual
+	/// channel, or `nullptr` if the virtual channel is free.
+	Message *getOwner() const { return owner; }
+
+	/// Allocate the output buffer to a message, or release it if
+	/// \a owner is `nullptr`.
+	void setOwner(Message *owner) { this->owner = owner; }
+
+	/// Return the output buffer allocated to the message at the head
+	/// of this input buffer, or `nullptr` if none was allocated yet.
+	Buffer *getAllocatedBuffer() const { return allocated_buffer; }
+
+	/// Set the output buffer allocated to the message at the head of
+	/// this input buffer.
+	void setAllocatedBuffer(Buffer *buffer) { allocated_buffer = buffer; }
+
+	/// Set the initial number of credits of an output buffer
+	void setCredits(int credits) { this->credits = credits; }
+
+	/// Return the credits available in the current cycle, collecting
+	/// first all returned credits that arrived by now.
+	int getCredits();
+
+	/// Consume credits for a packet sent to the paired input buffer
+	void ConsumeCredits(int size) { credits -= size; }
+
+	/// Return credits to this output buffer, that become available
+	/// after \a delay cycles.
+	void ReturnCredits(int size, int delay);
+
+	/// Return the cycle when the next credits in flight arrive, or -1
+	/// if there are no credits in flight.
+	long long getNextCreditCycle() const
+	{
+		return returned_credits.empty() ? -1 :
+				returned_credits.front().first;
+	}
+
 	/// Updating the buffer statistics
 	void UpdateOccupancyInformation();
 
+	/// Return the byte occupancy of the buffer accumulated over all
+	/// cycles until the current one
+	long long getAccumulatedOccupancyInBytes() const;
+
+	/// Return the number of bytes written into the buffer
+	long long getWrittenBytes() const { return written_bytes; }
+
+	/// Return the number of bytes read from the buffer
+	long long getReadBytes() const { return read_bytes; }
+
 	/// Dump the buffer information
 	void Dump(std::ostream &os = std::cout);
 
@@ -129,9 +129,9 @@ void Bus::TransferPacket(Packet *packet)
 	// Get the next entry in the routing table
 	RoutingTable *routing_table = network->getRoutingTable();
 	Node *destination_node = message->getDestinationNode();
-	RoutingTable::Entry *entry =
+	RoutingTable::Entry entry =
 			routing_table->Lookup(node, destination_node);
-	if (!entry)
+	if (!entry.getNextNode())
 		throw misc::Panic(misc::fmt("%s: no route from %s to %s.",
 				network->getName().c_str(),
 				node->getName().c_str(),
@@ -141,7 +141,7 @@ void Bus::TransferPacket(Packet *packet)
 	Buffer *destination_buffer = nullptr;
 	for (Buffer *buffer : destination_buffers)
 	{
-		if (entry->getNextNode() == buffer->getNode())
+		if (entry.getNextNode() == buffer->getNode())
 		{
 			destination_buffer = buffer;
 			break;
@@ -133,6 +133,16 @@ public:
 	/// Transfer the packet from an output buffer
 	void TransferPacket(Packet *packet);
 
+	/// Return the number of cycles a lane is busy transferring a packet
+	/// of \a size bytes
+	int getTransferLatency(int size) const
+	{
+		return (size - 1) / lanes[0]->getBandwidth() + 1;
+	}
+
+	/// Return the number of lanes
+	int getNumChannels() const { return lanes.size(); }
+
 
 
 
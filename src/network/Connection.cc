@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+
 #include "Connection.h"
 #include "Network.h"
 #include "Buffer.h"
@@ -31,6 +33,40 @@ Connection::Connection(const std::string &name, Network *network) :
 }
 
 
+void Connection::UpdateWindow(long long cycle, int window)
+{
+	// Still in the current window
+	if (cycle < window_start + window)
+		return;
+
+	// The current window becomes the previous one, unless a whole
+	// window passed with no transfers.
+	previous_window_busy_cycles = cycle < window_start + 2 * window ?
+			window_busy_cycles : 0;
+	window_busy_cycles = 0;
+	window_start = cycle - (cycle - window_start) % window;
+}
+
+
+int Connection::EstimateQueueingDelay(long long cycle,
+		int transfer_latency, int window)
+{
+	// Utilization per channel, bounded to keep the delay finite when
+	// the offered load exceeds the capacity of the connection.
+	UpdateWindow(cycle, window);
+	double utilization = (double) (previous_window_busy_cycles +
+			window_busy_cycles) / (window + cycle - window_start) /
+			getNumChannels();
+	utilization = std::min(utilization, 0.99);
+
+	// Charge the transfer
+	window_busy_cycles += transfer_latency;
+
+	// Waiting time of an M/D/1 queue
+	return utilization * transfer_latency / (2 * (1 - utilization));
+}
+
+
 void Connection::addSourceBuffer(Buffer* buffer)
 {
 	this->source_buffers.emplace_back(buffer);
@@ -47,6 +47,15 @@ protected:
 	// List of the destination buffers connected to the bus
 	std::vector<Buffer *> destination_buffers;
 
+	// Analytical model. First cycle of the current utilization window,
+	// and transfer cycles charged in the current and previous windows.
+	long long window_start = 0;
+	long long window_busy_cycles = 0;
+	long long previous_window_busy_cycles = 0;
+
+	// Move the utilization window forward to contain the given cycle
+	void UpdateWindow(long long cycle, int window);
+
 public:
 
 	/// Constructor
@@ -84,6 +93,23 @@ public:
 
 	/// Transfer the packet 
 	virtual void TransferPacket(Packet *packet) = 0;
+
+	/// Return the number of cycles the connection is busy transferring
+	/// a packet of \a size bytes
+	virtual int getTransferLatency(int size) const = 0;
+
+	/// Return the number of packets the connection can transfer at the
+	/// same time
+	virtual int getNumChannels() const { return 1; }
+
+	/// Analytical model. Return the expected number of cycles a packet
+	/// that is busy in the connection for \a transfer_latency cycles
+	/// waits before it is transferred in the given cycle, and charge its
+	/// transfer to the utilization of the connection. The connection is
+	/// modeled as an M/D/1 queue whose utilization is estimated over the
+	/// last one to two windows of \a window cycles.
+	int EstimateQueueingDelay(long long cycle, int transfer_latency,
+			int window);
 };
 }
 
@@ -226,8 +226,31 @@ void Link::TransferPacket(Packet *packet)
 		return;
 	}
 
-	// Check if the destination buffer is full
+	// In flit-level networks, the output buffer needs enough credits
+	// for the packet. Credits in flight arrive in a later cycle, while
+	// credits are only returned once the destination buffer drains.
 	int packet_size = packet->getSize();
+	if (network->isFlitLevel() &&
+			source_buffer->getCredits() < packet_size)
+	{
+		// Update debug information
+		System::debug << misc::fmt("net: %s - M-%lld:%d - "
+				"stl_no_credits: %s:%s\n",
+				network->getName().c_str(),
+				message->getId(), packet->getId(),
+				node->getName().c_str(),
+				source_buffer->getName().c_str());
+
+		// Wait for credits
+		long long credit_cycle = source_buffer->getNextCreditCycle();
+		if (credit_cycle >= 0)
+			esim_engine->Next(current_event, credit_cycle - cycle);
+		else
+			destination_buffer->Wait(current_event);
+		return;
+	}
+
+	// Check if the destination buffer is full
 	if (destination_buffer->getCount() + packet_size >
 			destination_buffer->getSize())
 	{
@@ -261,6 +284,10 @@ void Link::TransferPacket(Packet *packet)
 	busy = cycle + latency - 1;
 	destination_buffer->write_busy = cycle + latency - 1;
 
+	// Consume credits
+	if (network->isFlitLevel())
+		source_buffer->ConsumeCredits(packet_size);
+
 	// Transfer message to next input buffer
 	source_buffer->ExtractPacket();
 	destination_buffer->InsertPacket(packet);
@@ -367,4 +394,23 @@ Buffer *Link::getDestinationBufferfromSource(Buffer *buffer)
 	// Buffer is not found
 	return nullptr;
 }
+
+
+Buffer *Link::getSourceBufferFromDestination(Buffer *buffer)
+{
+	for (unsigned i = 0; i < destination_buffers.size(); i++)
+		if (buffer == destination_buffers[i])
+			return source_buffers[i];
+
+	// Buffer is not found
+	return nullptr;
+}
+
+
+void Link::InitializeCredits()
+{
+	for (unsigned i = 0; i < source_buffers.size(); i++)
+		source_buffers[i]->setCredits(destination_buffers[i]->getSize());
+}
+
 }
@@ -112,6 +112,9 @@ public:
 	/// Get the amount of transfered bytes
 	long long getTransferredBytes() const { return transferred_bytes; }
 
+	/// Get the number of transferred packets
+	long long getTransferredPackets() const { return transferred_packets; }
+
 	/// Get destination node
 	Node *getDestinationNode() const { return destination_node; }
 
@@ -132,6 +135,13 @@ public:
 	/// Transfer the packet from an output buffer 
 	void TransferPacket(Packet *packet);
 
+	/// Return the number of cycles the link is busy transferring a
+	/// packet of \a size bytes
+	int getTransferLatency(int size) const
+	{
+		return (size - 1) / bandwidth + 1;
+	}
+
 	/// This function returns the buffer that is scheduled to transmit
 	/// a packet on the link on the current cycle. The arbitration
 	/// is in round-robin fashion.
@@ -153,6 +163,15 @@ public:
 	///		source buffer.
 	///
 	Buffer *getDestinationBufferfromSource(Buffer *buffer);
+
+	/// Return the source buffer that is paired with the given
+	/// destination buffer in a virtual channel, or `nullptr` if the
+	/// buffer is not a destination buffer of the link.
+	Buffer *getSourceBufferFromDestination(Buffer *buffer);
+
+	/// Give each source buffer as many credits as the capacity of its
+	/// paired destination buffer. Used in flit-level networks.
+	void InitializeCredits();
 };
 
 
@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <cassert>
+
 #include <lib/cpp/Misc.h>
 #include <lib/cpp/Error.h>
 #include <lib/cpp/String.h>
@@ -31,58 +33,112 @@
 namespace net
 {
 
-Message::Message(long long id, 
-		Network *network,
-		Node *source_node, 
-		Node *destination_node, 
+Message::Message(Network *network) :
+		network(network)
+{
+}
+
+
+void Message::Reset(long long id,
+		Node *source_node,
+		Node *destination_node,
 		int size,
-		long long cycle) :
-		id(id),
-		network(network),
-		source_node(source_node),
-		destination_node(destination_node),
-		size(size),
-		send_cycle(cycle)
+		long long cycle)
 {
+	this->id = id;
+	this->source_node = source_node;
+	this->destination_node = destination_node;
+	this->size = size;
+	send_cycle = cycle;
+	num_packets = 0;
+	num_received_packets = 0;
+
+	// Unicast by default
+	multicast_root = nullptr;
+	destinations.clear();
+	num_destinations = 1;
+	copies.clear();
+	delivered_copies.clear();
+	receive_event = nullptr;
+	num_received_copies = 0;
 }
 
 
-void Message::Packetize(int packet_size)
+void Message::UpdateDestinationNode()
 {
-	int packet_count = (size - 1) / packet_size + 1;
-	for (int i = 0; i < packet_count; i++)
+	// Count destinations and take the first one
+	destination_node = nullptr;
+	num_destinations = 0;
+	for (unsigned i = 0; i < destinations.size(); i++)
 	{
-		auto packet = misc::new_unique<Packet>(this, packet_size);
-		this->packets.push_back(std::move(packet));
+		if (!destinations[i])
+			continue;
+		if (!destination_node)
+			destination_node = network->getNode(i);
+		num_destinations++;
 	}
 }
 
 
-bool Message::Assemble(Packet *packet)
+void Message::setMulticast(Message *root,
+		const std::vector<bool> &destinations)
 {
-	// Check if the packet belongs to this message
-	bool is_packet_belongs_to_message = false;
-	for (auto &message_packet : packets)
+	// Set destinations
+	multicast_root = root;
+	this->destinations = destinations;
+	UpdateDestinationNode();
+	assert(num_destinations > 0);
+
+	// The original message tracks the delivery of copies to each node
+	if (root == this)
 	{
-		if (message_packet.get() == packet)
-		{
-			is_packet_belongs_to_message = true;
-			break;
-		}
+		delivered_copies.assign(destinations.size(), nullptr);
+		waiting_queues.resize(destinations.size());
 	}
-	if (!is_packet_belongs_to_message)
+}
+
+
+void Message::RemoveDestinations(const std::vector<bool> &destinations)
+{
+	// Clear destinations
+	assert(destinations.size() == this->destinations.size());
+	for (unsigned i = 0; i < destinations.size(); i++)
+		if (destinations[i])
+			this->destinations[i] = false;
+	UpdateDestinationNode();
+	assert(num_destinations > 0);
+}
+
+
+void Message::Packetize(int packet_size)
+{
+	// Create packet objects only if the message needs more packets than
+	// any previous message using this object.
+	num_packets = (size - 1) / packet_size + 1;
+	while ((int) packets.size() < num_packets)
+		packets.emplace_back(misc::new_unique<Packet>(this,
+				packets.size()));
+
+	// Initialize packets
+	for (int i = 0; i < num_packets; i++)
+		packets[i]->Reset(packet_size);
+}
+
+
+bool Message::Assemble(Packet *packet)
+{
+	// Check if the packet belongs to this message
+	if (packet->getMessage() != this || packet->getId() >= num_packets)
 		throw misc::Panic("Cannot assemble the message from a packet"
 				"that does not belongs this message.");
 
 	// Check if the packet has been assembled before
-	for (auto &received_packet : received_packets)
-	{
-		if (received_packet == packet)
-			throw misc::Panic("Packets have been assembled twice");
-	}
+	if (packet->isReceived())
+		throw misc::Panic("Packets have been assembled twice");
 
 	// Mark the packet has been received
-	received_packets.push_back(packet);
+	packet->setReceived();
+	num_received_packets++;
 
 	// Update the trace with the position of the packet, the depacketizer
 	net::System::trace << misc::fmt("net.packet net=\"%s\" "
@@ -92,7 +148,7 @@ bool Message::Assemble(Packet *packet)
 			packet->getNode()->getName().c_str());
 
 	// Check if all the packets of the message received
-	if (received_packets.size() == packets.size())
+	if (num_received_packets == num_packets)
 	{
 		return true;
 	}
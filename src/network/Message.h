@@ -23,6 +23,8 @@
 #include <vector>
 #include <memory>
 
+#include <lib/esim/Queue.h>
+
 #include "Packet.h"
 
 namespace net 
@@ -34,36 +36,95 @@ class Message
 {
 
 	// Id of the message
-	long long id;
+	long long id = 0;
 
 	// Network that this message belongs to 
 	Network *network;
 
 	// Source node
-	Node *source_node;
+	Node *source_node = nullptr;
 
 	// Destination node
-	Node *destination_node;
+	Node *destination_node = nullptr;
 
 	// Size of the message
-	int size;
+	int size = 0;
 
-	// A list of packet
+	// Packets of the message. Packet objects are kept when the message
+	// is recycled, so only the first 'num_packets' belong to the message
+	// currently using this object.
 	std::vector<std::unique_ptr<Packet>> packets;
 
-	// A list of received packets
-	std::vector<Packet *> received_packets;
+	// Number of packets of the message
+	int num_packets = 0;
+
+	// Number of packets received
+	int num_received_packets = 0;
 
 	// Cycle when the message was sent
-	long long send_cycle;
+	long long send_cycle = 0;
+
+
+
+	//
+	// Multicast
+	//
+
+	// Original multicast message that this message is a copy of, or the
+	// message itself if it is the original. Null for unicast messages.
+	Message *multicast_root = nullptr;
+
+	// Bitmask of the destination nodes of a multicast message that this
+	// copy still has to reach, indexed by node index. The destination
+	// node of the message is the first one in the bitmask.
+	std::vector<bool> destinations;
+
+	// Number of destinations in the bitmask
+	int num_destinations = 1;
+
+	// Original message only. Copies made from it, not including itself.
+	std::vector<Message *> copies;
+
+	// Original message only. Copy delivered to each node, by node index.
+	std::vector<Message *> delivered_copies;
+
+	// Original message only. Event chains waiting for a copy to be
+	// delivered to each node, by node index.
+	std::vector<esim::Queue> waiting_queues;
+
+	// Original message only. Event scheduled when a copy is delivered to
+	// a node that is waiting for it, or null if copies are received
+	// automatically.
+	esim::Event *receive_event = nullptr;
+
+	// Original message only. Number of copies received.
+	int num_received_copies = 0;
+
+	// Update the destination node after the bitmask changed
+	void UpdateDestinationNode();
 
 public:
 
-	/// Constructor
-	Message(long long id, Network *network, 
-			Node *source_node, Node *destination_node,
+	/// Constructor. Message objects are pooled by their network, and are
+	/// initialized with Reset() every time they are used for a new
+	/// message.
+	Message(Network *network);
+
+	/// Initialize the message with a new identifier, endpoints, size,
+	/// and send cycle, discarding its previous packets.
+	void Reset(long long id, Node *source_node, Node *destination_node,
 			int size, long long cycle);
 
+	/// Make the message a multicast message, or a copy of multicast
+	/// message \a root, to the destination nodes set in a bitmask indexed
+	/// by node index. The destination node of the message becomes the
+	/// first one in the bitmask.
+	void setMulticast(Message *root, const std::vector<bool> &destinations);
+
+	/// Remove the destinations set in a bitmask from the destinations of a
+	/// multicast message, after a copy was made for them
+	void RemoveDestinations(const std::vector<bool> &destinations);
+
 	/// Packetize
 	void Packetize(int packet_size);
 
@@ -96,10 +157,76 @@ public:
 	long long getSendCycle() const { return send_cycle; }
 
 	/// Get number of packets belongs to the message
-	int getNumPackets() const { return packets.size(); }
+	int getNumPackets() const { return num_packets; }
 
 	/// Get packet by index
 	Packet *getPacket(int index) const { return packets[index].get(); }
+
+	/// Return whether this is a multicast message, or a copy of one
+	bool isMulticast() const { return multicast_root; }
+
+	/// Return the original multicast message that this message is a copy
+	/// of, the message itself if it is the original, or `nullptr` for
+	/// unicast messages.
+	Message *getMulticastRoot() const { return multicast_root; }
+
+	/// Return the bitmask of destination nodes that a multicast message
+	/// still has to reach, indexed by node index
+	const std::vector<bool> &getDestinations() const
+	{
+		return destinations;
+	}
+
+	/// Return the number of destination nodes that the message still has
+	/// to reach, which is 1 for unicast messages
+	int getNumDestinations() const { return num_destinations; }
+
+	/// Original multicast message only. Record a copy made from it.
+	void addCopy(Message *copy) { copies.push_back(copy); }
+
+	/// Original multicast message only. Return the copies made from it,
+	/// not including itself.
+	const std::vector<Message *> &getCopies() const { return copies; }
+
+	/// Original multicast message only. Return the copy delivered to the
+	/// node with the given index, or `nullptr` if it was not delivered.
+	Message *getDeliveredCopy(int index) const
+	{
+		return delivered_copies[index];
+	}
+
+	/// Original multicast message only. Record the copy delivered to the
+	/// node with the given index.
+	void setDeliveredCopy(int index, Message *copy)
+	{
+		delivered_copies[index] = copy;
+	}
+
+	/// Original multicast message only. Return the queue of event chains
+	/// waiting for a copy delivered to the node with the given index.
+	esim::Queue *getWaitingQueue(int index)
+	{
+		return &waiting_queues[index];
+	}
+
+	/// Original multicast message only. Set the event scheduled when a
+	/// copy is delivered to a waiting node.
+	void setReceiveEvent(esim::Event *receive_event)
+	{
+		this->receive_event = receive_event;
+	}
+
+	/// Original multicast message only. Return the event scheduled when a
+	/// copy is delivered to a waiting node.
+	esim::Event *getReceiveEvent() const { return receive_event; }
+
+	/// Original multicast message only. Count a received copy, and return
+	/// whether all copies were received.
+	bool ReceiveCopy()
+	{
+		num_received_copies++;
+		return num_received_copies == (int) copies.size() + 1;
+	}
 };
 
 }  // namespace net
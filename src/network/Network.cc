@@ -17,11 +17,13 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <cstring>
 #include <csignal>
 #include <fstream>
 
 #include <lib/esim/Engine.h>
+#include <lib/esim/IntervalStats.h>
 
 #include "Buffer.h"
 #include "Bus.h"
@@ -31,10 +33,18 @@
 #include "Network.h"
 #include "RoutingTable.h"
 #include "Switch.h"
+#include "Topology.h"
 
 namespace net
 {
 
+const misc::StringMap Network::SwitchAllocatorMap =
+{
+	{ "RoundRobin", SwitchAllocatorRoundRobin },
+	{ "iSLIP", SwitchAllocatorISLIP }
+};
+
+
 
 static const char *err_cycle_detected =
 	"\tA cycle is detected in the graph representing the routing table"
@@ -88,6 +98,22 @@ void Network::ParseConfiguration(misc::IniFile *config,
 				name.c_str()));
 	}
 
+	// Analytical model
+	analytical = config->ReadBool(section, "Analytical", false);
+	analytical_window = config->ReadInt(section, "AnalyticalWindow", 1000);
+	if (analytical && fix_latency)
+		throw Error(misc::fmt("%s: Network %s: an analytical network "
+				"cannot have a fix latency or be ideal.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+	if (analytical_window < 1)
+		throw Error(misc::fmt("%s: Network %s: invalid analytical "
+				"window.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+
 	// Print a warning in case constant network is used
 	if (fix_latency > 0)
 	{
@@ -119,6 +145,111 @@ void Network::ParseConfiguration(misc::IniFile *config,
 				"negative.\n%s", config->getPath().c_str(),
 				name.c_str(), System::err_config_note));
 
+	// Flit-level switching. Flits are carried through the network as
+	// packets of the flit size.
+	flit_size = config->ReadInt(section, "FlitSize", 0);
+	router_stages = config->ReadInt(section, "RouterStages", 4);
+	credit_delay = config->ReadInt(section, "CreditDelay", 1);
+	if (flit_size < 0 || router_stages < 1 || credit_delay < 1)
+		throw Error(misc::fmt("%s: Network %s: invalid flit size, "
+				"router stages, or credit delay.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+	if (flit_size && analytical)
+		throw Error(misc::fmt("%s: Network %s: variables "
+				"FlitSize and Analytical cannot be set at the "
+				"same time.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+	if (flit_size && packet_size)
+		throw Error(misc::fmt("%s: Network %s: variables "
+				"FlitSize and DefaultPacketSize cannot be "
+				"set at the same time.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+	if (flit_size)
+		packet_size = flit_size;
+
+	// Multicast messages. Switches replicate whole messages, so copies
+	// cannot be made of flits.
+	multicast = config->ReadBool(section, "Multicast", false);
+	if (multicast && flit_size)
+		throw Error(misc::fmt("%s: Network %s: variables "
+				"Multicast and FlitSize cannot be set at the "
+				"same time.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+
+	// Energy model
+	buffer_write_energy = config->ReadDouble(section, "BufferWriteEnergy",
+			0.4);
+	buffer_read_energy = config->ReadDouble(section, "BufferReadEnergy",
+			0.3);
+	crossbar_energy = config->ReadDouble(section, "CrossbarEnergy", 0.5);
+	link_energy = config->ReadDouble(section, "LinkEnergy", 0.8);
+	if (buffer_write_energy < 0 || buffer_read_energy < 0 ||
+			crossbar_energy < 0 || link_energy < 0)
+		throw Error(misc::fmt("%s: Network %s: energies cannot be "
+				"negative.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+
+	// Switch allocator
+	std::string switch_allocator_name = config->ReadString(section,
+			"SwitchAllocator", "RoundRobin");
+	switch_allocator = (SwitchAllocator) SwitchAllocatorMap.MapStringCase(
+			switch_allocator_name);
+	if (!switch_allocator)
+		throw Error(misc::fmt("%s: Network %s: invalid switch "
+				"allocator '%s'.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				switch_allocator_name.c_str(),
+				System::err_config_note));
+	allocator_iterations = config->ReadInt(section,
+			"AllocatorIterations", 1);
+	if (allocator_iterations < 1)
+		throw Error(misc::fmt("%s: Network %s: invalid number of "
+				"allocator iterations.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+
+	// Generate a regular topology
+	std::string topology_name = config->ReadString(section, "Topology");
+	if (!topology_name.empty())
+	{
+		Topology::Kind kind = (Topology::Kind)
+				Topology::KindMap.MapStringCase(topology_name);
+		if (!kind)
+			throw Error(misc::fmt("%s: Network %s: invalid "
+					"topology '%s'.\n%s",
+					config->getPath().c_str(),
+					name.c_str(),
+					topology_name.c_str(),
+					System::err_config_note));
+		topology = misc::new_unique<Topology>(this, kind);
+		topology->ParseConfiguration(config, section);
+		topology->Generate(default_bandwidth,
+				default_input_buffer_size,
+				default_output_buffer_size);
+	}
+	// Copies of multicast messages follow the deterministic routes from
+	// the node where they are replicated
+	if (multicast && routing_table.isAdaptive())
+		throw Error(misc::fmt("%s: Network %s: multicast messages "
+				"are not supported with adaptive routing.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+	int num_generated_nodes = nodes.size();
+	int num_generated_connections = connections.size();
+
 	// Parse the configure file for nodes
 	ParseConfigurationForNodes(config);
 
@@ -131,15 +262,37 @@ void Network::ParseConfiguration(misc::IniFile *config,
 	// Parse the configuration file for Bus ports
 	ParseConfigurationForBusPorts(config);
 
+	// Generated topologies cannot be extended
+	if (topology && ((int) nodes.size() != num_generated_nodes ||
+			(int) connections.size() != num_generated_connections))
+		throw Error(misc::fmt("%s: Network %s: nodes, links, and "
+				"buses cannot be added to a network with a "
+				"generated topology.\n%s",
+				config->getPath().c_str(),
+				name.c_str(),
+				System::err_config_note));
+
+	// Output buffers of links start with as many credits as the input
+	// buffers on the other side can hold
+	if (flit_size)
+		for (auto &connection : connections)
+		{
+			Link *link = dynamic_cast<Link *>(connection.get());
+			if (link)
+				link->InitializeCredits();
+		}
+
 	// Time to create the initial routing table
 	routing_table.Initialize();
 
 	// Parse the routing elements, for manual routing.
 	if (!ParseConfigurationForRoutes(config))
-		routing_table.FloydWarshall();
+		routing_table.CalculateRoutes();
 
-	// If the network with current routing contains a cycle, warn
-	if (routing_table.hasCycle())
+	// If the network with current routing contains a cycle, warn. The
+	// routes of generated topologies are known in advance, and checking
+	// all pairs of nodes would be too slow for large networks.
+	if (topology ? topology->hasCycle() : routing_table.hasCycle())
 		misc::Warning("Network %s: Cycle found in the "
 				"routing table.\n%s", name.c_str(),
 				err_cycle_detected);
@@ -600,6 +753,15 @@ bool Network::ParseConfigurationForRoutes(misc::IniFile *ini_file)
 		if (strcasecmp(tokens[2].c_str(), "Routes"))
 			continue;
 
+		// Manual routes need a routing table
+		if (topology)
+			throw Error(misc::fmt("%s: Network %s: manual routes "
+					"cannot be used with a generated "
+					"topology.\n%s",
+					ini_file->getPath().c_str(),
+					name.c_str(),
+					System::err_config_note));
+
 		// Set routing to true
 		routing = true;
 
@@ -797,12 +959,28 @@ void Network::DumpReport(std::ostream &os) const
 	os << misc::fmt("TransferredBytes = %lld\n", accumulated_bytes);
 	os << misc::fmt("AverageLatency = %.4f\n", transfers ?
 			(double) accumulated_latency / transfers : 0.0);
+	os << misc::fmt("LatencyP99 = %lld\n",
+			getPercentile(latency_histogram, 0.99));
+	os << misc::fmt("MaxLatency = %d\n", latency_histogram.empty() ?
+			0 : (int) latency_histogram.size() - 1);
 
 	// Cycle related information
 	System *system = System::getInstance();
 	long long cycle = system->getCycle();
 	os << misc::fmt("Cycles = %llu\n", cycle);
 
+	// Dynamic energy
+	double energy = 0.0;
+	for (auto &node : nodes)
+		energy += getNodeEnergy(node.get());
+	for (auto &connection : connections)
+	{
+		Link *link = dynamic_cast<Link *>(connection.get());
+		if (link)
+			energy += getLinkEnergy(link);
+	}
+	os << misc::fmt("DynamicEnergy = %.2f\n", energy);
+
 	// Creating an empty link before starting the links
 	os << "\n";
 
@@ -819,6 +997,248 @@ void Network::DumpReport(std::ostream &os) const
 }
 
 
+long long Network::getPercentile(const std::vector<long long> &histogram,
+		double percentile)
+{
+	// Total number of messages
+	long long count = 0;
+	for (long long value : histogram)
+		count += value;
+	if (!count)
+		return 0;
+
+	// Find the latency where the fraction of messages is reached
+	long long accumulated = 0;
+	for (unsigned latency = 0; latency < histogram.size(); latency++)
+	{
+		accumulated += histogram[latency];
+		if (accumulated >= percentile * count)
+			return latency;
+	}
+	return histogram.size() - 1;
+}
+
+
+void Network::RegisterIntervalStats()
+{
+	// Ignore if interval statistics are not active
+	esim::IntervalStats *interval_stats = esim::IntervalStats::getInstance();
+	if (!interval_stats->isActive())
+		return;
+
+	// Register statistics for every link
+	System *system = System::getInstance();
+	for (auto &connection : connections)
+	{
+		Link *link = dynamic_cast<Link *>(connection.get());
+		if (!link)
+			continue;
+
+		// Bytes transferred per cycle
+		std::string prefix = name + "." + link->getName();
+		interval_stats->RegisterRate(prefix + ".BytesPerCycle",
+				[link]() { return link->getTransferredBytes(); },
+				system->getFrequencyDomain());
+
+		// Fraction of cycles the link was busy
+		interval_stats->RegisterRate(prefix + ".Utilization",
+				[link]() { return link->getBusyCycle(); },
+				system->getFrequencyDomain());
+	}
+
+	// Register statistics for every node
+	for (auto &node : nodes)
+	{
+		// Average number of output buffers receiving from the crossbar
+		std::string prefix = name + "." + node->getName();
+		Switch *switch_node = dynamic_cast<Switch *>(node.get());
+		if (switch_node)
+			interval_stats->RegisterRate(prefix +
+					".CrossbarBusyBuffers",
+					[switch_node]()
+					{
+						return switch_node->
+							getCrossbarBusyCycles();
+					},
+					system->getFrequencyDomain());
+
+		// Average bytes in every buffer
+		std::vector<Buffer *> buffers;
+		for (int i = 0; i < node->getNumInputBuffers(); i++)
+			buffers.push_back(node->getInputBuffer(i));
+		for (int i = 0; i < node->getNumOutputBuffers(); i++)
+			buffers.push_back(node->getOutputBuffer(i));
+		for (Buffer *buffer : buffers)
+			interval_stats->RegisterRate(prefix + "." +
+					buffer->getName() + ".Occupancy",
+					[buffer]()
+					{
+						return buffer->
+							getAccumulatedOccupancyInBytes();
+					},
+					system->getFrequencyDomain());
+	}
+}
+
+
+double Network::getNodeEnergy(Node *node) const
+{
+	// Buffer writes and reads
+	double energy = 0.0;
+	for (int i = 0; i < node->getNumInputBuffers(); i++)
+	{
+		Buffer *buffer = node->getInputBuffer(i);
+		energy += buffer->getWrittenBytes() * buffer_write_energy +
+				buffer->getReadBytes() * buffer_read_energy;
+	}
+	for (int i = 0; i < node->getNumOutputBuffers(); i++)
+	{
+		Buffer *buffer = node->getOutputBuffer(i);
+		energy += buffer->getWrittenBytes() * buffer_write_energy +
+				buffer->getReadBytes() * buffer_read_energy;
+	}
+
+	// Crossbar traversals
+	Switch *switch_node = dynamic_cast<Switch *>(node);
+	if (switch_node)
+		energy += switch_node->getCrossbarBytes() * crossbar_energy;
+	return energy;
+}
+
+
+void Network::DumpHeatmapHeader(std::ostream &os)
+{
+	os << "Cycle,Network,Kind,Name,X,Y,DestinationX,DestinationY,"
+			"Utilization,Occupancy,Energy\n";
+}
+
+
+void Network::DumpHeatmapRow(std::ostream &os, long long cycle,
+		const std::string &kind, const std::string &name,
+		Node *source_node, Node *destination_node,
+		long long busy_cycles, long long capacity,
+		long long occupancy, long long buffer_size,
+		double energy, HeatmapSample &sample) const
+{
+	// Coordinates
+	int x = source_node->getIndex();
+	int y = 0;
+	int destination_x = destination_node->getIndex();
+	int destination_y = 0;
+	if (topology)
+	{
+		topology->getCoordinates(source_node, x, y);
+		topology->getCoordinates(destination_node, destination_x,
+				destination_y);
+	}
+
+	// Utilization and average occupancy over the interval
+	long long cycles = cycle - heatmap_cycle;
+	double utilization = cycles && capacity ?
+			(double) (busy_cycles - sample.busy_cycles) /
+			(cycles * capacity) : 0.0;
+	double average_occupancy = cycles && buffer_size ?
+			(double) (occupancy - sample.occupancy) /
+			(cycles * buffer_size) : 0.0;
+
+	// Dump row
+	os << misc::fmt("%lld,%s,%s,%s,%d,%d,%d,%d,%.4f,%.4f,%.2f\n",
+			cycle, this->name.c_str(), kind.c_str(), name.c_str(),
+			x, y, destination_x, destination_y,
+			utilization, average_occupancy,
+			energy - sample.energy);
+
+	// Save sample
+	sample.busy_cycles = busy_cycles;
+	sample.occupancy = occupancy;
+	sample.energy = energy;
+}
+
+
+void Network::DumpHeatmap(std::ostream &os, long long cycle)
+{
+	// Initialize samples
+	heatmap_samples.resize(connections.size() + nodes.size());
+
+	// Links, with the occupancy of the output buffers on their source
+	// side and the input buffers on their destination side
+	for (unsigned i = 0; i < connections.size(); i++)
+	{
+		Link *link = dynamic_cast<Link *>(connections[i].get());
+		if (!link)
+			continue;
+		long long occupancy = 0;
+		long long buffer_size = 0;
+		for (int j = 0; j < link->getNumSourceBuffers(); j++)
+		{
+			Buffer *buffer = link->getSourceBuffer(j);
+			occupancy += buffer->getAccumulatedOccupancyInBytes();
+			buffer_size += buffer->getSize();
+		}
+		for (int j = 0; j < link->getNumDestinationBuffers(); j++)
+		{
+			Buffer *buffer = link->getDestinationBuffer(j);
+			occupancy += buffer->getAccumulatedOccupancyInBytes();
+			buffer_size += buffer->getSize();
+		}
+		DumpHeatmapRow(os, cycle, "Link", link->getName(),
+				link->getSourceNode(),
+				link->getDestinationNode(),
+				link->getBusyCycle(), 1,
+				occupancy, buffer_size,
+				getLinkEnergy(link),
+				heatmap_samples[i]);
+	}
+
+	// Nodes, with the crossbar utilization of switches
+	for (unsigned i = 0; i < nodes.size(); i++)
+	{
+		Node *node = nodes[i].get();
+		long long occupancy = 0;
+		long long buffer_size = 0;
+		for (int j = 0; j < node->getNumInputBuffers(); j++)
+		{
+			Buffer *buffer = node->getInputBuffer(j);
+			occupancy += buffer->getAccumulatedOccupancyInBytes();
+			buffer_size += buffer->getSize();
+		}
+		for (int j = 0; j < node->getNumOutputBuffers(); j++)
+		{
+			Buffer *buffer = node->getOutputBuffer(j);
+			occupancy += buffer->getAccumulatedOccupancyInBytes();
+			buffer_size += buffer->getSize();
+		}
+		Switch *switch_node = dynamic_cast<Switch *>(node);
+		DumpHeatmapRow(os, cycle,
+				switch_node ? "Switch" : "EndNode",
+				node->getName(), node, node,
+				switch_node ? switch_node->
+					getCrossbarBusyCycles() : 0,
+				switch_node ? node->getNumOutputBuffers() : 0,
+				occupancy, buffer_size,
+				getNodeEnergy(node),
+				heatmap_samples[connections.size() + i]);
+	}
+
+	// Save cycle
+	heatmap_cycle = cycle;
+}
+
+
+Message *Network::allocateMessage()
+{
+	// Take a free message from the pool, growing it if needed
+	if (free_messages.empty())
+	{
+		message_pool.emplace_back(misc::new_unique<Message>(this));
+		free_messages.push_back(message_pool.back().get());
+	}
+	Message *message = free_messages.back();
+	free_messages.pop_back();
+	return message;
+}
+
+
 Message *Network::newMessage(EndNode *source_node, EndNode *destination_node,
 		int size)
 {
@@ -826,13 +1246,10 @@ Message *Network::newMessage(EndNode *source_node, EndNode *destination_node,
 	System *system = System::getInstance();
 	long long cycle = system->getCycle();
 
-	// Insert the created message into the hashtable
-	message_table.emplace(message_id_counter, misc::new_unique<Message>(
-			message_id_counter, this, source_node,
-			destination_node, size, cycle));
-
-	// Get the pointer to the newly created messag
-	Message *message = message_table[message_id_counter].get();
+	// Initialize a message from the pool
+	Message *message = allocateMessage();
+	message->Reset(message_id_counter, source_node, destination_node,
+			size, cycle);
 
 	// Increase message id counter
 	message_id_counter++;
@@ -842,6 +1259,104 @@ Message *Network::newMessage(EndNode *source_node, EndNode *destination_node,
 }
 
 
+int Network::EstimateLatency(EndNode *source_node,
+		EndNode *destination_node,
+		int size,
+		long long cycle)
+{
+	// Packets are transferred in a pipeline, so the latency is the one
+	// of the first packet along the route, plus the time for the rest of
+	// packets to follow it through the slowest connection.
+	int packet = packet_size ? std::min(packet_size, size) : size;
+	int num_packets = (size - 1) / packet + 1;
+
+	// Insertion in the first output buffer
+	int latency = 1;
+	int max_transfer_latency = 0;
+
+	// Traverse the route
+	Node *node = source_node;
+	while (node != destination_node)
+	{
+		// Next hop
+		RoutingTable::Entry entry = routing_table.Lookup(node,
+				destination_node);
+		Buffer *buffer = entry.getBuffer();
+		if (!buffer)
+			throw misc::Panic(misc::fmt("%s: no route from %s to %s",
+					name.c_str(),
+					source_node->getName().c_str(),
+					destination_node->getName().c_str()));
+		Connection *connection = buffer->getConnection();
+
+		// Transfer through the connection, after waiting for other
+		// messages. The whole message is charged to its utilization.
+		int transfer_latency = connection->getTransferLatency(packet);
+		latency += transfer_latency + connection->EstimateQueueingDelay(
+				cycle, connection->getTransferLatency(size),
+				analytical_window);
+		max_transfer_latency = std::max(max_transfer_latency,
+				transfer_latency);
+
+		// Traversal of the switch crossbar
+		node = entry.getNextNode();
+		Switch *switch_node = dynamic_cast<Switch *>(node);
+		if (switch_node)
+		{
+			int switch_latency = (packet - 1) /
+					switch_node->getBandwidth() + 1;
+			latency += switch_latency;
+			max_transfer_latency = std::max(max_transfer_latency,
+					switch_latency);
+		}
+	}
+
+	// Rest of packets
+	return latency + (num_packets - 1) * max_transfer_latency;
+}
+
+
+void Network::SendAnalytical(Message *message, esim::Event *receive_event)
+{
+	// The message travels as a single packet
+	EndNode *source_node = misc::cast<EndNode *>(message->getSourceNode());
+	EndNode *destination_node = misc::cast<EndNode *>(
+			message->getDestinationNode());
+	message->Packetize(message->getSize());
+	Packet *packet = message->getPacket(0);
+
+	// Estimate latency
+	System *system = System::getInstance();
+	long long cycle = system->getCycle();
+	int latency = EstimateLatency(source_node, destination_node,
+			message->getSize(), cycle);
+
+	// As in the detailed model, the output buffer of the source node
+	// accepts one message per cycle.
+	RoutingTable::Entry entry = routing_table.Lookup(source_node,
+			destination_node);
+	entry.getBuffer()->write_busy = cycle;
+
+	// Debug information
+	System::debug << misc::fmt("net: %s - M-%lld - analytical_lat=%d\n",
+			name.c_str(), message->getId(), latency);
+
+	// Update the network related statistics
+	source_node->incSentBytes(packet->getSize());
+	source_node->incSentPackets();
+	destination_node->incReceivedBytes(packet->getSize());
+	destination_node->incReceivedPackets();
+	packet->setNode(destination_node);
+
+	// Schedule the receive event directly
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	auto frame = misc::new_shared<Frame>(packet);
+	frame->automatic_receive = !receive_event;
+	esim_engine->Call(System::event_receive, frame, receive_event,
+			latency);
+}
+
+
 bool Network::CanSend(EndNode *source_node,
 		EndNode *destination_node,
 		int size,
@@ -852,15 +1367,29 @@ bool Network::CanSend(EndNode *source_node,
 	assert(!retry_event || esim_engine->getCurrentEvent());
 
 	// Get output buffer
-	RoutingTable::Entry *entry = routing_table.Lookup(source_node, 
+	RoutingTable::Entry entry = routing_table.Lookup(source_node, 
 			destination_node);
-	Buffer *output_buffer = entry->getBuffer();
+	Buffer *output_buffer = entry.getBuffer();
 
 	// If there is no route, return
 	if (!output_buffer)
 		return false;
 
+	// Get the least required size in the buffer
+	int required_size = size;
+	if (packet_size != 0)
+		required_size = ((size - 1) / packet_size + 1) * packet_size;
+
+	// Check the output buffer
+	return CanInsert(output_buffer, required_size, retry_event);
+}
+
+
+bool Network::CanInsert(Buffer *output_buffer, int size,
+		esim::Event *retry_event)
+{
 	// Get current cycle
+	esim::Engine *esim_engine = esim::Engine::getInstance();
 	System *system = System::getInstance();
 	long long cycle = system->getCycle();
 
@@ -873,19 +1402,13 @@ bool Network::CanSend(EndNode *source_node,
 		return false;
 	}
 
-	// Get the least required size in the buffer
-	int required_size = size;
-	if (packet_size != 0)
-		required_size = ((size - 1) / packet_size + 1) * packet_size;
-
 	// Check if the buffer can fit one message
-	if (required_size > output_buffer->getSize())
+	if (size > output_buffer->getSize())
 		throw Error("Buffer too small for the "
 			"message size.");
 	
 	// Check if the buffer has enough space for the current message
-	if (output_buffer->getCount() + required_size >
-			output_buffer->getSize())
+	if (output_buffer->getCount() + size > output_buffer->getSize())
 	{
 		if (retry_event)
 			output_buffer->Wait(retry_event);
@@ -914,6 +1437,13 @@ Message *Network::Send(EndNode *source_node,
 			name.c_str(), message->getId(),
 			message->getSize(), source_node->getName().c_str());
 
+	// Analytical model, the message is delivered in one event
+	if (analytical)
+	{
+		SendAnalytical(message, receive_event);
+		return message;
+	}
+
 	// Packetize message
 	if (packet_size == 0)
 		message->Packetize(size);
@@ -982,9 +1512,9 @@ Message *Network::TrySend(EndNode *source_node,
 		esim::Event *retry_event)
 {
 	// Get output buffer
-	RoutingTable::Entry *entry = routing_table.Lookup(source_node, 
+	RoutingTable::Entry entry = routing_table.Lookup(source_node, 
 			destination_node);
-	Buffer *output_buffer = entry->getBuffer();
+	Buffer *output_buffer = entry.getBuffer();
 	
 	// Check if route exist
 	if (!output_buffer)
@@ -1003,6 +1533,18 @@ Message *Network::TrySend(EndNode *source_node,
 
 void Network::Receive(EndNode *node, Message *message)
 {
+	// For multicast messages, absorb the copy delivered to the node
+	Message *root = message->getMulticastRoot();
+	if (root)
+	{
+		message = root->getDeliveredCopy(node->getIndex());
+		if (!message)
+			throw Error(misc::fmt("Multicast message %lld has not "
+					"arrived at %s.", root->getId(),
+					node->getName().c_str()));
+		root->setDeliveredCopy(node->getIndex(), nullptr);
+	}
+
 	// Assert that the location of the packets are in the receive node
 	for (int i = 0; i < message->getNumPackets(); i++)
 	{
@@ -1020,6 +1562,10 @@ void Network::Receive(EndNode *node, Message *message)
 	transfers++;
 	accumulated_bytes += message->getSize();
 	accumulated_latency += cycle - message->getSendCycle();
+	unsigned latency = cycle - message->getSendCycle();
+	if (latency >= latency_histogram.size())
+		latency_histogram.resize(latency + 1);
+	latency_histogram[latency]++;
 
 	// Remove packets from their buffer
 	for (int i = 0; i < message->getNumPackets(); i++)
@@ -1030,7 +1576,7 @@ void Network::Receive(EndNode *node, Message *message)
 		// In the case the network is fixed, there are no
 		// buffer insertion and extraction. Otherwise, extract
 		// from buffer and report in trace
-		if (!hasConstantLatency())
+		if (!hasConstantLatency() && !analytical)
 		{
 			// Remove the packet from buffer
 			buffer->RemovePacket(packet);
@@ -1065,8 +1611,301 @@ void Network::Receive(EndNode *node, Message *message)
 	System::trace << misc::fmt("net.end_msg net=\"%s\" name=\"M-%lld\"\n",
 			name.c_str(), message->getId());
 
-	// Destroy the message
-	message_table.erase(message->getId());
+	// Return the message to the pool. Copies of a multicast message are
+	// returned together once all of them were received.
+	if (!root)
+	{
+		free_messages.push_back(message);
+		return;
+	}
+	if (root->ReceiveCopy())
+	{
+		for (Message *copy : root->getCopies())
+			free_messages.push_back(copy);
+		free_messages.push_back(root);
+	}
+}
+
+
+Message *Network::SplitMulticast(Message *message,
+		const std::vector<bool> &destinations)
+{
+	// Initialize a copy from the pool, with the identifier and send cycle
+	// of the original message
+	Message *root = message->getMulticastRoot();
+	Message *copy = allocateMessage();
+	copy->Reset(root->getId(), root->getSourceNode(), nullptr,
+			root->getSize(), root->getSendCycle());
+	copy->setMulticast(root, destinations);
+	copy->Packetize(copy->getSize());
+	root->addCopy(copy);
+
+	// Remove destinations from the message
+	message->RemoveDestinations(destinations);
+	return copy;
+}
+
+
+std::vector<Message *> Network::SplitMulticastAtSource(Message *message)
+{
+	std::vector<Message *> copies;
+	Node *source_node = message->getSourceNode();
+	while (message->getNumDestinations() > 1)
+	{
+		// Without switches carrying the message, every destination
+		// receives its own copy
+		Message *copy;
+		if (fix_latency || analytical)
+		{
+			std::vector<bool> destinations(nodes.size());
+			destinations[message->getDestinationNode()->
+					getIndex()] = true;
+			copy = SplitMulticast(message, destinations);
+		}
+		else
+		{
+			copy = ReplicateMulticast(message, source_node);
+		}
+
+		// All destinations reached in the same way
+		if (!copy)
+			break;
+		copies.push_back(copy);
+	}
+
+	// The message itself is the last copy
+	copies.push_back(message);
+	return copies;
+}
+
+
+bool Network::CanSendMulticast(EndNode *source_node,
+		const std::vector<EndNode *> &destination_nodes,
+		int size,
+		esim::Event *retry_event)
+{
+	// If 'retry_event' was specified, we must be in an event handler
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	assert(!retry_event || esim_engine->getCurrentEvent());
+
+	// Output buffer and next node of every copy leaving the source node.
+	// Without switches carrying the message, the destination takes the
+	// place of the next node, since each one receives its own copy.
+	std::vector<std::pair<Buffer *, Node *>> copies;
+	for (EndNode *destination_node : destination_nodes)
+	{
+		RoutingTable::Entry entry = routing_table.Lookup(source_node,
+				destination_node);
+		if (!entry.getBuffer())
+			return false;
+		std::pair<Buffer *, Node *> copy(entry.getBuffer(),
+				fix_latency || analytical ? destination_node :
+				entry.getNextNode());
+		if (std::find(copies.begin(), copies.end(), copy) ==
+				copies.end())
+			copies.push_back(copy);
+	}
+
+	// Each copy takes a whole number of packets in the buffer
+	int required_size = size;
+	if (packet_size != 0)
+		required_size = ((size - 1) / packet_size + 1) * packet_size;
+
+	// Check every output buffer for all copies leaving through it, the
+	// first time it appears in the list
+	for (unsigned i = 0; i < copies.size(); i++)
+	{
+		Buffer *output_buffer = copies[i].first;
+		int num_copies = 0;
+		bool checked = false;
+		for (unsigned j = 0; j < copies.size(); j++)
+		{
+			if (copies[j].first != output_buffer)
+				continue;
+			checked |= j < i;
+			num_copies++;
+		}
+		if (!checked && !CanInsert(output_buffer,
+				num_copies * required_size,
+				retry_event))
+			return false;
+	}
+
+	// All criteria met
+	return true;
+}
+
+
+Message *Network::SendMulticast(EndNode *source_node,
+		const std::vector<EndNode *> &destination_nodes,
+		int size,
+		esim::Event *receive_event)
+{
+	// Multicast must be enabled
+	if (!multicast)
+		throw Error(misc::fmt("Network %s: multicast messages are not "
+				"enabled.", name.c_str()));
+
+	// Bitmask of destinations
+	if (destination_nodes.empty())
+		throw misc::Panic(misc::fmt("%s: multicast message with no "
+				"destinations", name.c_str()));
+	std::vector<bool> destinations(nodes.size());
+	for (EndNode *destination_node : destination_nodes)
+	{
+		int index = destination_node->getIndex();
+		if (index >= (int) nodes.size() ||
+				nodes[index].get() != destination_node ||
+				destination_node == source_node ||
+				destinations[index])
+			throw misc::Panic(misc::fmt("%s: invalid multicast "
+					"destination %s",
+					name.c_str(),
+					destination_node->getName().c_str()));
+		destinations[index] = true;
+	}
+
+	// Create message
+	Message *message = newMessage(source_node, destination_nodes[0], size);
+	message->setMulticast(message, destinations);
+	message->setReceiveEvent(receive_event);
+
+	// Updating trace with new message creation
+	net::System::trace << misc::fmt("net.new_msg net=\"%s\" "
+			"name=\"M-%lld\" size=%d state=\"%s:create\"\n",
+			name.c_str(), message->getId(),
+			message->getSize(), source_node->getName().c_str());
+
+	// Debug information
+	System::debug << misc::fmt("net: %s - send M-%lld "
+			"'%s'-->%d destinations\n",
+			name.c_str(),
+			message->getId(),
+			source_node->getName().c_str(),
+			(int) destination_nodes.size());
+
+	// Send the copies leaving the source node, each as a single packet
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	for (Message *copy : SplitMulticastAtSource(message))
+	{
+		// Analytical model
+		if (analytical)
+		{
+			SendAnalytical(copy, nullptr);
+			continue;
+		}
+
+		// Update the trace with the new packet
+		copy->Packetize(size);
+		Packet *packet = copy->getPacket(0);
+		net::System::trace << misc::fmt("net.new_packet net=\"%s\" "
+				"name=\"P-%lld:%d\" size=%d "
+				"state=\"%s:packetizer\"\n",
+				name.c_str(), copy->getId(),
+				packet->getId(), packet->getSize(),
+				source_node->getName().c_str());
+
+		// Insert the packet in the output buffer right away
+		auto frame = misc::new_shared<Frame>(packet);
+		esim_engine->Execute(System::event_send, frame, nullptr);
+	}
+
+	// Return the original message
+	return message;
+}
+
+
+Message *Network::TrySendMulticast(EndNode *source_node,
+		const std::vector<EndNode *> &destination_nodes,
+		int size,
+		esim::Event *receive_event,
+		esim::Event *retry_event)
+{
+	// Check if message can be sent
+	if (!CanSendMulticast(source_node, destination_nodes, size,
+			retry_event))
+		return nullptr;
+
+	// Send message
+	return SendMulticast(source_node, destination_nodes, size,
+			receive_event);
+}
+
+
+void Network::WaitMulticast(Message *message, EndNode *node)
+{
+	// The message must have a receive event
+	Message *root = message->getMulticastRoot();
+	if (!root || !root->getReceiveEvent())
+		throw misc::Panic(misc::fmt("%s: message %lld is not a "
+				"multicast message with a receive event",
+				name.c_str(), message->getId()));
+
+	// The copy may have arrived already
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	int index = node->getIndex();
+	if (root->getDeliveredCopy(index))
+	{
+		esim_engine->Next(root->getReceiveEvent());
+		return;
+	}
+
+	// Wait for the copy
+	root->getWaitingQueue(index)->Wait(root->getReceiveEvent());
+}
+
+
+Message *Network::ReplicateMulticast(Message *message, Node *node)
+{
+	// Route to the first destination
+	RoutingTable::Entry entry = routing_table.Lookup(node,
+			message->getDestinationNode());
+
+	// Destinations reached through the same output buffer and next node
+	const std::vector<bool> &destinations = message->getDestinations();
+	std::vector<bool> group(destinations.size());
+	int group_size = 0;
+	for (unsigned i = 0; i < destinations.size(); i++)
+	{
+		if (!destinations[i])
+			continue;
+		RoutingTable::Entry other = routing_table.Lookup(node,
+				nodes[i].get());
+		if (other.getBuffer() == entry.getBuffer() &&
+				other.getNextNode() == entry.getNextNode())
+		{
+			group[i] = true;
+			group_size++;
+		}
+	}
+
+	// No replication needed
+	if (group_size == message->getNumDestinations())
+		return nullptr;
+
+	// Copy for the group
+	return SplitMulticast(message, group);
+}
+
+
+void Network::DeliverMulticast(EndNode *node, Message *copy)
+{
+	// Copies have a single destination once delivered
+	Message *root = copy->getMulticastRoot();
+	if (copy->getNumDestinations() != 1 ||
+			copy->getDestinationNode() != node)
+		throw misc::Panic(misc::fmt("%s: copy of multicast message "
+				"%lld delivered to the wrong node %s",
+				name.c_str(), copy->getId(),
+				node->getName().c_str()));
+	int index = node->getIndex();
+	root->setDeliveredCopy(index, copy);
+
+	// Receive automatically, or resume the waiting event chain
+	if (!root->getReceiveEvent())
+		Receive(node, copy);
+	else
+		root->getWaitingQueue(index)->WakeupAll();
 }
 
 
@@ -33,6 +33,7 @@
 #include "Node.h"
 #include "RoutingTable.h"
 #include "System.h"
+#include "Topology.h"
 
 namespace net
 {
@@ -44,6 +45,20 @@ class Graph;
 
 class Network
 {
+public:
+
+	/// Allocators matching input and output buffers in switches
+	enum SwitchAllocator
+	{
+		SwitchAllocatorInvalid = 0,
+		SwitchAllocatorRoundRobin,
+		SwitchAllocatorISLIP
+	};
+
+	/// String map for SwitchAllocator
+	static const misc::StringMap SwitchAllocatorMap;
+
+private:
 
 	// Network name
 	std::string name;
@@ -51,8 +66,13 @@ class Network
 	// Message ID counter
 	long long message_id_counter = 0;
 
-	// A hashtable of messages in flight
-	std::unordered_map<long long, std::unique_ptr<Message>> message_table;
+	// Slab of all message objects created by the network. Messages are
+	// recycled once received, so message and packet objects are only
+	// allocated when more messages than ever before are in flight.
+	std::vector<std::unique_ptr<Message>> message_pool;
+
+	// Message objects in the pool that are not in flight
+	std::vector<Message *> free_messages;
 
 	// List of nodes in the network
 	std::vector<std::unique_ptr<Node>> nodes;
@@ -72,6 +92,9 @@ class Network
 	// Routing table
 	RoutingTable routing_table;
 
+	// Generated topology, if any
+	std::unique_ptr<Topology> topology;
+
 	// Parse the config file to add all the nodes belongs to the network
 	void ParseConfigurationForNodes(misc::IniFile *ini_file);
 
@@ -106,6 +129,24 @@ class Network
 	// Defaule packet size - zero means no packeting
 	int packet_size = 0;
 
+	// Flit size in flit-level networks, or zero for packet-level
+	// switching. In flit-level networks, messages are split into flits
+	// that follow each other through the network in wormhole fashion.
+	int flit_size = 0;
+
+	// Number of stages of the router pipeline in flit-level networks
+	int router_stages = 4;
+
+	// Cycles for credits to travel back over a link in flit-level
+	// networks
+	int credit_delay = 1;
+
+	// Switch allocator
+	SwitchAllocator switch_allocator = SwitchAllocatorRoundRobin;
+
+	// Number of iterations of the iSLIP allocator
+	int allocator_iterations = 1;
+
 	// fix latency of the network. If activated
 	// the network sends the messages with a fixed latency
 	// regardless of the topology.
@@ -113,6 +154,78 @@ class Network
 	// of 1.
 	int fix_latency = 0;
 
+	// Analytical network model. Messages are delivered with a single
+	// event, after a latency estimated from the route and the recent
+	// utilization of its connections.
+	bool analytical = false;
+
+	// Number of cycles of the windows over which the analytical model
+	// estimates the utilization of connections
+	int analytical_window = 1000;
+
+	// Whether users of the network can send multicast messages, which
+	// switches replicate toward their destinations
+	bool multicast = false;
+
+	// Energy model, in pJ per byte written into or read from a buffer,
+	// traversing a switch crossbar, or traversing a link
+	double buffer_write_energy = 0.0;
+	double buffer_read_energy = 0.0;
+	double crossbar_energy = 0.0;
+	double link_energy = 0.0;
+
+	// Values of the statistics of a link or node in the last heatmap
+	// sample
+	struct HeatmapSample
+	{
+		long long busy_cycles = 0;
+		long long occupancy = 0;
+		double energy = 0.0;
+	};
+
+	// Last heatmap samples of links, followed by those of nodes
+	std::vector<HeatmapSample> heatmap_samples;
+
+	// Cycle of the last heatmap sample
+	long long heatmap_cycle = 0;
+
+	// Dump a row of the heatmap for a link or node
+	void DumpHeatmapRow(std::ostream &os, long long cycle,
+			const std::string &kind, const std::string &name,
+			Node *source_node, Node *destination_node,
+			long long busy_cycles, long long capacity,
+			long long occupancy, long long buffer_size,
+			double energy, HeatmapSample &sample) const;
+
+	// Take a message object from the pool
+	Message *allocateMessage();
+
+	// Check whether the given number of bytes can be inserted into an
+	// output buffer of an end node in the current cycle. See CanSend().
+	bool CanInsert(Buffer *output_buffer, int size,
+			esim::Event *retry_event);
+
+	// Multicast. Make a copy of a multicast message for the destinations
+	// set in a bitmask, and remove them from the message. The copy
+	// travels as a single packet.
+	Message *SplitMulticast(Message *message,
+			const std::vector<bool> &destinations);
+
+	// Multicast. Return the copies in which a multicast message leaves
+	// its source node, one for every output buffer and next node toward
+	// its destinations, or one for every destination if the message is
+	// not carried by switches. The message itself is the last copy.
+	std::vector<Message *> SplitMulticastAtSource(Message *message);
+
+	// Analytical model. Deliver a message with a single event.
+	void SendAnalytical(Message *message, esim::Event *receive_event);
+
+	// Analytical model. Return the latency of a message of the given size
+	// sent in the given cycle, and charge its transfers to the
+	// connections in its route.
+	int EstimateLatency(EndNode *source_node, EndNode *destination_node,
+			int size, long long cycle);
+
 
 	
 	//
@@ -128,6 +241,9 @@ class Network
 	// Accumulation of size of all messages in the network
 	long long accumulated_bytes = 0;
 
+	// Number of messages received with each latency in cycles
+	std::vector<long long> latency_histogram;
+
 
 
 
@@ -166,12 +282,63 @@ public:
 	/// Return the routing table of the network.
 	RoutingTable *getRoutingTable() { return &routing_table; }
 
+	/// Return the generated topology, or `nullptr` if nodes and links
+	/// were given in the configuration file.
+	Topology *getTopology() const { return topology.get(); }
+
 	/// Set packet size
 	void setPacketSize(int packet_size) { this->packet_size = packet_size; }
 
 	/// Get packet size
 	int getPacketSize() const { return packet_size; }
 
+	/// Return whether the network uses flit-level wormhole switching
+	bool isFlitLevel() const { return flit_size > 0; }
+
+	/// Get the flit size, or zero in packet-level networks
+	int getFlitSize() const { return flit_size; }
+
+	/// Get the number of stages of the router pipeline in flit-level
+	/// networks
+	int getRouterStages() const { return router_stages; }
+
+	/// Get the credit return delay in flit-level networks
+	int getCreditDelay() const { return credit_delay; }
+
+	/// Get the switch allocator
+	SwitchAllocator getSwitchAllocator() const { return switch_allocator; }
+
+	/// Get the number of iterations of the iSLIP allocator
+	int getAllocatorIterations() const { return allocator_iterations; }
+
+	/// Get the number of messages received so far
+	long long getTransfers() const { return transfers; }
+
+	/// Get the total size in bytes of messages received so far
+	long long getAccumulatedBytes() const { return accumulated_bytes; }
+
+	/// Get the sum of latencies of messages received so far
+	long long getAccumulatedLatency() const { return accumulated_latency; }
+
+	/// Get the number of messages received so far with each latency in
+	/// cycles, indexed by latency
+	const std::vector<long long> &getLatencyHistogram() const
+	{
+		return latency_histogram;
+	}
+
+	/// Return the latency in cycles under which a fraction \a percentile
+	/// (between 0 and 1) of the messages in a latency histogram were
+	/// received, or 0 if the histogram is empty.
+	static long long getPercentile(const std::vector<long long> &histogram,
+			double percentile);
+
+	/// Get the number of messages sent and not received yet
+	int getNumMessagesInFlight() const
+	{
+		return message_pool.size() - free_messages.size();
+	}
+
 	/// Get the condition of the network, to see if it is
 	/// and ideal network with a fix latency or not.
 	///
@@ -182,6 +349,11 @@ public:
 	/// Get the fix delay of the network
 	int getFixLatency() const {return fix_latency; }
 
+	/// Return whether the network uses the analytical model, where each
+	/// message is delivered in a single event with a latency that
+	/// accounts for contention.
+	bool isAnalytical() const { return analytical; }
+
 	/// Create a message to be transfered in the network. The network 
 	/// keeps the ownership of the message. Message is destoried when it 
 	/// is received by the \a destination node.
@@ -308,12 +480,101 @@ public:
 	/// node. The caller must make sure that this is the actual location
 	/// of the message. This function should be called when the
 	/// `receive_event` is triggered after a call to Send() or TrySend().
-	/// The message object is freed in this call.
+	/// The message object is freed in this call. For multicast messages,
+	/// the copy delivered to the node is absorbed, and the message
+	/// objects are freed once all copies are received.
 	void Receive(EndNode *node, Message *message);
 
 
 
 
+	//
+	// Multicast
+	//
+
+	/// Return whether users of the network can send multicast messages
+	bool hasMulticast() const { return multicast; }
+
+	/// Allow users of the network to send multicast messages
+	void setMulticast(bool multicast) { this->multicast = multicast; }
+
+	/// Check if a multicast message can be sent from the given source
+	/// node to the given destination nodes. This is the case if all
+	/// output buffers of the source node toward the destinations have
+	/// room for the copies of the message that leave through them, and
+	/// are not busy. The meaning of arguments and return value is the
+	/// same as in CanSend().
+	bool CanSendMulticast(EndNode *source_node,
+			const std::vector<EndNode *> &destination_nodes,
+			int size,
+			esim::Event *retry_event = nullptr);
+
+	/// Send a multicast message through the network. The message travels
+	/// as a single packet as long as the routes to its destinations are
+	/// the same. Where routes diverge, switches replicate the packet, so
+	/// that every connection carries at most one copy of the message.
+	/// Networks with a fix latency or using the analytical model deliver
+	/// a separate copy to each destination.
+	///
+	/// \param source_node
+	///	Source node for the message transfer. Must be an end node.
+	///
+	/// \param destination_nodes
+	///	Destination end nodes, with no repetitions and not including
+	///	the source node.
+	///
+	/// \param size
+	///	Size in bytes of the message.
+	///
+	/// \param receive_event
+	///	If this optional argument is `nullptr`, every copy is received
+	///	automatically by its destination node. Otherwise, an event
+	///	chain must call WaitMulticast() for each destination node, and
+	///	`receive_event` is scheduled in that event chain once the copy
+	///	arrives.
+	///
+	/// \return
+	///	The function returns the original message object, valid until
+	///	all copies are received.
+	///
+	Message *SendMulticast(EndNode *source_node,
+			const std::vector<EndNode *> &destination_nodes,
+			int size,
+			esim::Event *receive_event = nullptr);
+
+	/// Send a multicast message only if it is possible to send it right
+	/// away. The meaning of arguments is the same as in SendMulticast()
+	/// and TrySend(). This function must be invoked within an event
+	/// handler.
+	Message *TrySendMulticast(EndNode *source_node,
+			const std::vector<EndNode *> &destination_nodes,
+			int size,
+			esim::Event *receive_event = nullptr,
+			esim::Event *retry_event = nullptr);
+
+	/// Suspend the current event chain until the copy of a multicast
+	/// message sent with a receive event arrives at destination \a node.
+	/// The receive event is then scheduled with the current event frame,
+	/// and the event chain must call Receive() for the node and message.
+	/// This function must be invoked within an event handler.
+	void WaitMulticast(Message *message, EndNode *node);
+
+	/// Replicate a multicast message whose packet is at \a node, when its
+	/// destinations are reached through different output buffers or next
+	/// nodes. The function returns a copy for the destinations reached
+	/// in the same way as the first one, removing them from the message,
+	/// or `nullptr` if all destinations are reached in the same way.
+	Message *ReplicateMulticast(Message *message, Node *node);
+
+	/// Record the arrival of a copy of a multicast message at one of its
+	/// destination nodes. The copy is received right away if the message
+	/// has no receive event. Otherwise, the event chain waiting for it is
+	/// resumed.
+	void DeliverMulticast(EndNode *node, Message *copy);
+
+
+
+
 	//
 	// Nodes
 	//
@@ -416,6 +677,32 @@ public:
 
 	/// Generating the static graph file
 	void StaticGraph(const std::string &path);
+
+	/// Register in the interval statistics, if active, the bytes per
+	/// cycle and utilization of every link, the average number of output
+	/// buffers of every switch receiving from the crossbar, and the
+	/// average byte occupancy of every buffer.
+	void RegisterIntervalStats();
+
+	/// Return the dynamic energy in pJ consumed so far by the buffers of
+	/// a node and, for switches, by its crossbar
+	double getNodeEnergy(Node *node) const;
+
+	/// Return the dynamic energy in pJ consumed so far by a link
+	double getLinkEnergy(Link *link) const
+	{
+		return link->getTransferredBytes() * link_energy;
+	}
+
+	/// Dump a heatmap sample in CSV format, with a row for every link and
+	/// node containing the utilization, average buffer occupancy, and
+	/// dynamic energy since the previous sample. Rows are keyed by the
+	/// coordinates of the nodes in the generated topology, or by node
+	/// indices in row 0 for networks without a generated topology.
+	void DumpHeatmap(std::ostream &os, long long cycle);
+
+	/// Dump the header of the heatmap CSV file
+	static void DumpHeatmapHeader(std::ostream &os);
 };
 
 
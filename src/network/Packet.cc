@@ -23,12 +23,27 @@
 namespace net
 {
 
-Packet::Packet(Message *message, int size) :
+Packet::Packet(Message *message, int id) :
 		message(message),
-		size(size)
+		size(0),
+		id(id)
 {
-	// Assigning the packet's id
-	id = message->getNumPackets();
+}
+
+
+void Packet::Reset(int size)
+{
+	this->size = size;
+	busy = 0;
+	node = nullptr;
+	buffer = nullptr;
+	received = false;
+}
+
+
+bool Packet::isTail() const
+{
+	return id == message->getNumPackets() - 1;
 }
 
 }  // namespace net
@@ -38,19 +38,26 @@ class Packet
 	int id;
 
 	// In transit until cycle
-	long long busy;
+	long long busy = 0;
 
 	// Current position in the network, which node it is at
-	Node *node;
+	Node *node = nullptr;
 
 	// Current position in the network, which buffer it is at
-	Buffer *buffer;
+	Buffer *buffer = nullptr;
+
+	// Whether the packet was assembled in its destination
+	bool received = false;
 
 
 public:
 
-	/// Constructor
-	Packet(Message *message, int size);
+	/// Constructor. Packets are owned by their message and reused every
+	/// time the message is recycled, always with the same index \a id.
+	Packet(Message *message, int id);
+
+	/// Prepare the packet to be sent again with the given size
+	void Reset(int size);
 
 	/// Get session id
 	int getId() const { return id; }
@@ -79,6 +86,20 @@ public:
 	/// Get the cycle which the packet is busy
 	long long getBusy() const { return busy; }
 
+	/// Mark the packet as assembled in its destination
+	void setReceived() { received = true; }
+
+	/// Return whether the packet was assembled in its destination
+	bool isReceived() const { return received; }
+
+	/// Return whether this is the first packet of its message. In
+	/// flit-level networks, this is the head flit.
+	bool isHead() const { return id == 0; }
+
+	/// Return whether this is the last packet of its message. In
+	/// flit-level networks, this is the tail flit.
+	bool isTail() const;
+
 };
 
 }  // namespace net
@@ -17,16 +17,21 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
 #include <climits>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <set>
+#include <thread>
+#include <unordered_set>
 
 #include <lib/cpp/Error.h>
 
 #include "Node.h"
 #include "Network.h"
 #include "RoutingTable.h"
+#include "System.h"
 
 namespace net
 {
@@ -51,128 +56,157 @@ void RoutingTable::Initialize()
 	// Set dimension
 	dimension = network->getNumNodes();
 
+	// No table for algorithmic routing
+	if (routing_function)
+		return;
+
+	// Costs are stored in 16 bits
+	if (dimension > USHRT_MAX)
+		throw Error(misc::fmt("Network %s: too many nodes (%d) for a "
+				"routing table", network->getName().c_str(),
+				dimension));
+
 	// Initiate table with infinite costs
+	entries.resize((size_t) dimension * dimension);
 	for (int i = 0; i < dimension; i++)
-	{
 		for (int j = 0; j < dimension; j++)
-		{
-			entries.emplace_back(misc::new_unique<Entry>(
-					i == j ? 0 : dimension, 
-					nullptr, nullptr));
-		}
-	}
+			getEntry(i, j).cost = i == j ? 0 : dimension;
 
 	// Set 1-hop connections
+	std::vector<Hop> hops;
 	for (int i = 0; i < dimension; i++)
 	{
 		Node *node = network->getNode(i);
-		for (int j = 0; j < node->getNumOutputBuffers(); j++)
+		getHops(node, hops);
+		for (Hop &hop : hops)
 		{
-			Buffer *source_buffer = node->getOutputBuffer(j);
-			Connection* connection = source_buffer->getConnection();
-			for (int k = 0; k < 
-					connection->getNumDestinationBuffers();
-					k++)
-			{
-				Buffer *dst_buffer = connection->
-					getDestinationBuffer(k);
-				Node* dst_node = dst_buffer->getNode();
-				if (node != dst_node)
-				{
-					Entry* entry = Lookup(node, dst_node);
-					entry->cost = 1;
-					entry->setNextNode(dst_node);
-					entry->setBuffer(source_buffer);
-				}
-			}
+			// The first buffer leading to the neighbor is used
+			CompactEntry &entry = getEntry(i, hop.node);
+			if (entry.cost == 1)
+				continue;
+			entry.cost = 1;
+			entry.next_node = hop.node;
+			entry.buffer = hop.buffer;
 		}
 	}
 }
 
 
-void RoutingTable::FloydWarshall()
+void RoutingTable::getHops(Node *node, std::vector<Hop> &hops) const
 {
-	// The entry->next_node values do not necessarily point
-	// to the immediate next hop after this.
-	for (int k = 0; k < dimension; k++)
+	hops.clear();
+	for (int j = 0; j < node->getNumOutputBuffers(); j++)
 	{
-		for (int i = 0; i < dimension; i++)
+		Buffer *source_buffer = node->getOutputBuffer(j);
+		Connection* connection = source_buffer->getConnection();
+		for (int k = 0; k < connection->getNumDestinationBuffers(); k++)
 		{
-			for (int j = 0; j < dimension; j++)
-			{
-				Node *node_i = network->getNode(i);
-				Node *node_j = network->getNode(j);
-				Node *node_k = network->getNode(k);
-
-				Entry *entry_i_k = Lookup(node_i,node_k);
-				Entry *entry_k_j = Lookup(node_k,node_j);
-				Entry *entry_i_j = Lookup(node_i,node_j);
-
-				int temp_cost = entry_i_k->cost +
-						entry_k_j->cost;
-				if (entry_i_j->cost > temp_cost)
-				{
-					entry_i_j->cost = temp_cost;
-					entry_i_j->setNextNode(node_k);
-				}
-			}
+			Buffer *dst_buffer = connection->getDestinationBuffer(k);
+			Node* dst_node = dst_buffer->getNode();
+			if (node != dst_node)
+				hops.push_back({ dst_node->getIndex(), j });
 		}
 	}
+}
 
-	// Calculating the output buffer for the entry.
-	Node *next_node = nullptr;
-	Entry *entry = nullptr;
+
+void RoutingTable::setEntry(Node *source, Node *destination, int cost,
+		Node *next_node, Buffer *buffer)
+{
+	assert(!buffer || buffer->getNode() == source);
+	CompactEntry &entry = getEntry(source->getIndex(),
+			destination->getIndex());
+	entry.cost = cost;
+	entry.next_node = next_node ? next_node->getIndex() : -1;
+	entry.buffer = buffer ? buffer->getIndex() : -1;
+}
+
+
+void RoutingTable::CalculateRoutes()
+{
+	// No table for algorithmic routing
+	if (routing_function)
+		return;
+
+	// Neighbors of each node, and nodes that each node is a neighbor of
+	std::vector<std::vector<Hop>> hops(dimension);
+	std::vector<std::vector<int>> reverse_hops(dimension);
 	for (int i = 0; i < dimension; i++)
 	{
-		for (int j = 0; j < dimension; j++)
-		{
+		getHops(network->getNode(i), hops[i]);
+		for (Hop &hop : hops[i])
+			reverse_hops[hop.node].push_back(i);
+	}
 
-			Node *node_i = network->getNode(i);
-			Node *node_j = network->getNode(j);
+	// Number of host threads
+	int num_threads = System::getRoutingThreads();
+	if (num_threads <= 0)
+		num_threads = std::thread::hardware_concurrency();
+	num_threads = std::max(1, std::min(num_threads, dimension / 64));
+
+	// Each thread calculates the routes to a contiguous range of
+	// destinations. Threads write disjoint entries of the table.
+	std::vector<std::thread> threads;
+	for (int i = 1; i < num_threads; i++)
+		threads.emplace_back(&RoutingTable::CalculateRoutesTo, this,
+				std::cref(hops), std::cref(reverse_hops),
+				(int) ((long long) dimension * i / num_threads),
+				(int) ((long long) dimension * (i + 1) /
+						num_threads));
+	CalculateRoutesTo(hops, reverse_hops, 0, dimension / num_threads);
+	for (std::thread &thread : threads)
+		thread.join();
+}
 
-			auto entry_i_j = Lookup(node_i, node_j);
-			next_node = entry_i_j->getNextNode();
 
-			if (!next_node)
+void RoutingTable::CalculateRoutesTo(
+		const std::vector<std::vector<Hop>> &hops,
+		const std::vector<std::vector<int>> &reverse_hops,
+		int first,
+		int last)
+{
+	std::vector<int> distance(dimension);
+	std::vector<int> queue(dimension);
+	for (int j = first; j < last; j++)
+	{
+		// Breadth-first search from the destination over the reverse
+		// graph, calculating the distance from every node.
+		std::fill(distance.begin(), distance.end(), -1);
+		int head = 0;
+		int tail = 0;
+		distance[j] = 0;
+		queue[tail++] = j;
+		while (head < tail)
+		{
+			int node = queue[head++];
+			for (int previous : reverse_hops[node])
 			{
-				entry_i_j->setBuffer(nullptr);
-				continue;
+				if (distance[previous] >= 0)
+					continue;
+				distance[previous] = distance[node] + 1;
+				queue[tail++] = previous;
 			}
+		}
 
-			// Follow the buffers path
-			for (;;)
+		// The next hop of every node is its first neighbor one hop
+		// closer to the destination.
+		for (int i = 0; i < dimension; i++)
+		{
+			CompactEntry &entry = getEntry(i, j);
+			if (i == j || distance[i] < 0)
 			{
-				entry = Lookup(node_i, next_node);
-				if (entry->cost <= 1)
-					break;
-				next_node = entry->getNextNode();
+				entry.next_node = -1;
+				entry.buffer = -1;
+				continue;
 			}
-
-			// Get the output buffer based on the next node
-			for (int k = 0; k < node_i->getNumOutputBuffers(); k++)
+			for (const Hop &hop : hops[i])
 			{
-				Buffer *buffer = node_i->getOutputBuffer(k);
-				bool found = false;
-				Connection *connection = buffer->getConnection();
-				for (int m = 0; m < connection->
-						getNumDestinationBuffers(); 
-						m++)
-				{
-					Buffer *destination_buffer = 
-						connection->
-						getDestinationBuffer(m);
-					Node *receive_node = 
-							destination_buffer->
-							getNode();
-					if (next_node != receive_node)
-						continue;
-					entry_i_j->setNextNode(receive_node);
-					entry_i_j->setBuffer(buffer);
-					found = true;
-					break;
-				}
-				if (found)
-					break;
+				if (distance[hop.node] != distance[i] - 1)
+					continue;
+				entry.cost = distance[i];
+				entry.next_node = hop.node;
+				entry.buffer = hop.buffer;
+				break;
 			}
 		}
 	}
@@ -180,6 +214,35 @@ void RoutingTable::FloydWarshall()
 
 
 bool RoutingTable::hasCycle()
+{
+	// Every packet takes the route in the table
+	return hasCycle([this](Node *node, Node *destination,
+			Buffer *input_buffer, std::vector<Entry> &entries)
+			{
+				entries.push_back(Lookup(node, destination));
+			});
+}
+
+
+// Return the input buffer of a node where packets sent through the given
+// output buffer of a neighbor arrive
+static Buffer *getPairedInputBuffer(Buffer *output_buffer, Node *node)
+{
+	// Virtual channels of links are pairs of buffers
+	Link *link = dynamic_cast<Link *>(output_buffer->getConnection());
+	if (link)
+		return link->getDestinationBufferfromSource(output_buffer);
+
+	// Input buffer connected to the same bus
+	for (int i = 0; i < node->getNumInputBuffers(); i++)
+		if (node->getInputBuffer(i)->getConnection() ==
+				output_buffer->getConnection())
+			return node->getInputBuffer(i);
+	return nullptr;
+}
+
+
+bool RoutingTable::hasCycle(RouteSetFunction route_set)
 {
 	// First create an empty graph
 	std::unique_ptr<misc::Graph> graph = misc::new_unique<misc::Graph>();
@@ -187,144 +250,82 @@ bool RoutingTable::hasCycle()
 	// Create an unordered_map for mapping each buffer to vertices of
 	// the graph
 	std::unordered_map<Buffer *, misc::Vertex *> buffer_to_vertex;
-
-	// For every output buffer that plays a role in routing table
-	for (int node_id = 0; node_id < dimension; node_id++)
+	auto getVertex = [&](Buffer *buffer)
 	{
-		// Get the node
-		Node *node = network->getNode(node_id);
-
-		// For each output buffer from the output buffer list,
-		// figure out if the output buffer is in the routing table
-		for (int buffer_id = 0; buffer_id < node->getNumOutputBuffers();
-				buffer_id++)
-		{
-			// Get the output buffer from the list in the node 
-			Buffer *output_buffer = node->getOutputBuffer(
-					buffer_id);
-
-			// Find the buffer in the routing table
-			for (int destination_node_id = 0; 
-					destination_node_id < dimension;
-					destination_node_id++)
-			{
-				// Get the destination node
-				Node *destination_node = network->getNode(
-					destination_node_id);
-
-				// Look up the routing table
-				Entry *entry = Lookup(node, destination_node);
-
-				// Check if the current output buffer is the 
-				// path between the two nodes
-				if (output_buffer == entry->getBuffer())
-				{
-					// This means the buffer is involved 
-					// in the graph and might be part of 
-					// a deadlock scenario. So we create
-					// a vertex for it
-					graph->addVertex(misc::new_unique<
-							misc::Vertex>
-							(output_buffer->getName().
-							c_str()));
-
-					// Get the vertex which is the last
-					// vertex in the vertices list
-					misc::Vertex *vertex = graph->getVertex(
-							graph->getNumVertices() - 1);
-
-					// Map the vertex with the buffer for
-					// future easy reference
-					buffer_to_vertex.insert(std::make_pair(
-							output_buffer,
-							vertex));
-					
-					// We break from the for look and move
-					// on to the next buffer since we
-					// already find the buffer in the table
-					break;
-				}
-			}
-		} 
-	}
-
-	// For every source node
-	for (int source_id = 0; source_id < dimension; source_id++)
+		auto it = buffer_to_vertex.find(buffer);
+		if (it != buffer_to_vertex.end())
+			return it->second;
+		graph->addVertex(misc::new_unique<misc::Vertex>(
+				buffer->getName().c_str()));
+		misc::Vertex *vertex = graph->getVertex(
+				graph->getNumVertices() - 1);
+		buffer_to_vertex.emplace(buffer, vertex);
+		return vertex;
+	};
+
+	// Edges already added, to avoid duplicates
+	std::set<std::pair<misc::Vertex *, misc::Vertex *>> edges;
+
+	// For every destination node
+	std::vector<Entry> entries;
+	for (int destination_id = 0; destination_id < dimension;
+			destination_id++)
 	{
-		// Get the source node
-		Node *source_node = network->getNode(source_id);
-
-		//For every destination node
-		for (int destination_id = 0; destination_id< dimension; 
-				destination_id++)
+		// Get the destination node
+		Node *destination_node = network->getNode(destination_id);
+
+		// States to explore, given by the node and the output buffer
+		// of the previous hop that the packet came through. Packets
+		// can be injected from any node.
+		std::vector<std::pair<Node *, Buffer *>> states;
+		std::unordered_set<Buffer *> visited;
+		for (int source_id = 0; source_id < dimension; source_id++)
+			if (source_id != destination_id)
+				states.emplace_back(network->getNode(source_id),
+						nullptr);
+
+		// Explore states
+		while (!states.empty())
 		{
-			// Get the destination node
-			Node *destination_node = network->getNode(
-					destination_id);
-
-			// If the source and destination are the same, continue
-			if (source_node == destination_node)
-				continue;
-
-			// Find the entry in the routing table
-			Entry *entry = Lookup(source_node, destination_node);
-
-			// Get the associated output buffer for the entry
-			Buffer *source_vertex_buffer = entry->getBuffer();
-			if (source_vertex_buffer)
+			// Next state
+			Node *node = states.back().first;
+			Buffer *previous_buffer = states.back().second;
+			states.pop_back();
+
+			// Routes offered to the packet
+			Buffer *input_buffer = previous_buffer ?
+					getPairedInputBuffer(previous_buffer,
+					node) : nullptr;
+			entries.clear();
+			route_set(node, destination_node, input_buffer, entries);
+			for (Entry &entry : entries)
 			{
-				// Get the next node of the entry
-				Node *next_node = entry->getNextNode();
-
-				// Based on the next node perform another 
-				// lookup in the routing table to retrieve the 
-				// next output buffer (next_node, destination)
-				Entry *next_entry = Lookup(next_node, 
-						destination_node);
-
-				// Get the associated output buffer for the
-				// next entry if any
-				Buffer *destination_vertex_buffer = next_entry->
-						getBuffer();
-				if (destination_vertex_buffer)
+				// No route
+				Buffer *buffer = entry.getBuffer();
+				if (!buffer)
+					continue;
+
+				// Add an edge from the previous buffer
+				misc::Vertex *vertex = getVertex(buffer);
+				if (previous_buffer)
 				{
-
-					// Find the source vertex based on the 
-					// source output buffer in the unordered 
-					// map
-					auto source_vertex_it = 
-							buffer_to_vertex.find(
-							source_vertex_buffer);
-					assert(source_vertex_it != 
-							buffer_to_vertex.end());
-
-					// Find the destination vertex based on 
-					// the destination output buffer
-					auto destination_vertex_it = 
-							buffer_to_vertex.find(
-							destination_vertex_buffer);
-					assert(destination_vertex_it != 
-							buffer_to_vertex.end());
-
-					// First see if the edge exists
-					if (!graph->findEdge(source_vertex_it->second,
-						destination_vertex_it->second))
-					{
-						// Add an edge to the graph based 
-						// on the source and the destination 
-						//vertex
+					misc::Vertex *previous_vertex =
+							getVertex(previous_buffer);
+					if (edges.emplace(previous_vertex,
+							vertex).second)
 						graph->addEdge(misc::new_unique<
-								misc::Edge>
-								(source_vertex_it->
-								second,
-								destination_vertex_it->
-								second),
-								source_vertex_it->
-								second,
-								destination_vertex_it->
-								second);
-					}
+								misc::Edge>(
+								previous_vertex,
+								vertex),
+								previous_vertex,
+								vertex);
 				}
+
+				// Continue from the next node
+				Node *next_node = entry.getNextNode();
+				if (next_node != destination_node &&
+						visited.insert(buffer).second)
+					states.emplace_back(next_node, buffer);
 			}
 		}
 	}
@@ -338,15 +339,36 @@ bool RoutingTable::hasCycle()
 }
 
 
-RoutingTable::Entry *RoutingTable::Lookup(Node *source,
+Buffer *RoutingTable::Route(Node *node, Node *destination,
+		Buffer *input_buffer) const
+{
+	// Adaptive routing
+	if (adaptive_routing_function)
+		return adaptive_routing_function(node, destination,
+				input_buffer);
+
+	// Route in the table
+	return Lookup(node, destination).getBuffer();
+}
+
+
+RoutingTable::Entry RoutingTable::Lookup(Node *source,
 		Node *destination) const
 {
+	// Algorithmic routing
+	if (routing_function)
+		return routing_function(source, destination);
+
 	int i = source->getIndex();
 	int j = destination->getIndex();
 	assert((dimension > 0) && (i < dimension) && (j < dimension));
 
-	int location = i * dimension + j;
-	return entries.at(location).get();
+	const CompactEntry &entry = entries[(size_t) i * dimension + j];
+	return Entry(entry.cost,
+			entry.next_node < 0 ? nullptr :
+					network->getNode(entry.next_node),
+			entry.buffer < 0 ? nullptr :
+					source->getOutputBuffer(entry.buffer));
 }
 
 
@@ -370,23 +392,23 @@ void RoutingTable::Dump(std::ostream &os) const
 			unsigned int entry_text_size = 0;
 
 			// Get the entry of the table
-			Entry *entry = Lookup(node_i, network->getNode(j));
+			Entry entry = Lookup(node_i, network->getNode(j));
 
 			// Get the string size of the members that
 			// will be printed, and add them up
 			// Starting with the cost
-			entry_text_size += std::to_string(entry->cost).length();
+			entry_text_size += std::to_string(entry.cost).length();
 
 			// Then add 2 for the separator, followed by the
 			// name of the next_node
-			Node *next = entry->getNextNode();
+			Node *next = entry.getNextNode();
 			if (next)
 				entry_text_size += next->getName().length();
 			entry_text_size += 2;
 
 			// Another separator (+2) followed by the name of
 			// the buffer
-			Buffer *buffer = entry->getBuffer();
+			Buffer *buffer = entry.getBuffer();
 			if (buffer)
 				entry_text_size += buffer->getName().length();
 			entry_text_size += 2;
@@ -457,24 +479,24 @@ void RoutingTable::Dump(std::ostream &os) const
 		for (int j = 0; j < dimension; j++)
 		{
 			Node *node_j = network->getNode(j);
-			Entry *entry = Lookup(node_i,node_j);
+			Entry entry = Lookup(node_i,node_j);
 
 			// First we have to create the string that will be
 			// printed for each element:
 			// Node:Buffer (Cost), or
 			// Empty
-			if (entry->getNextNode())	
+			if (entry.getNextNode())	
 			{
 				// In case there is a next node
-				Node *next = entry->getNextNode();
+				Node *next = entry.getNextNode();
 				std::string element = next->getName() + ':'; 
 
 				// Make sure the buffer exists, and add it to
 				// the string
-				if (entry->getBuffer())
-					element = element + entry->getBuffer()->
+				if (entry.getBuffer())
+					element = element + entry.getBuffer()->
 							getName();
-				element = element + ' ' + '(' + std::to_string(entry->cost)
+				element = element + ' ' + '(' + std::to_string(entry.cost)
 							+ ')';
 
 				// Printing the entry out
@@ -512,11 +534,8 @@ void RoutingTable::UpdateRoute(Node *source, Node *destination,
 				source->getName().c_str(),
 				destination->getName().c_str()));
 
-	// Getting the routing table entry
-	Entry *entry = Lookup(source, destination);
-
-	// Setting the next node
-	entry->setNextNode(next);
+	// Output buffer of the route
+	Buffer *route_buffer = nullptr;
 
 	// Exit strategy from the nested loop
 	bool route_updated = false;
@@ -558,7 +577,7 @@ void RoutingTable::UpdateRoute(Node *source, Node *destination,
 				assert(entry_buffer->getNode() == source);
 
 				// Update the entry with calculated buffer
-				entry->setBuffer(entry_buffer);
+				route_buffer = entry_buffer;
 				route_updated = true;
 				break;
 			}
@@ -581,8 +600,9 @@ void RoutingTable::UpdateRoute(Node *source, Node *destination,
 						getDestinationBuffer(j);
 				if (destination_buffer->getNode() == next)
 				{
-					// Update the entry
-					entry->setBuffer(destination_buffer);
+					// Update the entry with the output
+					// buffer leading to the connection
+					route_buffer = buffer;
 
 					// Exit the nested loop
 					route_updated = true;
@@ -599,6 +619,12 @@ void RoutingTable::UpdateRoute(Node *source, Node *destination,
 				network->getName().c_str(),
 				source->getName().c_str(),
 				destination->getName().c_str()));
+
+	// Update the routing table entry
+	setEntry(source, destination,
+			getEntry(source->getIndex(),
+					destination->getIndex()).cost,
+			next, route_buffer);
 }
 
 
@@ -626,17 +652,18 @@ void RoutingTable::UpdateManualRoutingCost()
 			Node *destination = network->getNode(j);
 
 			// Lookup the entry
-			Entry *entry = Lookup(source, destination);
+			CompactEntry &entry = getEntry(i, j);
 
 			// Get the next node
-			Node *next = entry->getNextNode();
+			Node *next = entry.next_node < 0 ? nullptr :
+					network->getNode(entry.next_node);
 
 			// If the entry has a next node we have to update
 			// the cost
 			if (next)
 			{
 				// The cost of the first step in the route
-				entry->cost = Lookup(source, next)->cost;
+				entry.cost = Lookup(source, next).cost;
 
 				// Traverse through the path
 				for(;;)
@@ -647,7 +674,7 @@ void RoutingTable::UpdateManualRoutingCost()
 
 					// Get the next element in the path
 					Node *path_entry = Lookup(next, 
-							destination)->getNextNode();
+							destination).getNextNode();
 
 					// If there is a missing link just break
 					// No error is reported since the
@@ -658,7 +685,7 @@ void RoutingTable::UpdateManualRoutingCost()
 					// Update the cost one step at a time
 					// The entry cost here should already
 					// been 1.
-					entry->cost += Lookup(next, path_entry)->cost;
+					entry.cost += Lookup(next, path_entry).cost;
 
 					// We set the update the next, to 
 					// become next in path
@@ -20,6 +20,9 @@
 #ifndef NETWORK_ROUTINGTABLE_H
 #define NETWORK_ROUTINGTABLE_H
 
+#include <cassert>
+#include <functional>
+#include <iostream>
 #include <vector>
 #include <memory>
 
@@ -74,16 +77,91 @@ public:
 		void setBuffer(Buffer *buffer) { this->buffer = buffer; }
 	};
 
+	/// Function returning the route from a node to a destination node,
+	/// used by regular topologies to route algorithmically without a
+	/// table.
+	typedef std::function<Entry(Node *node, Node *destination)>
+			RoutingFunction;
+
+	/// Function choosing the output buffer of a packet in a node heading
+	/// to a destination node, given the input buffer where the packet is,
+	/// or `nullptr` if the packet is injected. Used for adaptive routing.
+	typedef std::function<Buffer *(Node *node, Node *destination,
+			Buffer *input_buffer)> AdaptiveRoutingFunction;
+
+	/// Function adding to \a entries all the routes that a packet in a
+	/// node heading to a destination node can take, given the input
+	/// buffer where the packet is, or `nullptr` if the packet is
+	/// injected. Used to check routing algorithms for deadlocks.
+	typedef std::function<void(Node *node, Node *destination,
+			Buffer *input_buffer, std::vector<Entry> &entries)>
+			RouteSetFunction;
+
 private:
 
+	// Entry as stored in the table. Nodes and buffers are referenced by
+	// their index, so that a table for thousands of nodes fits in memory.
+	struct CompactEntry
+	{
+		// Index of the next node, or -1 if there is no route
+		int next_node = -1;
+
+		// Index of the output buffer in the node, or -1 if none
+		short buffer = -1;
+
+		// Cost in hops
+		unsigned short cost = 0;
+	};
+
+	// Connection from a node to a neighbor node
+	struct Hop
+	{
+		// Index of the neighbor
+		int node;
+
+		// Index of the output buffer leading to the neighbor
+		int buffer;
+	};
+
 	// Associated network
 	Network *network;
 
 	// Dimension
 	int dimension = 0;
 
-	// Entries
-	std::vector<std::unique_ptr<Entry>> entries;
+	// Entries, indexed by source and destination node
+	std::vector<CompactEntry> entries;
+
+	// Function for algorithmic routing, if any
+	RoutingFunction routing_function;
+
+	// Function for adaptive routing, if any
+	AdaptiveRoutingFunction adaptive_routing_function;
+
+	// Return the entry from the node with index i to the node with
+	// index j
+	CompactEntry &getEntry(int i, int j)
+	{
+		assert(i < dimension && j < dimension);
+		return entries[(size_t) i * dimension + j];
+	}
+
+	// Set the entry from a node to a destination node
+	void setEntry(Node *source, Node *destination, int cost,
+			Node *next_node, Buffer *buffer);
+
+	// Return the nodes connected to a node in one hop, in the order of
+	// the output buffers of the node.
+	void getHops(Node *node, std::vector<Hop> &hops) const;
+
+	// Calculate the routes from all nodes to the nodes with index
+	// between 'first' and 'last', with a breadth-first search from each
+	// destination node over the reverse graph.
+	void CalculateRoutesTo(
+			const std::vector<std::vector<Hop>> &hops,
+			const std::vector<std::vector<int>> &reverse_hops,
+			int first,
+			int last);
 
 public:
 
@@ -98,11 +176,47 @@ public:
 	/// the table structures.
 	void Initialize();
 
-	/// Perform a Floyd-Warshall to find the best routes
-	void FloydWarshall();
+	/// Route algorithmically with the given function instead of a table.
+	/// This must be invoked before the table is initialized, and no table
+	/// is allocated afterwards.
+	void setRoutingFunction(RoutingFunction routing_function)
+	{
+		this->routing_function = routing_function;
+	}
+
+	/// Return whether routes are calculated algorithmically
+	bool isAlgorithmic() const { return (bool) routing_function; }
 
-	/// Look up the entry from a certain node to a certain node
-	Entry *Lookup(Node *source, Node *destination) const;
+	/// Route packets adaptively with the given function. The routes
+	/// returned by Lookup() are still used to inject packets from end
+	/// nodes.
+	void setAdaptiveRoutingFunction(
+			AdaptiveRoutingFunction adaptive_routing_function)
+	{
+		this->adaptive_routing_function = adaptive_routing_function;
+	}
+
+	/// Return whether packets are routed adaptively
+	bool isAdaptive() const { return (bool) adaptive_routing_function; }
+
+	/// Return the output buffer that a packet in an input buffer of a
+	/// node takes towards a destination node. With adaptive routing, the
+	/// choice depends on the current state of the network. Otherwise,
+	/// this is the buffer returned by Lookup(). Returns `nullptr` if
+	/// there is no route.
+	Buffer *Route(Node *node, Node *destination, Buffer *input_buffer) const;
+
+	/// Find the shortest routes between all pairs of nodes. A
+	/// breadth-first search runs from each destination node, and
+	/// destinations are distributed across host threads (see option
+	/// '--net-routing-threads'). Among neighbors at the same distance from
+	/// the destination, the one reached through the first output buffer of
+	/// the node is chosen.
+	void CalculateRoutes();
+
+	/// Look up the entry from a certain node to a certain node. An entry
+	/// with no buffer is returned if there is no route.
+	Entry Lookup(Node *source, Node *destination) const;
 
 	/// Generating the route file
 	void DumpRoutes(const std::string &path);
@@ -113,6 +227,13 @@ public:
 	/// Check if the routing table has cycle
 	bool hasCycle();
 
+	/// Check if the dependencies between buffers have a cycle, for a
+	/// routing algorithm that can offer several routes to a packet. For
+	/// each destination, all states reachable by packets injected from
+	/// any node are explored, and an edge is added from every buffer
+	/// to every buffer that the packet can request next.
+	bool hasCycle(RouteSetFunction route_set);
+
 	/// Update a route manually. This function is used for adding route-steps.
 	/// Route-step is an element in the list of connections that provide the
 	/// path between two nodes in manual routing. Each routes requires the
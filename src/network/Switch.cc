@@ -17,7 +17,13 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+#include <unordered_map>
+
+#include <lib/esim/Engine.h>
+
 #include "Packet.h"
+#include "Frame.h"
 #include "Switch.h"
 
 namespace net
@@ -95,18 +101,57 @@ void Switch::Forward(Packet *packet)
 		return;
 	}
 
-	// Look up the routing table for next output buffer
+	// In flit-level networks, the flits following the head flit use the
+	// virtual channel allocated to their message. Otherwise, packets are
+	// routed every time they try to move, so that adaptive routes
+	// reflect the current state of the network.
 	RoutingTable *routing_table = network->getRoutingTable();
-	Node *destination_node = message->getDestinationNode();
-	RoutingTable::Entry *entry = 
-			routing_table->Lookup(node, destination_node);
-	if (!entry) 
-		throw misc::Panic(misc::fmt("%s: no route from %s "
-				"to %s.",
-				network->getName().c_str(), 
-				node->getName().c_str(), 
-				destination_node->getName().c_str()));
-	Buffer *output_buffer = entry->getBuffer();
+	Buffer *output_buffer = network->isFlitLevel() ?
+			input_buffer->getAllocatedBuffer() : nullptr;
+	if (!output_buffer)
+	{
+		// Route the packet to the next output buffer. Multicast
+		// messages with several destinations follow the routing table,
+		// so that they are replicated where the routes to their
+		// destinations diverge.
+		Node *destination_node = message->getDestinationNode();
+		output_buffer = message->getNumDestinations() > 1 ?
+				routing_table->Lookup(node, destination_node).
+				getBuffer() :
+				routing_table->Route(node, destination_node,
+				input_buffer);
+		if (!output_buffer) 
+			throw misc::Panic(misc::fmt("%s: no route from %s "
+					"to %s.",
+					network->getName().c_str(), 
+					node->getName().c_str(), 
+					destination_node->getName().c_str()));
+
+		// Head flits allocate a virtual channel that is held by the
+		// message until its tail flit goes through
+		if (network->isFlitLevel())
+		{
+			output_buffer = AllocateVirtualChannel(message,
+					output_buffer);
+			if (!output_buffer)
+			{
+				// Update debug information
+				System::debug << misc::fmt("net: %s - "
+						"M-%lld:%d - "
+						"stl_sw_vc_alloc: %s\n",
+						network->getName().c_str(),
+						message->getId(),
+						packet->getId(),
+						name.c_str());
+
+				esim_engine->Next(current_event, 1);
+				return;
+			}
+		}
+
+		// Record the request for the switch allocators
+		input_buffer->setAllocatedBuffer(output_buffer);
+	}
 
 	// Check if the output buffer is busy
 	if (output_buffer->write_busy >= cycle)
@@ -178,7 +223,11 @@ void Switch::Forward(Packet *packet)
 	}
 
 	// If scheduler says that it is not our turn, try later
-	if (Schedule(output_buffer) != input_buffer)
+	bool granted = network->getSwitchAllocator() ==
+			Network::SwitchAllocatorISLIP ?
+			Allocate(input_buffer) == output_buffer :
+			Schedule(output_buffer) == input_buffer;
+	if (!granted)
 	{
 		// Update debug information
 		System::debug << misc::fmt("net: %s - M-%lld:%d - "
@@ -196,22 +245,53 @@ void Switch::Forward(Packet *packet)
 	int latency = (packet->getSize() - 1) / bandwidth + 1;
 	input_buffer->read_busy = cycle + latency - 1;
 	output_buffer->write_busy = cycle + latency - 1;
+	crossbar_bytes += packet->getSize();
+	crossbar_busy_cycles += latency;
+
+	// In flit-level networks, flits go through the router pipeline
+	// stages of route computation, virtual channel allocation, switch
+	// allocation, and switch traversal. Only head flits go through the
+	// first two stages. The crossbar is only busy during traversal.
+	if (network->isFlitLevel())
+	{
+		int stages = network->getRouterStages();
+		latency += packet->isHead() ? stages - 1 :
+				std::max(stages - 3, 0);
+	}
+
+	// The tail flit releases the virtual channel
+	if (network->isFlitLevel() && packet->isTail())
+		output_buffer->setOwner(nullptr);
+	if (!network->isFlitLevel() || packet->isTail())
+		input_buffer->setAllocatedBuffer(nullptr);
+
+	// Multicast messages are replicated when the routes to their
+	// destinations diverge. Only a copy for the destinations reached
+	// through the output buffer goes through the crossbar, while the
+	// original packet stays in the input buffer for the rest.
+	Message *copy = message->getNumDestinations() > 1 ?
+			network->ReplicateMulticast(message, this) : nullptr;
+	Packet *forwarded_packet = copy ? copy->getPacket(0) : packet;
 
 	// Transfer message to next output buffer
-	input_buffer->ExtractPacket();
-	output_buffer->InsertPacket(packet);
-	packet->setBuffer(output_buffer);
-	packet->setBusy(cycle + latency - 1);
-
-	// Buffer's trace information
-	System::trace << misc::fmt("net.packet_extract "
-			"net=\"%s\" node=\"%s\" buffer=\"%s\" "
-			"name=\"P-%lld:%d\" occpncy=%d\n",
-			network->getName().c_str(),
-			input_buffer->getNode()->getName().c_str(),
-			input_buffer->getName().c_str(),
-			message->getId(), packet->getId(),
-			input_buffer->getOccupancyInBytes());
+	if (!copy)
+	{
+		input_buffer->ExtractPacket();
+
+		// Buffer's trace information
+		System::trace << misc::fmt("net.packet_extract "
+				"net=\"%s\" node=\"%s\" buffer=\"%s\" "
+				"name=\"P-%lld:%d\" occpncy=%d\n",
+				network->getName().c_str(),
+				input_buffer->getNode()->getName().c_str(),
+				input_buffer->getName().c_str(),
+				message->getId(), packet->getId(),
+				input_buffer->getOccupancyInBytes());
+	}
+	output_buffer->InsertPacket(forwarded_packet);
+	forwarded_packet->setNode(this);
+	forwarded_packet->setBuffer(output_buffer);
+	forwarded_packet->setBusy(cycle + latency - 1);
 
 	System::trace << misc::fmt("net.packet_insert net=\"%s\" "
 			"node=\"%s\" buffer=\"%s\" "
@@ -219,9 +299,21 @@ void Switch::Forward(Packet *packet)
 			network->getName().c_str(),
 			output_buffer->getNode()->getName().c_str(),
 			output_buffer->getName().c_str(),
-			message->getId(), packet->getId(),
+			message->getId(), forwarded_packet->getId(),
 			output_buffer->getOccupancyInBytes());
 
+	// The copy of a multicast message continues in a new event chain,
+	// and the original packet is routed again once the input buffer is
+	// not busy.
+	if (copy)
+	{
+		auto frame = misc::new_shared<Frame>(forwarded_packet);
+		esim_engine->Call(System::event_output_buffer, frame, nullptr,
+				latency);
+		esim_engine->Next(current_event, 1);
+		return;
+	}
+
 	// Schedule next event
 	esim_engine->Next(System::event_output_buffer, latency);
 }
@@ -289,19 +381,7 @@ Buffer *Switch::Schedule(Buffer *output_buffer)
 		// Skip the buffer whose first packet is not to be forwarded
 		// to the output buffer
 		Packet *packet = input_buffer->getBufferHead();
-		Message *message = packet->getMessage();
-		Node *destination_node = message->getDestinationNode();
-		Network *network = message->getNetwork();
-		RoutingTable *routingTable = network->getRoutingTable();
-		RoutingTable::Entry *entry = routingTable->Lookup(this, 
-				destination_node);
-		if (!entry) 
-			throw misc::Panic(misc::fmt("No route found from "
-					"node %s to node %s", 
-					this->getName().c_str(),
-					destination_node->getName().c_str()));
-		Buffer *next_buffer = entry->getBuffer();
-		if (next_buffer != output_buffer)
+		if (getRequest(input_buffer) != output_buffer)
 			continue;
 	
 		// There must be enough space left in the output buffer
@@ -319,4 +399,242 @@ Buffer *Switch::Schedule(Buffer *output_buffer)
 	return nullptr;
 }
 
+
+Buffer *Switch::getRequest(Buffer *input_buffer)
+{
+	// Output buffer chosen last time the packet was routed, or virtual
+	// channel allocated to the message
+	Packet *packet = input_buffer->getBufferHead();
+	Message *message = packet->getMessage();
+	Network *network = message->getNetwork();
+	if (input_buffer->getAllocatedBuffer() || network->isFlitLevel())
+		return input_buffer->getAllocatedBuffer();
+
+	// Look up the routing table
+	Node *destination_node = message->getDestinationNode();
+	RoutingTable *routingTable = network->getRoutingTable();
+	RoutingTable::Entry entry = routingTable->Lookup(this, 
+			destination_node);
+	if (!entry.getBuffer()) 
+		throw misc::Panic(misc::fmt("No route found from "
+				"node %s to node %s", 
+				this->getName().c_str(),
+				destination_node->getName().c_str()));
+	return entry.getBuffer();
+}
+
+
+Buffer *Switch::getReadyRequest(Buffer *input_buffer)
+{
+	// The packet at the head of the buffer must have arrived, and the
+	// buffer must not be in read busy
+	long long cycle = System::getInstance()->getCycle();
+	Packet *packet = input_buffer->getBufferHead();
+	if (!packet || packet->getBusy() >= cycle ||
+			input_buffer->read_busy >= cycle)
+		return nullptr;
+
+	// The output buffer must be free and have space for the packet
+	Buffer *output_buffer = getRequest(input_buffer);
+	if (!output_buffer || output_buffer->write_busy >= cycle ||
+			output_buffer->getCount() + packet->getSize() >
+			output_buffer->getSize())
+		return nullptr;
+
+	// Request valid
+	return output_buffer;
+}
+
+
+Buffer *Switch::AllocateVirtualChannel(Message *message, Buffer *output_buffer)
+{
+	// Virtual channels of buses are not interchangeable, and adaptive
+	// routing chooses the virtual channel itself
+	Link *link = dynamic_cast<Link *>(output_buffer->getConnection());
+	if (!link || network->getRoutingTable()->isAdaptive())
+	{
+		if (output_buffer->getOwner())
+			return nullptr;
+		output_buffer->setOwner(message);
+		return output_buffer;
+	}
+
+	// Find the routed virtual channel in the link
+	int num_virtual_channels = link->getNumSourceBuffers();
+	int routed_index = 0;
+	while (link->getSourceBuffer(routed_index) != output_buffer)
+		routed_index++;
+
+	// Take the first free virtual channel
+	for (int i = 0; i < num_virtual_channels; i++)
+	{
+		Buffer *buffer = link->getSourceBuffer((routed_index + i) %
+				num_virtual_channels);
+		if (!buffer->getOwner())
+		{
+			buffer->setOwner(message);
+			return buffer;
+		}
+	}
+
+	// All virtual channels are held by other messages
+	return nullptr;
+}
+
+
+void Switch::InitializePorts()
+{
+	// Group input buffers by connection
+	std::unordered_map<Connection *, int> ports;
+	for (auto &buffer : input_buffers)
+	{
+		auto it = ports.find(buffer->getConnection());
+		if (it == ports.end())
+		{
+			it = ports.emplace(buffer->getConnection(),
+					input_port_buffers.size()).first;
+			input_port_buffers.emplace_back();
+		}
+		input_port_buffers[it->second].push_back(buffer->getIndex());
+	}
+
+	// Group output buffers by connection
+	ports.clear();
+	for (auto &buffer : output_buffers)
+	{
+		auto it = ports.find(buffer->getConnection());
+		if (it == ports.end())
+			it = ports.emplace(buffer->getConnection(),
+					num_output_ports++).first;
+		output_ports.push_back(it->second);
+	}
+
+	// Initialize arbiters
+	grant_pointers.resize(num_output_ports);
+	accept_pointers.resize(input_port_buffers.size());
+	buffer_pointers.resize(input_port_buffers.size());
+	matches.resize(input_buffers.size());
+}
+
+
+void Switch::Match()
+{
+	// Clear previous matches
+	std::fill(matches.begin(), matches.end(), nullptr);
+
+	// Collect requests of all input buffers
+	std::vector<Buffer *> requests(input_buffers.size());
+	for (unsigned i = 0; i < input_buffers.size(); i++)
+		requests[i] = getReadyRequest(input_buffers[i].get());
+
+	// Iterations
+	int num_input_ports = input_port_buffers.size();
+	std::vector<bool> input_matched(num_input_ports);
+	std::vector<bool> output_matched(num_output_ports);
+	for (int iteration = 0; iteration < network->getAllocatorIterations();
+			iteration++)
+	{
+		// Grant phase. Each unmatched output port grants the first
+		// unmatched input port requesting it, after its pointer.
+		std::vector<int> grants(num_output_ports, -1);
+		for (int output_port = 0; output_port < num_output_ports;
+				output_port++)
+		{
+			if (output_matched[output_port])
+				continue;
+			for (int i = 0; i < num_input_ports; i++)
+			{
+				int input_port = (grant_pointers[output_port] + i)
+						% num_input_ports;
+				if (input_matched[input_port])
+					continue;
+				bool requested = false;
+				for (int index : input_port_buffers[input_port])
+					if (requests[index] && output_ports[requests[
+							index]->getIndex()] ==
+							output_port)
+						requested = true;
+				if (requested)
+				{
+					grants[output_port] = input_port;
+					break;
+				}
+			}
+		}
+
+		// Accept phase. Each unmatched input port accepts the first
+		// output port granting it, after its pointer.
+		bool matched = false;
+		for (int input_port = 0; input_port < num_input_ports;
+				input_port++)
+		{
+			if (input_matched[input_port])
+				continue;
+			for (int i = 0; i < num_output_ports; i++)
+			{
+				int output_port = (accept_pointers[input_port] + i)
+						% num_output_ports;
+				if (grants[output_port] != input_port)
+					continue;
+
+				// Choose among the buffers of the input port
+				// requesting the output port
+				const std::vector<int> &buffers =
+						input_port_buffers[input_port];
+				int num_buffers = buffers.size();
+				for (int j = 0; j < num_buffers; j++)
+				{
+					int k = (buffer_pointers[input_port] + j)
+							% num_buffers;
+					Buffer *request = requests[buffers[k]];
+					if (!request || output_ports[request->
+							getIndex()] != output_port)
+						continue;
+					matches[buffers[k]] = request;
+					buffer_pointers[input_port] =
+							(k + 1) % num_buffers;
+					break;
+				}
+
+				// Pointers are only updated in the first
+				// iteration, which avoids starvation
+				if (!iteration)
+				{
+					grant_pointers[output_port] = (input_port
+							+ 1) % num_input_ports;
+					accept_pointers[input_port] = (output_port
+							+ 1) % num_output_ports;
+				}
+				input_matched[input_port] = true;
+				output_matched[output_port] = true;
+				matched = true;
+				break;
+			}
+		}
+
+		// Stop when no new match was found
+		if (!matched)
+			break;
+	}
+}
+
+
+Buffer *Switch::Allocate(Buffer *input_buffer)
+{
+	// Ports are created the first time
+	if (matches.empty())
+		InitializePorts();
+
+	// Make a new decision once per cycle
+	long long cycle = System::getInstance()->getCycle();
+	if (allocated_cycle != cycle)
+	{
+		allocated_cycle = cycle;
+		Match();
+	}
+
+	// Return the matched output buffer
+	return matches[input_buffer->getIndex()];
+}
+
 }
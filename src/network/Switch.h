@@ -31,6 +31,68 @@ class Switch : public Node
 	// Bandwidth of the switch
 	int bandwidth;
 
+	// Bytes that traversed the crossbar, and sum over all output buffers
+	// of the cycles they were busy receiving from the crossbar
+	long long crossbar_bytes = 0;
+	long long crossbar_busy_cycles = 0;
+
+
+
+	//
+	// iSLIP allocator
+	//
+
+	// Cycle when the last allocation was made
+	long long allocated_cycle = -1;
+
+	// Indices of the input buffers of each input port. Input buffers
+	// connected to the same link or bus form one port.
+	std::vector<std::vector<int>> input_port_buffers;
+
+	// Output port of each output buffer, by index
+	std::vector<int> output_ports;
+
+	// Number of output ports
+	int num_output_ports = 0;
+
+	// Round-robin pointers of the grant arbiters of output ports
+	std::vector<int> grant_pointers;
+
+	// Round-robin pointers of the accept arbiters of input ports
+	std::vector<int> accept_pointers;
+
+	// Round-robin pointers among the buffers of each input port
+	std::vector<int> buffer_pointers;
+
+	// Output buffer matched with each input buffer in the last
+	// allocation, by input buffer index
+	std::vector<Buffer *> matches;
+
+	// Group input and output buffers into ports
+	void InitializePorts();
+
+	// Run the iterations of the iSLIP allocator for the current cycle
+	void Match();
+
+	// Return the output buffer requested by the packet at the head of
+	// an input buffer, which is the one chosen the last time the packet
+	// was routed. In flit-level networks, this is the output buffer
+	// allocated to the message, or null if the head flit did not
+	// allocate a virtual channel yet.
+	Buffer *getRequest(Buffer *input_buffer);
+
+	// Return the output buffer requested by the packet at the head of
+	// an input buffer, only if the packet can be forwarded in the
+	// current cycle.
+	Buffer *getReadyRequest(Buffer *input_buffer);
+
+	// Allocate a virtual channel of the same link as the routed output
+	// buffer to a message, starting with the routed output buffer
+	// itself. With adaptive routing, only the routed output buffer is
+	// considered. Return null if all virtual channels are held by other
+	// messages.
+	Buffer *AllocateVirtualChannel(Message *message, Buffer *output_buffer);
+
 public:
 
 	/// Constructor
@@ -53,6 +115,16 @@ public:
 	/// Dump node information
 	void Dump(std::ostream &os) const;
 
+	/// Get the crossbar bandwidth
+	int getBandwidth() const { return bandwidth; }
+
+	/// Return the number of bytes that traversed the crossbar
+	long long getCrossbarBytes() const { return crossbar_bytes; }
+
+	/// Return the sum over all output buffers of the cycles they were
+	/// busy receiving packets from the crossbar
+	long long getCrossbarBusyCycles() const { return crossbar_busy_cycles; }
+
 	/// Forward the packet to next hop
 	/// 
 	/// This function would at first assert the packet is in an input 
@@ -107,6 +179,22 @@ public:
 	/// 	The input buffer that is wired with the output buffer
 	///
 	Buffer *Schedule(Buffer *output_buffer);
+
+	/// Implements the separable iSLIP allocator in the switch. The
+	/// input and output buffers attached to the same link or bus form
+	/// one port. In every cycle, each input port requests the output
+	/// ports of the packets at the head of its buffers. Each output
+	/// port grants one requesting input port, and each input port
+	/// accepts one grant, both in round-robin order starting after the
+	/// last accepted match. Unmatched ports are matched again in the
+	/// following iterations, up to the network's number of allocator
+	/// iterations. This function returns the output buffer matched
+	/// with \a input_buffer in the current cycle, or null if the input
+	/// buffer was not matched.
+	///
+	/// This function needs to be called within an event handler.
+	///
+	Buffer *Allocate(Buffer *input_buffer);
 };
 
 }
@@ -17,9 +17,16 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sys/resource.h>
+
 #include <lib/cpp/CommandLine.h>
 #include <lib/esim/Engine.h>
 #include <lib/cpp/Misc.h>
+#include <lib/cpp/Timer.h>
 
 #include "Network.h"
 #include "Node.h"
@@ -49,8 +56,30 @@ long long System::max_cycles = 1000000;
 
 int System::message_size = 1;
 
+int System::routing_threads = 0;
+
 double System::injection_rate = 0.001;
 
+Traffic::Pattern System::traffic_pattern = Traffic::PatternUniform;
+
+std::string System::hotspot_name;
+
+double System::hotspot_fraction = 0.5;
+
+std::string System::trace_input;
+
+std::string System::heatmap_file;
+
+long long System::heatmap_interval = 0;
+
+std::string System::sweep_file;
+
+double System::sweep_step = 0.01;
+
+std::string System::benchmark_file;
+
+long long System::benchmark_cycles = 20000;
+
 bool System::stand_alone = false;
 
 bool System::help = false;
@@ -75,14 +104,6 @@ System *System::getInstance()
 }
 
 
-double System::RandomExponential(double lambda)
-{
-	double x = (double) random() / RAND_MAX;
-	double ret = log(1 - x) / -lambda;
-	return ret;
-}
-
-
 System::System()
 {
 	// Create frequency domain
@@ -158,6 +179,113 @@ void System::RegisterOptions()
 			"in the network configuration file (option "
 			"'--net-config')");
 
+	// Traffic pattern for stand-alone simulator
+	command_line->RegisterEnum("--net-traffic {uniform|transpose|"
+			"bit-complement|bit-reverse|hotspot|neighbor|trace} "
+			"(default = uniform)",
+			(int &) traffic_pattern, Traffic::PatternMap,
+			"For network simulation, destination of the messages "
+			"injected by each end node, where end nodes are numbered "
+			"in the order they are defined. With 'uniform', "
+			"destinations are random. With 'transpose', "
+			"'bit-complement', and 'bit-reverse', end node i sends to "
+			"the end node obtained by transposing the row and column "
+			"of i in a square, complementing its bits, or reversing "
+			"its bits, respectively. With 'hotspot', a fraction of "
+			"the messages go to a single end node (see "
+			"'--net-hotspot-node'). With 'neighbor', end node i sends "
+			"to end node i + 1. With 'trace', messages are read from "
+			"the file given in '--net-trace-input'. This option must "
+			"be used together with '--net-sim'.");
+
+	// Hotspot node
+	command_line->RegisterString("--net-hotspot-node <name>",
+			hotspot_name,
+			"Destination end node of the 'hotspot' traffic pattern. "
+			"The default is the first end node of the network.");
+
+	// Hotspot fraction
+	command_line->RegisterDouble("--net-hotspot-fraction <number> "
+			"(default = 0.5)",
+			hotspot_fraction,
+			"Fraction of the messages sent to the hotspot node in the "
+			"'hotspot' traffic pattern. The rest of the messages are "
+			"sent to random destinations.");
+
+	// Message trace
+	command_line->RegisterString("--net-trace-input <file>",
+			trace_input,
+			"Binary message trace injected with traffic pattern "
+			"'trace'. Each record contains a 64-bit injection cycle, "
+			"followed by 32-bit source end node index, destination "
+			"end node index, and message size in bytes, all in host "
+			"byte order. Messages wait in their source end node until "
+			"they can be sent, and the simulation ends when all of "
+			"them are received, or after '--net-max-cycles' cycles.");
+
+	// Heatmap
+	command_line->RegisterString("--net-heatmap <file>",
+			heatmap_file,
+			"File to dump, in CSV format, the utilization, average "
+			"buffer occupancy, and dynamic energy of every link and "
+			"node of all networks. Rows are keyed by the coordinates "
+			"of nodes in generated topologies, or by node indices "
+			"otherwise, and links include the coordinates of both "
+			"ends. Values cover each interval given in option "
+			"'--net-heatmap-interval', or the whole simulation.");
+
+	// Heatmap interval
+	command_line->RegisterInt64("--net-heatmap-interval <cycles> "
+			"(default = 0)",
+			heatmap_interval,
+			"Interval in network cycles between heatmap samples "
+			"(option '--net-heatmap'). With the default value of 0, "
+			"only one sample is dumped at the end of the "
+			"simulation.");
+
+	// Injection rate sweep
+	command_line->RegisterString("--net-sweep <file>",
+			sweep_file,
+			"Run a sequence of network simulations with increasing "
+			"injection rates, starting at the sweep step (option "
+			"'--net-sweep-step') and stopping once the network "
+			"saturates, that is, when the accepted throughput falls "
+			"below 90% of the offered throughput. Each step runs for "
+			"'--net-max-cycles' cycles after a warm-up of 1/5 of "
+			"that, and dumps a line to <file> in CSV format with the "
+			"injection rate, offered and accepted throughput in "
+			"messages per end node per cycle, and average, 99th "
+			"percentile, and maximum latency of the messages received "
+			"in the step. This option must be used together with "
+			"'--net-sim'.");
+
+	// Injection rate sweep step
+	command_line->RegisterDouble("--net-sweep-step <number> "
+			"(default = 0.01)",
+			sweep_step,
+			"Increment of the injection rate between steps of an "
+			"injection rate sweep (option '--net-sweep').");
+
+	// Host performance benchmark
+	command_line->RegisterString("--net-benchmark <file>",
+			benchmark_file,
+			"Measure the host performance of the network model and "
+			"dump a report into <file>. Standard topologies (8x8 "
+			"and 16x16 meshes, and a fat tree) are simulated with "
+			"a fixed uniform synthetic load, reporting simulated "
+			"cycles per second, packets per second, and the peak "
+			"resident set size of the host process. No network "
+			"configuration file is needed. This option cannot be "
+			"used together with '--net-sim', '--net-sweep', "
+			"'--net-traffic', or '--net-trace-input'.");
+
+	// Cycles of each benchmark topology
+	command_line->RegisterInt64("--net-benchmark-cycles <number> "
+			"(default = 20000)",
+			benchmark_cycles,
+			"Number of cycles simulated for each topology of the "
+			"network benchmark (option '--net-benchmark').");
+
 	// Help message for network configuration
 	command_line->RegisterBool("--net-help",
 			help,
@@ -183,6 +311,15 @@ void System::RegisterOptions()
 			"Files for representing the routing table of each individual "
 			"network. The input is a string that consequently creates "
 			"an individual file for each network.");
+
+	// Threads for routing tables
+	command_line->RegisterInt32("--net-routing-threads <number> "
+			"(default = 0)",
+			routing_threads,
+			"Number of host threads calculating the routing tables "
+			"of the networks. Routes to different destinations are "
+			"calculated in parallel. The default value of 0 uses "
+			"all host cores.");
 }
 
 
@@ -204,10 +341,51 @@ void System::ProcessOptions()
 	if (!sim_net_name.empty())
 		stand_alone = true;
 
+	// The benchmark creates its own networks
+	if (!benchmark_file.empty())
+	{
+		if (stand_alone)
+			throw Error("Options --net-benchmark and --net-sim "
+					"cannot be used together");
+		if (!sweep_file.empty())
+			throw Error("Options --net-benchmark and --net-sweep "
+					"cannot be used together");
+		if (traffic_pattern != Traffic::PatternUniform)
+			throw Error("Options --net-benchmark and --net-traffic "
+					"cannot be used together");
+		if (!trace_input.empty())
+			throw Error("Options --net-benchmark and "
+					"--net-trace-input cannot be used "
+					"together");
+		if (benchmark_cycles < 1)
+			throw Error(misc::fmt("%lld: invalid value for option "
+					"--net-benchmark-cycles",
+					benchmark_cycles));
+		stand_alone = true;
+		return;
+	}
+
 	// Stand-Alone requires config file
 	if (stand_alone && config_file.empty())
 		throw Error(misc::fmt("Option --net-sim requires "
 				" --net-config option "));
+
+	// Trace-driven traffic requires a trace
+	if (traffic_pattern == Traffic::PatternTrace && trace_input.empty())
+		throw Error("Option --net-traffic trace requires option "
+				"--net-trace-input");
+
+	// Sweeps require synthetic traffic
+	if (!sweep_file.empty())
+	{
+		if (traffic_pattern == Traffic::PatternTrace)
+			throw Error("Option --net-sweep cannot be used with "
+					"trace-driven traffic");
+		if (sweep_step <= 0 || sweep_step > 1)
+			throw Error(misc::fmt("%g: invalid value for option "
+					"--net-sweep-step, must be greater than "
+					"0 and at most 1", sweep_step));
+	}
 }
 
 
@@ -220,6 +398,14 @@ void System::ReadConfiguration()
 		misc::IniFile ini_file(config_file);
 		ParseConfiguration(&ini_file);
 
+		// Link statistics for interval statistics
+		for (auto &network : networks)
+			network->RegisterIntervalStats();
+
+		// Heatmap
+		if (!heatmap_file.empty())
+			StartHeatmap();
+
 		// Currently network trace info will be created only if
 		// we have external configuration file. Here we activate the
 		// trace, since we have a configuration file, but the trace
@@ -231,6 +417,48 @@ void System::ReadConfiguration()
 }
 
 
+void System::StartHeatmap()
+{
+	// Check interval
+	if (heatmap_interval < 0 || heatmap_interval > INT_MAX)
+		throw Error(misc::fmt("%lld: invalid value for option "
+				"--net-heatmap-interval", heatmap_interval));
+
+	// Open file
+	heatmap.open(heatmap_file);
+	if (!heatmap)
+		throw Error(misc::fmt("%s: cannot open heatmap file",
+				heatmap_file.c_str()));
+	Network::DumpHeatmapHeader(heatmap);
+
+	// Schedule a periodic sample, and a last sample at the end
+	event_heatmap = esim_engine->RegisterEvent("net_heatmap",
+			EventHeatmapHandler, frequency_domain);
+	event_heatmap_end = esim_engine->RegisterEvent("net_heatmap_end",
+			EventHeatmapHandler, frequency_domain);
+	if (heatmap_interval)
+		esim_engine->Call(event_heatmap, nullptr, nullptr,
+				heatmap_interval, heatmap_interval);
+	esim_engine->EndEvent(event_heatmap_end);
+}
+
+
+void System::EventHeatmapHandler(esim::Event *event, esim::Frame *frame)
+{
+	// Periodic samples drained from the event heap after the simulation
+	// finished are ignored. The last interval is dumped by the end event.
+	System *system = getInstance();
+	esim::Engine *esim_engine = esim::Engine::getInstance();
+	if (event == system->event_heatmap && esim_engine->hasFinished())
+		return;
+
+	// Dump a sample for every network
+	long long cycle = system->getCycle();
+	for (auto &network : system->networks)
+		network->DumpHeatmap(system->heatmap, cycle);
+}
+
+
 void System::TraceHeader()
 {
 	// Update the trace header with network information
@@ -243,79 +471,257 @@ void System::TraceHeader()
 }
 
 
-void System::UniformTrafficSimulation(Network *network)
+std::unique_ptr<Traffic> System::CreateTraffic(Network *network)
 {
-	// Initiate a list of double for injection time
-	auto inject_time = misc::new_unique_array<double>(network->getNumNodes());
+	// Create traffic
+	auto traffic = misc::new_unique<Traffic>(network, traffic_pattern);
+	traffic->setInjectionRate(injection_rate);
+	traffic->setMessageSize(message_size);
 
+	// Hotspot
+	if (traffic_pattern == Traffic::PatternHotspot)
+	{
+		EndNode *hotspot_node = traffic->getEndNode(0);
+		if (!hotspot_name.empty())
+		{
+			hotspot_node = dynamic_cast<EndNode *>(
+					network->getNodeByName(hotspot_name));
+			if (!hotspot_node)
+				throw Error(misc::fmt("Network %s: %s: invalid "
+						"end node for option "
+						"--net-hotspot-node",
+						network->getName().c_str(),
+						hotspot_name.c_str()));
+		}
+		traffic->setHotspot(hotspot_node, hotspot_fraction);
+	}
+
+	// Message trace
+	if (traffic_pattern == Traffic::PatternTrace)
+		traffic->LoadTrace(trace_input);
+
+	// Return
+	return traffic;
+}
+
+
+void System::TrafficSimulation(Network *network, Traffic *traffic,
+		long long end_cycle)
+{
 	// Loop from the beginning to the end the simulation
+	esim::Engine *esim_engine = esim::Engine::getInstance();
 	while (1)
 	{
 		// Get current cycle and check max cycles
-		esim::Engine *esim_engine = esim::Engine::getInstance();
-		long long cycle = System::getInstance()->getCycle();
-		if (cycle >= max_cycles)
+		long long cycle = getCycle();
+		if (cycle >= end_cycle)
 			break;
 
-		// Traverse all nodes to check if some nodes need injection
-		for (int i = 0; i < network->getNumNodes(); i++)
-		{
-			// Get end node
-			EndNode *node = dynamic_cast<EndNode *>(
-					network->getNode(i));
-			if (!node)
-				continue;
-
-			// Check turn for next injection
-			if (inject_time[i] > cycle)
-				continue;
-
-			// Get a random destination node
-			EndNode *destination_node = nullptr;
-			while (1)
-			{
-				int num_nodes = network->getNumNodes();
-				int index = random() % num_nodes;
-				destination_node = dynamic_cast<EndNode *>(
-						network->getNode(index));
-				if (destination_node && destination_node != 
-						node)
-					break;
-			}
-
-			// Inject
-			while (inject_time[i] < cycle)
-			{
-				// Schedule next injection
-				inject_time[i] += RandomExponential(
-						injection_rate);
-
-				// Send the packet
-				if (network->CanSend(node, destination_node,
-					System::message_size))
-					network->Send(node, destination_node,
-							System::message_size);
-			}
-		}
+		// Trace finished
+		if (traffic->getPattern() == Traffic::PatternTrace &&
+				traffic->isTraceDone() &&
+				!network->getNumMessagesInFlight())
+			break;
+
+		// Inject messages
+		traffic->Inject(cycle);
 
 		// Next cycle
-		debug << misc::fmt("___ cycle %lld ___\n", cycle);	
+		debug << misc::fmt("___ cycle %lld ___\n", cycle);
 		esim_engine->ProcessEvents();
 	}
 }
 
+
+void System::SweepSimulation(Network *network, Traffic *traffic)
+{
+	// Open output file
+	std::ofstream f(sweep_file);
+	if (!f)
+		throw Error(misc::fmt("%s: cannot open injection rate sweep "
+				"file", sweep_file.c_str()));
+
+	// Header
+	f << "InjectionRate,OfferedThroughput,AcceptedThroughput,"
+			"AverageLatency,P99Latency,MaxLatency\n";
+
+	// Steps. The rate is computed from the step number to avoid
+	// accumulating rounding errors.
+	long long warmup_cycles = max_cycles / 5;
+	for (int step = 1; step * sweep_step <= 1.0 + 1e-9; step++)
+	{
+		// Warm up with the new rate, so that the statistics of the
+		// step do not include the transition from the previous one.
+		double rate = step * sweep_step;
+		traffic->setInjectionRate(rate);
+		TrafficSimulation(network, traffic, getCycle() + warmup_cycles);
+
+		// Statistics at the beginning of the step
+		long long start_cycle = getCycle();
+		long long start_offered = traffic->getNumOffered();
+		long long start_transfers = network->getTransfers();
+		long long start_latency = network->getAccumulatedLatency();
+		std::vector<long long> histogram =
+				network->getLatencyHistogram();
+
+		// Run step
+		TrafficSimulation(network, traffic, start_cycle + max_cycles);
+
+		// Latency histogram of the messages received in the step
+		const std::vector<long long> &end_histogram =
+				network->getLatencyHistogram();
+		histogram.resize(end_histogram.size());
+		int max_latency = 0;
+		for (unsigned i = 0; i < end_histogram.size(); i++)
+		{
+			histogram[i] = end_histogram[i] - histogram[i];
+			if (histogram[i])
+				max_latency = i;
+		}
+
+		// Throughput in messages per end node per cycle
+		long long transfers = network->getTransfers() - start_transfers;
+		double end_node_cycles = (double) traffic->getNumEndNodes() *
+				(getCycle() - start_cycle);
+		double offered = (traffic->getNumOffered() - start_offered) /
+				end_node_cycles;
+		double accepted = transfers / end_node_cycles;
+		double latency = transfers ? (double) (network->
+				getAccumulatedLatency() - start_latency) /
+				transfers : 0.0;
+
+		// Dump step
+		f << misc::fmt("%g,%.6f,%.6f,%.4f,%lld,%d\n",
+				rate, offered, accepted, latency,
+				Network::getPercentile(histogram, 0.99),
+				max_latency);
+		f.flush();
+
+		// Stop when the network saturates
+		if (accepted < 0.9 * offered)
+			break;
+	}
+}
+
+
+void System::Benchmark(std::ostream &os, long long cycles)
+{
+	// Benchmark topologies. The load is fixed, so that results only
+	// depend on the host performance of the network model.
+	struct BenchmarkCase
+	{
+		const char *name;
+		const char *topology;
+	};
+	const BenchmarkCase cases[] =
+	{
+		{ "mesh-8x8", "Topology = Mesh2D\nColumns = 8\nRows = 8\n" },
+		{ "mesh-16x16", "Topology = Mesh2D\nColumns = 16\nRows = 16\n" },
+		{ "fat-tree-4x3", "Topology = FatTree\nRadix = 4\nLevels = 3\n" }
+	};
+	const double rate = 0.01;
+	const int size = 32;
+	const int packet_size = 32;
+
+	// Header
+	os << "; Network benchmark report\n";
+	os << "[ General ]\n";
+	os << "Version = 1\n";
+	os << misc::fmt("Cycles = %lld\n", cycles);
+	os << misc::fmt("InjectionRate = %g\n", rate);
+	os << misc::fmt("MessageSize = %d\n", size);
+	os << misc::fmt("PacketSize = %d\n", packet_size);
+	os << '\n';
+
+	// Run cases
+	for (const BenchmarkCase &benchmark_case : cases)
+	{
+		// Create network
+		std::string name = std::string("bench-") + benchmark_case.name;
+		std::string section = "Network." + name;
+		misc::IniFile ini_file;
+		ini_file.LoadFromString(misc::fmt("[ %s ]\n"
+				"DefaultInputBufferSize = 64\n"
+				"DefaultOutputBufferSize = 64\n"
+				"DefaultBandwidth = 8\n"
+				"%s",
+				section.c_str(),
+				benchmark_case.topology));
+		ParseConfiguration(&ini_file);
+		Network *network = getNetworkByName(name);
+		assert(network);
+		network->setPacketSize(packet_size);
+
+		// Uniform traffic, with a fixed seed so that every run injects
+		// the same messages
+		Traffic traffic(network, Traffic::PatternUniform);
+		traffic.setInjectionRate(rate);
+		traffic.setMessageSize(size);
+		traffic.setStartCycle(getCycle());
+		srandom(1);
+
+		// Simulate
+		misc::Timer timer("Benchmark");
+		timer.Start();
+		TrafficSimulation(network, &traffic, getCycle() + cycles);
+		timer.Stop();
+
+		// Peak resident set size in KB
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+
+		// Every message is split into the same number of packets
+		double seconds = std::max(timer.getValue(), 1LL) / 1e6;
+		long long packets = network->getTransfers() *
+				((size + packet_size - 1) / packet_size);
+
+		// Dump
+		os << misc::fmt("[ Benchmark.%s ]\n", benchmark_case.name);
+		os << misc::fmt("EndNodes = %d\n", traffic.getNumEndNodes());
+		os << misc::fmt("OfferedMessages = %lld\n",
+				traffic.getNumOffered());
+		os << misc::fmt("DroppedMessages = %lld\n",
+				traffic.getNumDropped());
+		os << misc::fmt("Messages = %lld\n",
+				network->getTransfers());
+		os << misc::fmt("Packets = %lld\n", packets);
+		os << misc::fmt("HostTime = %.3f\n", seconds);
+		os << misc::fmt("CyclesPerSecond = %.0f\n", cycles / seconds);
+		os << misc::fmt("PacketsPerSecond = %.0f\n", packets / seconds);
+		os << misc::fmt("PeakRSS = %ld\n", usage.ru_maxrss);
+		os << '\n';
+		os.flush();
+	}
+}
+
+
 void System::StandAlone()
 {
-	// Generate a uniform traffic pattern on the network.
-	// Later, this function can be easily extended (via a switch)
-	// to support other traffic patterns, hence the stand-alone
-	// function is not combined with the uniform traffic function.
+	// Host performance benchmark
+	if (!benchmark_file.empty())
+	{
+		std::ofstream f(benchmark_file);
+		if (!f)
+			throw Error(misc::fmt("%s: cannot open network "
+					"benchmark file",
+					benchmark_file.c_str()));
+		Benchmark(f, benchmark_cycles);
+		return;
+	}
+
+	// Get the network
 	Network *network = getNetworkByName(sim_net_name);
 	if (!network)
 		throw Error(misc::fmt("%s: The network does not exist for "
 				"stand-alone simulation\n",
 				config_file.c_str()));
-	UniformTrafficSimulation(network);
+
+	// Simulate the traffic
+	std::unique_ptr<Traffic> traffic = CreateTraffic(network);
+	if (sweep_file.empty())
+		TrafficSimulation(network, traffic.get(), max_cycles);
+	else
+		SweepSimulation(network, traffic.get());
 }
 
 
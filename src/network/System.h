@@ -22,6 +22,7 @@
 
 #include <cassert>
 #include <cmath>
+#include <fstream>
 
 #include <lib/cpp/Debug.h>
 #include <lib/cpp/Error.h>
@@ -31,6 +32,8 @@
 #include <lib/esim/Trace.h>
 
 #include "Network.h"
+#include "Traffic.h"
+
 namespace net
 {
 
@@ -100,12 +103,35 @@ class System
 	/// Message size in stand alone network
 	static int message_size;
 
+	// Number of host threads calculating routing tables
+	static int routing_threads;
+
 	// Network trace version identifiers
 	static const int trace_version_major;
 	static const int trace_version_minor;
 
-	// Get a exponential random valueclass Network;
-	static double RandomExponential(double lambda);
+	// Traffic pattern for stand-alone simulation
+	static Traffic::Pattern traffic_pattern;
+
+	// Name of the hotspot end node, and fraction of messages sent to it
+	static std::string hotspot_name;
+	static double hotspot_fraction;
+
+	// Binary message trace for trace-driven traffic
+	static std::string trace_input;
+
+	// Heatmap output file, and sampling interval in cycles
+	static std::string heatmap_file;
+	static long long heatmap_interval;
+
+	// Output file of an injection rate sweep, and rate increment
+	static std::string sweep_file;
+	static double sweep_step;
+
+	// Output file of the host performance benchmark, and number of
+	// cycles simulated for each benchmark topology
+	static std::string benchmark_file;
+	static long long benchmark_cycles;
 
 
 
@@ -121,6 +147,9 @@ class System
 	static void EventTypeInputBufferHandler(esim::Event *, esim::Frame *);
 	static void EventTypeReceiveHandler(esim::Event *, esim::Frame *);
 
+	// Event handler for heatmap samples
+	static void EventHeatmapHandler(esim::Event *, esim::Frame *);
+
 
 
 
@@ -140,6 +169,17 @@ class System
 	// List of networks in the system
 	std::vector<std::unique_ptr<Network>> networks;
 
+	// Heatmap output file
+	std::ofstream heatmap;
+
+	// Periodic heatmap sampling event, and heatmap sampling event for
+	// the end of the simulation
+	esim::Event *event_heatmap = nullptr;
+	esim::Event *event_heatmap_end = nullptr;
+
+	// Open the heatmap file and schedule its sampling events
+	void StartHeatmap();
+
 public:
 
 	//
@@ -199,6 +239,10 @@ public:
 	/// by the user.
 	static int getMessageSize() { return message_size; }
 
+	/// Return the number of host threads calculating routing tables, as
+	/// configured by the user, or 0 to use all host cores.
+	static int getRoutingThreads() { return routing_threads; }
+
 
 
 
@@ -223,6 +267,12 @@ public:
 		return frequency_domain->getCycle();
 	}
 
+	/// Return the network frequency domain
+	esim::FrequencyDomain *getFrequencyDomain() const
+	{
+		return frequency_domain;
+	}
+
 	/// Parse a configuration INI file
 	void ParseConfiguration(misc::IniFile *ini_file);
 
@@ -242,8 +292,29 @@ public:
 	// file passed with '--net-config' by the user.
 	void ReadConfiguration();
 
-	// Uniform traffic simulation
-	void UniformTrafficSimulation(Network *network);
+	// Create the traffic for stand-alone simulation, as configured with
+	// command-line options
+	std::unique_ptr<Traffic> CreateTraffic(Network *network);
+
+	// Inject traffic until the given cycle. Trace-driven simulations end
+	// earlier if all trace messages were received.
+	void TrafficSimulation(Network *network, Traffic *traffic,
+			long long end_cycle);
+
+	// Simulate with increasing injection rates until the network
+	// saturates, dumping latency and throughput of each step
+	void SweepSimulation(Network *network, Traffic *traffic);
+
+	/// Measure the host performance of the network model. A set of
+	/// standard topologies (8x8 and 16x16 meshes, and a fat tree) is
+	/// created and simulated with a fixed uniform synthetic load for the
+	/// given number of cycles each. A report is dumped in INI format into
+	/// the output stream, with one section per topology including the
+	/// simulated cycles and packets per second of host time, and the peak
+	/// resident set size of the host process so far. Keys are never
+	/// removed or renamed, so that reports of different releases can be
+	/// compared.
+	void Benchmark(std::ostream &os, long long cycles);
 
 	// Stand-Alone simulation
 	void StandAlone();
@@ -59,6 +59,29 @@ const std::string System::help_message =
 		"      If set, the messages in the networks are packetized to\n"
 		"      smaller packets, and an individual packet is transfered\n"
 		"      over the communication medium (link,bus) at each cycle.\n"
+		"  FlitSize = <flit_size> (Optional)\n"
+		"      If set, the network uses flit-level wormhole switching.\n"
+		"      Messages are split into flits of this size in bytes. The\n"
+		"      head flit of a message allocates a virtual channel in\n"
+		"      every switch, which is held until the tail flit goes\n"
+		"      through. Links use per-virtual channel credits for flow\n"
+		"      control. Cannot be combined with DefaultPacketSize.\n"
+		"  RouterStages = <stages> (Default = 4)\n"
+		"      Number of stages of the router pipeline in flit-level\n"
+		"      networks: route computation, virtual channel allocation,\n"
+		"      switch allocation, and switch traversal. Body and tail\n"
+		"      flits skip the first two stages.\n"
+		"  CreditDelay = <cycles> (Default = 1)\n"
+		"      Cycles for a credit to travel back over a link in\n"
+		"      flit-level networks.\n"
+		"  SwitchAllocator = {RoundRobin|iSLIP} (Default = RoundRobin)\n"
+		"      Allocator of the switch crossbar. With RoundRobin, every\n"
+		"      output buffer arbitrates among the input buffers\n"
+		"      independently. With iSLIP, a separable allocator matches\n"
+		"      input and output ports, where the buffers of one link or\n"
+		"      bus form a port.\n"
+		"  AllocatorIterations = <num> (Default = 1)\n"
+		"      Number of iterations of the iSLIP allocator.\n"
 		"  Ideal = <true/false> (Optional)\n"
 		"      If set to true, the network is an ideal network with a\n"
 		"      single cycle latency between send and receive. The \n"
@@ -70,6 +93,67 @@ const std::string System::help_message =
 		"      packetizing, with the fix_latency, regardless of\n"
 		"      the network topology. The ideal option still requires a\n"
 		"      network to connect the end-nodes to each other\n"
+		"  Analytical = <true/false> (Default = false)\n"
+		"      If set to true, every message is delivered with a single\n"
+		"      event, after the latency of its route plus a queueing\n"
+		"      delay for each link or bus. The delay is the waiting time\n"
+		"      of an M/D/1 queue with the utilization of the connection\n"
+		"      estimated from the messages sent recently. Buffers and\n"
+		"      switch allocation are not modeled.\n"
+		"  AnalyticalWindow = <cycles> (Default = 1000)\n"
+		"      Length of the windows over which the analytical model\n"
+		"      estimates the utilization of links and buses.\n"
+		"  Multicast = <true/false> (Default = false)\n"
+		"      If set to true, users of the network such as the memory\n"
+		"      hierarchy send a single multicast message to several\n"
+		"      destinations. Switches replicate the message where the\n"
+		"      routes to its destinations diverge. Multicast is not\n"
+		"      supported with FlitSize or adaptive routing.\n"
+		"  BufferWriteEnergy = <pJ> (Default = 0.4)\n"
+		"  BufferReadEnergy = <pJ> (Default = 0.3)\n"
+		"  CrossbarEnergy = <pJ> (Default = 0.5)\n"
+		"  LinkEnergy = <pJ> (Default = 0.8)\n"
+		"      Dynamic energy per byte written into or read from a\n"
+		"      buffer, traversing a switch crossbar, or traversing a\n"
+		"      link. The energy of every node and link is reported in\n"
+		"      the heatmap (option '--net-heatmap'), and the total in\n"
+		"      the network report.\n"
+		"  Topology = {Mesh2D|Torus2D|FatTree|Dragonfly|Ring} (Optional)\n"
+		"      If set, nodes and links are generated for a regular\n"
+		"      topology, and no Node, Link, Bus, BusPort, or Routes\n"
+		"      sections can be given for the network. End nodes are\n"
+		"      named n0, n1, ..., and switches s0, s1, ... Routes are\n"
+		"      calculated algorithmically: dimension-order (XY) in\n"
+		"      meshes and tori, shortest direction in rings, up/down in\n"
+		"      fat trees, and minimal local-global-local in dragonflies.\n"
+		"  Columns = <num>, Rows = <num> (Mesh2D, Torus2D)\n"
+		"      Number of switches in each dimension.\n"
+		"  Switches = <num> (Ring)\n"
+		"      Number of switches in the ring.\n"
+		"  Radix = <num>, Levels = <num> (FatTree)\n"
+		"      The fat tree is a k-ary n-tree with k = Radix and\n"
+		"      n = Levels, with k^n end nodes and n levels of k^(n-1)\n"
+		"      switches.\n"
+		"  GroupSize = <num>, GlobalLinks = <num> (Dragonfly)\n"
+		"      Number of switches in each group, fully connected to each\n"
+		"      other, and number of links from each switch to other\n"
+		"      groups.\n"
+		"  Groups = <num> (Dragonfly, Default = GroupSize * GlobalLinks + 1)\n"
+		"      Number of groups, with one link between every pair.\n"
+		"  Concentration = <num> (Default = 1)\n"
+		"      Number of end nodes attached to each switch, for all\n"
+		"      topologies except fat trees.\n"
+		"  VC = <num> (Default = 1)\n"
+		"      Number of virtual channels of the generated links.\n"
+		"  Routing = {Deterministic|WestFirst|OddEven|MinimalAdaptive}\n"
+		"      (Mesh2D, Torus2D, Ring, Default = Deterministic)\n"
+		"      Routing algorithm in switches. Adaptive algorithms choose\n"
+		"      among minimal routes the one with the least occupied\n"
+		"      output buffer and downstream input buffer. WestFirst and\n"
+		"      OddEven are turn models for Mesh2D. MinimalAdaptive uses\n"
+		"      escape virtual channels with dimension-order routes: VC 0\n"
+		"      in meshes, and VCs 0 and 1 with a dateline in tori and\n"
+		"      rings. It needs at least one more VC for adaptive routes.\n"
 		"\n"
 		"Sections '[ Network.<network>.Node.<node> ]' are used to \n"
 		"define nodes in network '<network>'.\n"
@@ -75,10 +75,10 @@ void System::EventTypeSendHandler(esim::Event *event,
 
 	// Lookup route from routing table
 	RoutingTable *routing_table = network->getRoutingTable();
-	RoutingTable::Entry *entry = routing_table->Lookup(
+	RoutingTable::Entry entry = routing_table->Lookup(
 			source_node,
 			destination_node);
-	Buffer *output_buffer = entry->getBuffer();
+	Buffer *output_buffer = entry.getBuffer();
 	if (!output_buffer)
 		throw misc::Panic(misc::fmt("%s: no route from "
 				"%s to %s.",
@@ -210,6 +210,14 @@ void System::EventTypeReceiveHandler(esim::Event *event,
 	// Check if the packet can be assembled 
 	if (message->Assemble(packet))
 	{
+		// Copies of multicast messages are delivered to the waiting
+		// event chain, if any
+		if (message->isMulticast())
+		{
+			network->DeliverMulticast(node, message);
+			return;
+		}
+
 		{
 			// Produce the depacketize in the trace, if message
 			// was packetized
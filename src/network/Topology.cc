@@ -0,0 +1,843 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2014  Amir Kavyan Ziabari (aziabari@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdlib>
+
+#include <lib/cpp/Error.h>
+
+#include "Link.h"
+#include "Network.h"
+#include "Node.h"
+#include "Topology.h"
+
+
+namespace net
+{
+
+const misc::StringMap Topology::KindMap =
+{
+	{ "Mesh2D", KindMesh2D },
+	{ "Torus2D", KindTorus2D },
+	{ "FatTree", KindFatTree },
+	{ "Dragonfly", KindDragonfly },
+	{ "Ring", KindRing }
+};
+
+const misc::StringMap Topology::RoutingMap =
+{
+	{ "Deterministic", RoutingDeterministic },
+	{ "WestFirst", RoutingWestFirst },
+	{ "OddEven", RoutingOddEven },
+	{ "MinimalAdaptive", RoutingMinimalAdaptive }
+};
+
+
+// Return digit 'index' of 'value' in base 'base'
+static int getDigit(int value, int index, int base)
+{
+	for (int i = 0; i < index; i++)
+		value /= base;
+	return value % base;
+}
+
+
+// Return 'value' with digit 'index' in base 'base' replaced by 'digit'
+static int setDigit(int value, int index, int base, int digit)
+{
+	int weight = 1;
+	for (int i = 0; i < index; i++)
+		weight *= base;
+	return value + (digit - getDigit(value, index, base)) * weight;
+}
+
+
+Topology::Topology(Network *network, Kind kind) :
+		network(network),
+		kind(kind)
+{
+	assert(kind != KindInvalid);
+}
+
+
+void Topology::ParseConfiguration(misc::IniFile *ini_file,
+		const std::string &section)
+{
+	// Parameters for each kind of topology
+	switch (kind)
+	{
+
+	case KindMesh2D:
+	case KindTorus2D:
+
+		columns = ini_file->ReadInt(section, "Columns", 0);
+		rows = ini_file->ReadInt(section, "Rows", 0);
+		concentration = ini_file->ReadInt(section, "Concentration", 1);
+		if (columns < 1 || rows < 1 || concentration < 1)
+			throw Error(misc::fmt("%s: Network %s: Columns, Rows, "
+					"and Concentration must be positive "
+					"for topology %s.\n%s",
+					ini_file->getPath().c_str(),
+					network->getName().c_str(),
+					KindMap[kind],
+					System::err_config_note));
+		num_switches = columns * rows;
+		num_end_nodes = num_switches * concentration;
+		break;
+
+	case KindRing:
+
+		// A ring is a torus with one row
+		columns = ini_file->ReadInt(section, "Switches", 0);
+		rows = 1;
+		concentration = ini_file->ReadInt(section, "Concentration", 1);
+		if (columns < 1 || concentration < 1)
+			throw Error(misc::fmt("%s: Network %s: Switches and "
+					"Concentration must be positive for "
+					"topology %s.\n%s",
+					ini_file->getPath().c_str(),
+					network->getName().c_str(),
+					KindMap[kind],
+					System::err_config_note));
+		num_switches = columns;
+		num_end_nodes = num_switches * concentration;
+		break;
+
+	case KindFatTree:
+
+		radix = ini_file->ReadInt(section, "Radix", 0);
+		levels = ini_file->ReadInt(section, "Levels", 0);
+		if (radix < 2 || levels < 1)
+			throw Error(misc::fmt("%s: Network %s: Radix must be "
+					"at least 2 and Levels positive for "
+					"topology %s.\n%s",
+					ini_file->getPath().c_str(),
+					network->getName().c_str(),
+					KindMap[kind],
+					System::err_config_note));
+
+		// A k-ary n-tree has k^n end nodes and n levels of k^(n-1)
+		// switches. Every leaf switch connects to k end nodes.
+		level_size = 1;
+		for (int i = 1; i < levels; i++)
+			level_size *= radix;
+		concentration = radix;
+		num_switches = levels * level_size;
+		num_end_nodes = level_size * radix;
+		break;
+
+	case KindDragonfly:
+
+		group_size = ini_file->ReadInt(section, "GroupSize", 0);
+		global_links = ini_file->ReadInt(section, "GlobalLinks", 0);
+		concentration = ini_file->ReadInt(section, "Concentration", 1);
+		if (group_size < 1 || global_links < 1 || concentration < 1)
+			throw Error(misc::fmt("%s: Network %s: GroupSize, "
+					"GlobalLinks, and Concentration must "
+					"be positive for topology %s.\n%s",
+					ini_file->getPath().c_str(),
+					network->getName().c_str(),
+					KindMap[kind],
+					System::err_config_note));
+
+		// With one global link between every pair of groups, there are
+		// at most GroupSize * GlobalLinks + 1 groups.
+		num_groups = ini_file->ReadInt(section, "Groups",
+				group_size * global_links + 1);
+		if (num_groups < 1 || num_groups > group_size * global_links + 1)
+			throw Error(misc::fmt("%s: Network %s: Groups must be "
+					"between 1 and GroupSize * GlobalLinks "
+					"+ 1 for topology %s.\n%s",
+					ini_file->getPath().c_str(),
+					network->getName().c_str(),
+					KindMap[kind],
+					System::err_config_note));
+		num_switches = num_groups * group_size;
+		num_end_nodes = num_switches * concentration;
+		break;
+
+	default:
+
+		throw misc::Panic("Invalid topology");
+	}
+
+	// Virtual channels of all links
+	num_virtual_channels = ini_file->ReadInt(section, "VC", 1);
+	if (num_virtual_channels < 1)
+		throw Error(misc::fmt("%s: Network %s: virtual channels "
+				"cannot be zero/negative.\n",
+				ini_file->getPath().c_str(),
+				network->getName().c_str()));
+
+	// Routing algorithm
+	std::string routing_name = ini_file->ReadString(section, "Routing",
+			"Deterministic");
+	routing = (Routing) RoutingMap.MapStringCase(routing_name);
+	if (!routing)
+		throw Error(misc::fmt("%s: Network %s: invalid routing "
+				"algorithm '%s'.\n%s",
+				ini_file->getPath().c_str(),
+				network->getName().c_str(),
+				routing_name.c_str(),
+				System::err_config_note));
+
+	// Turn models are only deadlock-free in meshes
+	if ((routing == RoutingWestFirst || routing == RoutingOddEven) &&
+			kind != KindMesh2D)
+		throw Error(misc::fmt("%s: Network %s: routing %s is only "
+				"supported in topology %s.\n%s",
+				ini_file->getPath().c_str(),
+				network->getName().c_str(),
+				RoutingMap[routing],
+				KindMap[KindMesh2D],
+				System::err_config_note));
+
+	// Minimal adaptive routing needs escape channels, and at least one
+	// adaptive channel. Tori and rings need two escape channels to break
+	// the cycles of wrap-around links.
+	if (routing == RoutingMinimalAdaptive)
+	{
+		if (kind != KindMesh2D && kind != KindTorus2D &&
+				kind != KindRing)
+			throw Error(misc::fmt("%s: Network %s: routing %s is "
+					"not supported in topology %s.\n%s",
+					ini_file->getPath().c_str(),
+					network->getName().c_str(),
+					RoutingMap[routing],
+					KindMap[kind],
+					System::err_config_note));
+		num_escape_channels = kind == KindMesh2D ? 1 : 2;
+		if (num_virtual_channels <= num_escape_channels)
+			throw Error(misc::fmt("%s: Network %s: routing %s "
+					"needs at least %d virtual channels "
+					"in topology %s.\n%s",
+					ini_file->getPath().c_str(),
+					network->getName().c_str(),
+					RoutingMap[routing],
+					num_escape_channels + 1,
+					KindMap[kind],
+					System::err_config_note));
+	}
+}
+
+
+Node *Topology::getSwitch(int index)
+{
+	assert(index >= 0 && index < num_switches);
+	return network->getNode(num_end_nodes + index);
+}
+
+
+Link *Topology::getLinkTo(Node *node, Node *neighbor) const
+{
+	for (int i = 0; i < node->getNumOutputBuffers(); i++)
+	{
+		Buffer *buffer = node->getOutputBuffer(i);
+		Link *link = dynamic_cast<Link *>(buffer->getConnection());
+		if (link && link->getDestinationNode() == neighbor)
+			return link;
+	}
+	return nullptr;
+}
+
+
+Buffer *Topology::getBufferTo(Node *node, Node *neighbor) const
+{
+	Link *link = getLinkTo(node, neighbor);
+	return link ? link->getSourceBuffer(0) : nullptr;
+}
+
+
+void Topology::Connect(Node *node1, Node *node2)
+{
+	network->addBidirectionalLink(node1->getName() + "-" +
+			node2->getName(),
+			node1,
+			node2,
+			bandwidth,
+			input_buffer_size,
+			output_buffer_size,
+			num_virtual_channels);
+}
+
+
+void Topology::Generate(int bandwidth, int input_buffer_size,
+		int output_buffer_size)
+{
+	// Topology must be generated in an empty network
+	if (network->getNumNodes())
+		throw misc::Panic("Topology generated in non-empty network");
+
+	// Save link parameters
+	this->bandwidth = bandwidth;
+	this->input_buffer_size = input_buffer_size;
+	this->output_buffer_size = output_buffer_size;
+
+	// End nodes, followed by switches
+	for (int i = 0; i < num_end_nodes; i++)
+		network->addEndNode(input_buffer_size, output_buffer_size,
+				misc::fmt("n%d", i), nullptr);
+	for (int i = 0; i < num_switches; i++)
+		network->addSwitch(input_buffer_size, output_buffer_size,
+				bandwidth, misc::fmt("s%d", i));
+
+	// Connect end nodes to their switch. In fat trees, these are the
+	// switches in the lowest level.
+	for (int i = 0; i < num_end_nodes; i++)
+		Connect(network->getNode(i), getSwitch(i / concentration));
+
+	// Connect switches
+	switch (kind)
+	{
+
+	case KindMesh2D:
+	case KindTorus2D:
+	case KindRing:
+	{
+		// Neighbors in each dimension. Wrap-around links are added in
+		// tori and rings when they do not duplicate an existing link.
+		bool wrap = kind != KindMesh2D;
+		for (int y = 0; y < rows; y++)
+		{
+			for (int x = 0; x < columns; x++)
+			{
+				Node *node = getSwitch(y * columns + x);
+				if (x + 1 < columns)
+					Connect(node, getSwitch(y * columns + x + 1));
+				else if (wrap && columns > 2)
+					Connect(node, getSwitch(y * columns));
+				if (y + 1 < rows)
+					Connect(node, getSwitch((y + 1) * columns + x));
+				else if (wrap && rows > 2)
+					Connect(node, getSwitch(x));
+			}
+		}
+		break;
+	}
+
+	case KindFatTree:
+
+		// Switch w in level l connects to the switches in level l + 1
+		// whose index differs from w only in digit l.
+		for (int level = 0; level < levels - 1; level++)
+			for (int w = 0; w < level_size; w++)
+				for (int digit = 0; digit < radix; digit++)
+					Connect(getSwitch(level * level_size + w),
+							getSwitch((level + 1) *
+							level_size + setDigit(w,
+							level, radix, digit)));
+		break;
+
+	case KindDragonfly:
+
+		// Routers in a group are fully connected
+		for (int group = 0; group < num_groups; group++)
+			for (int r1 = 0; r1 < group_size; r1++)
+				for (int r2 = r1 + 1; r2 < group_size; r2++)
+					Connect(getSwitch(group * group_size + r1),
+							getSwitch(group * group_size + r2));
+
+		// Global channel c of group g leads to group c if c < g, or to
+		// group c + 1 otherwise. Router r owns channels
+		// r * GlobalLinks to (r + 1) * GlobalLinks - 1.
+		for (int group = 0; group < num_groups; group++)
+		{
+			for (int target = group + 1; target < num_groups; target++)
+			{
+				int channel = target - 1;
+				int target_channel = group;
+				Connect(getSwitch(group * group_size +
+						channel / global_links),
+						getSwitch(target * group_size +
+						target_channel / global_links));
+			}
+		}
+		break;
+
+	default:
+
+		throw misc::Panic("Invalid topology");
+	}
+
+	// Route algorithmically
+	network->getRoutingTable()->setRoutingFunction(
+			[this](Node *node, Node *destination)
+			{
+				return Route(node, destination);
+			});
+	if (routing != RoutingDeterministic)
+		network->getRoutingTable()->setAdaptiveRoutingFunction(
+				[this](Node *node, Node *destination,
+						Buffer *input_buffer)
+				{
+					return RouteAdaptive(node, destination,
+							input_buffer);
+				});
+}
+
+
+void Topology::getCoordinates(Node *node, int &x, int &y) const
+{
+	// Switch the node is or is attached to
+	int index = node->getIndex();
+	int switch_index = index < num_end_nodes ? index / concentration :
+			index - num_end_nodes;
+
+	// Coordinates
+	int width = kind == KindFatTree ? level_size :
+			kind == KindDragonfly ? group_size :
+			columns;
+	x = switch_index % width;
+	y = switch_index / width;
+}
+
+
+bool Topology::hasCycle() const
+{
+	// Adaptive routing
+	RoutingTable *routing_table = network->getRoutingTable();
+	if (routing != RoutingDeterministic)
+		return routing_table->hasCycle([this](Node *node,
+				Node *destination, Buffer *input_buffer,
+				std::vector<RoutingTable::Entry> &entries)
+				{
+					getAdaptiveRoutes(node, destination,
+							input_buffer,
+							routing ==
+							RoutingMinimalAdaptive,
+							entries);
+				});
+
+	// Deterministic routing
+	switch (kind)
+	{
+
+	case KindTorus2D:
+	case KindRing:
+
+		return columns > 2 || rows > 2;
+
+	case KindDragonfly:
+
+		return num_groups > 2;
+
+	default:
+
+		return false;
+	}
+}
+
+
+void Topology::getOffsets(int index, int destination, int &dx, int &dy) const
+{
+	// Offsets in each dimension, taking the shortest direction in tori
+	// and rings.
+	dx = destination % columns - index % columns;
+	dy = destination / columns - index / columns;
+	if (kind != KindMesh2D)
+	{
+		if (dx > columns / 2)
+			dx -= columns;
+		else if (dx < -columns / 2 || (dx < 0 &&
+				-dx * 2 == columns))
+			dx += columns;
+		if (dy > rows / 2)
+			dy -= rows;
+		else if (dy < -rows / 2 || (dy < 0 && -dy * 2 == rows))
+			dy += rows;
+	}
+}
+
+
+int Topology::RouteMesh(int index, int end_node, int &next) const
+{
+	// Destination switch
+	int destination = end_node / concentration;
+	if (index == destination)
+	{
+		next = end_node;
+		return 1;
+	}
+
+	// Offsets in each dimension
+	int x = index % columns;
+	int y = index / columns;
+	int dx;
+	int dy;
+	getOffsets(index, destination, dx, dy);
+
+	// Dimension-order routing, X first
+	if (dx)
+		x = (x + (dx > 0 ? 1 : -1) + columns) % columns;
+	else
+		y = (y + (dy > 0 ? 1 : -1) + rows) % rows;
+	next = num_end_nodes + y * columns + x;
+	return std::abs(dx) + std::abs(dy) + 1;
+}
+
+
+int Topology::RouteFatTree(int index, int end_node, int &next) const
+{
+	// Level and position of the switch, and leaf switch of the
+	// destination
+	int level = index / level_size;
+	int w = index % level_size;
+	int destination = end_node / radix;
+
+	// Level of the nearest common ancestor, which is the lowest level
+	// above all digits where the switch and the destination differ.
+	int ancestor = level;
+	for (int i = level; i < levels - 1; i++)
+		if (getDigit(w, i, radix) != getDigit(destination, i, radix))
+			ancestor = i + 1;
+
+	// Go down
+	if (ancestor == level)
+	{
+		if (level == 0)
+			next = end_node;
+		else
+			next = num_end_nodes + (level - 1) * level_size +
+					setDigit(w, level - 1, radix,
+					getDigit(destination, level - 1,
+					radix));
+		return level + 1;
+	}
+
+	// Go up, to the parent that matches the destination in the digit
+	// changed by the link.
+	next = num_end_nodes + (level + 1) * level_size + setDigit(w, level,
+			radix, getDigit(destination, level, radix));
+	return ancestor - level + ancestor + 1;
+}
+
+
+int Topology::RouteDragonfly(int index, int end_node, int &next) const
+{
+	// Group and router of the switch and the destination
+	int group = index / group_size;
+	int router = index % group_size;
+	int destination = end_node / concentration;
+	int destination_group = destination / group_size;
+	int destination_router = destination % group_size;
+
+	// Destination attached to this router
+	if (index == destination)
+	{
+		next = end_node;
+		return 1;
+	}
+
+	// Destination in the same group
+	if (group == destination_group)
+	{
+		next = num_end_nodes + destination;
+		return 2;
+	}
+
+	// Routers owning the global link between both groups
+	int channel = destination_group > group ? destination_group - 1 :
+			destination_group;
+	int global_router = channel / global_links;
+	int landing_channel = group > destination_group ? group - 1 : group;
+	int landing_router = landing_channel / global_links;
+
+	// Local hop to the router with the global link, or global hop
+	if (router != global_router)
+		next = num_end_nodes + group * group_size + global_router;
+	else
+		next = num_end_nodes + destination_group * group_size +
+				landing_router;
+	return (router != global_router) + 1 +
+			(landing_router != destination_router) + 1;
+}
+
+
+RoutingTable::Entry Topology::Route(Node *node, Node *destination) const
+{
+	// Routes only lead to end nodes
+	int index = node->getIndex();
+	int end_node = destination->getIndex();
+	if (node == destination)
+		return RoutingTable::Entry(0, nullptr, nullptr);
+	if (end_node >= num_end_nodes)
+		return RoutingTable::Entry(network->getNumNodes(), nullptr,
+				nullptr);
+
+	// End nodes forward to their switch
+	int next;
+	int cost;
+	int switch_index = index < num_end_nodes ? index / concentration :
+			index - num_end_nodes;
+	switch (kind)
+	{
+
+	case KindMesh2D:
+	case KindTorus2D:
+	case KindRing:
+
+		cost = RouteMesh(switch_index, end_node, next);
+		break;
+
+	case KindFatTree:
+
+		cost = RouteFatTree(switch_index, end_node, next);
+		break;
+
+	case KindDragonfly:
+
+		cost = RouteDragonfly(switch_index, end_node, next);
+		break;
+
+	default:
+
+		throw misc::Panic("Invalid topology");
+	}
+	if (index < num_end_nodes)
+	{
+		next = num_end_nodes + switch_index;
+		cost++;
+	}
+
+	// Entry
+	Node *next_node = network->getNode(next);
+	return RoutingTable::Entry(cost, next_node,
+			getBufferTo(node, next_node));
+}
+
+
+void Topology::addRoutes(int index, int dx, int dy, int cost,
+		int first_vc, int last_vc,
+		std::vector<RoutingTable::Entry> &entries) const
+{
+	// Neighbor in the given direction, wrapping around in tori
+	int x = (index % columns + dx + columns) % columns;
+	int y = (index / columns + dy + rows) % rows;
+	Node *node = network->getNode(num_end_nodes + index);
+	Node *next_node = network->getNode(num_end_nodes + y * columns + x);
+
+	// One route per virtual channel
+	Link *link = getLinkTo(node, next_node);
+	for (int vc = first_vc; vc <= last_vc; vc++)
+		entries.emplace_back(cost, next_node, link->getSourceBuffer(vc));
+}
+
+
+int Topology::getEscapeChannel(int index, int destination, int dx,
+		int dy) const
+{
+	// Meshes have no wrap-around links
+	if (kind == KindMesh2D)
+		return 0;
+
+	// Routes use channel 0 until they cross the wrap-around link of the
+	// dimension, and channel 1 afterwards or if they never cross it.
+	int position = dx ? index % columns : index / columns;
+	int target = dx ? destination % columns : destination / columns;
+	int direction = dx ? dx : dy;
+	if (direction > 0)
+		return position > target ? 0 : 1;
+	return position < target ? 0 : 1;
+}
+
+
+void Topology::getAdaptiveRoutes(Node *node, Node *destination,
+		Buffer *input_buffer, bool escape_only,
+		std::vector<RoutingTable::Entry> &entries) const
+{
+	// Routes only lead to end nodes
+	int index = node->getIndex();
+	int end_node = destination->getIndex();
+	if (node == destination || end_node >= num_end_nodes)
+		return;
+
+	// End nodes inject packets into their switch
+	if (index < num_end_nodes)
+	{
+		entries.push_back(Route(node, destination));
+		return;
+	}
+
+	// Any virtual channel can be used to reach the end node from its
+	// switch
+	int switch_index = index - num_end_nodes;
+	int destination_switch = end_node / concentration;
+	if (switch_index == destination_switch)
+	{
+		Link *link = getLinkTo(node, destination);
+		for (int vc = 0; vc < num_virtual_channels; vc++)
+			entries.emplace_back(1, destination,
+					link->getSourceBuffer(vc));
+		return;
+	}
+
+	// Minimal directions
+	int dx;
+	int dy;
+	getOffsets(switch_index, destination_switch, dx, dy);
+	int step_x = dx > 0 ? 1 : -1;
+	int step_y = dy > 0 ? 1 : -1;
+	int cost = std::abs(dx) + std::abs(dy) + 1;
+	int last_vc = num_virtual_channels - 1;
+	switch (routing)
+	{
+
+	case RoutingWestFirst:
+
+		// All hops west go first
+		if (dx < 0)
+		{
+			addRoutes(switch_index, -1, 0, cost, 0, last_vc,
+					entries);
+			break;
+		}
+		if (dx)
+			addRoutes(switch_index, 1, 0, cost, 0, last_vc,
+					entries);
+		if (dy)
+			addRoutes(switch_index, 0, step_y, cost, 0, last_vc,
+					entries);
+		break;
+
+	case RoutingOddEven:
+	{
+		// Packets still in their source column came from an end node
+		// or from a switch in the same column.
+		int x = switch_index % columns;
+		bool source_column = true;
+		Link *link = input_buffer ? dynamic_cast<Link *>(
+				input_buffer->getConnection()) : nullptr;
+		if (link && link->getSourceNode()->getIndex() >= num_end_nodes)
+			source_column = (link->getSourceNode()->getIndex() -
+					num_end_nodes) % columns == x;
+
+		// Only vertical hops left
+		if (!dx)
+		{
+			addRoutes(switch_index, 0, step_y, cost, 0, last_vc,
+					entries);
+			break;
+		}
+
+		// Eastbound packets can only turn north or south in odd
+		// columns or in their source column, and must not reach an
+		// even destination column from the west with vertical hops
+		// left.
+		if (dx > 0)
+		{
+			if (dy && (x % 2 == 1 || source_column))
+				addRoutes(switch_index, 0, step_y, cost, 0,
+						last_vc, entries);
+			if (!dy || destination_switch % columns % 2 == 1 ||
+					dx != 1)
+				addRoutes(switch_index, 1, 0, cost, 0,
+						last_vc, entries);
+			break;
+		}
+
+		// Westbound packets can only go north or south in even
+		// columns
+		addRoutes(switch_index, -1, 0, cost, 0, last_vc, entries);
+		if (dy && x % 2 == 0)
+			addRoutes(switch_index, 0, step_y, cost, 0, last_vc,
+					entries);
+		break;
+	}
+
+	case RoutingMinimalAdaptive:
+	{
+		// Adaptive channels in all minimal directions
+		if (!escape_only)
+		{
+			if (dx)
+				addRoutes(switch_index, step_x, 0, cost,
+						num_escape_channels, last_vc,
+						entries);
+			if (dy)
+				addRoutes(switch_index, 0, step_y, cost,
+						num_escape_channels, last_vc,
+						entries);
+		}
+
+		// Escape channel in dimension order
+		int escape_dx = dx ? step_x : 0;
+		int escape_dy = dx ? 0 : step_y;
+		int vc = getEscapeChannel(switch_index, destination_switch,
+				escape_dx, escape_dy);
+		addRoutes(switch_index, escape_dx, escape_dy, cost, vc, vc,
+				entries);
+		break;
+	}
+
+	default:
+
+		throw misc::Panic("Invalid routing");
+	}
+}
+
+
+Buffer *Topology::RouteAdaptive(Node *node, Node *destination,
+		Buffer *input_buffer) const
+{
+	// Routes allowed by the algorithm
+	std::vector<RoutingTable::Entry> entries;
+	getAdaptiveRoutes(node, destination, input_buffer, false, entries);
+	if (entries.empty())
+		return nullptr;
+
+	// The escape route of minimal adaptive routing is only taken if no
+	// other route is available
+	int num_routes = entries.size();
+	if (routing == RoutingMinimalAdaptive && num_routes > 1 &&
+			node->getIndex() >= num_end_nodes &&
+			destination->getIndex() / concentration !=
+			node->getIndex() - num_end_nodes)
+		num_routes--;
+
+	// Choose the available route with the least occupancy in the
+	// output buffer and in the input buffer on the other side of the
+	// link. Virtual channels that are full or held by other messages
+	// are not available.
+	Buffer *best_buffer = nullptr;
+	int best_occupancy = 0;
+	for (int i = 0; i < num_routes; i++)
+	{
+		Buffer *buffer = entries[i].getBuffer();
+		if (buffer->getOwner() || buffer->getCount() >= buffer->getSize())
+			continue;
+		Link *link = misc::cast<Link *>(buffer->getConnection());
+		int occupancy = buffer->getCount() + link->
+				getDestinationBufferfromSource(buffer)->getCount();
+		if (!best_buffer || occupancy < best_occupancy)
+		{
+			best_buffer = buffer;
+			best_occupancy = occupancy;
+		}
+	}
+
+	// If no route is available, wait for the escape route, or for the
+	// first route of turn models
+	if (!best_buffer)
+		best_buffer = routing == RoutingMinimalAdaptive ?
+				entries.back().getBuffer() :
+				entries.front().getBuffer();
+	return best_buffer;
+}
+
+
+}  // namespace net
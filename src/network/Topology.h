@@ -0,0 +1,240 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2014  Amir Kavyan Ziabari (aziabari@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NETWORK_TOPOLOGY_H
+#define NETWORK_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/String.h>
+
+#include "RoutingTable.h"
+
+
+namespace net
+{
+
+class Buffer;
+class Link;
+class Network;
+class Node;
+
+
+/// Regular topology generated from a few parameters, instead of listing
+/// nodes and links in the configuration file. End nodes are named 'n<i>'
+/// and created first, so that end node 'n<i>' has index i in the network,
+/// followed by switches named 's<i>'. Routes are calculated algorithmically
+/// without a routing table.
+class Topology
+{
+public:
+
+	/// Kinds of topologies
+	enum Kind
+	{
+		KindInvalid = 0,
+		KindMesh2D,
+		KindTorus2D,
+		KindFatTree,
+		KindDragonfly,
+		KindRing
+	};
+
+	/// String map for Kind
+	static const misc::StringMap KindMap;
+
+	/// Routing algorithms for meshes, tori, and rings
+	enum Routing
+	{
+		RoutingInvalid = 0,
+		RoutingDeterministic,
+		RoutingWestFirst,
+		RoutingOddEven,
+		RoutingMinimalAdaptive
+	};
+
+	/// String map for Routing
+	static const misc::StringMap RoutingMap;
+
+private:
+
+	// Network the topology is generated in
+	Network *network;
+
+	// Kind of topology
+	Kind kind;
+
+	// Number of columns and rows of switches in meshes and tori. Rings
+	// use only the number of columns.
+	int columns = 0;
+	int rows = 0;
+
+	// Number of switch ports in each direction and number of levels in
+	// a fat tree (k-ary n-tree)
+	int radix = 0;
+	int levels = 0;
+
+	// Number of routers per group, global links per router, and groups in
+	// a dragonfly
+	int group_size = 0;
+	int global_links = 0;
+	int num_groups = 0;
+
+	// Routing algorithm
+	Routing routing = RoutingDeterministic;
+
+	// Number of escape virtual channels with minimal adaptive routing
+	int num_escape_channels = 0;
+
+	// Number of end nodes attached to each switch, except in fat trees,
+	// where it is the radix.
+	int concentration = 1;
+
+	// Number of switches in each level of a fat tree, equal to
+	// radix ^ (levels - 1).
+	int level_size = 0;
+
+	// Number of end nodes and switches
+	int num_end_nodes = 0;
+	int num_switches = 0;
+
+	// Link parameters
+	int bandwidth = 0;
+	int num_virtual_channels = 1;
+	int input_buffer_size = 0;
+	int output_buffer_size = 0;
+
+	// Return the node of the given switch
+	Node *getSwitch(int index);
+
+	// Return the link from a node to a neighbor
+	Link *getLinkTo(Node *node, Node *neighbor) const;
+
+	// Return the output buffer of a node leading to a neighbor, using the
+	// first virtual channel.
+	Buffer *getBufferTo(Node *node, Node *neighbor) const;
+
+	// Return the offsets from a switch to a destination switch in each
+	// dimension of a mesh, torus, or ring, taking the shortest direction
+	// when there are wrap-around links.
+	void getOffsets(int index, int destination, int &dx, int &dy) const;
+
+	// Add to 'entries' the routes from a switch to its neighbor in the
+	// given direction of a mesh, using the virtual channels between
+	// 'first_vc' and 'last_vc'.
+	void addRoutes(int index, int dx, int dy, int cost,
+			int first_vc, int last_vc,
+			std::vector<RoutingTable::Entry> &entries) const;
+
+	// Return the virtual channel of the escape route in a direction of
+	// a torus, which changes when the route crosses the wrap-around link
+	// of the dimension.
+	int getEscapeChannel(int index, int destination, int dx, int dy) const;
+
+	// Add to 'entries' the routes that a packet in a node can take towards
+	// an end node with adaptive routing. The escape route of minimal
+	// adaptive routing goes last, and is the only one if 'escape_only' is
+	// set.
+	void getAdaptiveRoutes(Node *node, Node *destination,
+			Buffer *input_buffer, bool escape_only,
+			std::vector<RoutingTable::Entry> &entries) const;
+
+	// Connect two nodes with a bidirectional link
+	void Connect(Node *node1, Node *node2);
+
+	// Calculate the route from a switch to an end node. The function
+	// returns the cost in hops, and the index of the next node in the
+	// network in argument 'next'.
+	int RouteMesh(int index, int end_node, int &next) const;
+	int RouteFatTree(int index, int end_node, int &next) const;
+	int RouteDragonfly(int index, int end_node, int &next) const;
+
+public:
+
+	/// Constructor
+	Topology(Network *network, Kind kind);
+
+	/// Return the kind of topology
+	Kind getKind() const { return kind; }
+
+	/// Return the routing algorithm
+	Routing getRouting() const { return routing; }
+
+	/// Return the number of end nodes
+	int getNumEndNodes() const { return num_end_nodes; }
+
+	/// Return the number of switches
+	int getNumSwitches() const { return num_switches; }
+
+	/// Read the parameters of the topology from section \a section of the
+	/// network configuration file.
+	void ParseConfiguration(misc::IniFile *ini_file,
+			const std::string &section);
+
+	/// Create all nodes and links in the network, and install the routing
+	/// function in its routing table.
+	void Generate(int bandwidth, int input_buffer_size,
+			int output_buffer_size);
+
+	/// Return the coordinates of a node in the topology. Switches of
+	/// meshes and tori are at their column and row, switches of rings at
+	/// their position and row 0, switches of fat trees at their position
+	/// in their level and the level, and switches of dragonflies at their
+	/// position in their group and the group. End nodes are at the
+	/// coordinates of the switch they are attached to.
+	void getCoordinates(Node *node, int &x, int &y) const;
+
+	/// Return whether the routes of the topology can form cycles of
+	/// dependent buffers, leading to possible deadlocks. With
+	/// deterministic routing, only meshes and fat trees are free of
+	/// cycles. With adaptive routing, the dependencies are checked with
+	/// RoutingTable::hasCycle() for all routes of turn models, and for
+	/// the escape routes of minimal adaptive routing.
+	bool hasCycle() const;
+
+	/// Return the route from a node to a destination node. Routes are
+	/// only defined for destinations that are end nodes. Meshes and tori
+	/// use dimension-order (XY) routing, rings take the shortest
+	/// direction, fat trees route up to the nearest common ancestor and
+	/// then down, and dragonflies use minimal local-global-local routing.
+	RoutingTable::Entry Route(Node *node, Node *destination) const;
+
+	/// Return the output buffer that a packet in an input buffer of a node
+	/// takes towards a destination end node with adaptive routing. Among
+	/// the minimal routes allowed by the routing algorithm, the one with
+	/// the least occupancy in the output buffer and the input buffer on
+	/// the other side of the link is chosen, skipping virtual channels
+	/// that are full or held by another message. West-first routing takes
+	/// all hops west first, and then adapts among the remaining
+	/// directions. Odd-even routing forbids east-to-north and
+	/// east-to-south turns in even columns and north-to-west and
+	/// south-to-west turns in odd columns. Minimal adaptive routing uses
+	/// all minimal directions in the adaptive virtual channels and falls
+	/// back to a dimension-order escape route in the escape channels
+	/// (channel 0 in meshes, 0 and 1 with a dateline in tori and rings).
+	Buffer *RouteAdaptive(Node *node, Node *destination,
+			Buffer *input_buffer) const;
+};
+
+
+}  // namespace net
+
+#endif
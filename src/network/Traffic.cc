@@ -0,0 +1,333 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Amir Kavyan Ziabari (ziabari@gmail.com)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+#include <lib/cpp/Error.h>
+
+#include "EndNode.h"
+#include "Network.h"
+#include "System.h"
+#include "Traffic.h"
+
+
+namespace net
+{
+
+const misc::StringMap Traffic::PatternMap =
+{
+	{ "uniform", PatternUniform },
+	{ "transpose", PatternTranspose },
+	{ "bit-complement", PatternBitComplement },
+	{ "bit-reverse", PatternBitReverse },
+	{ "hotspot", PatternHotspot },
+	{ "neighbor", PatternNeighbor },
+	{ "trace", PatternTrace }
+};
+
+
+// Return an exponentially distributed random value with rate 'lambda'
+static double RandomExponential(double lambda)
+{
+	double x = (double) random() / RAND_MAX;
+	return log(1 - x) / -lambda;
+}
+
+
+Traffic::Traffic(Network *network, Pattern pattern) :
+		network(network),
+		pattern(pattern)
+{
+	// Collect end nodes
+	for (int i = 0; i < network->getNumNodes(); i++)
+	{
+		EndNode *node = dynamic_cast<EndNode *>(network->getNode(i));
+		if (node)
+			end_nodes.push_back(node);
+	}
+	int num_end_nodes = end_nodes.size();
+	if (num_end_nodes < 2)
+		throw Error(misc::fmt("Network %s: traffic needs at least "
+				"two end nodes",
+				network->getName().c_str()));
+
+	// Bit permutations need a power of two number of end nodes
+	while ((1 << num_bits) < num_end_nodes)
+		num_bits++;
+	if ((pattern == PatternBitComplement ||
+			pattern == PatternBitReverse) &&
+			(1 << num_bits) != num_end_nodes)
+		throw Error(misc::fmt("Network %s: traffic pattern %s needs "
+				"a power of two number of end nodes (%d given)",
+				network->getName().c_str(),
+				PatternMap[pattern],
+				num_end_nodes));
+
+	// Transpose needs a square number of end nodes
+	while ((side + 1) * (side + 1) <= num_end_nodes)
+		side++;
+	if (pattern == PatternTranspose && side * side != num_end_nodes)
+		throw Error(misc::fmt("Network %s: traffic pattern %s needs "
+				"a square number of end nodes (%d given)",
+				network->getName().c_str(),
+				PatternMap[pattern],
+				num_end_nodes));
+
+	// Initialize injection times and trace queues
+	inject_time.resize(num_end_nodes);
+	if (pattern == PatternTrace)
+		trace.resize(num_end_nodes);
+
+	// Default hotspot
+	hotspot_node = end_nodes[0];
+}
+
+
+void Traffic::setHotspot(EndNode *hotspot_node, double hotspot_fraction)
+{
+	// Check fraction
+	if (hotspot_fraction < 0 || hotspot_fraction > 1)
+		throw Error(misc::fmt("Network %s: invalid hotspot fraction "
+				"(%g), must be between 0 and 1",
+				network->getName().c_str(),
+				hotspot_fraction));
+
+	// Save values
+	this->hotspot_node = hotspot_node;
+	this->hotspot_fraction = hotspot_fraction;
+}
+
+
+void Traffic::setStartCycle(long long cycle)
+{
+	for (double &time : inject_time)
+		time = cycle;
+}
+
+
+void Traffic::AddTraceRecord(const TraceRecord &record)
+{
+	// Check pattern
+	if (pattern != PatternTrace)
+		throw misc::Panic("Trace record added to synthetic traffic");
+
+	// Check record
+	int num_end_nodes = end_nodes.size();
+	if (record.source < 0 || record.source >= num_end_nodes ||
+			record.destination < 0 ||
+			record.destination >= num_end_nodes)
+		throw Error(misc::fmt("Network %s: trace record at cycle "
+				"%lld: invalid end node (source %d, destination "
+				"%d, %d end nodes)",
+				network->getName().c_str(),
+				record.cycle,
+				record.source,
+				record.destination,
+				num_end_nodes));
+	if (record.source == record.destination)
+		throw Error(misc::fmt("Network %s: trace record at cycle "
+				"%lld: source and destination are the same "
+				"end node (%d)",
+				network->getName().c_str(),
+				record.cycle,
+				record.source));
+	if (record.size < 1)
+		throw Error(misc::fmt("Network %s: trace record at cycle "
+				"%lld: invalid message size (%d)",
+				network->getName().c_str(),
+				record.cycle,
+				record.size));
+
+	// Insert keeping the queue sorted by cycle. Records are usually
+	// sorted in the trace already, so the search starts at the end.
+	std::deque<TraceRecord> &queue = trace[record.source];
+	auto it = queue.end();
+	while (it != queue.begin() && (it - 1)->cycle > record.cycle)
+		--it;
+	queue.insert(it, record);
+	num_pending_records++;
+}
+
+
+void Traffic::LoadTrace(const std::string &path)
+{
+	// Open file
+	std::ifstream f(path, std::ios::binary);
+	if (!f)
+		throw Error(misc::fmt("%s: cannot open message trace",
+				path.c_str()));
+
+	// Read records
+	while (true)
+	{
+		int64_t cycle;
+		int32_t fields[3];
+		f.read((char *) &cycle, sizeof cycle);
+		f.read((char *) fields, sizeof fields);
+		if (f.gcount() == 0 && f.eof())
+			break;
+		if (!f)
+			throw Error(misc::fmt("%s: truncated record in message "
+					"trace", path.c_str()));
+
+		// Add record
+		TraceRecord record;
+		record.cycle = cycle;
+		record.source = fields[0];
+		record.destination = fields[1];
+		record.size = fields[2];
+		AddTraceRecord(record);
+	}
+}
+
+
+EndNode *Traffic::getRandomDestination(EndNode *source)
+{
+	// Draw among all nodes of the network until an end node other than
+	// the source is found.
+	while (true)
+	{
+		int index = random() % network->getNumNodes();
+		EndNode *node = dynamic_cast<EndNode *>(
+				network->getNode(index));
+		if (node && node != source)
+			return node;
+	}
+}
+
+
+EndNode *Traffic::getDestination(int index)
+{
+	EndNode *source = end_nodes[index];
+	int num_end_nodes = end_nodes.size();
+	int destination = index;
+	switch (pattern)
+	{
+
+	case PatternUniform:
+
+		return getRandomDestination(source);
+
+	case PatternTranspose:
+
+		destination = (index % side) * side + index / side;
+		break;
+
+	case PatternBitComplement:
+
+		destination = ~index & (num_end_nodes - 1);
+		break;
+
+	case PatternBitReverse:
+
+		destination = 0;
+		for (int bit = 0; bit < num_bits; bit++)
+			if (index & (1 << bit))
+				destination |= 1 << (num_bits - bit - 1);
+		break;
+
+	case PatternHotspot:
+	{
+		// The hotspot itself sends uniform traffic
+		double x = (double) random() / RAND_MAX;
+		if (x < hotspot_fraction && source != hotspot_node)
+			return hotspot_node;
+		return getRandomDestination(source);
+	}
+
+	case PatternNeighbor:
+
+		destination = (index + 1) % num_end_nodes;
+		break;
+
+	default:
+
+		throw misc::Panic("Invalid traffic pattern");
+	}
+
+	// Nodes mapped to themselves do not inject traffic
+	return destination == index ? nullptr : end_nodes[destination];
+}
+
+
+void Traffic::InjectTrace(int index, long long cycle)
+{
+	// Records are injected in order. A record that cannot be sent blocks
+	// the following ones from the same source.
+	EndNode *source = end_nodes[index];
+	std::deque<TraceRecord> &queue = trace[index];
+	while (!queue.empty() && queue.front().cycle <= cycle)
+	{
+		TraceRecord &record = queue.front();
+		EndNode *destination = end_nodes[record.destination];
+		if (!network->CanSend(source, destination, record.size))
+			break;
+
+		// Send
+		network->Send(source, destination, record.size);
+		queue.pop_front();
+		num_pending_records--;
+		num_offered++;
+	}
+}
+
+
+void Traffic::Inject(long long cycle)
+{
+	// Traverse all end nodes to check if some need injection
+	for (unsigned i = 0; i < end_nodes.size(); i++)
+	{
+		// Trace-driven traffic
+		if (pattern == PatternTrace)
+		{
+			InjectTrace(i, cycle);
+			continue;
+		}
+
+		// Check turn for next injection
+		if (inject_time[i] > cycle)
+			continue;
+
+		// Inject
+		EndNode *source = end_nodes[i];
+		while (inject_time[i] < cycle)
+		{
+			// Schedule next injection
+			inject_time[i] += RandomExponential(injection_rate);
+
+			// Get destination
+			EndNode *destination = getDestination(i);
+			if (!destination)
+				continue;
+
+			// Send the message, or drop it
+			num_offered++;
+			if (network->CanSend(source, destination, message_size))
+				network->Send(source, destination, message_size);
+			else
+				num_dropped++;
+		}
+	}
+}
+
+
+}  // namespace net
@@ -0,0 +1,193 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Amir Kavyan Ziabari (ziabari@gmail.com)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NETWORK_TRAFFIC_H
+#define NETWORK_TRAFFIC_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <lib/cpp/String.h>
+
+
+namespace net
+{
+
+class EndNode;
+class Network;
+
+
+/// Synthetic or trace-driven traffic injected into a network by the
+/// stand-alone network simulator. End nodes are identified by their index
+/// among the end nodes of the network, in the order they were created. In
+/// networks generated with a topology, end node 'n<i>' has index i.
+class Traffic
+{
+public:
+
+	/// Traffic patterns
+	enum Pattern
+	{
+		PatternInvalid = 0,
+		PatternUniform,
+		PatternTranspose,
+		PatternBitComplement,
+		PatternBitReverse,
+		PatternHotspot,
+		PatternNeighbor,
+		PatternTrace
+	};
+
+	/// String map for Pattern
+	static const misc::StringMap PatternMap;
+
+	/// Record of a binary message trace. Records are stored in the file
+	/// as packed fields in host byte order: a 64-bit injection cycle,
+	/// followed by 32-bit source end node index, destination end node
+	/// index, and message size in bytes.
+	struct TraceRecord
+	{
+		long long cycle;
+		int source;
+		int destination;
+		int size;
+	};
+
+private:
+
+	// Network traffic is injected into
+	Network *network;
+
+	// Traffic pattern
+	Pattern pattern;
+
+	// End nodes of the network
+	std::vector<EndNode *> end_nodes;
+
+	// Number of bits of an end node index, for bit permutations
+	int num_bits = 0;
+
+	// Number of end nodes in each row and column, for the transpose
+	int side = 0;
+
+	// Messages injected per cycle by each end node
+	double injection_rate = 0.001;
+
+	// Size of synthetic messages in bytes
+	int message_size = 1;
+
+	// Destination of the hotspot pattern, and fraction of the messages
+	// sent to it
+	EndNode *hotspot_node = nullptr;
+	double hotspot_fraction = 0.5;
+
+	// Cycle of the next injection of each end node
+	std::vector<double> inject_time;
+
+	// Pending trace records for each source end node, sorted by cycle
+	std::vector<std::deque<TraceRecord>> trace;
+
+	// Number of trace records not injected yet
+	long long num_pending_records = 0;
+
+	// Number of messages generated, and number of those that were
+	// dropped because the source node could not send them
+	long long num_offered = 0;
+	long long num_dropped = 0;
+
+	// Return a random end node, drawn among all nodes of the network
+	EndNode *getRandomDestination(EndNode *source);
+
+	// Inject the trace records of source end node 'index' due in 'cycle'
+	void InjectTrace(int index, long long cycle);
+
+public:
+
+	/// Constructor. Throws an error if the pattern cannot be used with
+	/// the number of end nodes of the network.
+	Traffic(Network *network, Pattern pattern);
+
+	/// Return the traffic pattern
+	Pattern getPattern() const { return pattern; }
+
+	/// Return the number of end nodes
+	int getNumEndNodes() const { return end_nodes.size(); }
+
+	/// Return the end node with the given index
+	EndNode *getEndNode(int index) const { return end_nodes[index]; }
+
+	/// Set the number of messages injected per cycle by each end node
+	void setInjectionRate(double injection_rate)
+	{
+		this->injection_rate = injection_rate;
+	}
+
+	/// Return the number of messages injected per cycle by each end node
+	double getInjectionRate() const { return injection_rate; }
+
+	/// Set the size in bytes of synthetic messages
+	void setMessageSize(int message_size)
+	{
+		this->message_size = message_size;
+	}
+
+	/// Set the destination of the hotspot pattern and the fraction of
+	/// messages sent to it. The rest of the messages are sent to random
+	/// destinations. By default, the hotspot is the first end node and
+	/// receives half of the messages.
+	void setHotspot(EndNode *hotspot_node, double hotspot_fraction);
+
+	/// Start injecting synthetic messages at the given cycle, instead of
+	/// cycle 0. Used when the network simulation does not start at the
+	/// beginning of the global simulation.
+	void setStartCycle(long long cycle);
+
+	/// Load a binary message trace with records in the format described
+	/// in TraceRecord. The pattern must be PatternTrace.
+	void LoadTrace(const std::string &path);
+
+	/// Add a single trace record. The pattern must be PatternTrace.
+	void AddTraceRecord(const TraceRecord &record);
+
+	/// Return the destination of the next synthetic message sent by the
+	/// end node with the given index, or `nullptr` if the pattern maps the
+	/// node to itself and it does not inject any traffic.
+	EndNode *getDestination(int index);
+
+	/// Inject the messages due in the given cycle, in the network
+	/// frequency domain. Synthetic messages that cannot be sent are
+	/// dropped, while trace messages wait in their source node until they
+	/// can be sent.
+	void Inject(long long cycle);
+
+	/// Return whether all trace records were injected
+	bool isTraceDone() const { return num_pending_records == 0; }
+
+	/// Return the number of messages generated so far
+	long long getNumOffered() const { return num_offered; }
+
+	/// Return the number of generated messages dropped so far
+	long long getNumDropped() const { return num_dropped; }
+};
+
+
+}  // namespace net
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Shi Dong (dong.sh@husky.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <limits>
+
+#include <arch/x86/emulator/Extended.h>
+
+namespace x86
+{
+
+// Check that the 10 bytes of an extended value match the given sign and
+// exponent field and the given significand
+static void ExpectBytes(const unsigned char *x, unsigned short exponent,
+		unsigned long long significand)
+{
+	for (int i = 0; i < 8; i++)
+		EXPECT_EQ((significand >> (i * 8)) & 0xff, x[i]);
+	EXPECT_EQ(exponent & 0xff, x[8]);
+	EXPECT_EQ(exponent >> 8, x[9]);
+}
+
+TEST(TestX86EmulatorExtended, conversions)
+{
+	unsigned char x[10];
+
+	// Normal values
+	Extended::DoubleToExtended(1.0, x);
+	ExpectBytes(x, 0x3fff, 0x8000000000000000ull);
+	Extended::FloatToExtended(-2.5f, x);
+	ExpectBytes(x, 0xc000, 0xa000000000000000ull);
+	Extended::DoubleToExtended(0.1, x);
+	ExpectBytes(x, 0x3ffb, 0xccccccccccccd000ull);
+
+	// Zero, infinity, and a double denormal, which is normal as an
+	// extended value
+	Extended::DoubleToExtended(-0.0, x);
+	ExpectBytes(x, 0x8000, 0);
+	Extended::DoubleToExtended(std::numeric_limits<double>::infinity(), x);
+	ExpectBytes(x, 0x7fff, 0x8000000000000000ull);
+	Extended::DoubleToExtended(std::numeric_limits<double>::denorm_min(), x);
+	ExpectBytes(x, 0x3bcd, 0x8000000000000000ull);
+
+	// Round trips
+	double values[] = { 1.5, -1e300, 3.0e-310, 0.1, 123456789.0 };
+	for (double value : values)
+	{
+		Extended::DoubleToExtended(value, x);
+		EXPECT_EQ(value, Extended::ExtendedToDouble(x));
+		EXPECT_EQ((float) value, Extended::ExtendedToFloat(x));
+		EXPECT_EQ((long double) value, Extended::ExtendedToLongDouble(x));
+	}
+
+	// NaN
+	Extended::DoubleToExtended(std::numeric_limits<double>::quiet_NaN(), x);
+	EXPECT_TRUE(std::isnan(Extended::ExtendedToDouble(x)));
+}
+
+TEST(TestX86EmulatorExtended, long_double)
+{
+	// Values with more precision than a double are only exact if the host
+	// long double uses the x87 format
+	long double value = 1.0L + std::ldexp(1.0L, -60);
+	Extended e(value);
+	if (std::numeric_limits<long double>::digits == 64)
+	{
+		EXPECT_EQ(value, e.getLongDouble());
+	}
+	EXPECT_EQ(1.0, e.getDouble());
+}
+
+}
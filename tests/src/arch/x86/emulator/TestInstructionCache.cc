@@ -0,0 +1,360 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Shi Dong (dong.sh@husky.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/Error.h>
+#include <memory/Memory.h>
+#include <arch/x86/emulator/Context.h>
+#include <arch/x86/emulator/Emulator.h>
+#include <arch/x86/emulator/InstructionCache.h>
+#include <arch/x86/timing/Timing.h>
+
+namespace x86
+{
+
+static void Cleanup()
+{
+	Timing::Destroy();
+	Emulator::Destroy();
+	comm::ArchPool::Destroy();
+}
+
+// Address of the code in the tests
+static const unsigned code_address = 0x10000;
+
+// Create a context with a code page holding the given instructions
+static Context *CreateContext(const unsigned char *code, unsigned size)
+{
+	Emulator *emulator = Emulator::getInstance();
+	Context *context = emulator->newContext();
+	context->Initialize();
+	mem::Memory *memory = context->getMemory();
+	memory->Map(code_address, mem::Memory::PageSize,
+			mem::Memory::AccessRead |
+			mem::Memory::AccessWrite |
+			mem::Memory::AccessExec);
+	memory->Write(code_address, size, (const char *) code);
+	context->getRegs().setEip(code_address);
+	return context;
+}
+
+TEST(TestX86EmulatorInstructionCache, memory_code_pages)
+{
+	mem::Memory memory;
+	memory.Map(0x1000, 2 * mem::Memory::PageSize,
+			mem::Memory::AccessRead | mem::Memory::AccessWrite);
+
+	// Pages that are not allocated cannot be marked
+	EXPECT_FALSE(memory.MarkCode(0x2ffe, 4));
+	EXPECT_FALSE(memory.hasInvalidatedCode());
+
+	// Writes to unmarked pages are not reported
+	char value = 1;
+	memory.Write(0x2000, 1, &value);
+	EXPECT_FALSE(memory.hasInvalidatedCode());
+
+	// An instruction crossing a page boundary marks both pages, and each
+	// page is reported once until it is marked again
+	EXPECT_TRUE(memory.MarkCode(0x1ffe, 4));
+	memory.Write(0x2000, 1, &value);
+	memory.Write(0x2001, 1, &value);
+	EXPECT_TRUE(memory.hasInvalidatedCode());
+	std::vector<unsigned> tags = memory.TakeInvalidatedCode();
+	ASSERT_EQ(1u, tags.size());
+	EXPECT_EQ(0x2000u, tags[0]);
+	EXPECT_FALSE(memory.hasInvalidatedCode());
+
+	// Changing permissions and unmapping are reported
+	memory.Protect(0x1000, mem::Memory::PageSize, mem::Memory::AccessRead);
+	tags = memory.TakeInvalidatedCode();
+	ASSERT_EQ(1u, tags.size());
+	EXPECT_EQ(0x1000u, tags[0]);
+	EXPECT_TRUE(memory.MarkCode(0x2000, 1));
+	memory.Unmap(0x2000, mem::Memory::PageSize);
+	tags = memory.TakeInvalidatedCode();
+	ASSERT_EQ(1u, tags.size());
+	EXPECT_EQ(0x2000u, tags[0]);
+}
+
+TEST(TestX86EmulatorInstructionCache, loop)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Code to execute
+	//	mov ecx, 10
+	// loop:
+	//	inc eax
+	//	dec ecx
+	//	jnz loop
+	unsigned char code[] = {
+		0xb9, 0x0a, 0x00, 0x00, 0x00,
+		0x40,
+		0x49,
+		0x75, 0xfc
+	};
+
+	try
+	{
+		// Run the loop
+		Context *context = CreateContext(code, sizeof(code));
+		for (int i = 0; i < 31; i++)
+			context->Execute();
+		EXPECT_EQ(10u, context->getRegs().getEax());
+		EXPECT_EQ(code_address + sizeof(code),
+				context->getRegs().getEip());
+
+		// Only the first iteration decoded instructions
+		InstructionCache *inst_cache = context->getInstructionCache();
+		EXPECT_EQ(4, inst_cache->getNumEntries());
+		EXPECT_EQ(4, inst_cache->getNumMisses());
+		EXPECT_EQ(27, inst_cache->getNumHits());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+
+	Cleanup();
+}
+
+TEST(TestX86EmulatorInstructionCache, self_modifying_code)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Code to execute
+	//	mov eax, 1
+	unsigned char code[] = {
+		0xb8, 0x01, 0x00, 0x00, 0x00
+	};
+
+	try
+	{
+		// Execute once
+		Context *context = CreateContext(code, sizeof(code));
+		context->Execute();
+		EXPECT_EQ(1u, context->getRegs().getEax());
+
+		// Execute again after modifying the immediate value
+		mem::Memory *memory = context->getMemory();
+		unsigned value = 2;
+		memory->Write(code_address + 1, 4, (const char *) &value);
+		context->getRegs().setEip(code_address);
+		context->Execute();
+		EXPECT_EQ(2u, context->getRegs().getEax());
+		EXPECT_EQ(1, context->getInstructionCache()->
+				getNumInvalidations());
+
+		// Remove execution permissions of the code page. The
+		// instruction is fetched again, causing a fault.
+		memory->Protect(code_address, mem::Memory::PageSize,
+				mem::Memory::AccessRead);
+		context->getRegs().setEip(code_address);
+		EXPECT_THROW(context->Execute(), mem::Memory::Error);
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+
+	Cleanup();
+}
+
+TEST(TestX86EmulatorInstructionCache, blocks)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Same loop as in test 'loop'
+	unsigned char code[] = {
+		0xb9, 0x0a, 0x00, 0x00, 0x00,
+		0x40,
+		0x49,
+		0x75, 0xfc
+	};
+
+	try
+	{
+		// Run the loop, stopping exactly at its end
+		Context *context = CreateContext(code, sizeof(code));
+		EXPECT_EQ(31, context->ExecuteBlock(31));
+		EXPECT_EQ(10u, context->getRegs().getEax());
+		EXPECT_EQ(code_address + sizeof(code),
+				context->getRegs().getEip());
+
+		// One block starting at the first instruction, and another one
+		// starting at the target of the jump
+		InstructionCache *inst_cache = context->getInstructionCache();
+		EXPECT_EQ(2, inst_cache->getNumBlocks());
+		EXPECT_EQ(31, Emulator::getInstance()->getNumInstructions());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+
+	Cleanup();
+}
+
+TEST(TestX86EmulatorInstructionCache, blocks_self_modifying_code)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Code to execute, modifying the immediate value of the instruction
+	// following it in the same block
+	//	mov byte [0x10008], 2
+	//	mov eax, 1
+	//	mov ebx, eax
+	unsigned char code[] = {
+		0xc6, 0x05, 0x08, 0x00, 0x01, 0x00, 0x02,
+		0xb8, 0x01, 0x00, 0x00, 0x00,
+		0x89, 0xc3
+	};
+
+	try
+	{
+		// The block is left right after the write
+		Context *context = CreateContext(code, sizeof(code));
+		EXPECT_EQ(1, context->ExecuteBlock(3));
+
+		// The rest of the code is decoded again
+		EXPECT_EQ(2, context->ExecuteBlock(2));
+		EXPECT_EQ(2u, context->getRegs().getEax());
+		EXPECT_EQ(2u, context->getRegs().getEbx());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+
+	Cleanup();
+}
+
+TEST(TestX86EmulatorInstructionCache, parallel_serializing)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Code to execute
+	//	mov eax, 1
+	//	lock inc dword [0x10100]
+	//	mov ebx, eax
+	unsigned char code[] = {
+		0xb8, 0x01, 0x00, 0x00, 0x00,
+		0xf0, 0xff, 0x05, 0x00, 0x01, 0x01, 0x00,
+		0x89, 0xc3
+	};
+
+	try
+	{
+		// Parallel emulation stops before the atomic instruction
+		Context *context = CreateContext(code, sizeof(code));
+		EXPECT_EQ(1, context->ExecuteParallel(3));
+		EXPECT_EQ(code_address + 5, context->getRegs().getEip());
+
+		// The lock prefix does not change the decoded instruction
+		context->Execute();
+		EXPECT_EQ(Instruction::Opcode_inc_rm32,
+				context->getInstruction()->getOpcode());
+		EXPECT_TRUE(context->getInstruction()->getPrefixes() &
+				Instruction::PrefixLock);
+		unsigned value = 0;
+		context->getMemory()->Read(0x10100, 4, (char *) &value);
+		EXPECT_EQ(1u, value);
+
+		// The write to the code page is processed before emulating the
+		// rest of the code in parallel mode, where instructions are
+		// not counted in the emulator
+		EXPECT_EQ(0, context->ExecuteParallel(1));
+		context->getInstructionCache()->Refresh();
+		EXPECT_EQ(1, context->ExecuteParallel(1));
+		EXPECT_EQ(1u, context->getRegs().getEbx());
+		EXPECT_EQ(1, Emulator::getInstance()->getNumInstructions());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+
+	Cleanup();
+}
+
+TEST(TestX86EmulatorInstructionCache, parallel_run)
+{
+	// Cleanup singleton instances
+	Cleanup();
+
+	// Code to execute, incrementing a counter in a data page
+	//	mov ecx, 10
+	// loop:
+	//	lock inc dword [0x20000]
+	//	dec ecx
+	//	jnz loop
+	//	mov eax, 1
+	//	xor ebx, ebx
+	//	int 0x80
+	unsigned char code[] = {
+		0xb9, 0x0a, 0x00, 0x00, 0x00,
+		0xf0, 0xff, 0x05, 0x00, 0x00, 0x02, 0x00,
+		0x49,
+		0x75, 0xf6,
+		0xb8, 0x01, 0x00, 0x00, 0x00,
+		0x31, 0xdb,
+		0xcd, 0x80
+	};
+
+	try
+	{
+		// Two contexts with their own memory, each emulating 34
+		// instructions, of which 11 are serializing
+		Emulator *emulator = Emulator::getInstance();
+		for (int i = 0; i < 2; i++)
+		{
+			Context *context = CreateContext(code, sizeof(code));
+			context->getMemory()->Map(0x20000,
+					mem::Memory::PageSize,
+					mem::Memory::AccessRead |
+					mem::Memory::AccessWrite);
+		}
+
+		// Run until both contexts exit
+		Emulator::setNumThreads(2);
+		while (emulator->Run());
+		EXPECT_EQ(68, emulator->getNumInstructions());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+
+	// Restore the default number of threads
+	Emulator::setNumThreads(1);
+	Cleanup();
+}
+
+}
@@ -0,0 +1,122 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Shi Dong (dong.sh@husky.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <arch/x86/emulator/Regs.h>
+
+namespace x86
+{
+
+// Masks of the arithmetic flags in register 'eflags'
+static const unsigned CF = 1 << Instruction::FlagCF;
+static const unsigned PF = 1 << Instruction::FlagPF;
+static const unsigned AF = 1 << Instruction::FlagAF;
+static const unsigned ZF = 1 << Instruction::FlagZF;
+static const unsigned SF = 1 << Instruction::FlagSF;
+static const unsigned OF = 1 << Instruction::FlagOF;
+
+// Return the arithmetic flags of the last operation
+static unsigned getFlags(const Regs &regs)
+{
+	return regs.getEflags() & Regs::ArithmeticFlagsMask;
+}
+
+TEST(TestX86EmulatorRegs, lazy_flags_add_sub)
+{
+	Regs regs;
+
+	// 0xffffffff + 1
+	regs.setLazyFlags(Regs::FlagsOpAdd, 4, 0, 0xffffffff, 1);
+	EXPECT_EQ(CF | PF | AF | ZF, getFlags(regs));
+
+	// 0x7f + 1, byte operands
+	regs.setLazyFlags(Regs::FlagsOpAdd, 1, 0x80, 0x7f, 1);
+	EXPECT_EQ(AF | SF | OF, getFlags(regs));
+
+	// 0xffffffff + 0 with an input carry
+	regs.setLazyFlags(Regs::FlagsOpAdd, 4, 0, 0xffffffff, 0, 1);
+	EXPECT_EQ(CF | PF | AF | ZF, getFlags(regs));
+
+	// 1 - 2
+	regs.setLazyFlags(Regs::FlagsOpSub, 4, 0xffffffff, 1, 2);
+	EXPECT_EQ(CF | PF | AF | SF, getFlags(regs));
+
+	// 0x8000 - 1, word operands
+	regs.setLazyFlags(Regs::FlagsOpSub, 2, 0x7fff, 0x8000, 1);
+	EXPECT_EQ(PF | AF | OF, getFlags(regs));
+
+	// 5 - 5 with an input borrow
+	regs.setLazyFlags(Regs::FlagsOpSub, 4, 0xffffffff, 5, 5, 1);
+	EXPECT_EQ(CF | PF | AF | SF, getFlags(regs));
+
+	// Logic operations clear CF and OF
+	regs.setLazyFlags(Regs::FlagsOpLogic, 4, 0x80000003, 0x80000003,
+			0xffffffff);
+	EXPECT_EQ(PF | SF, getFlags(regs));
+}
+
+TEST(TestX86EmulatorRegs, lazy_flags_inc_dec_shift)
+{
+	Regs regs;
+
+	// Increment preserves the carry flag
+	regs.setLazyFlags(Regs::FlagsOpInc, 4, 0x80000000, 0x7fffffff, 1, 1);
+	EXPECT_EQ(CF | PF | AF | SF | OF, getFlags(regs));
+	regs.setLazyFlags(Regs::FlagsOpDec, 1, 0xff, 0, 1, 0);
+	EXPECT_EQ(PF | AF | SF, getFlags(regs));
+
+	// 0x81 << 1, byte operands
+	regs.setLazyFlags(Regs::FlagsOpShl, 1, 0x02, 0x81, 1);
+	EXPECT_TRUE(regs.getFlag(Instruction::FlagCF));
+	EXPECT_TRUE(regs.getFlag(Instruction::FlagOF));
+	EXPECT_FALSE(regs.getFlag(Instruction::FlagZF));
+
+	// 0x80000001 >> 1
+	regs.setLazyFlags(Regs::FlagsOpShr, 4, 0x40000000, 0x80000001, 1);
+	EXPECT_EQ(CF | PF | OF, getFlags(regs) & ~AF);
+
+	// 0x80 >> 2, arithmetic, byte operands
+	regs.setLazyFlags(Regs::FlagsOpSar, 1, 0xe0, 0x80, 2);
+	EXPECT_EQ(SF, getFlags(regs) & ~AF);
+}
+
+TEST(TestX86EmulatorRegs, lazy_flags_update)
+{
+	Regs regs;
+	regs.setEflags(1 << Instruction::FlagDF);
+
+	// Flags not computed lazily are preserved
+	regs.setLazyFlags(Regs::FlagsOpSub, 4, 0, 3, 3);
+	EXPECT_TRUE(regs.getFlag(Instruction::FlagDF));
+	EXPECT_EQ(PF | ZF | (1u << Instruction::FlagDF), regs.getEflags());
+
+	// Setting a single flag keeps the rest of the computed flags
+	regs.setFlag(Instruction::FlagCF);
+	EXPECT_EQ(CF | PF | ZF, getFlags(regs));
+	regs.clearFlag(Instruction::FlagZF);
+	EXPECT_EQ(CF | PF, getFlags(regs));
+
+	// Setting the whole register discards the last operation
+	regs.setLazyFlags(Regs::FlagsOpAdd, 4, 0, 0xffffffff, 1);
+	regs.setEflags(0);
+	EXPECT_EQ(0u, regs.getEflags());
+}
+
+}
@@ -22,6 +22,7 @@
 #include <string>
 #include <regex>
 #include <exception>
+#include <dram/Address.h>
 #include <dram/Controller.h>
 #include <dram/System.h>
 #include <lib/cpp/Misc.h>
@@ -448,4 +449,145 @@ TEST(TestSystemConfiguration, section_correct_timings_DDR3_1600)
 	}
 }
 
+
+// Controller with 2 channels, 2 ranks, 8 banks, 1024 rows and 1024 columns,
+// that is 1, 1, 3, 10 and 10 address bits.
+static std::string mapping_config(const std::string &general)
+{
+	return "[ General ]\n"
+			"Frequency = 1000\n" + general +
+			"[ MemoryController One ]\n"
+			"NumChannels = 2\n"
+			"NumRanks = 2\n"
+			"NumBanks = 8\n"
+			"NumRows = 1024\n"
+			"NumColumns = 1024\n";
+}
+
+TEST(TestSystemConfiguration, section_address_mapping)
+{
+	// Address mappings and the expected location of logical channel 1,
+	// rank 1, bank 5, row 7, and column 3
+	struct Mapping
+	{
+		std::string config;
+		long long address;
+	};
+	const Mapping mappings[] =
+	{
+		// Default, Ch:Ra:Ba:Ro:Co
+		{ "", (1LL << 24) | (1 << 23) | (5 << 20) | (7 << 10) | 3 },
+
+		// Ro:Ra:Ba:Ch:Co
+		{ "AddressMapping = RoRaBaChCo\n",
+			(7LL << 15) | (1 << 14) | (5 << 11) | (1 << 10) | 3 },
+
+		// Ro:Ba:Ra:Co:Ch
+		{ "AddressMapping = RoBaRaCoCh\n",
+			(7LL << 15) | (5 << 12) | (1 << 11) | (3 << 1) | 1 },
+
+		// Ro:Co(4 bits):Ra:Ba:Ch:Co(6 bits), column 3 in line 0
+		{ "AddressMapping = CacheLine\n",
+			(7LL << 15) | (1 << 10) | (5 << 7) | (1 << 6) | 3 }
+	};
+
+	for (const Mapping &mapping : mappings)
+	{
+		// Cleanup singleton instance
+		Cleanup();
+
+		// Set up INI file
+		misc::IniFile ini_file;
+		ini_file.LoadFromString(mapping_config(mapping.config));
+
+		// Test body
+		try
+		{
+			System *dram_system = System::getInstance();
+			dram_system->ParseConfiguration(&ini_file);
+			Address address(mapping.address);
+			EXPECT_EQ(0, address.getPhysical());
+			EXPECT_EQ(1, address.getLogical());
+			EXPECT_EQ(1, address.getRank());
+			EXPECT_EQ(5, address.getBank());
+			EXPECT_EQ(7, address.getRow());
+			EXPECT_EQ(3, address.getColumn());
+		}
+		catch (misc::Error &error)
+		{
+			error.Dump();
+			FAIL();
+		}
+	}
+
+	// Cache-line interleaving splits the column around the other
+	// components
+	Cleanup();
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(mapping_config(
+			"AddressMapping = CacheLine\n"
+			"LineSize = 16\n"));
+	System::getInstance()->ParseConfiguration(&ini_file);
+	Address address((9LL << 9) | (1 << 4) | 2);
+	EXPECT_EQ(1, address.getLogical());
+	EXPECT_EQ(0, address.getRank());
+	EXPECT_EQ((9 << 4) | 2, address.getColumn());
+}
+
+TEST(TestSystemConfiguration, section_address_mapping_xor)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(mapping_config("XorBankHashing = True\n"));
+
+	// Test body
+	try
+	{
+		System *dram_system = System::getInstance();
+		dram_system->ParseConfiguration(&ini_file);
+
+		// Rows 1 and 2 of bank 5 map to different banks
+		Address address_1((5 << 20) | (1 << 10));
+		Address address_2((5 << 20) | (2 << 10));
+		EXPECT_EQ(4, address_1.getBank());
+		EXPECT_EQ(1, address_1.getRow());
+		EXPECT_EQ(7, address_2.getBank());
+
+		// Rows with the same low bits map to the same bank
+		Address address_9((5 << 20) | (9 << 10));
+		EXPECT_EQ(4, address_9.getBank());
+	}
+	catch (misc::Error &error)
+	{
+		error.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemConfiguration, section_address_mapping_line_size)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(mapping_config("LineSize = 48\n"));
+
+	// Test body
+	std::string message;
+	try
+	{
+		System::getInstance()->ParseConfiguration(&ini_file);
+	}
+	catch (misc::Error &error)
+	{
+		message = error.getMessage();
+	}
+	EXPECT_REGEX_MATCH(".*The value for 'LineSize' must be a power of "
+			"two.\n.*", message.c_str());
+}
+
 }
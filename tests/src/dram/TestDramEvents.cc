@@ -17,6 +17,8 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <array>
+#include <sstream>
 #include <string>
 #include <regex>
 #include <exception>
@@ -26,6 +28,8 @@
 #include <dram/Channel.h>
 #include <dram/Controller.h>
 #include <dram/Rank.h>
+#include <dram/Request.h>
+#include <dram/Scheduler.h>
 #include <dram/System.h>
 #include <gtest/gtest.h>
 #include <lib/cpp/IniFile.h>
@@ -806,4 +810,575 @@ TEST(TestSystemEvents, section_test_address_out_of_bounds)
 	EXPECT_REGEX_MATCH(misc::fmt("Invalid Address").c_str(),
 			message.c_str());
 }
+
+
+// Create a read request issued by a core for a row of a bank in the first
+// rank, with the default geometry of 1024 columns and 1024 rows.
+static std::shared_ptr<Request> CreateRequest(int core, int bank, int row)
+{
+	auto request = std::make_shared<Request>();
+	request->setType(RequestRead);
+	request->setCore(core);
+	request->setEncodedAddress(((long long) bank << 20) | (row << 10));
+	return request;
+}
+
+TEST(TestSystemEvents, section_scheduler_frfcfs)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"SchedulingPolicy = FRFCFS\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		Channel *channel = dram_system->getController(0)->getChannel(0);
+		Bank *bank_0 = channel->getRank(0)->getBank(0);
+		Bank *bank_1 = channel->getRank(0)->getBank(1);
+
+		// Bank 0 needs to open a row, while bank 1 has its row open
+		// and its read at the front of the queue
+		bank_0->ProcessRequest(CreateRequest(0, 0, 5));
+		bank_1->ProcessRequest(CreateRequest(0, 1, 3));
+		bank_1->RunFrontCommand();
+		EXPECT_EQ(0, channel->getNextPendingBank());
+		EXPECT_EQ(1, channel->getNextRowHitBank());
+		EXPECT_EQ(-1, channel->getNextRowHitBank(2));
+
+		// The row hit goes first
+		EXPECT_EQ(bank_1, channel->getScheduler()->FindNext());
+
+		// Without row hits, the oldest command goes first
+		bank_1->RunFrontCommand();
+		EXPECT_EQ(-1, channel->getNextPendingBank(1));
+		EXPECT_EQ(bank_0, channel->getScheduler()->FindNext());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_scheduler_frfcfs_same_bank)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"SchedulingPolicy = FRFCFS\n"
+			"Refresh = None\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		esim::Engine *engine = esim::Engine::getInstance();
+		Channel *channel = dram_system->getController(0)->getChannel(0);
+		Bank *bank = channel->getRank(0)->getBank(0);
+
+		// Open row 3
+		bank->ProcessRequest(CreateRequest(0, 0, 3));
+		while (bank->getNumCommandsInQueue() > 0)
+			engine->ProcessEvents();
+		EXPECT_EQ(3, bank->getActiveRow());
+
+		// A conflict followed by a hit in the same bank. The hit is
+		// broken down into commands first, and the conflict waits.
+		auto conflict = CreateRequest(0, 0, 5);
+		auto hit = CreateRequest(0, 0, 3);
+		bank->ProcessRequest(conflict);
+		EXPECT_EQ("Precharge", bank->getCommandInQueueType(0));
+		bank->ProcessRequest(hit);
+		EXPECT_EQ(1, bank->getNumCommandsInQueue());
+		EXPECT_EQ("Read", bank->getCommandInQueueType(0));
+		EXPECT_EQ(1, bank->getNumRequestsInQueue());
+		EXPECT_EQ(conflict.get(), bank->getRequestInQueue(0));
+		EXPECT_EQ(0, channel->getNextRowHitBank());
+
+		// The hit finishes its column access before the conflict
+		while (bank->getNumCommandsInQueue() > 0)
+			engine->ProcessEvents();
+		EXPECT_EQ(0, bank->getNumRequestsInQueue());
+		EXPECT_GE(hit->getCycleAccess(), 0);
+		EXPECT_LT(hit->getCycleAccess(), conflict->getCycleAccess());
+		EXPECT_EQ(5, bank->getActiveRow());
+		EXPECT_EQ(1, bank->getNumRowHits());
+		EXPECT_EQ(1, bank->getNumRowMisses());
+		EXPECT_EQ(1, bank->getNumRowConflicts());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_scheduler_parbs)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"SchedulingPolicy = PARBS\n"
+			"MarkingCap = 2\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		Channel *channel = dram_system->getController(0)->getChannel(0);
+		Bank *bank_0 = channel->getRank(0)->getBank(0);
+		Bank *bank_1 = channel->getRank(0)->getBank(1);
+
+		// Core 0 has three requests in bank 0, and core 1 one request
+		// in bank 1
+		std::array<std::shared_ptr<Request>, 3> requests;
+		for (int i = 0; i < 3; i++)
+		{
+			requests[i] = CreateRequest(0, 0, i + 1);
+			bank_0->ProcessRequest(requests[i]);
+		}
+		auto request = CreateRequest(1, 1, 1);
+		bank_1->ProcessRequest(request);
+
+		// The batch includes two requests of core 0, and core 1 is
+		// ranked first for having the shortest job
+		EXPECT_EQ(bank_1, channel->getScheduler()->FindNext());
+		EXPECT_TRUE(requests[0]->isMarked());
+		EXPECT_TRUE(requests[1]->isMarked());
+		EXPECT_FALSE(requests[2]->isMarked());
+		EXPECT_TRUE(request->isMarked());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_scheduler_atlas)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"SchedulingPolicy = ATLAS\n"
+			"QuantumLength = 1\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		Channel *channel = dram_system->getController(0)->getChannel(0);
+		Bank *bank_0 = channel->getRank(0)->getBank(0);
+		Bank *bank_1 = channel->getRank(0)->getBank(1);
+		ATLAS *scheduler = dynamic_cast<ATLAS *>(
+				channel->getScheduler());
+		ASSERT_TRUE(scheduler);
+
+		// Core 0 attains more service than core 1 in the first quantum
+		auto request_0 = CreateRequest(0, 0, 1);
+		auto request_1 = CreateRequest(1, 1, 1);
+		Command read(request_0, CommandRead, 0, bank_0);
+		Command precharge(request_1, CommandPrecharge, 0, bank_1);
+		scheduler->CommandScheduled(&read);
+		scheduler->CommandScheduled(&read);
+		scheduler->CommandScheduled(&precharge);
+
+		// End the quantum
+		esim::Engine *engine = esim::Engine::getInstance();
+		while (System::frequency_domain->getCycle() < 2)
+			engine->ProcessEvents();
+
+		// Both cores issue a request at the same time, and the one of
+		// core 1 goes first
+		bank_0->ProcessRequest(CreateRequest(0, 0, 2));
+		bank_1->ProcessRequest(CreateRequest(1, 1, 2));
+		EXPECT_EQ(bank_1, scheduler->FindNext());
+		EXPECT_GT(scheduler->getTotalService(0),
+				scheduler->getTotalService(1));
+		EXPECT_GT(scheduler->getTotalService(1), 0);
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_refresh_rank)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"tREFI = 400\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		esim::Engine *engine = esim::Engine::getInstance();
+		Channel *channel = dram_system->getController(0)->getChannel(0);
+		Rank *rank_0 = channel->getRank(0);
+		Rank *rank_1 = channel->getRank(1);
+		Bank *bank = rank_0->getBank(0);
+
+		// Refreshes of the two ranks are staggered
+		while (System::frequency_domain->getCycle() < 210)
+			engine->ProcessEvents();
+		long long refresh_end = bank->getRefreshEnd();
+		EXPECT_EQ(1, rank_0->getNumRefreshes());
+		EXPECT_EQ(0, rank_1->getNumRefreshes());
+		EXPECT_EQ(8 * 128, rank_0->getNumRefreshBankCycles());
+		EXPECT_GT(refresh_end, 210);
+		EXPECT_EQ(refresh_end, rank_0->getBank(7)->getRefreshEnd());
+
+		// A read waits for the refresh to finish
+		dram_system->Read(0);
+		engine->ProcessEvents();
+		engine->ProcessEvents();
+		while (bank->getNumCommandsInQueue() > 0)
+			engine->ProcessEvents();
+		EXPECT_GT(System::frequency_domain->getCycle(), refresh_end);
+		EXPECT_EQ(1, rank_0->getNumCommands(CommandActivate));
+		EXPECT_EQ(1, rank_0->getNumCommands(CommandRead));
+
+		// Second rank
+		while (System::frequency_domain->getCycle() < 410)
+			engine->ProcessEvents();
+		EXPECT_EQ(1, rank_1->getNumRefreshes());
+		EXPECT_EQ(8 * 128, rank_1->getNumRefreshBankCycles());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_refresh_bank)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"Refresh = Bank\n"
+			"tREFI = 800\n"
+			"tRFCpb = 40\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		esim::Engine *engine = esim::Engine::getInstance();
+		Rank *rank = dram_system->getController(0)->getChannel(0)->
+				getRank(0);
+
+		// One bank is refreshed every 100 cycles, only blocking itself
+		while (System::frequency_domain->getCycle() < 60)
+			engine->ProcessEvents();
+		long long refresh_end = rank->getBank(0)->getRefreshEnd();
+		EXPECT_EQ(1, rank->getNumRefreshes());
+		EXPECT_EQ(40, rank->getNumRefreshBankCycles());
+		EXPECT_EQ(0, rank->getBank(1)->getRefreshEnd());
+		while (System::frequency_domain->getCycle() < 160)
+			engine->ProcessEvents();
+		EXPECT_EQ(2, rank->getNumRefreshes());
+		EXPECT_EQ(refresh_end + 100, rank->getBank(1)->getRefreshEnd());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_refresh_open_row)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"Refresh = None\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		esim::Engine *engine = esim::Engine::getInstance();
+		Rank *rank = dram_system->getController(0)->getChannel(0)->
+				getRank(0);
+		Bank *bank = rank->getBank(0);
+
+		// Open a row with a first read
+		dram_system->Read(0);
+		while (System::frequency_domain->getCycle() < 50)
+			engine->ProcessEvents();
+		EXPECT_EQ(0, bank->getActiveRow());
+
+		// A queued read to the open row is a row-buffer hit, until the
+		// refresh closes the row and an activate is queued ahead of it.
+		bank->ProcessRequest(CreateRequest(0, 0, 0));
+		EXPECT_EQ("Read", bank->getCommandInQueueType(0));
+		rank->Refresh();
+		EXPECT_TRUE(bank->isPrecharged());
+		EXPECT_EQ(2, bank->getNumCommandsInQueue());
+		EXPECT_EQ("Activate", bank->getCommandInQueueType(0));
+		EXPECT_EQ("Read", bank->getCommandInQueueType(1));
+
+		// The read completes after the refresh
+		while (bank->getNumCommandsInQueue() > 0)
+			engine->ProcessEvents();
+		EXPECT_GE(System::frequency_domain->getCycle(),
+				bank->getRefreshEnd());
+		EXPECT_EQ(2, rank->getNumCommands(CommandActivate));
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_power_down)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"Refresh = None\n"
+			"PowerDown = Precharged\n"
+			"PowerDownThreshold = 10\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		esim::Engine *engine = esim::Engine::getInstance();
+		Rank *rank = dram_system->getController(0)->getChannel(0)->
+				getRank(0);
+		Bank *bank = rank->getBank(0);
+
+		// The rank powers down after the first read, closing the row
+		dram_system->Read(0);
+		while (System::frequency_domain->getCycle() < 100)
+			engine->ProcessEvents();
+		EXPECT_EQ(0, bank->getActiveRow());
+
+		// The second read exits power-down, and activates the row again
+		long long cycle = System::frequency_domain->getCycle();
+		bank->ProcessRequest(CreateRequest(0, 0, 0));
+		EXPECT_EQ(1, rank->getNumPowerDownExits());
+		EXPECT_EQ(cycle + 5, rank->getPowerUpCycle());
+		EXPECT_EQ("Activate", bank->getCommandInQueueType(0));
+		while (bank->getNumCommandsInQueue() > 0)
+			engine->ProcessEvents();
+		EXPECT_GE(System::frequency_domain->getCycle(), cycle + 5);
+
+		// Report
+		std::ostringstream os;
+		dram_system->DumpReport(os);
+		misc::IniFile report;
+		report.LoadFromString(os.str());
+		std::string section = "MemoryController.One";
+		ASSERT_TRUE(report.Exists(section));
+		EXPECT_EQ(2, report.ReadInt(section, "Activates"));
+		EXPECT_EQ(2, report.ReadInt(section, "Reads"));
+		EXPECT_EQ(0, report.ReadInt(section, "Refreshes"));
+		EXPECT_EQ(1, report.ReadInt(section, "PowerDownExits"));
+		EXPECT_GT(report.ReadInt(section, "PrechargedPowerDownCycles"),
+				0);
+		EXPECT_GT(report.ReadDouble(section, "ActivateEnergy"), 0);
+		EXPECT_GT(report.ReadDouble(section, "ReadEnergy"), 0);
+		EXPECT_EQ(0, report.ReadDouble(section, "WriteEnergy"));
+		EXPECT_GT(report.ReadDouble(section, "BackgroundEnergy"), 0);
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_self_refresh)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"tREFI = 1000\n"
+			"PowerDown = Active\n"
+			"PowerDownThreshold = 10\n"
+			"SelfRefreshThreshold = 30\n");
+
+	// Set up dram instance
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+
+	// Test body
+	try
+	{
+		esim::Engine *engine = esim::Engine::getInstance();
+		Rank *rank = dram_system->getController(0)->getChannel(0)->
+				getRank(0);
+
+		// The idle rank enters power-down, then self-refresh, and skips
+		// its refresh
+		while (System::frequency_domain->getCycle() < 600)
+			engine->ProcessEvents();
+		long long cycle = System::frequency_domain->getCycle();
+		EXPECT_EQ(0, rank->getNumRefreshes());
+		rank->UpdatePowerState();
+		EXPECT_EQ(10, rank->getPowerStateCycles(
+				RankPowerPrechargedStandby));
+		EXPECT_EQ(20, rank->getPowerStateCycles(
+				RankPowerPrechargedPowerDown));
+		EXPECT_EQ(cycle - 30, rank->getPowerStateCycles(
+				RankPowerSelfRefresh));
+
+		// A read exits self-refresh
+		rank->getBank(0)->ProcessRequest(CreateRequest(0, 0, 0));
+		EXPECT_EQ(1, rank->getNumSelfRefreshExits());
+		EXPECT_EQ(0, rank->getNumPowerDownExits());
+		EXPECT_EQ(cycle + 136, rank->getPowerUpCycle());
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+TEST(TestSystemEvents, section_request_statistics)
+{
+	// cleanup singleton instance
+	Cleanup();
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(default_config +
+			"Refresh = None\n");
+
+	// Set up dram instance, sampling the queue occupancy every 100 cycles
+	System::setReportInterval(100);
+	System *dram_system = System::getInstance();
+	dram_system->ParseConfiguration(&ini_file);
+	System::setReportInterval(10000);
+
+	// Test body
+	try
+	{
+		// Row miss, hit and conflict in bank 0, and a miss in bank 1
+		dram_system->Read(0);
+		dram_system->Read(1);
+		dram_system->Read(1 << 10);
+		dram_system->Read(1 << 20);
+		esim::Engine *engine = esim::Engine::getInstance();
+		while (System::frequency_domain->getCycle() < 1000)
+			engine->ProcessEvents();
+
+		// Row-buffer statistics of each bank
+		Controller *controller = dram_system->getController(0);
+		Channel *channel = controller->getChannel(0);
+		Bank *bank_0 = channel->getRank(0)->getBank(0);
+		Bank *bank_1 = channel->getRank(0)->getBank(1);
+		EXPECT_EQ(1, bank_0->getNumRowHits());
+		EXPECT_EQ(1, bank_0->getNumRowMisses());
+		EXPECT_EQ(1, bank_0->getNumRowConflicts());
+		EXPECT_EQ(0, bank_1->getNumRowHits());
+		EXPECT_EQ(1, bank_1->getNumRowMisses());
+
+		// Latency components add up to the total latency, and the data
+		// transfer takes the duration of a read
+		long long sum = 0;
+		for (int i = LatencyQueueing; i < LatencyComponentCount; i++)
+		{
+			LatencyComponent component = (LatencyComponent) i;
+			sum += channel->getLatencySum(component);
+			long long count = 0;
+			for (long long value : channel->getLatencyLogHistogram(
+					component))
+				count += value;
+			EXPECT_EQ(4, count);
+		}
+		EXPECT_EQ(channel->getLatencySum(LatencyTotal), sum);
+		EXPECT_EQ(4 * controller->getCommandDuration(CommandRead),
+				channel->getLatencySum(LatencyTransfer));
+		EXPECT_GT(channel->getLatencySum(LatencyQueueing), 0);
+
+		// Queue occupancy, with all requests arriving at once and
+		// finishing in the first interval
+		const std::vector<double> &samples =
+				channel->getOccupancySamples();
+		ASSERT_GE(samples.size(), 9u);
+		EXPECT_EQ(4, channel->getMaxOccupancy());
+		EXPECT_GT(samples[0], 0);
+		EXPECT_LE(samples[0], 4);
+		EXPECT_EQ(0, samples.back());
+
+		// Report of each bank
+		std::ostringstream os;
+		dram_system->DumpReport(os);
+		misc::IniFile report;
+		report.LoadFromString(os.str());
+		std::string section = "MemoryController.One.Channel0.Rank0.Bank0";
+		ASSERT_TRUE(report.Exists(section));
+		EXPECT_EQ(3, report.ReadInt64(section, "Requests"));
+		EXPECT_EQ(1, report.ReadInt64(section, "RowConflicts"));
+		EXPECT_EQ(2, report.ReadInt64("MemoryController.One.Channel0",
+				"RowMisses"));
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
 }
@@ -0,0 +1,198 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  David English (english.d@husky.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <dram/System.h>
+#include <dram/Trace.h>
+#include <gtest/gtest.h>
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <lib/esim/Engine.h>
+
+
+namespace dram
+{
+
+static void Cleanup()
+{
+	esim::Engine::Destroy();
+
+	System::Destroy();
+}
+
+// Two channels, where bit 24 of an address selects the channel
+static std::string trace_config =
+			"[ General ]\n"
+			"Frequency = 100000\n"
+			"[ MemoryController One ]\n"
+			"NumChannels = 2\n";
+
+// Write trace records to a new temporary file and return its path
+static std::string WriteTrace(const std::vector<Trace::Record> &records,
+		int extra_bytes = 0)
+{
+	char path[] = "/tmp/m2s-dram-trace-XXXXXX";
+	int fd = mkstemp(path);
+	close(fd);
+	std::ofstream f(path, std::ios::binary);
+	f.write((const char *) records.data(),
+			records.size() * sizeof(Trace::Record));
+	for (int i = 0; i < extra_bytes; i++)
+		f.put(0);
+	return path;
+}
+
+// Run a trace-driven simulation with the given number of host threads and
+// return its report
+static std::string RunTrace(const std::string &path, int num_threads)
+{
+	Cleanup();
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(trace_config);
+	System *system = System::getInstance();
+	system->ParseConfiguration(&ini_file);
+	system->TraceSimulation(path, num_threads);
+	std::ostringstream os;
+	system->DumpReport(os);
+	return os.str();
+}
+
+TEST(TestSystemTrace, trace_threads)
+{
+	// Requests to both channels, with row hits and conflicts in a few
+	// banks, from two sources
+	std::vector<Trace::Record> records;
+	for (int i = 0; i < 200; i++)
+	{
+		int64_t channel = i % 2;
+		int64_t bank = (i / 2) % 4;
+		int64_t row = (i / 64) % 3;
+		int64_t column = i % 16;
+		int64_t address = (channel << 24) | (bank << 20) |
+				(row << 10) | column;
+		records.push_back({ i * 3, address, i % 5 == 0, i % 2 });
+	}
+	std::string path = WriteTrace(records);
+
+	try
+	{
+		// Same channel results with one and two host threads
+		std::string report_single = RunTrace(path, 1);
+		std::string report_multi = RunTrace(path, 2);
+		size_t pos_single = report_single.find("[ MemoryController");
+		size_t pos_multi = report_multi.find("[ MemoryController");
+		ASSERT_NE(std::string::npos, pos_single);
+		ASSERT_NE(std::string::npos, pos_multi);
+		EXPECT_EQ(report_single.substr(pos_single),
+				report_multi.substr(pos_multi));
+
+		// Summary
+		misc::IniFile report;
+		report.LoadFromString(report_multi);
+		EXPECT_EQ(2, report.ReadInt("Trace", "Threads"));
+		EXPECT_EQ(200, report.ReadInt64("Trace", "Records"));
+		EXPECT_EQ(200, report.ReadInt64("Trace", "Requests"));
+		EXPECT_EQ(40, report.ReadInt64("Trace", "WriteRequests"));
+		EXPECT_GT(report.ReadDouble("Trace", "RowHitRate"), 0.5);
+		EXPECT_LT(report.ReadDouble("Trace", "RowHitRate"), 1.0);
+		EXPECT_GT(report.ReadDouble("Trace", "Bandwidth"), 0.0);
+		EXPECT_LE(report.ReadInt64("Trace", "LatencyP50"),
+				report.ReadInt64("Trace", "LatencyP99"));
+
+		// Each channel served half of the requests, and all channels
+		// end in the same cycle
+		const char *sections[] =
+		{
+			"MemoryController.One.Channel0",
+			"MemoryController.One.Channel1"
+		};
+		for (const char *section : sections)
+		{
+			ASSERT_TRUE(report.Exists(section));
+			EXPECT_EQ(100, report.ReadInt64(section, "Requests"));
+			EXPECT_EQ(report.ReadInt64("Trace", "Cycles"),
+					report.ReadInt64(section, "Cycles"));
+		}
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+	remove(path.c_str());
+}
+
+TEST(TestSystemTrace, trace_invalid)
+{
+	// Missing file
+	EXPECT_THROW(RunTrace("/nonexistent/trace", 1), Error);
+
+	// Truncated record
+	std::string path = WriteTrace({ { 0, 0, 0, 0 } }, 5);
+	EXPECT_THROW(RunTrace(path, 1), Error);
+	remove(path.c_str());
+
+	// Records out of order
+	path = WriteTrace({ { 10, 0, 0, 0 }, { 5, 0, 0, 0 } });
+	EXPECT_THROW(RunTrace(path, 1), Error);
+	remove(path.c_str());
+
+	// Invalid type
+	path = WriteTrace({ { 0, 0, 2, 0 } });
+	EXPECT_THROW(RunTrace(path, 1), Error);
+	remove(path.c_str());
+
+	// Address out of range
+	path = WriteTrace({ { 0, 1LL << 40, 0, 0 } });
+	EXPECT_THROW(RunTrace(path, 1), Error);
+	remove(path.c_str());
+
+	// Source ids out of range, reported with their record
+	path = WriteTrace({ { 0, 0, 0, 0 }, { 0, 0, 0, -1 } });
+	EXPECT_THROW(RunTrace(path, 1), Error);
+	remove(path.c_str());
+	path = WriteTrace({ { 0, 0, 0, 0 },
+			{ 0, 0, 0, Trace::MaxSources } });
+	std::string message;
+	try
+	{
+		RunTrace(path, 1);
+	}
+	catch (Error &e)
+	{
+		message = e.getMessage();
+	}
+	EXPECT_NE(std::string::npos, message.find("record 1: invalid source"));
+	remove(path.c_str());
+
+	// An empty trace runs no requests
+	path = WriteTrace({});
+	misc::IniFile report;
+	report.LoadFromString(RunTrace(path, 2));
+	EXPECT_EQ(0, report.ReadInt64("Trace", "Requests"));
+	remove(path.c_str());
+}
+
+}
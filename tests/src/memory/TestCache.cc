@@ -0,0 +1,73 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+#include <memory/Cache.h>
+
+namespace mem
+{
+
+TEST(TestCache, bdi_size)
+{
+	// Block of zeros
+	char block[64] = { };
+	EXPECT_EQ(1u, Cache::getBDISize(block, sizeof block));
+
+	// Repeated 8-byte value
+	for (unsigned i = 0; i < sizeof block; i++)
+		block[i] = i % 8 + 1;
+	EXPECT_EQ(8u, Cache::getBDISize(block, sizeof block));
+
+	// Pointers close to each other, with 8-byte base and 1-byte deltas
+	long long values[8];
+	for (int i = 0; i < 8; i++)
+		values[i] = 0x7fff12345000ll + i * 16;
+	memcpy(block, values, sizeof block);
+	EXPECT_EQ(8u + 8u + 1u, Cache::getBDISize(block, sizeof block));
+
+	// Random data is not compressible
+	for (unsigned i = 0; i < sizeof block; i++)
+		block[i] = (i * 0x9e3779b1u) >> 13;
+	EXPECT_EQ(64u, Cache::getBDISize(block, sizeof block));
+}
+
+
+TEST(TestCache, fpc_size)
+{
+	// Block of zeros, encoded as two runs of 8 zero words
+	char block[64] = { };
+	EXPECT_EQ(2u, Cache::getFPCSize(block, sizeof block));
+
+	// Small integers, encoded as sign-extended 4-bit values
+	int words[16];
+	for (int i = 0; i < 16; i++)
+		words[i] = i % 8 - 4;
+	memcpy(block, words, sizeof block);
+	EXPECT_EQ(14u, Cache::getFPCSize(block, sizeof block));
+
+	// Random data is not compressible
+	for (unsigned i = 0; i < sizeof block; i++)
+		block[i] = (i * 0x9e3779b1u) >> 13;
+	EXPECT_EQ(64u, Cache::getFPCSize(block, sizeof block));
+}
+
+}  // namespace mem
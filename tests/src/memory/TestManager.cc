@@ -0,0 +1,92 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <memory/Manager.h>
+#include <memory/Memory.h>
+
+namespace mem
+{
+
+TEST(TestManager, segregated_split)
+{
+	Memory memory;
+	Manager manager(&memory, Manager::AllocatorSegregated);
+
+	// First allocation maps a page and splits it down to a 16-byte block
+	unsigned a = manager.Allocate(10, 1);
+	EXPECT_EQ(0u, a % Memory::PageSize);
+	EXPECT_EQ(10u, manager.getAllocatedSize());
+	EXPECT_EQ(Memory::PageSize, manager.getOccupiedSize());
+	EXPECT_TRUE(manager.isValidAddress(a + 9));
+	EXPECT_FALSE(manager.isValidAddress(a + 10));
+
+	// Second allocation takes the buddy of the first block
+	unsigned b = manager.Allocate(16, 1);
+	EXPECT_EQ(a + 16, b);
+
+	// Blocks are aligned to their size
+	unsigned c = manager.Allocate(100, 64);
+	EXPECT_EQ(0u, c % 128);
+	EXPECT_EQ(Memory::PageSize, manager.getOccupiedSize());
+
+	// Internal fragmentation of the 10-byte and 100-byte allocations
+	EXPECT_DOUBLE_EQ(1.0 - 126.0 / 160.0,
+			manager.getInternalFragmentation());
+}
+
+
+TEST(TestManager, segregated_coalesce)
+{
+	Memory memory;
+	Manager manager(&memory, Manager::AllocatorSegregated);
+
+	// Allocate two buddies and free the first
+	unsigned a = manager.Allocate(32, 1);
+	unsigned b = manager.Allocate(32, 1);
+	EXPECT_EQ(a + 32, b);
+	manager.Free(a);
+	EXPECT_FALSE(manager.isValidAddress(a));
+
+	// The freed block is reused
+	EXPECT_EQ(a, manager.Allocate(20, 1));
+	manager.Free(a);
+
+	// Freeing both buddies coalesces the whole page, which is released
+	manager.Free(b);
+	EXPECT_EQ(0u, manager.getOccupiedSize());
+	EXPECT_EQ(nullptr, memory.getPage(a));
+	EXPECT_DOUBLE_EQ(0.0, manager.getExternalFragmentation());
+}
+
+
+TEST(TestManager, segregated_large)
+{
+	Memory memory;
+	Manager manager(&memory, Manager::AllocatorSegregated);
+
+	// Allocations larger than a page use whole pages
+	unsigned a = manager.Allocate(Memory::PageSize + 1, 1);
+	EXPECT_EQ(2 * Memory::PageSize, manager.getOccupiedSize());
+	manager.Free(a);
+	EXPECT_EQ(0u, manager.getOccupiedSize());
+}
+
+}  // namespace mem
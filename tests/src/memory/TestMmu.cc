@@ -0,0 +1,129 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Rafael Ubal (ubal@ece.neu.edu)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <lib/cpp/Error.h>
+#include <memory/Mmu.h>
+
+namespace mem
+{
+
+TEST(TestMmu, policy_sequential)
+{
+	Mmu mmu;
+	Mmu::Space *space = mmu.newSpace();
+
+	// Pages are allocated in first-touch order
+	EXPECT_EQ(0x0u, mmu.TranslateVirtualAddress(space, 0x5000));
+	EXPECT_EQ(0x1004u, mmu.TranslateVirtualAddress(space, 0x1004));
+	EXPECT_EQ(0x8u, mmu.TranslateVirtualAddress(space, 0x5008));
+}
+
+
+TEST(TestMmu, policy_coloring)
+{
+	Mmu mmu;
+	mmu.setPolicy(Mmu::PolicyColoring);
+	mmu.setNumColors(4);
+	Mmu::Space *space = mmu.newSpace();
+
+	// Physical pages keep the color of the virtual page
+	unsigned virtual_addresses[] = { 0x3000, 0x7000, 0x2000, 0x10000 };
+	for (unsigned virtual_address : virtual_addresses)
+	{
+		unsigned physical_address = mmu.TranslateVirtualAddress(space,
+				virtual_address);
+		EXPECT_EQ((virtual_address >> Mmu::LogPageSize) % 4,
+				mmu.getColor(physical_address));
+	}
+
+	// Pages of the same color are allocated in order
+	EXPECT_EQ(0x3000u, mmu.TranslateVirtualAddress(space, 0x3000));
+	EXPECT_EQ(0x7000u, mmu.TranslateVirtualAddress(space, 0x7000));
+}
+
+
+TEST(TestMmu, policy_huge_page)
+{
+	Mmu mmu;
+	mmu.setPolicy(Mmu::PolicyHugePage);
+	Mmu::Space *space1 = mmu.newSpace();
+	Mmu::Space *space2 = mmu.newSpace();
+
+	// Pages in the same 2MB region are contiguous
+	EXPECT_EQ(0x5000u, mmu.TranslateVirtualAddress(space1, 0x405000));
+	EXPECT_EQ(0x1ff000u, mmu.TranslateVirtualAddress(space1, 0x5ff000));
+
+	// A different region or space uses a new huge page
+	EXPECT_EQ(0x200000u, mmu.TranslateVirtualAddress(space2, 0x400000));
+	EXPECT_EQ(0x400010u, mmu.TranslateVirtualAddress(space1, 0x10));
+
+	// Reverse translation
+	Mmu::Space *space;
+	unsigned virtual_address;
+	EXPECT_TRUE(mmu.TranslatePhysicalAddress(0x1ff004, space,
+			virtual_address));
+	EXPECT_EQ(space1, space);
+	EXPECT_EQ(0x5ff004u, virtual_address);
+}
+
+
+TEST(TestMmu, policy_huge_page_exhausted)
+{
+	Mmu mmu;
+	mmu.setPolicy(Mmu::PolicyHugePage);
+	Mmu::Space *space1 = mmu.newSpace();
+	Mmu::Space *space2 = mmu.newSpace();
+
+	// Every 2MB region of the first space takes a huge page, filling
+	// up the whole physical space
+	for (unsigned long long address = 0; address < 1ull << 32;
+			address += Mmu::HugePageSize)
+		mmu.TranslateVirtualAddress(space1, address);
+	EXPECT_EQ(0xffe00000u, mmu.TranslateVirtualAddress(space1,
+			0xffe00000));
+
+	// No huge page is left for another space
+	EXPECT_THROW(mmu.TranslateVirtualAddress(space2, 0), misc::Error);
+}
+
+
+TEST(TestMmu, policy_numa)
+{
+	Mmu mmu;
+	mmu.setPolicy(Mmu::PolicyNuma);
+	mmu.setNumNodes(4);
+	mmu.BindRegion(0x10000000, 0x1fffffff, 3);
+	Mmu::Space *space = mmu.newSpace();
+
+	// Bound region
+	unsigned physical_address = mmu.TranslateVirtualAddress(space,
+			0x10000000);
+	EXPECT_EQ(0xc0000000u, physical_address);
+	EXPECT_EQ(3u, mmu.getNode(physical_address));
+	EXPECT_EQ(0xc0001000u, mmu.TranslateVirtualAddress(space, 0x1fff0000));
+
+	// Unbound pages are interleaved
+	EXPECT_EQ(0x00000000u, mmu.TranslateVirtualAddress(space, 0x0000));
+	EXPECT_EQ(0x40000000u, mmu.TranslateVirtualAddress(space, 0x1000));
+	EXPECT_EQ(0x00001000u, mmu.TranslateVirtualAddress(space, 0x4000));
+}
+
+}  // namespace mem
@@ -19,6 +19,8 @@
 
 #include "gtest/gtest.h"
 
+#include <cstring>
+
 #include <arch/x86/timing/Timing.h>
 #include <arch/common/Arch.h>
 #include <lib/cpp/IniFile.h>
@@ -419,5 +421,57 @@ TEST(TestModule, can_access_2)
 }
 
 
+// This test checks the bank model. Two accesses to the same bank in the same
+// cycle are serialized, while an access to a different bank, or to the data
+// stage of the same bank, can start right away.
+TEST(TestModule, bank_conflicts)
+{
+	try
+	{
+		// Cleanup singleton instances
+		Cleanup();
+
+		// Load configuration file, with 2 banks interleaved at the
+		// granularity of the block size.
+		std::string mem_config = mem_config_1;
+		mem_config.replace(mem_config.find("Ports = 2\n"),
+				strlen("Ports = 2\n"),
+				"Banks = 2\n");
+		misc::IniFile ini_file_mem;
+		misc::IniFile ini_file_x86;
+		ini_file_mem.LoadFromString(mem_config);
+		ini_file_x86.LoadFromString(x86_config_0);
+
+		// Set up x86 timing simulator
+		x86::Timing::ParseConfiguration(&ini_file_x86);
+		x86::Timing::getInstance();
+
+		// Set up memory system
+		System *memory_system = System::getInstance();
+		memory_system->ReadConfiguration(&ini_file_mem);
+
+		// Get module
+		Module *module_l1_0 = memory_system->getModule("mod-l1-0");
+		ASSERT_NE(module_l1_0, nullptr);
+		EXPECT_EQ(2, module_l1_0->getNumBanks());
+		EXPECT_EQ(2, module_l1_0->getNumPorts());
+		EXPECT_EQ(0, module_l1_0->getBankIndex(0x400));
+		EXPECT_EQ(1, module_l1_0->getBankIndex(0x500));
+
+		// Accesses in the same cycle
+		EXPECT_EQ(0, module_l1_0->AccessTagBank(0x400));
+		EXPECT_EQ(1, module_l1_0->AccessTagBank(0x404));
+		EXPECT_EQ(2, module_l1_0->AccessTagBank(0x600));
+		EXPECT_EQ(0, module_l1_0->AccessTagBank(0x500));
+		EXPECT_EQ(0, module_l1_0->AccessDataBank(0x400));
+	}
+	catch (misc::Exception &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
 } // Namespace mem
 
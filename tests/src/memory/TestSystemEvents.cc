@@ -4490,6 +4490,112 @@ TEST(TestSystemEvents, config_0_store_3)
 	}
 }
 
+// l1_0 and l1_1 share address 0 under l2_0, and the store from l1_2
+// invalidates both of them with a single multicast message from l2_0.
+TEST(TestSystemEvents, config_0_store_multicast)
+{
+	try
+	{
+		// Cleanup singleton instances
+		Cleanup();
+
+		// Load configuration files, enabling multicast in net0
+		misc::IniFile ini_file_mem;
+		misc::IniFile ini_file_x86;
+		misc::IniFile ini_file_net;
+		ini_file_mem.LoadFromString(mem_config_0);
+		ini_file_x86.LoadFromString(x86_config);
+		ini_file_net.LoadFromString(net_config);
+		ini_file_net.WriteBool("Network.net0", "Multicast", true);
+
+		// Set up x86 timing simulator
+		x86::Timing::ParseConfiguration(&ini_file_x86);
+		x86::Timing::getInstance();
+
+		// Set up network system
+		net::System *network_system = net::System::getInstance();
+		network_system->ParseConfiguration(&ini_file_net);
+
+		// Set up memory system
+		System *memory_system = System::getInstance();
+		memory_system->ReadConfiguration(&ini_file_mem);
+
+		// Get modules
+		Module *module_l1_0 = memory_system->getModule("mod-l1-0");
+		Module *module_l1_1 = memory_system->getModule("mod-l1-1");
+		Module *module_l1_2 = memory_system->getModule("mod-l1-2");
+		Module *module_l2_0 = memory_system->getModule("mod-l2-0");
+		Module *module_mm = memory_system->getModule("mod-mm");
+		ASSERT_NE(module_l1_0, nullptr);
+		ASSERT_NE(module_l1_1, nullptr);
+		ASSERT_NE(module_l1_2, nullptr);
+		ASSERT_NE(module_l2_0, nullptr);
+		ASSERT_NE(module_mm, nullptr);
+
+		// Set L1 Block States
+		module_l1_0->getCache()->getBlock(0, 1)->setStateTag(
+				Cache::BlockShared, 0x0);
+		module_l1_1->getCache()->getBlock(0, 1)->setStateTag(
+				Cache::BlockShared, 0x0);
+
+		// Set L2 Block States and sharers
+		module_l2_0->getCache()->getBlock(0, 3)->setStateTag(
+				Cache::BlockShared, 0x0);
+		module_l2_0->setSharer(0, 3, 0, module_l1_0);
+		module_l2_0->setSharer(0, 3, 0, module_l1_1);
+
+		// Set MM block states and sharers
+		module_mm->getCache()->getBlock(0, 7)->setStateTag(
+				Cache::BlockExclusive, 0x0);
+		module_mm->setSharer(0, 7, 0, module_l2_0);
+
+		// Accesses
+		int witness = -1;
+		module_l1_2->Access(Module::AccessStore, 0x0, &witness);
+
+		// Simulation loop
+		esim::Engine *esim_engine = esim::Engine::getInstance();
+		while (witness < 0)
+			esim_engine->ProcessEvents();
+
+		// Check blocks in l1_0 and l1_1
+		unsigned tag;
+		Cache::BlockState state;
+		module_l1_0->getCache()->getBlock(0, 1, tag, state);
+		EXPECT_EQ(state, Cache::BlockInvalid);
+		module_l1_1->getCache()->getBlock(0, 1, tag, state);
+		EXPECT_EQ(state, Cache::BlockInvalid);
+
+		// Check block in l1_2
+		module_l1_2->getCache()->getBlock(0, 1, tag, state);
+		EXPECT_EQ(tag, 0x0);
+		EXPECT_EQ(state, Cache::BlockModified);
+
+		// Check L2-0 state and sharers
+		module_l2_0->getCache()->getBlock(0, 3, tag, state);
+		EXPECT_EQ(state, Cache::BlockInvalid);
+		EXPECT_EQ(module_l2_0->getNumSharers(0, 3, 0), 0);
+
+		// Each L1 receives an INV and sends an ACK
+		net::Node *node = module_l1_0->getLowNetworkNode();
+		EXPECT_EQ(node->getReceivedBytes(), 8);
+		EXPECT_EQ(node->getSentBytes(), 8);
+		node = module_l1_1->getLowNetworkNode();
+		EXPECT_EQ(node->getReceivedBytes(), 8);
+		EXPECT_EQ(node->getSentBytes(), 8);
+
+		// L2-0 injects the INV only once for both sharers
+		node = module_l2_0->getHighNetworkNode();
+		EXPECT_EQ(node->getReceivedBytes(), 16);
+		EXPECT_EQ(node->getSentBytes(), 8);
+	}
+	catch (misc::Exception &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
 // l1_0, l2_0, l3_0, and mm have address 0 in E
 // Cycle 1 - l1_0 writes address 0 (block in l1_0 turns M)
 // Cycle 2 - l1_1 reads address 0x200 (conflict in l1_0 and l2_0, but not in l3)
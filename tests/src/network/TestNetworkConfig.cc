@@ -2412,49 +2412,611 @@ TEST(TestSystemConfiguration, thorough_manual_routing)
 		Node *S4 = network->getNodeByName("s4");
 
 		// Checking the table one entry at a time -- N0 to N1
-		RoutingTable::Entry *entry = table->RoutingTable::Lookup(N0, N1);
-		EXPECT_EQ(entry->cost, 3);
-		EXPECT_EQ(entry->getNextNode(), S0);
+		RoutingTable::Entry entry = table->RoutingTable::Lookup(N0, N1);
+		EXPECT_EQ(entry.cost, 3);
+		EXPECT_EQ(entry.getNextNode(), S0);
 		entry = table->RoutingTable::Lookup(S0, N1);
-		EXPECT_EQ(entry->cost, 2);
-		EXPECT_EQ(entry->getNextNode(), S1);
-		Connection *connection = entry->getBuffer()->getConnection();
-		EXPECT_EQ(entry->getBuffer(), connection->getSourceBuffer(0));
+		EXPECT_EQ(entry.cost, 2);
+		EXPECT_EQ(entry.getNextNode(), S1);
+		Connection *connection = entry.getBuffer()->getConnection();
+		EXPECT_EQ(entry.getBuffer(), connection->getSourceBuffer(0));
 		entry = table->RoutingTable::Lookup(S1, N1);
-		EXPECT_EQ(entry->cost, 1);
-		EXPECT_EQ(entry->getNextNode(), N1);
+		EXPECT_EQ(entry.cost, 1);
+		EXPECT_EQ(entry.getNextNode(), N1);
 
 		// Checking the table one entry at a time -- N1 to N4
 		entry = table->RoutingTable::Lookup(N1, N4);
-		EXPECT_EQ(entry->cost, 5);
-		EXPECT_EQ(entry->getNextNode(), S1);
+		EXPECT_EQ(entry.cost, 5);
+		EXPECT_EQ(entry.getNextNode(), S1);
 		entry = table->RoutingTable::Lookup(S1, N4);
-		EXPECT_EQ(entry->cost, 4);
-		EXPECT_EQ(entry->getNextNode(), S2);
-		connection = entry->getBuffer()->getConnection();
-		EXPECT_EQ(entry->getBuffer(), connection->getSourceBuffer(1));
+		EXPECT_EQ(entry.cost, 4);
+		EXPECT_EQ(entry.getNextNode(), S2);
+		connection = entry.getBuffer()->getConnection();
+		EXPECT_EQ(entry.getBuffer(), connection->getSourceBuffer(1));
 		entry = table->RoutingTable::Lookup(S2, N4);
-		EXPECT_EQ(entry->cost, 3);
-		EXPECT_EQ(entry->getNextNode(), S3);
+		EXPECT_EQ(entry.cost, 3);
+		EXPECT_EQ(entry.getNextNode(), S3);
 		entry = table->RoutingTable::Lookup(S3, N4);
-		EXPECT_EQ(entry->cost, 2);
-		EXPECT_EQ(entry->getNextNode(), S4);
+		EXPECT_EQ(entry.cost, 2);
+		EXPECT_EQ(entry.getNextNode(), S4);
 		entry = table->RoutingTable::Lookup(S4, N4);
-		EXPECT_EQ(entry->cost, 1);
-		EXPECT_EQ(entry->getNextNode(), N4);
+		EXPECT_EQ(entry.cost, 1);
+		EXPECT_EQ(entry.getNextNode(), N4);
 
 		// Checking the table on entry at a time -- N3 to N2
 		entry = table->RoutingTable::Lookup(N3, N2);	
-		EXPECT_EQ(entry->cost, 3);
-		EXPECT_EQ(entry->getNextNode(), S3);
+		EXPECT_EQ(entry.cost, 3);
+		EXPECT_EQ(entry.getNextNode(), S3);
 		entry = table->RoutingTable::Lookup(S3, N2);
-		EXPECT_EQ(entry->cost, 2);
-		EXPECT_EQ(entry->getNextNode(), S2);
-		connection = entry->getBuffer()->getConnection();
-		EXPECT_EQ(entry->getBuffer(), connection->getSourceBuffer(0));
+		EXPECT_EQ(entry.cost, 2);
+		EXPECT_EQ(entry.getNextNode(), S2);
+		connection = entry.getBuffer()->getConnection();
+		EXPECT_EQ(entry.getBuffer(), connection->getSourceBuffer(0));
 		entry = table->RoutingTable::Lookup(S2, N2);
-		EXPECT_EQ(entry->cost, 1);
-		EXPECT_EQ(entry->getNextNode(), N2);
+		EXPECT_EQ(entry.cost, 1);
+		EXPECT_EQ(entry.getNextNode(), N2);
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+// Follow the routes between all pairs of end nodes, checking that every hop
+// decreases the cost by one and leads to the destination.
+static void CheckTopologyRoutes(Network *network)
+{
+	RoutingTable *table = network->getRoutingTable();
+	for (int i = 0; i < network->getNumEndNodes(); i++)
+	{
+		for (int j = 0; j < network->getNumEndNodes(); j++)
+		{
+			Node *node = network->getNode(i);
+			Node *destination = network->getNode(j);
+			RoutingTable::Entry entry = table->Lookup(node,
+					destination);
+			int cost = entry.cost;
+			while (node != destination)
+			{
+				entry = table->Lookup(node, destination);
+				ASSERT_EQ(cost, entry.cost);
+				ASSERT_TRUE(entry.getBuffer() != nullptr);
+				ASSERT_EQ(node, entry.getBuffer()->getNode());
+				node = entry.getNextNode();
+				cost--;
+			}
+			EXPECT_EQ(0, cost);
+		}
+	}
+}
+
+
+TEST(TestSystemConfiguration, topology_mesh)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"Topology = Mesh2D\n"
+			"Columns = 3\n"
+			"Rows = 3\n";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set up network instance
+	System *system = System::getInstance();
+	EXPECT_TRUE(system != nullptr);
+
+	// Test body
+	try
+	{
+		system->ParseConfiguration(&ini_file);
+		Network *network = system->getNetworkByName("net0");
+		EXPECT_EQ(9, network->getNumEndNodes());
+		EXPECT_EQ(18, network->getNumNodes());
+		EXPECT_TRUE(network->getRoutingTable()->isAlgorithmic());
+
+		// Dimension-order routing from the corner
+		Node *n0 = network->getNodeByName("n0");
+		Node *n8 = network->getNodeByName("n8");
+		Node *s0 = network->getNodeByName("s0");
+		RoutingTable::Entry entry = network->getRoutingTable()->
+				Lookup(n0, n8);
+		EXPECT_EQ(6, entry.cost);
+		EXPECT_EQ(s0, entry.getNextNode());
+		entry = network->getRoutingTable()->Lookup(s0, n8);
+		EXPECT_EQ(network->getNodeByName("s1"), entry.getNextNode());
+
+		// All routes
+		CheckTopologyRoutes(network);
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+TEST(TestSystemConfiguration, topology_all)
+{
+	// Topologies and their parameters
+	std::string topologies[] =
+	{
+		"Topology = Torus2D\nColumns = 4\nRows = 3\n"
+				"Concentration = 2\n",
+		"Topology = Ring\nSwitches = 5\n",
+		"Topology = FatTree\nRadix = 2\nLevels = 3\n",
+		"Topology = Dragonfly\nGroupSize = 2\nGlobalLinks = 2\n"
+				"Concentration = 2\n"
+	};
+	int num_end_nodes[] = { 24, 5, 8, 20 };
+
+	for (int i = 0; i < 4; i++)
+	{
+		// Cleanup singleton instance
+		Cleanup();
+
+		// Setup configuration file
+		std::string config =
+				"[ Network.net0 ]\n"
+				"DefaultInputBufferSize = 4\n"
+				"DefaultOutputBufferSize = 4\n"
+				"DefaultBandwidth = 1\n" +
+				topologies[i];
+
+		// Set up INI file
+		misc::IniFile ini_file;
+		ini_file.LoadFromString(config);
+
+		// Test body
+		try
+		{
+			System *system = System::getInstance();
+			system->ParseConfiguration(&ini_file);
+			Network *network = system->getNetworkByName("net0");
+			EXPECT_EQ(num_end_nodes[i], network->getNumEndNodes());
+			CheckTopologyRoutes(network);
+		}
+		catch (misc::Error &e)
+		{
+			e.Dump();
+			FAIL();
+		}
+	}
+}
+
+
+TEST(TestSystemConfiguration, topology_with_nodes)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"Topology = Ring\n"
+			"Switches = 4\n"
+			"[Network.net0.Node.N0]\n"
+			"Type = EndNode\n";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set up network instance
+	System *system = System::getInstance();
+	EXPECT_TRUE(system != nullptr);
+
+	// Test body
+	std::string message;
+	try
+	{
+		system->ParseConfiguration(&ini_file);
+	}
+	catch (misc::Error &error)
+	{
+		message = error.getMessage();
+	}
+	EXPECT_REGEX_MATCH(misc::fmt(".*%s: Network net0: nodes, links, and "
+			"buses cannot be added to a network with a generated "
+			"topology.\n.*",
+			ini_file.getPath().c_str()).c_str(),
+			message.c_str());
+}
+
+
+static void CheckAdaptiveRoutes(Network *network)
+{
+	RoutingTable *table = network->getRoutingTable();
+	for (int i = 0; i < network->getNumEndNodes(); i++)
+	{
+		for (int j = 0; j < network->getNumEndNodes(); j++)
+		{
+			// Adaptive routes must be minimal
+			Node *node = network->getNode(i);
+			Node *destination = network->getNode(j);
+			int cost = table->Lookup(node, destination).cost;
+			Buffer *input_buffer = nullptr;
+			while (node != destination)
+			{
+				Buffer *buffer = table->Route(node, destination,
+						input_buffer);
+				ASSERT_TRUE(buffer != nullptr);
+				ASSERT_EQ(node, buffer->getNode());
+				Link *link = misc::cast<Link *>(
+						buffer->getConnection());
+				input_buffer = link->
+						getDestinationBufferfromSource(
+						buffer);
+				node = link->getDestinationNode();
+				cost--;
+			}
+			EXPECT_EQ(0, cost);
+		}
+	}
+}
+
+
+TEST(TestSystemConfiguration, topology_adaptive)
+{
+	// Topologies and routing algorithms
+	std::string topologies[] =
+	{
+		"Topology = Mesh2D\nColumns = 4\nRows = 4\n"
+				"Routing = WestFirst\n",
+		"Topology = Mesh2D\nColumns = 4\nRows = 4\n"
+				"Routing = OddEven\n",
+		"Topology = Mesh2D\nColumns = 4\nRows = 3\n"
+				"Routing = MinimalAdaptive\nVC = 2\n",
+		"Topology = Torus2D\nColumns = 4\nRows = 5\n"
+				"Routing = MinimalAdaptive\nVC = 3\n",
+		"Topology = Ring\nSwitches = 5\nConcentration = 2\n"
+				"Routing = MinimalAdaptive\nVC = 3\n"
+	};
+
+	for (auto &topology : topologies)
+	{
+		// Cleanup singleton instance
+		Cleanup();
+
+		// Setup configuration file
+		std::string config =
+				"[ Network.net0 ]\n"
+				"DefaultInputBufferSize = 4\n"
+				"DefaultOutputBufferSize = 4\n"
+				"DefaultBandwidth = 1\n" +
+				topology;
+
+		// Set up INI file
+		misc::IniFile ini_file;
+		ini_file.LoadFromString(config);
+
+		// Test body
+		try
+		{
+			System *system = System::getInstance();
+			system->ParseConfiguration(&ini_file);
+			Network *network = system->getNetworkByName("net0");
+			EXPECT_TRUE(network->getRoutingTable()->isAdaptive());
+			EXPECT_FALSE(network->getTopology()->hasCycle());
+			CheckAdaptiveRoutes(network);
+		}
+		catch (misc::Error &e)
+		{
+			e.Dump();
+			FAIL();
+		}
+	}
+}
+
+
+TEST(TestSystemConfiguration, topology_adaptive_cycle)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"Topology = Mesh2D\n"
+			"Columns = 3\n"
+			"Rows = 3\n";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Test body
+	try
+	{
+		System *system = System::getInstance();
+		system->ParseConfiguration(&ini_file);
+		Network *network = system->getNetworkByName("net0");
+		RoutingTable *table = network->getRoutingTable();
+
+		// Dimension-order routes have no cycles
+		EXPECT_FALSE(table->hasCycle());
+
+		// Fully adaptive minimal routes without escape channels do
+		EXPECT_TRUE(table->hasCycle([table](Node *node,
+				Node *destination, Buffer *input_buffer,
+				std::vector<RoutingTable::Entry> &entries)
+				{
+					int cost = table->Lookup(node,
+							destination).cost;
+					for (int i = 0; i < node->
+							getNumOutputBuffers(); i++)
+					{
+						Buffer *buffer = node->
+								getOutputBuffer(i);
+						Link *link = misc::cast<Link *>(
+								buffer->
+								getConnection());
+						Node *next = link->
+								getDestinationNode();
+						if (table->Lookup(next, destination)
+								.cost == cost - 1)
+							entries.emplace_back(cost,
+									next, buffer);
+					}
+				}));
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+TEST(TestSystemConfiguration, topology_adaptive_invalid)
+{
+	// Invalid combinations and their errors
+	std::string topologies[] =
+	{
+		"Topology = Torus2D\nColumns = 3\nRows = 3\n"
+				"Routing = WestFirst\n",
+		"Topology = Mesh2D\nColumns = 3\nRows = 3\n"
+				"Routing = MinimalAdaptive\n"
+	};
+	std::string errors[] =
+	{
+		"routing WestFirst is only supported in topology Mesh2D",
+		"routing MinimalAdaptive needs at least 2 virtual channels "
+				"in topology Mesh2D"
+	};
+
+	for (int i = 0; i < 2; i++)
+	{
+		// Cleanup singleton instance
+		Cleanup();
+
+		// Setup configuration file
+		std::string config =
+				"[ Network.net0 ]\n"
+				"DefaultInputBufferSize = 4\n"
+				"DefaultOutputBufferSize = 4\n"
+				"DefaultBandwidth = 1\n" +
+				topologies[i];
+
+		// Set up INI file
+		misc::IniFile ini_file;
+		ini_file.LoadFromString(config);
+
+		// Test body
+		std::string message;
+		try
+		{
+			System *system = System::getInstance();
+			system->ParseConfiguration(&ini_file);
+		}
+		catch (misc::Error &error)
+		{
+			message = error.getMessage();
+		}
+		EXPECT_REGEX_MATCH(misc::fmt(".*%s: Network net0: %s.\n.*",
+				ini_file.getPath().c_str(),
+				errors[i].c_str()).c_str(),
+				message.c_str());
+	}
+}
+
+
+TEST(TestSystemConfiguration, multicast_invalid)
+{
+	// Invalid combinations and their errors
+	std::string options[] =
+	{
+		"FlitSize = 4\nTopology = Mesh2D\nColumns = 3\nRows = 3\n",
+		"Topology = Mesh2D\nColumns = 3\nRows = 3\nVC = 2\n"
+				"Routing = MinimalAdaptive\n"
+	};
+	std::string errors[] =
+	{
+		"variables Multicast and FlitSize cannot be set at the same "
+				"time",
+		"multicast messages are not supported with adaptive routing"
+	};
+
+	for (int i = 0; i < 2; i++)
+	{
+		// Cleanup singleton instance
+		Cleanup();
+
+		// Setup configuration file
+		std::string config =
+				"[ Network.net0 ]\n"
+				"DefaultInputBufferSize = 4\n"
+				"DefaultOutputBufferSize = 4\n"
+				"DefaultBandwidth = 1\n"
+				"Multicast = True\n" +
+				options[i];
+
+		// Set up INI file
+		misc::IniFile ini_file;
+		ini_file.LoadFromString(config);
+
+		// Test body
+		std::string message;
+		try
+		{
+			System *system = System::getInstance();
+			system->ParseConfiguration(&ini_file);
+		}
+		catch (misc::Error &error)
+		{
+			message = error.getMessage();
+		}
+		EXPECT_REGEX_MATCH(misc::fmt(".*%s: Network net0: %s.\n.*",
+				ini_file.getPath().c_str(),
+				errors[i].c_str()).c_str(),
+				message.c_str());
+	}
+}
+
+
+TEST(TestSystemConfiguration, routes_shortest_paths)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// A chain of switches s0-s1-s2-s3 with a shortcut between s0 and s3.
+	// Node N4 can only send to s2, so it cannot be reached.
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"\n"
+			"[ Network.net0.Node.N0 ]\n"
+			"Type = EndNode\n"
+			"\n"
+			"[ Network.net0.Node.N3 ]\n"
+			"Type = EndNode\n"
+			"\n"
+			"[ Network.net0.Node.N4 ]\n"
+			"Type = EndNode\n"
+			"\n"
+			"[ Network.net0.Node.s0 ]\n"
+			"Type = Switch\n"
+			"\n"
+			"[ Network.net0.Node.s1 ]\n"
+			"Type = Switch\n"
+			"\n"
+			"[ Network.net0.Node.s2 ]\n"
+			"Type = Switch\n"
+			"\n"
+			"[ Network.net0.Node.s3 ]\n"
+			"Type = Switch\n"
+			"\n"
+			"[ Network.net0.Link.N0-s0 ]\n"
+			"Type = Bidirectional\n"
+			"Source = N0\n"
+			"Dest = s0\n"
+			"\n"
+			"[ Network.net0.Link.N3-s3 ]\n"
+			"Type = Bidirectional\n"
+			"Source = N3\n"
+			"Dest = s3\n"
+			"\n"
+			"[ Network.net0.Link.s0-s1 ]\n"
+			"Type = Bidirectional\n"
+			"Source = s0\n"
+			"Dest = s1\n"
+			"\n"
+			"[ Network.net0.Link.s1-s2 ]\n"
+			"Type = Bidirectional\n"
+			"Source = s1\n"
+			"Dest = s2\n"
+			"\n"
+			"[ Network.net0.Link.s2-s3 ]\n"
+			"Type = Bidirectional\n"
+			"Source = s2\n"
+			"Dest = s3\n"
+			"\n"
+			"[ Network.net0.Link.s0-s3 ]\n"
+			"Type = Bidirectional\n"
+			"Source = s0\n"
+			"Dest = s3\n"
+			"\n"
+			"[ Network.net0.Link.N4-s2 ]\n"
+			"Type = Unidirectional\n"
+			"Source = N4\n"
+			"Dest = s2\n";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set up network instance
+	System *system = System::getInstance();
+	EXPECT_TRUE(system != nullptr);
+
+	// Test body
+	try
+	{
+		// Parse the configuration file
+		system->ParseConfiguration(&ini_file);
+		Network *network = system->getNetworkByName("net0");
+		RoutingTable *table = network->getRoutingTable();
+		Node *N0 = network->getNodeByName("N0");
+		Node *N3 = network->getNodeByName("N3");
+		Node *N4 = network->getNodeByName("N4");
+		Node *s0 = network->getNodeByName("s0");
+		Node *s1 = network->getNodeByName("s1");
+		Node *s2 = network->getNodeByName("s2");
+		Node *s3 = network->getNodeByName("s3");
+
+		// Routes take the shortcut
+		RoutingTable::Entry entry = table->Lookup(N0, N3);
+		EXPECT_EQ(3, entry.cost);
+		EXPECT_EQ(s0, entry.getNextNode());
+		entry = table->Lookup(s0, N3);
+		EXPECT_EQ(2, entry.cost);
+		EXPECT_EQ(s3, entry.getNextNode());
+		EXPECT_EQ(s0, entry.getBuffer()->getNode());
+		entry = table->Lookup(s3, N0);
+		EXPECT_EQ(2, entry.cost);
+		EXPECT_EQ(s0, entry.getNextNode());
+
+		// Among equally short routes, the first output buffer is used
+		entry = table->Lookup(s1, N3);
+		EXPECT_EQ(3, entry.cost);
+		EXPECT_EQ(s0, entry.getNextNode());
+
+		// Routes from the node that cannot be reached
+		entry = table->Lookup(N4, N3);
+		EXPECT_EQ(3, entry.cost);
+		EXPECT_EQ(s2, entry.getNextNode());
+		entry = table->Lookup(N4, N0);
+		EXPECT_EQ(4, entry.cost);
+		EXPECT_EQ(s2, entry.getNextNode());
+
+		// No route to the node that cannot be reached
+		entry = table->Lookup(N0, N4);
+		EXPECT_EQ(nullptr, entry.getNextNode());
+		EXPECT_EQ(nullptr, entry.getBuffer());
+		entry = table->Lookup(s1, N4);
+		EXPECT_EQ(nullptr, entry.getNextNode());
+		EXPECT_EQ(nullptr, entry.getBuffer());
+		EXPECT_FALSE(network->CanSend(misc::cast<EndNode *>(N0),
+				misc::cast<EndNode *>(N4), 4));
 	}
 	catch (misc::Error &e)
 	{
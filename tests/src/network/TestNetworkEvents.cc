@@ -21,6 +21,7 @@
 
 #include <string>
 #include <regex>
+#include <sstream>
 #include <exception>
 #include <network/EndNode.h>
 #include <network/Message.h>
@@ -1884,4 +1885,403 @@ TEST(TestSystemConfiguration, event_config_13_ideal_fix_latency)
 	}
 }
 
+TEST(TestSystemConfiguration, event_config_14_flit_level_wormhole)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"FlitSize = 1\n"
+			"SwitchAllocator = iSLIP\n"
+			"[Network.net0.Node.n0]\n"
+			"Type = EndNode\n"
+			"[Network.net0.Node.n1]\n"
+			"Type = EndNode\n"
+			"[Network.net0.Node.n2]\n"
+			"Type = EndNode\n"
+			"[Network.net0.Node.s0]\n"
+			"Type = Switch\n"
+			"[Network.net0.Link.n0-s0]\n"
+			"Type = Unidirectional\n"
+			"Source = n0\n"
+			"Dest = s0\n"
+			"[Network.net0.Link.n1-s0]\n"
+			"Type = Unidirectional\n"
+			"Source = n1\n"
+			"Dest = s0\n"
+			"[Network.net0.Link.s0-n2]\n"
+			"Type = Unidirectional\n"
+			"Source = s0\n"
+			"Dest = n2";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set up network instance
+	System *system = System::getInstance();
+	EXPECT_TRUE(system != nullptr);
+
+	// Test body
+	try
+	{
+		// Parse the configuration file
+		system->ParseConfiguration(&ini_file);
+
+		// Getting the network
+		Network *network = system->getNetworkByName("net0");
+		EXPECT_TRUE(network->isFlitLevel());
+
+		// Getting the nodes
+		EndNode *n0 = misc::cast<EndNode *>(network->getNodeByName("n0"));
+		EndNode *n1 = misc::cast<EndNode *>(network->getNodeByName("n1"));
+		EndNode *n2 = misc::cast<EndNode *>(network->getNodeByName("n2"));
+		Node *s0 = network->getNodeByName("s0");
+
+		// Two messages of 4 flits compete for the link to n2
+		Message *msg_1 = network->Send(n0, n2, 4);
+		Message *msg_2 = network->Send(n1, n2, 4);
+		EXPECT_EQ(msg_1->getNumPackets(), 4);
+		EXPECT_EQ(msg_2->getNumPackets(), 4);
+
+		// Simulation loop. The virtual channel towards n2 must be held
+		// by each message without interleaving with the other one.
+		esim::Engine *esim_engine = esim::Engine::getInstance();
+		Buffer *output_buffer = s0->getOutputBuffer(0);
+		std::vector<Message *> owners;
+		for (int i = 0; i < 100 && network->getTransfers() < 2; i++)
+		{
+			esim_engine->ProcessEvents();
+			Message *owner = output_buffer->getOwner();
+			if (owner && (owners.empty() || owners.back() != owner))
+				owners.push_back(owner);
+		}
+		EXPECT_EQ(network->getTransfers(), 2);
+		ASSERT_EQ(owners.size(), 2u);
+		EXPECT_NE(owners[0], owners[1]);
+
+		// All credits must have returned to the output buffers
+		for (int i = 0; i < 4; i++)
+			esim_engine->ProcessEvents();
+		for (int i = 0; i < network->getNumConnections(); i++)
+		{
+			Connection *connection = network->getConnection(i);
+			Buffer *buffer = connection->getSourceBuffer(0);
+			EXPECT_EQ(buffer->getCredits(), 4);
+		}
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+TEST(TestSystemConfiguration, event_config_15_analytical)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 8\n"
+			"DefaultOutputBufferSize = 8\n"
+			"DefaultBandwidth = 1\n"
+			"Analytical = True\n"
+			"AnalyticalWindow = 100\n"
+			"[Network.net0.Node.n0]\n"
+			"Type = EndNode\n"
+			"[Network.net0.Node.n1]\n"
+			"Type = EndNode\n"
+			"[Network.net0.Node.s0]\n"
+			"Type = Switch\n"
+			"[Network.net0.Link.n0-s0]\n"
+			"Type = Unidirectional\n"
+			"Source = n0\n"
+			"Dest = s0\n"
+			"[Network.net0.Link.s0-n1]\n"
+			"Type = Unidirectional\n"
+			"Source = s0\n"
+			"Dest = n1";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set up network instance
+	System *system = System::getInstance();
+	EXPECT_TRUE(system != nullptr);
+
+	// Test body
+	try
+	{
+		// Parse the configuration file
+		system->ParseConfiguration(&ini_file);
+		Network *network = system->getNetworkByName("net0");
+		EXPECT_TRUE(network->isAnalytical());
+
+		// Getting the nodes
+		EndNode *n0 = misc::cast<EndNode *>(network->getNodeByName("n0"));
+		EndNode *n1 = misc::cast<EndNode *>(network->getNodeByName("n1"));
+
+		// An idle network delivers the message after inserting it in
+		// the output buffer, two link transfers, and the crossbar.
+		esim::Engine *esim_engine = esim::Engine::getInstance();
+		Message *message = network->Send(n0, n1, 4);
+		EXPECT_EQ(1, message->getNumPackets());
+		while (network->getTransfers() < 1)
+			esim_engine->ProcessEvents();
+		EXPECT_EQ(13, network->getAccumulatedLatency());
+
+		// A message every 5 cycles loads the links by 80%, so the
+		// latency grows with the queueing delay.
+		for (int i = 0; i < 40; i++)
+		{
+			network->Send(n0, n1, 4);
+			for (int j = 0; j < 5; j++)
+				esim_engine->ProcessEvents();
+		}
+		while (network->getNumMessagesInFlight())
+			esim_engine->ProcessEvents();
+		EXPECT_EQ(41, network->getTransfers());
+		EXPECT_GT(network->getAccumulatedLatency(), 41 * 13);
+		EXPECT_GT(Network::getPercentile(network->getLatencyHistogram(),
+				1.0), 20);
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+TEST(TestSystemConfiguration, event_config_16_energy_heatmap)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"BufferWriteEnergy = 1\n"
+			"BufferReadEnergy = 1\n"
+			"CrossbarEnergy = 1\n"
+			"LinkEnergy = 1\n"
+			"Topology = Mesh2D\n"
+			"Columns = 2\n"
+			"Rows = 1\n";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set up network instance
+	System *system = System::getInstance();
+	EXPECT_TRUE(system != nullptr);
+
+	// Test body
+	try
+	{
+		// Parse the configuration file
+		system->ParseConfiguration(&ini_file);
+		Network *network = system->getNetworkByName("net0");
+		EndNode *n0 = misc::cast<EndNode *>(network->getNodeByName("n0"));
+		EndNode *n1 = misc::cast<EndNode *>(network->getNodeByName("n1"));
+		Node *s1 = network->getNodeByName("s1");
+
+		// Send a message through both switches
+		esim::Engine *esim_engine = esim::Engine::getInstance();
+		network->Send(n0, n1, 4);
+		while (network->getTransfers() < 1)
+			esim_engine->ProcessEvents();
+
+		// Switch s1 writes and reads 4 bytes in its input and output
+		// buffers, and passes them through its crossbar.
+		EXPECT_DOUBLE_EQ(20.0, network->getNodeEnergy(s1));
+
+		// The message traverses three links, and six buffers
+		std::ostringstream report;
+		network->DumpReport(report);
+		EXPECT_NE(std::string::npos, report.str().find(
+				"\nDynamicEnergy = 68.00\n"));
+
+		// Heatmap keyed by mesh coordinates
+		std::ostringstream heatmap;
+		Network::DumpHeatmapHeader(heatmap);
+		network->DumpHeatmap(heatmap, system->getCycle());
+		std::regex link_row(misc::fmt("%lld,net0,Link,link_s0_s1,"
+				"0,0,1,0,[0-9.]+,[0-9.]+,4.00",
+				system->getCycle()));
+		std::regex switch_row(misc::fmt("%lld,net0,Switch,s1,"
+				"1,0,1,0,[0-9.]+,[0-9.]+,20.00",
+				system->getCycle()));
+		EXPECT_TRUE(std::regex_search(heatmap.str(), link_row));
+		EXPECT_TRUE(std::regex_search(heatmap.str(), switch_row));
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+
+// Return the total number of bytes transferred by the links of a network
+static long long getLinkBytes(Network *network)
+{
+	long long bytes = 0;
+	for (int i = 0; i < network->getNumConnections(); i++)
+	{
+		Link *link = dynamic_cast<Link *>(network->getConnection(i));
+		if (link)
+			bytes += link->getTransferredBytes();
+	}
+	return bytes;
+}
+
+
+TEST(TestSystemConfiguration, event_config_17_multicast)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"Multicast = True\n"
+			"Topology = Mesh2D\n"
+			"Columns = 4\n"
+			"Rows = 4\n";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set up network instance
+	System *system = System::getInstance();
+	EXPECT_TRUE(system != nullptr);
+
+	// Test body
+	try
+	{
+		// Parse the configuration file
+		system->ParseConfiguration(&ini_file);
+		Network *network = system->getNetworkByName("net0");
+		EXPECT_TRUE(network->hasMulticast());
+		EndNode *n0 = misc::cast<EndNode *>(network->getNodeByName("n0"));
+		std::vector<EndNode *> destination_nodes = {
+			misc::cast<EndNode *>(network->getNodeByName("n3")),
+			misc::cast<EndNode *>(network->getNodeByName("n12")),
+			misc::cast<EndNode *>(network->getNodeByName("n15"))
+		};
+
+		// Invalid destinations
+		EXPECT_THROW(network->SendMulticast(n0, { n0 }, 4),
+				misc::Panic);
+		EXPECT_THROW(network->SendMulticast(n0, { }, 4),
+				misc::Panic);
+
+		// A multicast message to three corners of the mesh leaves the
+		// source node once, and is delivered to every destination.
+		esim::Engine *esim_engine = esim::Engine::getInstance();
+		ASSERT_TRUE(network->CanSendMulticast(n0, destination_nodes, 4));
+		network->SendMulticast(n0, destination_nodes, 4);
+		while (network->getNumMessagesInFlight())
+			esim_engine->ProcessEvents();
+		EXPECT_EQ(3, network->getTransfers());
+		EXPECT_EQ(4, n0->getSentBytes());
+		for (EndNode *node : destination_nodes)
+			EXPECT_EQ(4, node->getReceivedBytes());
+
+		// Links shared by the routes carry a single copy, compared to
+		// one message per destination.
+		long long multicast_bytes = getLinkBytes(network);
+		for (EndNode *node : destination_nodes)
+		{
+			while (!network->CanSend(n0, node, 4))
+				esim_engine->ProcessEvents();
+			network->Send(n0, node, 4);
+		}
+		while (network->getNumMessagesInFlight())
+			esim_engine->ProcessEvents();
+		long long unicast_bytes = getLinkBytes(network) -
+				multicast_bytes;
+		EXPECT_EQ(6, network->getTransfers());
+		EXPECT_EQ(52, multicast_bytes);
+		EXPECT_EQ(72, unicast_bytes);
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+TEST(TestSystemConfiguration, event_config_18_multicast_packets)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 6\n"
+			"DefaultOutputBufferSize = 6\n"
+			"DefaultBandwidth = 1\n"
+			"DefaultPacketSize = 4\n"
+			"FixLatency = 10\n"
+			"Multicast = True\n"
+			"Topology = Mesh2D\n"
+			"Columns = 2\n"
+			"Rows = 2\n";
+
+	// Set up INI file
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+
+	// Set up network instance
+	System *system = System::getInstance();
+	EXPECT_TRUE(system != nullptr);
+
+	// Test body
+	try
+	{
+		// Parse the configuration file
+		system->ParseConfiguration(&ini_file);
+		Network *network = system->getNetworkByName("net0");
+		EndNode *n0 = misc::cast<EndNode *>(network->getNodeByName("n0"));
+		EndNode *n1 = misc::cast<EndNode *>(network->getNodeByName("n1"));
+		EndNode *n2 = misc::cast<EndNode *>(network->getNodeByName("n2"));
+
+		// With a fixed latency, every destination receives its own
+		// copy from the output buffer of the source node. A 3-byte
+		// copy takes a whole 4-byte packet, so two copies never fit
+		// in the buffer.
+		EXPECT_TRUE(network->CanSend(n0, n1, 3));
+		EXPECT_THROW(network->CanSendMulticast(n0, { n1, n2 }, 3),
+				misc::Error);
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
 }
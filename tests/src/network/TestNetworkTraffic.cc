@@ -0,0 +1,238 @@
+/*
+ *  Multi2Sim
+ *  Copyright (C) 2015  Amir Kavyan Ziabari (ziabari@gmail.com)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+#include <network/EndNode.h>
+#include <network/Network.h>
+#include <network/System.h>
+#include <network/Traffic.h>
+#include <lib/cpp/IniFile.h>
+#include <lib/cpp/Error.h>
+#include <lib/esim/Engine.h>
+
+namespace net
+{
+
+static void Cleanup()
+{
+	esim::Engine::Destroy();
+
+	System::Destroy();
+}
+
+
+// Create a network 'net0' with a 4x4 mesh topology
+static Network *CreateMesh(System *system)
+{
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"Topology = Mesh2D\n"
+			"Columns = 4\n"
+			"Rows = 4\n";
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+	system->ParseConfiguration(&ini_file);
+	return system->getNetworkByName("net0");
+}
+
+
+TEST(TestTraffic, traffic_permutations)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Test body
+	try
+	{
+		System *system = System::getInstance();
+		Network *network = CreateMesh(system);
+
+		// Transpose
+		Traffic transpose(network, Traffic::PatternTranspose);
+		EXPECT_EQ(16, transpose.getNumEndNodes());
+		EXPECT_EQ(network->getNodeByName("n4"),
+				transpose.getDestination(1));
+		EXPECT_EQ(network->getNodeByName("n13"),
+				transpose.getDestination(7));
+		EXPECT_EQ(nullptr, transpose.getDestination(5));
+
+		// Bit complement
+		Traffic complement(network, Traffic::PatternBitComplement);
+		EXPECT_EQ(network->getNodeByName("n14"),
+				complement.getDestination(1));
+		EXPECT_EQ(network->getNodeByName("n0"),
+				complement.getDestination(15));
+
+		// Bit reverse
+		Traffic reverse(network, Traffic::PatternBitReverse);
+		EXPECT_EQ(network->getNodeByName("n8"),
+				reverse.getDestination(1));
+		EXPECT_EQ(network->getNodeByName("n11"),
+				reverse.getDestination(13));
+		EXPECT_EQ(nullptr, reverse.getDestination(6));
+
+		// Neighbor
+		Traffic neighbor(network, Traffic::PatternNeighbor);
+		EXPECT_EQ(network->getNodeByName("n3"),
+				neighbor.getDestination(2));
+		EXPECT_EQ(network->getNodeByName("n0"),
+				neighbor.getDestination(15));
+
+		// Hotspot receiving all messages
+		Traffic hotspot(network, Traffic::PatternHotspot);
+		EndNode *n9 = misc::cast<EndNode *>(
+				network->getNodeByName("n9"));
+		hotspot.setHotspot(n9, 1.0);
+		for (int i = 0; i < 16; i++)
+			if (i != 9)
+			{
+				EXPECT_EQ(n9, hotspot.getDestination(i));
+			}
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+TEST(TestTraffic, traffic_invalid_size)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Setup configuration file
+	std::string config =
+			"[ Network.net0 ]\n"
+			"DefaultInputBufferSize = 4\n"
+			"DefaultOutputBufferSize = 4\n"
+			"DefaultBandwidth = 1\n"
+			"Topology = Ring\n"
+			"Switches = 6\n";
+	misc::IniFile ini_file;
+	ini_file.LoadFromString(config);
+	System *system = System::getInstance();
+	system->ParseConfiguration(&ini_file);
+	Network *network = system->getNetworkByName("net0");
+
+	// Six end nodes are neither a square nor a power of two
+	EXPECT_THROW(Traffic(network, Traffic::PatternTranspose), Error);
+	EXPECT_THROW(Traffic(network, Traffic::PatternBitComplement), Error);
+	EXPECT_THROW(Traffic(network, Traffic::PatternBitReverse), Error);
+	EXPECT_NO_THROW(Traffic(network, Traffic::PatternNeighbor));
+}
+
+
+TEST(TestTraffic, traffic_trace)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Test body
+	try
+	{
+		System *system = System::getInstance();
+		Network *network = CreateMesh(system);
+
+		// Records out of order, and a burst from the same source
+		Traffic traffic(network, Traffic::PatternTrace);
+		traffic.AddTraceRecord({ 20, 0, 15, 4 });
+		traffic.AddTraceRecord({ 5, 3, 12, 1 });
+		for (int i = 0; i < 10; i++)
+			traffic.AddTraceRecord({ 10, 0, 5, 4 });
+		EXPECT_FALSE(traffic.isTraceDone());
+
+		// Invalid records
+		EXPECT_THROW(traffic.AddTraceRecord({ 0, 0, 16, 1 }), Error);
+		EXPECT_THROW(traffic.AddTraceRecord({ 0, 2, 2, 1 }), Error);
+
+		// All messages are delivered, none dropped, and the simulation
+		// ends before the maximum cycle.
+		system->TrafficSimulation(network, &traffic, 100000);
+		EXPECT_TRUE(traffic.isTraceDone());
+		EXPECT_EQ(12, traffic.getNumOffered());
+		EXPECT_EQ(0, traffic.getNumDropped());
+		EXPECT_EQ(12, network->getTransfers());
+		EXPECT_LT(system->getCycle(), 100000);
+		EXPECT_LE(Network::getPercentile(
+				network->getLatencyHistogram(), 0.5),
+				Network::getPercentile(
+				network->getLatencyHistogram(), 1.0));
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+
+TEST(TestTraffic, traffic_benchmark)
+{
+	// Cleanup singleton instance
+	Cleanup();
+
+	// Test body
+	try
+	{
+		// Run a short benchmark and parse its report
+		System *system = System::getInstance();
+		std::ostringstream os;
+		system->Benchmark(os, 200);
+		misc::IniFile report;
+		report.LoadFromString(os.str());
+
+		// Header
+		EXPECT_EQ(1, report.ReadInt("General", "Version"));
+		EXPECT_EQ(200, report.ReadInt64("General", "Cycles"));
+
+		// One section per topology, all delivering messages
+		const char *sections[] =
+		{
+			"Benchmark.mesh-8x8",
+			"Benchmark.mesh-16x16",
+			"Benchmark.fat-tree-4x3"
+		};
+		for (const char *section : sections)
+		{
+			ASSERT_TRUE(report.Exists(section));
+			EXPECT_GT(report.ReadInt64(section, "Messages"), 0);
+			EXPECT_GE(report.ReadInt64(section, "Packets"),
+					report.ReadInt64(section, "Messages"));
+			EXPECT_GT(report.ReadDouble(section, "CyclesPerSecond"), 0);
+			EXPECT_GT(report.ReadInt64(section, "PeakRSS"), 0);
+		}
+		EXPECT_EQ(256, report.ReadInt("Benchmark.mesh-16x16", "EndNodes"));
+		EXPECT_EQ(64, report.ReadInt("Benchmark.fat-tree-4x3", "EndNodes"));
+	}
+	catch (misc::Error &e)
+	{
+		e.Dump();
+		FAIL();
+	}
+}
+
+}